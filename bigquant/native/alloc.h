@@ -16,31 +16,195 @@
 
 #ifndef ALLOC_H
 #define ALLOC_H
+#include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#include "bigquant.h"
 
-void aligned_malloc(void** p, size_t alignment, size_t size) {
-  *p = NULL;
-#if defined(_MSC_VER)
-  *p = _aligned_malloc(size, alignment);
-  if (*p == NULL) {
-    fprintf(stderr, "Failed to Allocate Memory.\n");
-    exit(-1);
+#define HUGE_PAGE_SIZE (static_cast<size_t>(2) << 20)
+// Smallest block an arena reserves at a time.
+#define ARENA_CHUNK_SIZE (static_cast<size_t>(64) << 20)
+
+struct AllocationCounters {
+  AllocationCounters() : live_bytes_(0), peak_bytes_(0), allocations_(0), live_allocations_(0) {
   }
-#elif defined(__MINGW32__)
-  *p = __mingw_aligned_malloc(size, alignment);
-  if (*p == NULL) {
-    fprintf(stderr, "Failed to Allocate Memory.\n");
-    exit(-1);
+
+  void Add(size_t size) {
+    live_bytes_ += size;
+    peak_bytes_ = std::max(peak_bytes_, live_bytes_);
+    ++allocations_;
+    ++live_allocations_;
+  }
+
+  void Remove(size_t size) {
+    live_bytes_ -= size;
+    --live_allocations_;
   }
+
+  void Read(QuantizedAllocatorStats *stats) const {
+    stats->live_bytes = live_bytes_;
+    stats->peak_bytes = peak_bytes_;
+    stats->allocations = allocations_;
+    stats->live_allocations = live_allocations_;
+  }
+
+  size_t live_bytes_;
+  size_t peak_bytes_;
+  size_t allocations_;
+  size_t live_allocations_;
+};
+
+// Counters over every allocator of the process.
+struct ProcessAllocationCounters {
+  static ProcessAllocationCounters &Instance() {
+    // never destroyed, static tensors may be freed after it would have been
+    static ProcessAllocationCounters *counters = new ProcessAllocationCounters();
+    return *counters;
+  }
+
+  void Add(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.Add(size);
+  }
+
+  void Remove(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.Remove(size);
+  }
+
+  void Read(QuantizedAllocatorStats *stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.Read(stats);
+  }
+
+ private:
+  ProcessAllocationCounters() = default;
+
+  std::mutex mutex_;
+  AllocationCounters counters_;
+};
+
+struct Allocator;
+
+// Right in front of every block handed out, so that a block goes back to the allocator that made it whichever
+// allocator is in use by then.
+struct AllocationHeader {
+  Allocator *allocator_;
+  void *memory_;
+  size_t size_;
+  size_t reserved_;
+};
+
+// Source of the memory of tensors, packed weights and workspaces (QuantizedAllocatorCreate). Subclasses reserve raw
+// memory and return NULL when out of it; the counters of an allocator cover the blocks it handed out. A released
+// allocator is deleted along with its last block.
+struct Allocator {
+  Allocator() : released_(false) {
+  }
+
+  virtual ~Allocator() {
+  }
+
+  Allocator(const Allocator &) = delete;
+
+  Allocator &operator=(const Allocator &) = delete;
+
+  // alignment is a power of two; NULL when out of memory
+  void *Allocate(size_t alignment, size_t size) {
+    alignment = std::max(std::max(alignment, sizeof(void *)), BlockAlignment(size));
+    size_t offset = (sizeof(AllocationHeader) + alignment - 1) / alignment * alignment;
+    void *memory = Reserve(alignment, offset + size);
+    if (memory == NULL) {
+      return NULL;
+    }
+    AllocationHeader *header = reinterpret_cast<AllocationHeader *>(static_cast<char *>(memory) + offset) - 1;
+    header->allocator_ = this;
+    header->memory_ = memory;
+    header->size_ = size;
+    header->reserved_ = offset + size;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      counters_.Add(size);
+    }
+    ProcessAllocationCounters::Instance().Add(size);
+    return header + 1;
+  }
+
+  static void Free(void *p) {
+    if (p == NULL) {
+      return;
+    }
+    AllocationHeader header = *(reinterpret_cast<AllocationHeader *>(p) - 1);
+    Allocator *allocator = header.allocator_;
+    allocator->Unreserve(header.memory_, header.reserved_);
+    ProcessAllocationCounters::Instance().Remove(header.size_);
+    bool unused;
+    {
+      std::lock_guard<std::mutex> lock(allocator->mutex_);
+      allocator->counters_.Remove(header.size_);
+      unused = allocator->released_ && allocator->counters_.live_allocations_ == 0;
+    }
+    if (unused) {
+      delete allocator;
+    }
+  }
+
+  // Blocks of the allocator stay valid after it is released.
+  void Release() {
+    bool unused;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      released_ = true;
+      unused = counters_.live_allocations_ == 0;
+    }
+    if (unused) {
+      delete this;
+    }
+  }
+
+  void Read(QuantizedAllocatorStats *stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.Read(stats);
+  }
+
+ protected:
+  // Alignment the allocator gives a block of size on top of the one asked for. The header then takes a whole
+  // alignment unit in front of the block.
+  virtual size_t BlockAlignment(size_t size) {
+    return 1;
+  }
+
+  virtual void *Reserve(size_t alignment, size_t size) = 0;
+
+  virtual void Unreserve(void *memory, size_t size) = 0;
+
+ private:
+  std::mutex mutex_;
+  AllocationCounters counters_;
+  bool released_;
+};
+
+inline void *SystemAlignedMalloc(size_t alignment, size_t size) {
+  void *p = NULL;
+#if defined(_MSC_VER)
+  p = _aligned_malloc(size, alignment);
+#elif defined(__MINGW32__)
+  p = __mingw_aligned_malloc(size, alignment);
 #else
-  if (posix_memalign(p, alignment, size) != 0) {
-    fprintf(stderr, "Failed to Allocate Memory.\n");
-    exit(-1);
+  if (posix_memalign(&p, alignment, size) != 0) {
+    p = NULL;
   }
 #endif
+  return p;
 }
 
-void aligned_free(void* p) {
+inline void SystemAlignedFree(void *p) {
 #if defined(_MSC_VER)
   _aligned_free(p);
 #elif defined(__MINGW32__)
@@ -50,4 +214,172 @@ void aligned_free(void* p) {
 #endif
 }
 
+// Whole 2 MB pages, which the kernel is asked to back with transparent huge pages where it supports them, so that
+// sweeping a large packed weight costs one TLB entry per 2 MB instead of one per 4 KB. The first lead bytes, whole
+// 2 MB pages, stay on small pages: they only hold an allocation header at their end.
+inline void *AllocateHugePages(size_t size, size_t lead) {
+  size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  void *p = SystemAlignedMalloc(HUGE_PAGE_SIZE, size);
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (p != NULL && size > lead) {
+    madvise(static_cast<char *>(p) + lead, size - lead, MADV_HUGEPAGE);
+  }
+#endif
+  return p;
+}
+
+struct DefaultAllocator : public Allocator {
+ protected:
+  void *Reserve(size_t alignment, size_t size) override {
+    return SystemAlignedMalloc(alignment, size);
+  }
+
+  void Unreserve(void *memory, size_t size) override {
+    SystemAlignedFree(memory);
+  }
+};
+
+// Blocks of 2 MB and more on huge pages of their own, starting on a page boundary behind one more page for the
+// header; smaller ones as the default allocator does.
+struct HugePageAllocator : public Allocator {
+ protected:
+  size_t BlockAlignment(size_t size) override {
+    return (size < HUGE_PAGE_SIZE) ? 1 : HUGE_PAGE_SIZE;
+  }
+
+  void *Reserve(size_t alignment, size_t size) override {
+    if (alignment != HUGE_PAGE_SIZE) {
+      return SystemAlignedMalloc(alignment, size);
+    }
+    return AllocateHugePages(size, HUGE_PAGE_SIZE);
+  }
+
+  void Unreserve(void *memory, size_t size) override {
+    SystemAlignedFree(memory);
+  }
+};
+
+// Hands out consecutive pieces of huge page chunks, which it keeps until it is deleted. Freeing a block only returns
+// its memory once every block of the arena is free, so an arena suits memory of one lifetime, e.g. one model's.
+struct ArenaAllocator : public Allocator {
+  ArenaAllocator() : chunk_(0), used_(0), live_(0) {
+  }
+
+  ~ArenaAllocator() {
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      SystemAlignedFree(chunks_[i].first);
+    }
+  }
+
+ protected:
+  void *Reserve(size_t alignment, size_t size) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (; chunk_ < chunks_.size(); ++chunk_, used_ = 0) {
+      size_t offset = (used_ + alignment - 1) / alignment * alignment;
+      if (offset + size <= chunks_[chunk_].second) {
+        used_ = offset + size;
+        ++live_;
+        return chunks_[chunk_].first + offset;
+      }
+    }
+    size_t chunk_size = std::max(ARENA_CHUNK_SIZE, size + alignment);
+    char *chunk = static_cast<char *>(AllocateHugePages(chunk_size, 0));
+    if (chunk == NULL) {
+      return NULL;
+    }
+    chunks_.push_back(std::make_pair(chunk, chunk_size));
+    chunk_ = chunks_.size() - 1;
+    used_ = size;
+    ++live_;
+    return chunk;
+  }
+
+  void Unreserve(void *memory, size_t size) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--live_ == 0) {
+      chunk_ = 0;
+      used_ = 0;
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::pair<char *, size_t> > chunks_;
+  size_t chunk_;
+  size_t used_;
+  size_t live_;
+};
+
+// Memory of a QuantizedCustomAllocatorCreate.
+struct CustomAllocator : public Allocator {
+  CustomAllocator(void *(*allocate)(size_t, size_t, void *), void (*release)(void *, void *), void *user_data)
+      : allocate_(allocate), release_(release), user_data_(user_data) {
+  }
+
+ protected:
+  void *Reserve(size_t alignment, size_t size) override {
+    return allocate_(alignment, size, user_data_);
+  }
+
+  void Unreserve(void *memory, size_t size) override {
+    release_(memory, user_data_);
+  }
+
+ private:
+  void *(*allocate_)(size_t, size_t, void *);
+  void (*release_)(void *, void *);
+  void *user_data_;
+};
+
+inline Allocator *CreateAllocator(ALLOCATOR_KIND kind) {
+  switch (kind) {
+    case DEFAULT_ALLOCATOR:
+      return new DefaultAllocator();
+    case HUGE_PAGE_ALLOCATOR:
+      return new HugePageAllocator();
+    case ARENA_ALLOCATOR:
+      return new ArenaAllocator();
+    default:
+      fprintf(stderr, "Unknown allocator %d.\n", kind);
+      return NULL;
+  }
+}
+
+// The allocator of the process (QuantizedSetAllocator); NULL selects the built-in default one.
+inline std::atomic<Allocator *> &ProcessAllocator() {
+  static std::atomic<Allocator *> allocator(NULL);
+  return allocator;
+}
+
+// The allocator of the calling thread (QuantizedBindAllocator), ahead of the one of the process.
+inline Allocator *&BoundAllocator() {
+  static thread_local Allocator *allocator = NULL;
+  return allocator;
+}
+
+inline Allocator *CurrentAllocator() {
+  Allocator *allocator = BoundAllocator();
+  if (allocator == NULL) {
+    allocator = ProcessAllocator().load();
+  }
+  if (allocator == NULL) {
+    // never destroyed, like the process counters
+    static Allocator *default_allocator = new DefaultAllocator();
+    allocator = default_allocator;
+  }
+  return allocator;
+}
+
+void aligned_malloc(void** p, size_t alignment, size_t size) {
+  *p = CurrentAllocator()->Allocate(alignment, size);
+  if (*p == NULL) {
+    fprintf(stderr, "Failed to Allocate Memory.\n");
+    exit(-1);
+  }
+}
+
+void aligned_free(void* p) {
+  Allocator::Free(p);
+}
+
 #endif
@@ -20,6 +20,7 @@
 typedef enum CPU_FEATURE { SSE4_2 = 0, AVX2_FMA = 1, AVX_512 = 2 } CPU_FEATURE;
 
 #if defined(AVX512)
+#define BUILD_CPU_FEATURE AVX_512
 #define GEMM_SHUFFLE_KERNEL_M 8
 #define GEMM_SHUFFLE_KERNEL_N 8
 #define GEMM_SHUFFLE_KERNEL_K 8
@@ -29,7 +30,9 @@ typedef enum CPU_FEATURE { SSE4_2 = 0, AVX2_FMA = 1, AVX_512 = 2 } CPU_FEATURE;
 #define FC_SHUFFLE_KERNEL_M GEMM_SHUFFLE_KERNEL_M
 #define FC_SHUFFLE_KERNEL_N GEMM_SHUFFLE_KERNEL_N
 #define FC_SHUFFLE_KERNEL_K GEMM_SHUFFLE_KERNEL_K
+#define FC_GEMV_KERNEL_K 64
 #elif defined(__AVX2__)
+#define BUILD_CPU_FEATURE AVX2_FMA
 #define GEMM_SHUFFLE_KERNEL_M 4
 #define GEMM_SHUFFLE_KERNEL_N 8
 #define GEMM_SHUFFLE_KERNEL_K 8
@@ -39,7 +42,9 @@ typedef enum CPU_FEATURE { SSE4_2 = 0, AVX2_FMA = 1, AVX_512 = 2 } CPU_FEATURE;
 #define FC_SHUFFLE_KERNEL_M 4
 #define FC_SHUFFLE_KERNEL_N 8
 #define FC_SHUFFLE_KERNEL_K 8
+#define FC_GEMV_KERNEL_K 32
 #else
+#define BUILD_CPU_FEATURE SSE4_2
 #define GEMM_SHUFFLE_KERNEL_M 2
 #define GEMM_SHUFFLE_KERNEL_N 2
 #define GEMM_SHUFFLE_KERNEL_K 16
@@ -49,6 +54,23 @@ typedef enum CPU_FEATURE { SSE4_2 = 0, AVX2_FMA = 1, AVX_512 = 2 } CPU_FEATURE;
 #define FC_SHUFFLE_KERNEL_M GEMM_SHUFFLE_KERNEL_M
 #define FC_SHUFFLE_KERNEL_N GEMM_SHUFFLE_KERNEL_N
 #define FC_SHUFFLE_KERNEL_K GEMM_SHUFFLE_KERNEL_K
+#define FC_GEMV_KERNEL_K 16
 #endif
 
+// Batches below FC_SHUFFLE_KERNEL_N run as matrix-vector products with the 4x1 stream kernel.
+#define FC_GEMV_KERNEL_M 4
+#define FC_GEMV_KERNEL_N 1
+
+// A GEMM plan hands out at least this many parallel tasks per thread where the shape allows, so that small GEMMs (late
+// layers at batch 1) still load every core evenly.
+#define GEMM_TASKS_PER_THREAD 4
+
+// A GEMM with too few M x N tiles for that is also split along K, into slices of at least this many elements.
+#define SPLIT_K_MIN_SLICE 1024
+
+// Shuffled uint8 activations handed between ops are packed for the conv and FC GEMM data operand, which share one
+// tile on every ISA.
+#define ACTIVATION_SHUFFLE_ROWS CONV_SHUFFLE_KERNEL_N
+#define ACTIVATION_SHUFFLE_COLS CONV_SHUFFLE_KERNEL_K
+
 #endif
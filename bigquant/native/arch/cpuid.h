@@ -50,6 +50,14 @@ static bool cpuid_support_feature(CPU_FEATURE f) {
   }
 }
 
+// Family, model and stepping (cpuid leaf 1 eax), which tell apart microarchitectures sharing an ISA.
+static uint32_t cpuid_signature() {
+  uint32_t eax, ebx, ecx, edx;
+  eax = 1;
+  __asm__("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+  return eax & 0x0fff3fff;
+}
+
 struct cache_info {
   int cache_id;
   int cache_level;
@@ -88,6 +96,7 @@ static int cpuid_caches(int cache_id, struct cache_info& info) {
   ecx = 1;
   __asm__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
   info.logic_cores_per_package = ebx;
+  return 0;
 }
 
 #endif
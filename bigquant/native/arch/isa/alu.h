@@ -23,6 +23,8 @@
 #define MIN_PS _mm512_min_ps
 #define ADD_PS _mm512_add_ps
 #define SUB_PS _mm512_sub_ps
+#define MAX_PS_HALF _mm256_max_ps
+#define SUB_PS_HALF _mm256_sub_ps
 #elif defined(__AVX2__)
 #define MAX_PS _mm256_max_ps
 #define MIN_PS _mm256_min_ps
@@ -45,6 +47,7 @@
 #define SUB_EPI16 _mm512_sub_epi16
 #define ADDS_EPI16 _mm512_adds_epi16
 #define ABS_EPI16 _mm512_abs_epi16
+#define REDUCE_ADD_EPI32 _mm512_reduce_add_epi32
 #elif defined(__AVX2__)
 #define ADD_EPI32 _mm256_add_epi32
 #define ADD_EPI32_HALF _mm_add_epi32
@@ -86,6 +89,7 @@
 #define PSTOEPI32 _mm512_cvtps_epi32
 #define EPI32TOPS _mm512_cvtepi32_ps
 #define EPI32TOPS_HALF _mm256_cvtepi32_ps
+#define EPU32TOEPI64 _mm512_cvtepu32_epi64
 #elif defined(__AVX2__)
 #define CVTSS_PS_HALF _mm_cvtss_f32
 #define CVTSS_PS _mm256_cvtss_f32
@@ -102,7 +106,9 @@
 #endif
 
 // VEC SP round
-#ifdef __AVX2__
+#if defined(AVX512)
+#define ROUND_PS _mm512_roundscale_ps
+#elif defined(__AVX2__)
 #define ROUND_PS _mm256_round_ps
 #else
 #define ROUND_PS _mm_round_ps
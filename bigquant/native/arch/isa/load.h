@@ -20,9 +20,12 @@
 #if defined(AVX512)
 #define LOAD_SI512 _mm512_load_si512
 #define LOAD_SI LOAD_SI512
+#define LOADU_SI _mm512_loadu_si512
+#define LOADU_SI_HALF _mm256_loadu_si256
 #elif defined(__AVX2__)  // load integer_
 #define LOAD_SI256 _mm256_load_si256
 #define LOAD_SI LOAD_SI256
+#define LOADU_SI _mm256_loadu_si256
 #define STREAMLOAD_SI256 _mm256_stream_load_si256
 #define STREAMLOAD_SI STREAMLOAD_SI256
 #else  // __SSE4_2__
@@ -31,6 +34,7 @@
 #define STREAMLOAD_SI128 _mm_stream_load_si128
 #define STREAMLOAD_SI STREAMLOAD_SI128
 #define LOADU_SI128 _mm_loadu_si128
+#define LOADU_SI LOADU_SI128
 #endif
 
 #if defined(AVX512)
@@ -32,6 +32,7 @@
 #define SET_EPI32 _mm512_set_epi32
 #define SET_EPI64 _mm512_set_epi64
 #define ZERO_PS _mm512_setzero_ps
+#define ZERO_PS_HALF _mm256_setzero_ps
 #elif defined(__AVX2__)
 #define ZEROS _mm256_setzero_si256
 #define INIT(X) SIMDSITYPE X = ZEROS()
@@ -37,6 +37,8 @@
 #endif
 
 #if defined(AVX512)
+#define STOREU512_SI _mm512_storeu_si512
+#define STOREU_SI STOREU512_SI
 #define STOREU_SI_QUARTER _mm_storeu_si128
 #define STORELO_EPI64_QUARTER _mm_storel_epi64
 #elif defined(__AVX2__)  // store integer
@@ -0,0 +1,289 @@
+#include <iostream>
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <x86intrin.h>
+#include "../base.h"
+#include "../common.h"
+#include "../ops/ops.h"
+#if defined(AVX512)
+#include "../ops/kernel/shuffle_avx512_igemm_4x4x64.h"
+#endif
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+// Micro-kernel benchmark: drives every ApplyKernelWrapper of the build's ISA on L1-resident packed panels over a sweep
+// of K and reports reference (TSC) cycles per call and int8 ops per cycle against the ISA peak, for the int32 result
+// and for the fused float epilogue of the NCHW convolution. Pin the core frequency (no turbo) so that TSC cycles are
+// core cycles.
+//
+// Each series is fitted as cycles = fixed + per_step * K / kernel_k. per_step above the compute bound points at loads
+// or dependency chains in the inner loop, the fixed cycles of the int32 series are the final reduction
+// (PostHaddReduce and the like) plus the store, and the fused minus the int32 fixed cycles are the float epilogue.
+//
+//   bench_kernels.out [--trials 7] [--json path]
+
+// Two pmaddubsw a cycle, each 2 ops (a multiply and the pairwise add) per byte of the vector.
+#define PEAK_OPS_PER_CYCLE (4 * sizeof(SIMDSITYPE))
+// Bytes of the A and B panels of one call, kept within L1.
+#define PANEL_BUDGET (16 * 1024)
+#define FAULT_TOLERANCE 0.5f
+
+struct Options {
+  size_t trials;
+  std::string json;
+};
+
+struct Sample {
+  size_t k;
+  double cycles;
+};
+
+struct Series {
+  std::string kernel;
+  const char *epilogue;
+  size_t m;
+  size_t n;
+  size_t kernel_k;
+  std::vector<Sample> samples;
+  double fixed;
+  double per_step;
+};
+
+// Scale factors and fusion parameters of the fused epilogue, for up to 64 rows and columns.
+struct EpilogueData {
+  EpilogueData() {
+    for (size_t i = 0; i < 64; ++i) {
+      ratio_a[i] = 0.01f;
+      ratio_b[i] = 0.02f;
+      min_b[i] = -1.0f;
+      kernel_sum[i] = 3.0f;
+      bias[i] = 0.5f;
+    }
+    global_mean = 0.0f;
+    mul_variance_coeff = 1.0f;
+    scale = 1.0f;
+    shift = 0.0f;
+  }
+
+  float ratio_a[64];
+  float ratio_b[64];
+  float min_b[64];
+  float kernel_sum[64];
+  float bias[64];
+  float global_mean;
+  float mul_variance_coeff;
+  float scale;
+  float shift;
+};
+
+// Best average of trials runs of calls back to back.
+template <typename Call>
+double CyclesPerCall(size_t trials, size_t calls, Call call) {
+  double best = DBL_MAX;
+  call();
+  for (size_t t = 0; t < trials; ++t) {
+    uint64_t start = __rdtsc();
+    for (size_t c = 0; c < calls; ++c) {
+      call();
+    }
+    uint64_t end = __rdtsc();
+    best = std::min(best, static_cast<double>(end - start) / calls);
+  }
+  return best;
+}
+
+// Least squares of cycles against the number of kernel steps.
+void Fit(Series &series) {
+  double n = series.samples.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (size_t i = 0; i < series.samples.size(); ++i) {
+    double x = static_cast<double>(series.samples[i].k / series.kernel_k);
+    double y = series.samples[i].cycles;
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  double d = n * sxx - sx * sx;
+  series.per_step = (d == 0) ? 0 : (n * sxy - sx * sy) / d;
+  series.fixed = (sy - series.per_step * sx) / n;
+}
+
+// int32_call(pa, pb, k, result) and fused_call(pa, pb, k, result, epilogue, is_block) run the kernel once;
+// target(result, pc) fills the fused result addresses of the tile at the origin and returns whether it is a block.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, typename Int32Call, typename FusedCall, typename Target>
+void BenchKernel(const Options &options, const char *name, Int32Call int32_call, FusedCall fused_call, Target target,
+                 std::vector<Series> &all) {
+  size_t max_k = PANEL_BUDGET / (kernel_m + kernel_n);
+  int8_t *pa;
+  uint8_t *pb;
+  int *c;
+  float *pc;
+  aligned_malloc(reinterpret_cast<void **>(&pa), 64, kernel_m * max_k);
+  aligned_malloc(reinterpret_cast<void **>(&pb), 64, kernel_n * max_k);
+  aligned_malloc(reinterpret_cast<void **>(&c), 64, kernel_m * kernel_n * sizeof(int));
+  // two tiles per channel, so that the tile at the origin takes the block store of the NCHW epilogue
+  aligned_malloc(reinterpret_cast<void **>(&pc), 64, kernel_m * 2 * kernel_n * sizeof(float));
+  for (size_t i = 0; i < kernel_m * max_k; ++i) {
+    pa[i] = static_cast<int8_t>(rand() % 128 - 64);
+  }
+  for (size_t i = 0; i < kernel_n * max_k; ++i) {
+    pb[i] = static_cast<uint8_t>(rand() % 128);
+  }
+  void *rows[kernel_m];
+  for (size_t i = 0; i < kernel_m; ++i) {
+    rows[i] = c + i * kernel_n;
+  }
+  float *result[kernel_m * kernel_n];
+  bool is_block = target(result, pc);
+  EpilogueData epilogue;
+
+  char kernel[32];
+  snprintf(kernel, sizeof(kernel), "%zux%zux%zu", kernel_m, kernel_n, kernel_k);
+  Series int32_series = {std::string(name) + " " + kernel, "int32", kernel_m, kernel_n, kernel_k, {}, 0, 0};
+  Series fused_series = {std::string(name) + " " + kernel, is_block ? "fused-block" : "fused", kernel_m, kernel_n,
+                         kernel_k, {}, 0, 0};
+  for (size_t k = 64; k <= max_k; k *= 2) {
+    size_t calls = std::max(static_cast<size_t>(256), (static_cast<size_t>(1) << 24) / (kernel_m * kernel_n * k));
+    double int32_cycles = CyclesPerCall(options.trials, calls, [&]() {
+      int8_t *a = pa;
+      uint8_t *b = pb;
+      // the panels and the pointers may have changed, so that no call is folded into the previous one
+      asm volatile("" : "+r"(a), "+r"(b) : : "memory");
+      int32_call(a, b, k, rows);
+    });
+    double fused_cycles = CyclesPerCall(options.trials, calls, [&]() {
+      int8_t *a = pa;
+      uint8_t *b = pb;
+      asm volatile("" : "+r"(a), "+r"(b) : : "memory");
+      fused_call(a, b, k, result, epilogue, is_block);
+    });
+    int32_series.samples.push_back({k, int32_cycles});
+    fused_series.samples.push_back({k, fused_cycles});
+    double ops = 2.0 * kernel_m * kernel_n * k;
+    printf("%-28s %-12s %5zu %12.1f %10.2f %7.1f%%\n", int32_series.kernel.c_str(), "int32", k, int32_cycles,
+           ops / int32_cycles, 100.0 * ops / int32_cycles / PEAK_OPS_PER_CYCLE);
+    printf("%-28s %-12s %5zu %12.1f %10.2f %7.1f%%\n", fused_series.kernel.c_str(), fused_series.epilogue, k,
+           fused_cycles, ops / fused_cycles, 100.0 * ops / fused_cycles / PEAK_OPS_PER_CYCLE);
+  }
+  Fit(int32_series);
+  Fit(fused_series);
+  all.push_back(int32_series);
+  all.push_back(fused_series);
+  aligned_free(pa);
+  aligned_free(pb);
+  aligned_free(c);
+  aligned_free(pc);
+}
+
+// Instantiates BenchKernel for the kernel of namespace ns with the calls the GEMM and the convolution make.
+#define BENCH_KERNEL(options, ns, kernel_m, kernel_n, kernel_k, all)                                                   \
+  BenchKernel<kernel_m, kernel_n, kernel_k>(                                                                           \
+      options, #ns,                                                                                                    \
+      [](int8_t *&pa, uint8_t *&pb, size_t k, void *result[]) {                                                       \
+        kernel::ns::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k>(pa, pb, k, FAULT_TOLERANCE, result, kernel_m,    \
+                                                                     kernel_n);                                        \
+      },                                                                                                               \
+      [](int8_t *&pa, uint8_t *&pb, size_t k, float *result[], EpilogueData &e, bool is_block) {                      \
+        kernel::ns::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k, NCHW>(                                           \
+            pa, pb, k, FAULT_TOLERANCE, result, kernel_m, kernel_n, 0, 0, e.ratio_a, e.ratio_b, e.min_b,              \
+            e.kernel_sum, e.bias, false, false, false, false, &e.global_mean, &e.mul_variance_coeff, &e.scale,        \
+            &e.shift, is_block);                                                                                       \
+      },                                                                                                               \
+      [](float *result[], float *pc) {                                                                                 \
+        return static_cast<bool>(kernel::ns::NCHWRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(            \
+            result, pc, kernel_m, 2 * kernel_n, 0, 0, 0, kernel_m * 2 * kernel_n, kernel_m * 2 * kernel_n,            \
+            2 * kernel_n));                                                                                            \
+      },                                                                                                               \
+      all)
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (value == NULL) {
+      fprintf(stderr, "Missing value for %s.\n", argv[i]);
+      return false;
+    }
+    if (strcmp(argv[i], "--trials") == 0) {
+      options.trials = std::max(strtoul(value, NULL, 10), 1UL);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      options.json = value;
+    } else {
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return false;
+    }
+    ++i;
+  }
+  return true;
+}
+
+bool WriteJson(const Options &options, const std::vector<Series> &all) {
+  FILE *file = fopen(options.json.c_str(), "w");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot write %s.\n", options.json.c_str());
+    return false;
+  }
+  fprintf(file, "{\n  \"version\": \"%s\",\n  \"isa\": %d,\n  \"peak_ops_per_cycle\": %zu,\n", GIT_VERSION,
+          static_cast<int>(BUILD_CPU_FEATURE), PEAK_OPS_PER_CYCLE);
+  fprintf(file, "  \"trials\": %zu,\n  \"series\": [", options.trials);
+  for (size_t i = 0; i < all.size(); ++i) {
+    const Series &series = all[i];
+    fprintf(file, "%s\n    {\"kernel\": \"%s\", \"epilogue\": \"%s\", \"fixed_cycles\": %.2f, ", (i == 0) ? "" : ",",
+            series.kernel.c_str(), series.epilogue, series.fixed);
+    fprintf(file, "\"cycles_per_step\": %.3f, \"bound_per_step\": %.3f, \"samples\": [", series.per_step,
+            2.0 * series.m * series.n * series.kernel_k / PEAK_OPS_PER_CYCLE);
+    for (size_t s = 0; s < series.samples.size(); ++s) {
+      double ops = 2.0 * series.m * series.n * series.samples[s].k;
+      fprintf(file, "%s{\"k\": %zu, \"cycles\": %.2f, \"ops_per_cycle\": %.3f}", (s == 0) ? "" : ", ",
+              series.samples[s].k, series.samples[s].cycles, ops / series.samples[s].cycles);
+    }
+    fprintf(file, "]}");
+  }
+  fprintf(file, "\n  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  options.trials = 7;
+  if (!ParseOptions(argc, argv, options)) {
+    return 1;
+  }
+  srand(0);
+  printf("peak %zu int8 ops/cycle\n", PEAK_OPS_PER_CYCLE);
+  printf("%-28s %-12s %5s %12s %10s %8s\n", "kernel", "epilogue", "K", "cycles/call", "ops/cycle", "of peak");
+  std::vector<Series> all;
+#if defined(AVX512)
+  BENCH_KERNEL(options, avx512_igemm8x8x8, 8, 8, 8, all);
+  BENCH_KERNEL(options, avx512_igemm4x4x64, 4, 4, 64, all);
+#elif defined(__AVX2__)
+  BENCH_KERNEL(options, igemm4xn, 4, 8, 8, all);
+#elif defined(__SSE4_2__)
+  BENCH_KERNEL(options, sse42_igemm2x2x16, 2, 2, 16, all);
+#endif
+  BENCH_KERNEL(options, igemm4x1, 4, 1, OPERAND_WIDTH, all);
+
+  printf("\n%-28s %-12s %12s %12s %12s %12s\n", "kernel", "epilogue", "fixed", "per step", "step bound",
+         "epilogue");
+  for (size_t i = 0; i < all.size(); ++i) {
+    const Series &series = all[i];
+    double bound = 2.0 * series.m * series.n * series.kernel_k / PEAK_OPS_PER_CYCLE;
+    printf("%-28s %-12s %12.1f %12.2f %12.2f", series.kernel.c_str(), series.epilogue, series.fixed, series.per_step,
+           bound);
+    if (i % 2 == 1) {
+      // the fused series follows the int32 series of the same kernel
+      printf(" %12.1f", series.fixed - all[i - 1].fixed);
+    }
+    printf("\n");
+  }
+  if (!options.json.empty() && !WriteJson(options, all)) {
+    return 1;
+  }
+  return 0;
+}
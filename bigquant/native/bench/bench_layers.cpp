@@ -0,0 +1,498 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cblas.h>
+#include "bigquant.h"
+
+#ifndef GIT_VERSION
+#define GIT_VERSION "unknown"
+#endif
+
+// Layer benchmark: runs the convolution and FC layers of common networks through QuantizedConvOp/QuantizedFCOp and
+// through the im2col + cblas_sgemm fp32 lowering, and reports latency percentiles, effective GOPS, compulsory bytes and
+// the speed-up over fp32, as a table and optionally as JSON for comparing runs.
+//
+//   bench_layers.out [--networks resnet50,vgg16,mobilenet_v1,inception_v3] [--batches 1,8,32,128] [--warmup 3]
+//                    [--repeat 20] [--no-baseline] [--memory-limit-mb 8192] [--json path]
+
+struct LayerDesc {
+  const char *name;
+  bool fc;
+  size_t channel_in;
+  size_t height;
+  size_t width;
+  size_t channel_out;
+  size_t kernel_h;
+  size_t kernel_w;
+  size_t stride;
+  size_t pad_h;
+  size_t pad_w;
+  size_t group;
+  // occurrences in the network, for the per network totals
+  size_t count;
+};
+
+#define CONV(name, c_in, h, w, c_out, k_h, k_w, stride, pad_h, pad_w, group, count) \
+  { name, false, c_in, h, w, c_out, k_h, k_w, stride, pad_h, pad_w, group, count }
+#define FC(name, c_in, c_out) \
+  { name, true, c_in, 1, 1, c_out, 1, 1, 1, 0, 0, 1, 1 }
+
+struct NetworkDesc {
+  const char *name;
+  std::vector<LayerDesc> layers;
+};
+
+// The distinct layer shapes of each network at its usual input resolution; ResNet-50 is v1.5, with the stride on the
+// 3x3 convolutions.
+std::vector<NetworkDesc> Networks() {
+  std::vector<NetworkDesc> networks;
+  networks.push_back({"resnet50",
+                      {CONV("conv1", 3, 224, 224, 64, 7, 7, 2, 3, 3, 1, 1),
+                       CONV("res2a_branch1", 64, 56, 56, 256, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("res2a_branch2a", 64, 56, 56, 64, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("res2_branch2b", 64, 56, 56, 64, 3, 3, 1, 1, 1, 1, 3),
+                       CONV("res2_branch2c", 64, 56, 56, 256, 1, 1, 1, 0, 0, 1, 3),
+                       CONV("res2_branch2a", 256, 56, 56, 64, 1, 1, 1, 0, 0, 1, 2),
+                       CONV("res3a_branch1", 256, 56, 56, 512, 1, 1, 2, 0, 0, 1, 1),
+                       CONV("res3a_branch2a", 256, 56, 56, 128, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("res3a_branch2b", 128, 56, 56, 128, 3, 3, 2, 1, 1, 1, 1),
+                       CONV("res3_branch2b", 128, 28, 28, 128, 3, 3, 1, 1, 1, 1, 3),
+                       CONV("res3_branch2c", 128, 28, 28, 512, 1, 1, 1, 0, 0, 1, 4),
+                       CONV("res3_branch2a", 512, 28, 28, 128, 1, 1, 1, 0, 0, 1, 3),
+                       CONV("res4a_branch1", 512, 28, 28, 1024, 1, 1, 2, 0, 0, 1, 1),
+                       CONV("res4a_branch2a", 512, 28, 28, 256, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("res4a_branch2b", 256, 28, 28, 256, 3, 3, 2, 1, 1, 1, 1),
+                       CONV("res4_branch2b", 256, 14, 14, 256, 3, 3, 1, 1, 1, 1, 5),
+                       CONV("res4_branch2c", 256, 14, 14, 1024, 1, 1, 1, 0, 0, 1, 6),
+                       CONV("res4_branch2a", 1024, 14, 14, 256, 1, 1, 1, 0, 0, 1, 5),
+                       CONV("res5a_branch1", 1024, 14, 14, 2048, 1, 1, 2, 0, 0, 1, 1),
+                       CONV("res5a_branch2a", 1024, 14, 14, 512, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("res5a_branch2b", 512, 14, 14, 512, 3, 3, 2, 1, 1, 1, 1),
+                       CONV("res5_branch2b", 512, 7, 7, 512, 3, 3, 1, 1, 1, 1, 2),
+                       CONV("res5_branch2c", 512, 7, 7, 2048, 1, 1, 1, 0, 0, 1, 3),
+                       CONV("res5_branch2a", 2048, 7, 7, 512, 1, 1, 1, 0, 0, 1, 2),
+                       FC("fc1000", 2048, 1000)}});
+  networks.push_back({"vgg16",
+                      {CONV("conv1_1", 3, 224, 224, 64, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv1_2", 64, 224, 224, 64, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv2_1", 64, 112, 112, 128, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv2_2", 128, 112, 112, 128, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv3_1", 128, 56, 56, 256, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv3_2", 256, 56, 56, 256, 3, 3, 1, 1, 1, 1, 2),
+                       CONV("conv4_1", 256, 28, 28, 512, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv4_2", 512, 28, 28, 512, 3, 3, 1, 1, 1, 1, 2),
+                       CONV("conv5_1", 512, 14, 14, 512, 3, 3, 1, 1, 1, 1, 3),
+                       FC("fc6", 25088, 4096),
+                       FC("fc7", 4096, 4096),
+                       FC("fc8", 4096, 1000)}});
+  networks.push_back({"mobilenet_v1",
+                      {CONV("conv1", 3, 224, 224, 32, 3, 3, 2, 1, 1, 1, 1),
+                       CONV("conv2_1_dw", 32, 112, 112, 32, 3, 3, 1, 1, 1, 32, 1),
+                       CONV("conv2_1_pw", 32, 112, 112, 64, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv2_2_dw", 64, 112, 112, 64, 3, 3, 2, 1, 1, 64, 1),
+                       CONV("conv2_2_pw", 64, 56, 56, 128, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv3_1_dw", 128, 56, 56, 128, 3, 3, 1, 1, 1, 128, 1),
+                       CONV("conv3_1_pw", 128, 56, 56, 128, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv3_2_dw", 128, 56, 56, 128, 3, 3, 2, 1, 1, 128, 1),
+                       CONV("conv3_2_pw", 128, 28, 28, 256, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv4_1_dw", 256, 28, 28, 256, 3, 3, 1, 1, 1, 256, 1),
+                       CONV("conv4_1_pw", 256, 28, 28, 256, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv4_2_dw", 256, 28, 28, 256, 3, 3, 2, 1, 1, 256, 1),
+                       CONV("conv4_2_pw", 256, 14, 14, 512, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv5_dw", 512, 14, 14, 512, 3, 3, 1, 1, 1, 512, 5),
+                       CONV("conv5_pw", 512, 14, 14, 512, 1, 1, 1, 0, 0, 1, 5),
+                       CONV("conv5_6_dw", 512, 14, 14, 512, 3, 3, 2, 1, 1, 512, 1),
+                       CONV("conv5_6_pw", 512, 7, 7, 1024, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv6_dw", 1024, 7, 7, 1024, 3, 3, 1, 1, 1, 1024, 1),
+                       CONV("conv6_pw", 1024, 7, 7, 1024, 1, 1, 1, 0, 0, 1, 1),
+                       FC("fc7", 1024, 1000)}});
+  networks.push_back({"inception_v3",
+                      {CONV("conv_1", 3, 299, 299, 32, 3, 3, 2, 0, 0, 1, 1),
+                       CONV("conv_2", 32, 149, 149, 32, 3, 3, 1, 0, 0, 1, 1),
+                       CONV("conv_3", 32, 147, 147, 64, 3, 3, 1, 1, 1, 1, 1),
+                       CONV("conv_4", 64, 73, 73, 80, 1, 1, 1, 0, 0, 1, 1),
+                       CONV("conv_5", 80, 73, 73, 192, 3, 3, 1, 0, 0, 1, 1),
+                       CONV("mixed_35_1x1", 256, 35, 35, 64, 1, 1, 1, 0, 0, 1, 9),
+                       CONV("mixed_35_5x5_reduce", 256, 35, 35, 48, 1, 1, 1, 0, 0, 1, 3),
+                       CONV("mixed_35_5x5", 48, 35, 35, 64, 5, 5, 1, 2, 2, 1, 3),
+                       CONV("mixed_35_3x3_a", 64, 35, 35, 96, 3, 3, 1, 1, 1, 1, 3),
+                       CONV("mixed_35_3x3_b", 96, 35, 35, 96, 3, 3, 1, 1, 1, 1, 3),
+                       CONV("mixed_3_3x3", 288, 35, 35, 384, 3, 3, 2, 0, 0, 1, 1),
+                       CONV("mixed_3_3x3_dbl", 96, 35, 35, 96, 3, 3, 2, 0, 0, 1, 1),
+                       CONV("mixed_17_1x1", 768, 17, 17, 192, 1, 1, 1, 0, 0, 1, 16),
+                       CONV("mixed_17_7x7_reduce", 768, 17, 17, 160, 1, 1, 1, 0, 0, 1, 6),
+                       CONV("mixed_17_1x7", 160, 17, 17, 160, 1, 7, 1, 0, 3, 1, 6),
+                       CONV("mixed_17_7x1", 160, 17, 17, 192, 7, 1, 1, 3, 0, 1, 6),
+                       CONV("mixed_8_3x3", 192, 17, 17, 320, 3, 3, 2, 0, 0, 1, 1),
+                       CONV("mixed_8_1x1", 2048, 8, 8, 384, 1, 1, 1, 0, 0, 1, 4),
+                       CONV("mixed_8_1x3", 384, 8, 8, 384, 1, 3, 1, 0, 1, 1, 8),
+                       CONV("mixed_8_3x1", 384, 8, 8, 384, 3, 1, 1, 1, 0, 1, 8),
+                       CONV("mixed_8_3x3_reduce", 2048, 8, 8, 448, 1, 1, 1, 0, 0, 1, 2),
+                       CONV("mixed_8_3x3_dbl", 448, 8, 8, 384, 3, 3, 1, 1, 1, 1, 2),
+                       FC("fc", 2048, 1000)}});
+  return networks;
+}
+
+struct Options {
+  Options() : warmup(3), repeat(20), baseline(true), memory_limit(static_cast<size_t>(8192) << 20) {
+  }
+
+  std::vector<std::string> networks;
+  std::vector<size_t> batches;
+  size_t warmup;
+  size_t repeat;
+  bool baseline;
+  size_t memory_limit;
+  std::string json;
+};
+
+std::vector<std::string> SplitList(const char *list) {
+  std::vector<std::string> items;
+  std::string all(list);
+  size_t begin = 0;
+  while (begin <= all.size()) {
+    size_t end = all.find(',', begin);
+    if (end == std::string::npos) {
+      end = all.size();
+    }
+    if (end > begin) {
+      items.push_back(all.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return items;
+}
+
+bool ParseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+    if (strcmp(argv[i], "--no-baseline") == 0) {
+      options.baseline = false;
+      continue;
+    }
+    if (value == NULL) {
+      fprintf(stderr, "Missing value for %s.\n", argv[i]);
+      return false;
+    }
+    if (strcmp(argv[i], "--networks") == 0) {
+      options.networks = SplitList(value);
+    } else if (strcmp(argv[i], "--batches") == 0) {
+      std::vector<std::string> batches = SplitList(value);
+      for (size_t b = 0; b < batches.size(); ++b) {
+        options.batches.push_back(strtoul(batches[b].c_str(), NULL, 10));
+      }
+    } else if (strcmp(argv[i], "--warmup") == 0) {
+      options.warmup = strtoul(value, NULL, 10);
+    } else if (strcmp(argv[i], "--repeat") == 0) {
+      options.repeat = std::max(strtoul(value, NULL, 10), 1UL);
+    } else if (strcmp(argv[i], "--memory-limit-mb") == 0) {
+      options.memory_limit = strtoul(value, NULL, 10) << 20;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      options.json = value;
+    } else {
+      fprintf(stderr, "Unknown option %s.\n", argv[i]);
+      return false;
+    }
+    ++i;
+  }
+  if (options.networks.empty()) {
+    options.networks = SplitList("resnet50,vgg16,mobilenet_v1,inception_v3");
+  }
+  if (options.batches.empty()) {
+    options.batches = {1, 8, 32, 128};
+  }
+  return true;
+}
+
+struct Latency {
+  Latency() : p50(0), p90(0), p99(0), mean(0), min(0) {
+  }
+
+  double p50;
+  double p90;
+  double p99;
+  double mean;
+  double min;
+};
+
+// Nearest rank percentiles, in milliseconds.
+template <typename Run>
+Latency Measure(const Options &options, Run run) {
+  for (size_t i = 0; i < options.warmup; ++i) {
+    run();
+  }
+  std::vector<double> times(options.repeat);
+  for (size_t i = 0; i < options.repeat; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    times[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+  std::sort(times.begin(), times.end());
+  Latency latency;
+  auto percentile = [&](double p) {
+    size_t rank = static_cast<size_t>(p * times.size() + 0.999999);
+    return times[std::min(std::max(rank, static_cast<size_t>(1)), times.size()) - 1];
+  };
+  latency.p50 = percentile(0.5);
+  latency.p90 = percentile(0.9);
+  latency.p99 = percentile(0.99);
+  for (size_t i = 0; i < times.size(); ++i) {
+    latency.mean += times[i] / times.size();
+  }
+  latency.min = times[0];
+  return latency;
+}
+
+struct LayerShape {
+  LayerShape(const LayerDesc &layer, size_t batch) : batch_(batch) {
+    height_out_ = (layer.height + 2 * layer.pad_h - layer.kernel_h) / layer.stride + 1;
+    width_out_ = (layer.width + 2 * layer.pad_w - layer.kernel_w) / layer.stride + 1;
+    gemm_k_ = layer.channel_in / layer.group * layer.kernel_h * layer.kernel_w;
+    input_ = batch * layer.channel_in * layer.height * layer.width;
+    output_ = batch * layer.channel_out * height_out_ * width_out_;
+    weight_ = layer.channel_out * gemm_k_;
+    ops_ = 2.0 * output_ * gemm_k_;
+  }
+
+  size_t batch_;
+  size_t height_out_;
+  size_t width_out_;
+  size_t gemm_k_;
+  size_t input_;
+  size_t output_;
+  size_t weight_;
+  double ops_;
+};
+
+// fp32 convolution lowered to im2col and one cblas_sgemm per image and group, as Caffe-style frameworks do.
+struct FloatConvolution {
+  FloatConvolution(const LayerDesc &layer, const LayerShape &shape)
+      : layer_(layer), shape_(shape), columns_(shape.gemm_k_ * shape.height_out_ * shape.width_out_) {
+  }
+
+  void Im2col(const float *image) {
+    size_t channels = layer_.channel_in / layer_.group;
+    size_t spatial = shape_.height_out_ * shape_.width_out_;
+    for (size_t c = 0; c < channels; ++c) {
+      for (size_t kh = 0; kh < layer_.kernel_h; ++kh) {
+        for (size_t kw = 0; kw < layer_.kernel_w; ++kw) {
+          float *column = columns_.data() + ((c * layer_.kernel_h + kh) * layer_.kernel_w + kw) * spatial;
+          for (size_t oh = 0; oh < shape_.height_out_; ++oh) {
+            long h = static_cast<long>(oh * layer_.stride + kh) - static_cast<long>(layer_.pad_h);
+            for (size_t ow = 0; ow < shape_.width_out_; ++ow) {
+              long w = static_cast<long>(ow * layer_.stride + kw) - static_cast<long>(layer_.pad_w);
+              bool inside = h >= 0 && h < static_cast<long>(layer_.height) && w >= 0 &&
+                            w < static_cast<long>(layer_.width);
+              *column++ = inside ? image[(c * layer_.height + h) * layer_.width + w] : 0.0f;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void Run(float *dst, const float *data, const float *weight) {
+    size_t channels_in = layer_.channel_in / layer_.group;
+    size_t channels_out = layer_.channel_out / layer_.group;
+    size_t spatial = shape_.height_out_ * shape_.width_out_;
+    for (size_t n = 0; n < shape_.batch_; ++n) {
+      for (size_t g = 0; g < layer_.group; ++g) {
+        Im2col(data + (n * layer_.channel_in + g * channels_in) * layer_.height * layer_.width);
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, channels_out, spatial, shape_.gemm_k_, 1.0f,
+                    weight + g * channels_out * shape_.gemm_k_, shape_.gemm_k_, columns_.data(), spatial, 0.0f,
+                    dst + (n * layer_.channel_out + g * channels_out) * spatial, spatial);
+      }
+    }
+  }
+
+  const LayerDesc &layer_;
+  const LayerShape &shape_;
+  std::vector<float> columns_;
+};
+
+struct LayerResult {
+  const char *network;
+  const LayerDesc *layer;
+  size_t batch;
+  Latency int8;
+  Latency fp32;
+  double gops;
+  double fp32_gops;
+  double bytes;
+};
+
+bool RunLayer(const Options &options, const char *network, const LayerDesc &layer, size_t batch,
+              LayerResult &result) {
+  LayerShape shape(layer, batch);
+  size_t columns = options.baseline && !layer.fc ? shape.gemm_k_ * shape.height_out_ * shape.width_out_ : 0;
+  size_t footprint = sizeof(float) * (shape.input_ + 2 * shape.output_ + shape.weight_ + columns);
+  if (footprint > options.memory_limit) {
+    printf("%-14s %-22s %5zu  skipped, needs %zu MB\n", network, layer.name, batch, footprint >> 20);
+    return false;
+  }
+  std::vector<float> data(shape.input_), weight(shape.weight_), bias(layer.channel_out), out(shape.output_);
+  unsigned seed = 1;
+  auto random = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<float>((seed >> 16) & 0x7fff) / 0x7fff - 0.5f;
+  };
+  std::generate(data.begin(), data.end(), random);
+  std::generate(weight.begin(), weight.end(), random);
+  std::generate(bias.begin(), bias.end(), random);
+
+  if (layer.fc) {
+    QuantizedFCOp *op = QuantizedFCOpCreate();
+    QuantizedFCOpSetupFCParameter(op, NCHW, layer.channel_out, layer.channel_in, AUTO_SELECT_FC);
+    QuantizedFCOpInitWeight(op, weight.data());
+    result.int8 = Measure(options, [&]() {
+      QuantizedFCOpExecute(op, out.data(), data.data(), bias.data(), batch, layer.channel_in);
+    });
+    QuantizedFCOpFree(op);
+  } else {
+    QuantizedConvOp *op = QuantizedConvOpCreate();
+    QuantizedConvOpSetupConvParameter(op, NCHW, layer.channel_out, layer.channel_in, layer.group, layer.kernel_h,
+                                      layer.kernel_w, layer.stride, layer.stride, layer.pad_h, layer.pad_w, 1, 1,
+                                      NO_FUSION, AUTO_SELECT_CONV);
+    QuantizedConvOpInitWeight(op, weight.data());
+    result.int8 = Measure(options, [&]() {
+      QuantizedConvOpExecute(op, out.data(), data.data(), bias.data(), batch, layer.channel_in, layer.height,
+                             layer.width);
+    });
+    QuantizedConvOpFree(op);
+  }
+
+  if (options.baseline) {
+    if (layer.fc) {
+      result.fp32 = Measure(options, [&]() {
+        cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, batch, layer.channel_out, layer.channel_in, 1.0f,
+                    data.data(), layer.channel_in, weight.data(), layer.channel_in, 0.0f, out.data(),
+                    layer.channel_out);
+      });
+    } else {
+      FloatConvolution convolution(layer, shape);
+      result.fp32 = Measure(options, [&]() { convolution.Run(out.data(), data.data(), weight.data()); });
+    }
+  }
+
+  result.network = network;
+  result.layer = &layer;
+  result.batch = batch;
+  result.gops = shape.ops_ / (result.int8.p50 * 1e6);
+  result.fp32_gops = options.baseline ? shape.ops_ / (result.fp32.p50 * 1e6) : 0;
+  // fp32 input and output plus the int8 weights, each moved once
+  result.bytes = sizeof(float) * (shape.input_ + shape.output_) + shape.weight_;
+  return true;
+}
+
+void PrintResult(const Options &options, const LayerResult &result) {
+  printf("%-14s %-22s %5zu %9.3f %9.3f %9.3f %8.1f %8.1f", result.network, result.layer->name, result.batch,
+         result.int8.p50, result.int8.p90, result.int8.p99, result.gops, result.bytes / (result.int8.p50 * 1e6));
+  if (options.baseline) {
+    printf(" %9.3f %7.2fx", result.fp32.p50, result.fp32.p50 / result.int8.p50);
+  }
+  printf("\n");
+}
+
+void WriteLatency(FILE *file, const char *name, const Latency &latency) {
+  fprintf(file, "\"%s\": {\"p50_ms\": %.6f, \"p90_ms\": %.6f, \"p99_ms\": %.6f, \"mean_ms\": %.6f, \"min_ms\": %.6f}",
+          name, latency.p50, latency.p90, latency.p99, latency.mean, latency.min);
+}
+
+bool WriteJson(const Options &options, const std::vector<LayerResult> &results) {
+  FILE *file = fopen(options.json.c_str(), "w");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot write %s.\n", options.json.c_str());
+    return false;
+  }
+  const char *omp_threads = getenv("OMP_NUM_THREADS");
+  fprintf(file, "{\n  \"version\": \"%s\",\n", GIT_VERSION);
+  fprintf(file, "  \"hardware_threads\": %u,\n  \"omp_num_threads\": \"%s\",\n", std::thread::hardware_concurrency(),
+          omp_threads == NULL ? "" : omp_threads);
+  fprintf(file, "  \"warmup\": %zu,\n  \"repeat\": %zu,\n  \"results\": [", options.warmup, options.repeat);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const LayerResult &result = results[i];
+    const LayerDesc &layer = *result.layer;
+    fprintf(file, "%s\n    {\"network\": \"%s\", \"layer\": \"%s\", \"op\": \"%s\", \"batch\": %zu, ",
+            (i == 0) ? "" : ",", result.network, layer.name, layer.fc ? "fc" : "conv", result.batch);
+    fprintf(file,
+            "\"shape\": {\"channel_in\": %zu, \"height\": %zu, \"width\": %zu, \"channel_out\": %zu, "
+            "\"kernel_h\": %zu, \"kernel_w\": %zu, \"stride\": %zu, \"pad_h\": %zu, \"pad_w\": %zu, \"group\": %zu}, ",
+            layer.channel_in, layer.height, layer.width, layer.channel_out, layer.kernel_h, layer.kernel_w,
+            layer.stride, layer.pad_h, layer.pad_w, layer.group);
+    fprintf(file, "\"count\": %zu, ", layer.count);
+    WriteLatency(file, "int8", result.int8);
+    fprintf(file, ", \"gops\": %.3f, \"bytes\": %.0f", result.gops, result.bytes);
+    if (options.baseline) {
+      fprintf(file, ", ");
+      WriteLatency(file, "fp32", result.fp32);
+      fprintf(file, ", \"fp32_gops\": %.3f, \"speedup\": %.4f", result.fp32_gops, result.fp32.p50 / result.int8.p50);
+    }
+    fprintf(file, "}");
+  }
+  fprintf(file, "\n  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseOptions(argc, argv, options)) {
+    return 1;
+  }
+  std::vector<NetworkDesc> networks = Networks();
+  for (size_t n = 0; n < options.networks.size(); ++n) {
+    bool known = false;
+    for (size_t i = 0; i < networks.size(); ++i) {
+      known = known || options.networks[n] == networks[i].name;
+    }
+    if (!known) {
+      fprintf(stderr, "Unknown network %s.\n", options.networks[n].c_str());
+      return 1;
+    }
+  }
+
+  printf("%-14s %-22s %5s %9s %9s %9s %8s %8s", "network", "layer", "batch", "p50 ms", "p90 ms", "p99 ms", "GOPS",
+         "GB/s");
+  if (options.baseline) {
+    printf(" %9s %8s", "fp32 ms", "speedup");
+  }
+  printf("\n");
+  std::vector<LayerResult> results;
+  for (size_t i = 0; i < networks.size(); ++i) {
+    const NetworkDesc &network = networks[i];
+    if (std::find(options.networks.begin(), options.networks.end(), network.name) == options.networks.end()) {
+      continue;
+    }
+    for (size_t b = 0; b < options.batches.size(); ++b) {
+      double total = 0, fp32_total = 0;
+      bool complete = true;
+      for (size_t l = 0; l < network.layers.size(); ++l) {
+        LayerResult result;
+        if (!RunLayer(options, network.name, network.layers[l], options.batches[b], result)) {
+          complete = false;
+          continue;
+        }
+        PrintResult(options, result);
+        results.push_back(result);
+        total += result.int8.p50 * network.layers[l].count;
+        fp32_total += result.fp32.p50 * network.layers[l].count;
+      }
+      if (complete) {
+        printf("%-14s %-22s %5zu %9.3f", network.name, "total", options.batches[b], total);
+        if (options.baseline) {
+          printf("%38s %9.3f %7.2fx", "", fp32_total, fp32_total / total);
+        }
+        printf("\n");
+      }
+    }
+  }
+  if (!options.json.empty() && !WriteJson(options, results)) {
+    return 1;
+  }
+  return 0;
+}
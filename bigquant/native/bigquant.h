@@ -20,8 +20,37 @@
 #include <stdint.h>
 
 typedef enum LAYOUT { NCHW = 0, NHWC = 1 } LAYOUT;
-typedef enum CONV_ALGORITHM { AUTO_SELECT_CONV = 0, SHUFFLE_CONV = 1 } CONV_ALGORITHM;
+typedef enum CONV_ALGORITHM {
+  AUTO_SELECT_CONV = 0,
+  SHUFFLE_CONV = 1,
+  WINOGRAD_CONV = 2,
+  DEPTHWISE_CONV = 3
+} CONV_ALGORITHM;
 typedef enum FC_ALGORITHM { AUTO_SELECT_FC = 0, SHUFFLE_FC = 1 } FC_ALGORITHM;
+typedef enum FUSION_MASK {
+  NO_FUSION = 0,
+  CONV_RELU_FUSION = 1,
+  CONV_BN_FUSION = 2,
+  CONV_BN_RELU_FUSION = 3,
+  CONV_RELU_BN_FUSION = 4
+} FUSION_MASK;
+typedef enum ACTIVATION_FORMAT {
+  FLOAT_ACTIVATION = 0,
+  UINT8_ACTIVATION = 1,
+  SHUFFLED_UINT8_ACTIVATION = 2
+} ACTIVATION_FORMAT;
+typedef enum THREADING_BACKEND { OPENMP_BACKEND = 0, THREAD_POOL_BACKEND = 1 } THREADING_BACKEND;
+typedef enum ALLOCATOR_KIND { DEFAULT_ALLOCATOR = 0, HUGE_PAGE_ALLOCATOR = 1, ARENA_ALLOCATOR = 2 } ALLOCATOR_KIND;
+// Phases nest: TRACE_OP is a whole op, TRACE_IM2COL includes its TRACE_FIND_EXTREME and TRACE_GEMM its
+// TRACE_EPILOGUE, which only split-K GEMMs run apart from the tiles.
+typedef enum TRACE_PHASE {
+  TRACE_OP = 0,
+  TRACE_FIND_EXTREME = 1,
+  TRACE_IM2COL = 2,
+  TRACE_LAYOUT_TRANSFORM = 3,
+  TRACE_GEMM = 4,
+  TRACE_EPILOGUE = 5
+} TRACE_PHASE;
 
 struct FPTensorDesc {
   void *data;
@@ -48,6 +77,49 @@ typedef struct QuantizedConvOp QuantizedConvOp;
 struct QuantizedFCOp;
 typedef struct QuantizedFCOp QuantizedFCOp;
 
+struct QuantizedExecutionContext;
+typedef struct QuantizedExecutionContext QuantizedExecutionContext;
+
+struct QuantizedAllocator;
+typedef struct QuantizedAllocator QuantizedAllocator;
+
+typedef struct QuantizedAllocatorStats {
+  size_t live_bytes;
+  size_t peak_bytes;
+  size_t allocations;
+  size_t live_allocations;
+} QuantizedAllocatorStats;
+
+typedef struct QuantizedTraceRecord {
+  // the QuantizedConvOp or QuantizedFCOp, 0 outside of one
+  uint64_t op;
+  uint32_t phase;
+  // recording thread, numbered in the order threads first record
+  uint32_t thread;
+  // steady clock, since the first use of tracing
+  uint64_t start_ns;
+  uint64_t end_ns;
+  // memory the phase reads and writes at least, and its arithmetic operations (2 per multiply-add)
+  uint64_t bytes;
+  uint64_t ops;
+} QuantizedTraceRecord;
+
+// Totals of the calls of one phase of one op. A counter the host cannot count, as in most VMs and containers without
+// PMU access, is UINT64_MAX.
+typedef struct QuantizedPerfCounterRecord {
+  uint64_t op;
+  uint32_t phase;
+  uint32_t calls;
+  // task clock of all threads
+  uint64_t cpu_ns;
+  uint64_t cycles;
+  uint64_t instructions;
+  // read misses
+  uint64_t llc_misses;
+  uint64_t l1d_misses;
+  uint64_t dtlb_misses;
+} QuantizedPerfCounterRecord;
+
 #ifdef WINDOWS
 #define API_PREFIX __declspec(dllexport)
 #else
@@ -68,11 +140,46 @@ API_PREFIX void QuantizedConvOpSetupConvParameter(QuantizedConvOp *p, LAYOUT lay
                                                   size_t dialation_h, size_t dialation_w, size_t fusion_mask,
                                                   CONV_ALGORITHM algo);
 
+API_PREFIX void QuantizedConvOpSetupBNParameter(QuantizedConvOp *p, float *global_mean, float *variance, float *scale,
+                                                float *shift, float eps);
+
+// Calibrated activation quantization, q = round(x / scale) + zero_point in [0, 127]; count is 1 (per tensor) or
+// channel_in (per channel). Must be called before InitWeight.
+API_PREFIX void QuantizedConvOpSetupActivationQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                           size_t count);
+
+// Output requantization fused into the GEMM epilogue, same form as the activation quantization with count 1 or
+// channel_out. Must be called before InitWeight.
+API_PREFIX void QuantizedConvOpSetupOutputQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                       size_t count);
+
 API_PREFIX void QuantizedConvOpInitWeight(QuantizedConvOp *p, float *weight);
 
+// Prepacked weights. SaveWeight writes the packed weights of an initialized op to a file; LoadWeight maps such a file
+// read-only in place of InitWeight, sharing its pages with every process that loads it. Both return 0 on success and
+// -1 otherwise, e.g. for a file of another ISA build or other op parameters, after which the op needs InitWeight.
+API_PREFIX int QuantizedConvOpSaveWeight(QuantizedConvOp *p, const char *path);
+
+API_PREFIX int QuantizedConvOpLoadWeight(QuantizedConvOp *p, const char *path);
+
 API_PREFIX void QuantizedConvOpExecute(QuantizedConvOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                        size_t channel_in, size_t height_in, size_t width_in);
 
+// QuantizedConvOpExecute on the threads and CPUs of context.
+API_PREFIX void QuantizedConvOpExecuteInContext(QuantizedConvOp *p, QuantizedExecutionContext *context, float *dst,
+                                                float *data, float *bias, size_t batch_size, size_t channel_in,
+                                                size_t height_in, size_t width_in);
+
+// uint8 input needs the activation quantization of the producing op, uint8 output the output quantization.
+// SHUFFLED_UINT8_ACTIVATION is the packed GEMM data operand of a 1x1, stride 1, unpadded convolution or of an FC;
+// it is read in place when 64-byte aligned.
+API_PREFIX void QuantizedConvOpExecuteQuantized(QuantizedConvOp *p, void *dst, ACTIVATION_FORMAT dst_format,
+                                                void *data, ACTIVATION_FORMAT data_format, float *bias,
+                                                size_t batch_size, size_t channel_in, size_t height_in,
+                                                size_t width_in);
+
+API_PREFIX void QuantizedConvOpReleaseWorkspace(QuantizedConvOp *p);
+
 API_PREFIX void QuantizedConvOpFree(QuantizedConvOp *p);
 
 API_PREFIX QuantizedFCOp *QuantizedFCOpCreate();
@@ -80,11 +187,92 @@ API_PREFIX QuantizedFCOp *QuantizedFCOpCreate();
 API_PREFIX void QuantizedFCOpSetupFCParameter(QuantizedFCOp *p, LAYOUT layout, size_t channel_out, size_t channel_in,
                                               FC_ALGORITHM algo);
 
+API_PREFIX void QuantizedFCOpSetupActivationQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point,
+                                                         size_t count);
+
+API_PREFIX void QuantizedFCOpSetupOutputQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point,
+                                                     size_t count);
+
 API_PREFIX void QuantizedFCOpInitWeight(QuantizedFCOp *p, float *weight);
 
+API_PREFIX int QuantizedFCOpSaveWeight(QuantizedFCOp *p, const char *path);
+
+API_PREFIX int QuantizedFCOpLoadWeight(QuantizedFCOp *p, const char *path);
+
 API_PREFIX void QuantizedFCOpExecute(QuantizedFCOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                      size_t channel_in);
 
+// QuantizedFCOpExecute on the threads and CPUs of context.
+API_PREFIX void QuantizedFCOpExecuteInContext(QuantizedFCOp *p, QuantizedExecutionContext *context, float *dst,
+                                              float *data, float *bias, size_t batch_size, size_t channel_in);
+
+API_PREFIX void QuantizedFCOpExecuteQuantized(QuantizedFCOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                              ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                              size_t channel_in);
+
+// Bytes of a SHUFFLED_UINT8_ACTIVATION tensor with pixels (batch * height * width) rows of channels values.
+API_PREFIX size_t QuantizedShuffledActivationSize(size_t pixels, size_t channels);
+
+API_PREFIX void QuantizedFCOpReleaseWorkspace(QuantizedFCOp *p);
+
+// Persists the choices of AUTO_SELECT_CONV/AUTO_SELECT_FC to path and reuses the ones already recorded there; NULL
+// keeps them in memory only. Returns 0 on success.
+API_PREFIX int QuantizedSetTuningDatabase(const char *path);
+
+// Runs the parallel loops of all ops on OpenMP teams forked by each calling thread (the default), or on one pool of
+// threads_num persistent threads (0: one per hardware thread) shared by all calling threads, the calling thread being
+// one of them. A single call uses at most max_concurrency threads (0: no limit). Loops of ops executing meanwhile
+// finish on the backend they started with. Returns 0 on success.
+API_PREFIX int QuantizedSetThreadingBackend(THREADING_BACKEND backend, size_t threads_num, size_t max_concurrency);
+
+// A slice of the machine for the ops of one model instance: threads_num threads (0: one per CPU of cpus), the thread
+// that executes an op being one of them, that run on the cpus_num CPUs listed in cpus only (NULL: on any CPU). GEMM
+// blocking inside a context is sized to its threads and to the L3 share of its CPUs. Returns NULL on an invalid CPU.
+API_PREFIX QuantizedExecutionContext *QuantizedExecutionContextCreate(size_t threads_num, const int *cpus,
+                                                                      size_t cpus_num);
+
+// Runs every op the calling thread executes, including the tensor based API, in context until the next call; NULL
+// returns the thread to the threading backend. A context must not be freed while a thread is bound to it.
+API_PREFIX void QuantizedBindExecutionContext(QuantizedExecutionContext *context);
+
+API_PREFIX void QuantizedExecutionContextFree(QuantizedExecutionContext *context);
+// Memory of tensors, packed weights and workspaces. HUGE_PAGE_ALLOCATOR puts blocks of 2 MB and more on transparent
+// huge pages of their own, 2 MB aligned; ARENA_ALLOCATOR carves blocks out of 64 MB huge page chunks and reuses them
+// only once all its blocks are free, which suits the memory of one model. Returns NULL for an unknown kind.
+API_PREFIX QuantizedAllocator *QuantizedAllocatorCreate(ALLOCATOR_KIND kind);
+// An allocator on top of allocate(alignment, size, user_data), which returns NULL when out of memory, and
+// release(p, user_data).
+API_PREFIX QuantizedAllocator *QuantizedCustomAllocatorCreate(void *(*allocate)(size_t, size_t, void *),
+                                                              void (*release)(void *, void *), void *user_data);
+// Allocates all later memory of the process from allocator; NULL restores the default allocator.
+API_PREFIX void QuantizedSetAllocator(QuantizedAllocator *allocator);
+// Allocates the memory the calling thread asks for from allocator, ahead of the one of the process, until the next
+// call; NULL returns the thread to the allocator of the process.
+API_PREFIX void QuantizedBindAllocator(QuantizedAllocator *allocator);
+// Counters of the blocks allocator handed out, or of the whole process for NULL. Peak is the highest live_bytes.
+API_PREFIX void QuantizedGetAllocatorStats(QuantizedAllocator *allocator, QuantizedAllocatorStats *stats);
+// Blocks of the allocator stay valid and go back to it when freed; it must no longer be set or bound.
+API_PREFIX void QuantizedAllocatorFree(QuantizedAllocator *allocator);
+
+// Records the phases of every op in a ring of records_per_thread records per thread, overwriting the oldest; 0 stops
+// tracing. Drops the records so far.
+API_PREFIX void QuantizedTraceEnable(size_t records_per_thread);
+// Moves up to capacity records to records, grouped by thread and oldest first. Returns how many.
+API_PREFIX size_t QuantizedTraceFetch(QuantizedTraceRecord *records, size_t capacity);
+// Drops the records so far.
+API_PREFIX void QuantizedTraceFlush();
+// Moves the records so far to a Chrome trace JSON file (chrome://tracing, Perfetto). Returns 0 on success.
+API_PREFIX int QuantizedTraceExportChrome(const char *path);
+
+// Counts the CPU time and cycles, instructions and cache and TLB misses of every traced phase, summed over the thread
+// running it and the workers of its parallel loops, into totals per op and phase; 0 stops counting. Drops the totals
+// so far. Returns -1 if perf_event_open cannot count anything here.
+API_PREFIX int QuantizedPerfCountersEnable(int enable);
+// Copies up to capacity of the totals to records. Returns how many totals there are.
+API_PREFIX size_t QuantizedPerfCountersFetch(QuantizedPerfCounterRecord *records, size_t capacity);
+// Drops the totals so far.
+API_PREFIX void QuantizedPerfCountersReset();
+
 API_PREFIX void QuantizedFCOpFree(QuantizedFCOp *p);
 
 API_PREFIX void QuantizedConvKernelDescInit(QuantizedTensorDesc *quantized_tensor, size_t c_out, size_t c_in,
@@ -18,6 +18,7 @@
 #include "base.h"
 #include "common.h"
 #include "alloc.h"
+#include "trace.h"
 #include "model.h"
 #include "ops/ops.h"
 #include "nn/convolution_op.h"
@@ -38,14 +39,56 @@ void InternalQuantizedConvOpSetupConvParameter(QuantizedConvOp *p, LAYOUT layout
                                                            fusion_mask, algo);
 }
 
+void InternalQuantizedConvOpSetupBNParameter(QuantizedConvOp *p, float *global_mean, float *variance, float *scale,
+                                             float *shift, float eps) {
+  reinterpret_cast<ConvOp *>(p)->SetupBNParameter(global_mean, variance, scale, shift, eps);
+}
+
+void InternalQuantizedConvOpSetupActivationQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                        size_t count) {
+  reinterpret_cast<ConvOp *>(p)->SetupActivationQuantization(scale, zero_point, count);
+}
+
+void InternalQuantizedConvOpSetupOutputQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                    size_t count) {
+  reinterpret_cast<ConvOp *>(p)->SetupOutputQuantization(scale, zero_point, count);
+}
+
 void InternalQuantizedConvOpInitWeight(QuantizedConvOp *p, float *weight) {
   reinterpret_cast<ConvOp *>(p)->InitWeight(weight);
 }
 
+int InternalQuantizedConvOpSaveWeight(QuantizedConvOp *p, const char *path) {
+  return reinterpret_cast<ConvOp *>(p)->SaveWeight(path);
+}
+
+int InternalQuantizedConvOpLoadWeight(QuantizedConvOp *p, const char *path) {
+  return reinterpret_cast<ConvOp *>(p)->LoadWeight(path);
+}
+
 void InternalQuantizedConvOpExecute(QuantizedConvOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                     size_t channel_in, size_t height_in, size_t width_in) {
   reinterpret_cast<ConvOp *>(p)->Execute(dst, data, bias, batch_size, channel_in, height_in, width_in);
 }
+
+void InternalQuantizedConvOpExecuteInContext(QuantizedConvOp *p, QuantizedExecutionContext *context, float *dst,
+                                             float *data, float *bias, size_t batch_size, size_t channel_in,
+                                             size_t height_in, size_t width_in) {
+  ExecutionContextScope scope(reinterpret_cast<ThreadPool *>(context));
+  reinterpret_cast<ConvOp *>(p)->Execute(dst, data, bias, batch_size, channel_in, height_in, width_in);
+}
+
+void InternalQuantizedConvOpExecuteQuantized(QuantizedConvOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                             ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                             size_t channel_in, size_t height_in, size_t width_in) {
+  reinterpret_cast<ConvOp *>(p)->ExecuteQuantized(dst, dst_format, data, data_format, bias, batch_size, channel_in,
+                                                  height_in, width_in);
+}
+
+void InternalQuantizedConvOpReleaseWorkspace(QuantizedConvOp *p) {
+  reinterpret_cast<ConvOp *>(p)->ReleaseWorkspace();
+}
+
 void InternalQuantizedConvOpFree(QuantizedConvOp *p) {
   delete reinterpret_cast<ConvOp *>(p);
 }
@@ -60,19 +103,150 @@ void InternalQuantizedFCOpSetupFCParameter(QuantizedFCOp *p, LAYOUT layout, size
   reinterpret_cast<FCOp *>(p)->SetupFCKernelParameter(layout, channel_out, channel_in, algo);
 }
 
+void InternalQuantizedFCOpSetupActivationQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point,
+                                                      size_t count) {
+  reinterpret_cast<FCOp *>(p)->SetupActivationQuantization(scale, zero_point, count);
+}
+
+void InternalQuantizedFCOpSetupOutputQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point, size_t count) {
+  reinterpret_cast<FCOp *>(p)->SetupOutputQuantization(scale, zero_point, count);
+}
+
 void InternalQuantizedFCOpInitWeight(QuantizedFCOp *p, float *weight) {
   reinterpret_cast<FCOp *>(p)->InitWeight(weight);
 }
 
+int InternalQuantizedFCOpSaveWeight(QuantizedFCOp *p, const char *path) {
+  return reinterpret_cast<FCOp *>(p)->SaveWeight(path);
+}
+
+int InternalQuantizedFCOpLoadWeight(QuantizedFCOp *p, const char *path) {
+  return reinterpret_cast<FCOp *>(p)->LoadWeight(path);
+}
+
 void InternalQuantizedFCOpExecute(QuantizedFCOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                   size_t channel_in) {
   reinterpret_cast<FCOp *>(p)->Execute(dst, data, bias, batch_size, channel_in);
 }
 
+void InternalQuantizedFCOpExecuteInContext(QuantizedFCOp *p, QuantizedExecutionContext *context, float *dst,
+                                           float *data, float *bias, size_t batch_size, size_t channel_in) {
+  ExecutionContextScope scope(reinterpret_cast<ThreadPool *>(context));
+  reinterpret_cast<FCOp *>(p)->Execute(dst, data, bias, batch_size, channel_in);
+}
+
+void InternalQuantizedFCOpExecuteQuantized(QuantizedFCOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                           ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                           size_t channel_in) {
+  reinterpret_cast<FCOp *>(p)->ExecuteQuantized(dst, dst_format, data, data_format, bias, batch_size, channel_in);
+}
+
+void InternalQuantizedFCOpReleaseWorkspace(QuantizedFCOp *p) {
+  reinterpret_cast<FCOp *>(p)->ReleaseWorkspace();
+}
+
 void InternalQuantizedFCOpFree(QuantizedFCOp *p) {
   delete reinterpret_cast<FCOp *>(p);
 }
 
+size_t InternalQuantizedShuffledActivationSize(size_t pixels, size_t channels) {
+  return GetAlignmentLength(pixels, ACTIVATION_SHUFFLE_ROWS) * GetAlignmentLength(channels, ACTIVATION_SHUFFLE_COLS);
+}
+
+int InternalQuantizedSetTuningDatabase(const char *path) {
+  return TuningDatabase::Instance().Open(path);
+}
+
+int InternalQuantizedSetThreadingBackend(THREADING_BACKEND backend, size_t threads_num, size_t max_concurrency) {
+  return ParallelBackend::Instance().Configure(backend, threads_num, max_concurrency);
+}
+
+QuantizedExecutionContext *InternalQuantizedExecutionContextCreate(size_t threads_num, const int *cpus,
+                                                                   size_t cpus_num) {
+  std::vector<int> cpu_set;
+  if (cpus != NULL) {
+    cpu_set.assign(cpus, cpus + cpus_num);
+  }
+  if (!ValidCpuSet(cpu_set)) {
+    fprintf(stderr, "Invalid CPU set for an execution context.\n");
+    return NULL;
+  }
+  if (threads_num == 0) {
+    threads_num = cpu_set.empty() ? std::max(std::thread::hardware_concurrency(), 1u) : cpu_set.size();
+  }
+  // the thread that executes an op is one of the threads of the context
+  ThreadPool *p = new ThreadPool(threads_num - 1, cpu_set);
+  return reinterpret_cast<QuantizedExecutionContext *>(p);
+}
+
+void InternalQuantizedBindExecutionContext(QuantizedExecutionContext *context) {
+  BindExecutionContext(reinterpret_cast<ThreadPool *>(context));
+}
+
+void InternalQuantizedExecutionContextFree(QuantizedExecutionContext *context) {
+  delete reinterpret_cast<ThreadPool *>(context);
+}
+
+QuantizedAllocator *InternalQuantizedAllocatorCreate(ALLOCATOR_KIND kind) {
+  return reinterpret_cast<QuantizedAllocator *>(CreateAllocator(kind));
+}
+
+QuantizedAllocator *InternalQuantizedCustomAllocatorCreate(void *(*allocate)(size_t, size_t, void *),
+                                                           void (*release)(void *, void *), void *user_data) {
+  Allocator *allocator = new CustomAllocator(allocate, release, user_data);
+  return reinterpret_cast<QuantizedAllocator *>(allocator);
+}
+
+void InternalQuantizedSetAllocator(QuantizedAllocator *allocator) {
+  ProcessAllocator() = reinterpret_cast<Allocator *>(allocator);
+}
+
+void InternalQuantizedBindAllocator(QuantizedAllocator *allocator) {
+  BoundAllocator() = reinterpret_cast<Allocator *>(allocator);
+}
+
+void InternalQuantizedGetAllocatorStats(QuantizedAllocator *allocator, QuantizedAllocatorStats *stats) {
+  if (allocator == NULL) {
+    ProcessAllocationCounters::Instance().Read(stats);
+  } else {
+    reinterpret_cast<Allocator *>(allocator)->Read(stats);
+  }
+}
+
+void InternalQuantizedAllocatorFree(QuantizedAllocator *allocator) {
+  if (allocator != NULL) {
+    reinterpret_cast<Allocator *>(allocator)->Release();
+  }
+}
+
+void InternalQuantizedTraceEnable(size_t records_per_thread) {
+  Tracer::Instance().Enable(records_per_thread);
+}
+
+size_t InternalQuantizedTraceFetch(QuantizedTraceRecord *records, size_t capacity) {
+  return Tracer::Instance().Fetch(records, capacity);
+}
+
+void InternalQuantizedTraceFlush() {
+  Tracer::Instance().Flush();
+}
+
+int InternalQuantizedTraceExportChrome(const char *path) {
+  return Tracer::Instance().ExportChrome(path);
+}
+
+int InternalQuantizedPerfCountersEnable(int enable) {
+  return PerfCounters::Instance().Enable(enable != 0);
+}
+
+size_t InternalQuantizedPerfCountersFetch(QuantizedPerfCounterRecord *records, size_t capacity) {
+  return PerfCounters::Instance().Fetch(records, capacity);
+}
+
+void InternalQuantizedPerfCountersReset() {
+  PerfCounters::Instance().Reset();
+}
+
 // The following is  tensor based APU
 void InternalQuantizedConvKernelDescInit(QuantizedTensorDesc *quantized_tensor, size_t c_out, size_t c_in,
                                          size_t kernel_h, size_t kernel_w) {
@@ -112,23 +286,17 @@ void InternalQuantizedConvKernelInit(QuantizedTensorDesc *quantized_tensor, floa
 void InternalQuantizedConvKernelLoadFromModel(QuantizedTensorDesc *quantized_tensor, int8_t *src, float *min,
                                               float *max, size_t c_out, size_t c_in, size_t kernel_h, size_t kernel_w,
                                               float threshold, LAYOUT layout) {
-  aligned_malloc(&(quantized_tensor->min), 64, quantized_tensor->workspace_size_per_meta_info);
-  aligned_malloc(&(quantized_tensor->max), 64, quantized_tensor->workspace_size_per_meta_info);
-  aligned_malloc(&(quantized_tensor->ratio), 64, quantized_tensor->workspace_size_per_meta_info);
-  aligned_malloc(&(quantized_tensor->data), 64, quantized_tensor->workspace_size);
-  std::vector<float> fp_model(c_out * c_in * kernel_h * kernel_w);
-  DequantizeModel(fp_model.data(), src, min, max, c_out, c_in, kernel_h, kernel_w);
-  float *tmp;
+  int8_t *tmp;
   if (layout == NHWC) {
-    tmp = fp_model.data();
+    tmp = src;
   } else {
-    aligned_malloc(reinterpret_cast<void **>(&tmp), 64, sizeof(float) * c_out * c_in * kernel_h * kernel_w);
-    TransformLayout<float>(NHWC, NCHW, tmp, fp_model.data(), c_out, c_in, kernel_h * kernel_w);
+    aligned_malloc(reinterpret_cast<void **>(&tmp), 64, sizeof(int8_t) * c_out * c_in * kernel_h * kernel_w);
+    TransformLayout<int8_t>(NHWC, NCHW, tmp, src, c_out, c_in, kernel_h * kernel_w);
   }
-  shuffle::PadQuantizeShuffle2D<float, CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(
+  shuffle::PadRequantizeShuffle2D<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(
       reinterpret_cast<int8_t *>(quantized_tensor->data), quantized_tensor->ori_shape[0],
       quantized_tensor->ori_shape[1], GetAlignmentLength(quantized_tensor->ori_shape[0], CONV_SHUFFLE_KERNEL_M),
-      GetAlignmentLength(quantized_tensor->ori_shape[1], CONV_SHUFFLE_KERNEL_K), tmp,
+      GetAlignmentLength(quantized_tensor->ori_shape[1], CONV_SHUFFLE_KERNEL_K), tmp, min, max,
       reinterpret_cast<float *>(quantized_tensor->min), reinterpret_cast<float *>(quantized_tensor->max),
       reinterpret_cast<float *>(quantized_tensor->ratio), threshold);
   if (layout == NCHW) {
@@ -230,16 +398,10 @@ void InternalQuantizedFCKernelInit(QuantizedTensorDesc *quantized_tensor, float
 void InternalQuantizedFCKernelLoadFromModel(QuantizedTensorDesc *quantized_tensor, int8_t *src, float *min, float *max,
                                             size_t c_out, size_t c_in, float threshold, LAYOUT layout) {
   assert((layout == NCHW) || (layout == NHWC));
-  aligned_malloc(&(quantized_tensor->min), 64, quantized_tensor->workspace_size_per_meta_info);
-  aligned_malloc(&(quantized_tensor->max), 64, quantized_tensor->workspace_size_per_meta_info);
-  aligned_malloc(&(quantized_tensor->ratio), 64, quantized_tensor->workspace_size_per_meta_info);
-  aligned_malloc(&(quantized_tensor->data), 64, quantized_tensor->workspace_size);
-  std::vector<float> fp_model(c_out * c_in);
-  DequantizeModel(fp_model.data(), src, min, max, c_out, c_in, 1, 1);
-  shuffle::PadQuantizeShuffle2D<float, FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_K>(
+  shuffle::PadRequantizeShuffle2D<FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_K>(
       reinterpret_cast<int8_t *>(quantized_tensor->data), quantized_tensor->ori_shape[0],
       quantized_tensor->ori_shape[1], GetAlignmentLength(quantized_tensor->ori_shape[0], FC_SHUFFLE_KERNEL_M),
-      GetAlignmentLength(quantized_tensor->ori_shape[1], FC_SHUFFLE_KERNEL_K), fp_model.data(),
+      GetAlignmentLength(quantized_tensor->ori_shape[1], FC_SHUFFLE_KERNEL_K), src, min, max,
       reinterpret_cast<float *>(quantized_tensor->min), reinterpret_cast<float *>(quantized_tensor->max),
       reinterpret_cast<float *>(quantized_tensor->ratio), threshold);
 }
@@ -38,11 +38,33 @@ void (*QuantizedConvOpSetupConvParameterRT)(QuantizedConvOp *p, LAYOUT layout, s
                                             size_t stride_w, size_t pad_h, size_t pad_w, size_t dialation_h,
                                             size_t dialation_w, size_t fusion_mask, CONV_ALGORITHM algo);
 
+void (*QuantizedConvOpSetupBNParameterRT)(QuantizedConvOp *p, float *global_mean, float *variance, float *scale,
+                                          float *shift, float eps);
+
+void (*QuantizedConvOpSetupActivationQuantizationRT)(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                     size_t count);
+
+void (*QuantizedConvOpSetupOutputQuantizationRT)(QuantizedConvOp *p, float *scale, uint8_t *zero_point, size_t count);
+
 void (*QuantizedConvOpInitWeightRT)(QuantizedConvOp *p, float *weight);
 
+int (*QuantizedConvOpSaveWeightRT)(QuantizedConvOp *p, const char *path);
+
+int (*QuantizedConvOpLoadWeightRT)(QuantizedConvOp *p, const char *path);
+
 void (*QuantizedConvOpExecuteRT)(QuantizedConvOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                  size_t channel_in, size_t height_in, size_t width_in);
 
+void (*QuantizedConvOpExecuteInContextRT)(QuantizedConvOp *p, QuantizedExecutionContext *context, float *dst,
+                                          float *data, float *bias, size_t batch_size, size_t channel_in,
+                                          size_t height_in, size_t width_in);
+
+void (*QuantizedConvOpExecuteQuantizedRT)(QuantizedConvOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                          ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                          size_t channel_in, size_t height_in, size_t width_in);
+
+void (*QuantizedConvOpReleaseWorkspaceRT)(QuantizedConvOp *p);
+
 void (*QuantizedConvOpFreeRT)(QuantizedConvOp *p);
 
 QuantizedFCOp *(*QuantizedFCOpCreateRT)();
@@ -50,13 +72,69 @@ QuantizedFCOp *(*QuantizedFCOpCreateRT)();
 void (*QuantizedFCOpSetupFCParameterRT)(QuantizedFCOp *p, LAYOUT layout, size_t channel_out, size_t channel_in,
                                         FC_ALGORITHM algo);
 
+void (*QuantizedFCOpSetupActivationQuantizationRT)(QuantizedFCOp *p, float *scale, uint8_t *zero_point, size_t count);
+
+void (*QuantizedFCOpSetupOutputQuantizationRT)(QuantizedFCOp *p, float *scale, uint8_t *zero_point, size_t count);
+
 void (*QuantizedFCOpInitWeightRT)(QuantizedFCOp *p, float *weight);
 
+int (*QuantizedFCOpSaveWeightRT)(QuantizedFCOp *p, const char *path);
+
+int (*QuantizedFCOpLoadWeightRT)(QuantizedFCOp *p, const char *path);
+
 void (*QuantizedFCOpExecuteRT)(QuantizedFCOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                size_t channel_in);
 
+void (*QuantizedFCOpExecuteInContextRT)(QuantizedFCOp *p, QuantizedExecutionContext *context, float *dst, float *data,
+                                        float *bias, size_t batch_size, size_t channel_in);
+
+void (*QuantizedFCOpExecuteQuantizedRT)(QuantizedFCOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                        ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                        size_t channel_in);
+
+void (*QuantizedFCOpReleaseWorkspaceRT)(QuantizedFCOp *p);
+
 void (*QuantizedFCOpFreeRT)(QuantizedFCOp *p);
 
+size_t (*QuantizedShuffledActivationSizeRT)(size_t pixels, size_t channels);
+
+int (*QuantizedSetTuningDatabaseRT)(const char *path);
+
+int (*QuantizedSetThreadingBackendRT)(THREADING_BACKEND backend, size_t threads_num, size_t max_concurrency);
+
+QuantizedExecutionContext *(*QuantizedExecutionContextCreateRT)(size_t threads_num, const int *cpus, size_t cpus_num);
+
+void (*QuantizedBindExecutionContextRT)(QuantizedExecutionContext *context);
+
+void (*QuantizedExecutionContextFreeRT)(QuantizedExecutionContext *context);
+
+QuantizedAllocator *(*QuantizedAllocatorCreateRT)(ALLOCATOR_KIND kind);
+
+QuantizedAllocator *(*QuantizedCustomAllocatorCreateRT)(void *(*allocate)(size_t, size_t, void *),
+                                                        void (*release)(void *, void *), void *user_data);
+
+void (*QuantizedSetAllocatorRT)(QuantizedAllocator *allocator);
+
+void (*QuantizedBindAllocatorRT)(QuantizedAllocator *allocator);
+
+void (*QuantizedGetAllocatorStatsRT)(QuantizedAllocator *allocator, QuantizedAllocatorStats *stats);
+
+void (*QuantizedAllocatorFreeRT)(QuantizedAllocator *allocator);
+
+void (*QuantizedTraceEnableRT)(size_t records_per_thread);
+
+size_t (*QuantizedTraceFetchRT)(QuantizedTraceRecord *records, size_t capacity);
+
+void (*QuantizedTraceFlushRT)();
+
+int (*QuantizedTraceExportChromeRT)(const char *path);
+
+int (*QuantizedPerfCountersEnableRT)(int enable);
+
+size_t (*QuantizedPerfCountersFetchRT)(QuantizedPerfCounterRecord *records, size_t capacity);
+
+void (*QuantizedPerfCountersResetRT)();
+
 void (*QuantizedConvKernelDescInitRT)(QuantizedTensorDesc *quantized_tensor, size_t c_out, size_t c_in, size_t kernel_h,
                                       size_t kernel_w);
 
@@ -118,21 +196,96 @@ void BindSymbol() {
       reinterpret_cast<void (*)(QuantizedConvOp *, LAYOUT, size_t, size_t, size_t, size_t, size_t, size_t, size_t,
                                 size_t, size_t, size_t, size_t, size_t, CONV_ALGORITHM)>(
           BINDSYMBOL(handler, "InternalQuantizedConvOpSetupConvParameter"));
+  QuantizedConvOpSetupBNParameterRT = reinterpret_cast<void (*)(QuantizedConvOp *, float *, float *, float *, float *,
+                                                                float)>(
+      BINDSYMBOL(handler, "InternalQuantizedConvOpSetupBNParameter"));
+  QuantizedConvOpSetupActivationQuantizationRT =
+      reinterpret_cast<void (*)(QuantizedConvOp *, float *, uint8_t *, size_t)>(
+          BINDSYMBOL(handler, "InternalQuantizedConvOpSetupActivationQuantization"));
+  QuantizedConvOpSetupOutputQuantizationRT = reinterpret_cast<void (*)(QuantizedConvOp *, float *, uint8_t *, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedConvOpSetupOutputQuantization"));
   QuantizedConvOpInitWeightRT =
       reinterpret_cast<void (*)(QuantizedConvOp *, float *)>(BINDSYMBOL(handler, "InternalQuantizedConvOpInitWeight"));
+  QuantizedConvOpSaveWeightRT = reinterpret_cast<int (*)(QuantizedConvOp *, const char *)>(
+      BINDSYMBOL(handler, "InternalQuantizedConvOpSaveWeight"));
+  QuantizedConvOpLoadWeightRT = reinterpret_cast<int (*)(QuantizedConvOp *, const char *)>(
+      BINDSYMBOL(handler, "InternalQuantizedConvOpLoadWeight"));
   QuantizedConvOpExecuteRT =
       reinterpret_cast<void (*)(QuantizedConvOp *, float *, float *, float *, size_t, size_t, size_t, size_t)>(
           BINDSYMBOL(handler, "InternalQuantizedConvOpExecute"));
+  QuantizedConvOpExecuteInContextRT =
+      reinterpret_cast<void (*)(QuantizedConvOp *, QuantizedExecutionContext *, float *, float *, float *, size_t,
+                                size_t, size_t, size_t)>(
+          BINDSYMBOL(handler, "InternalQuantizedConvOpExecuteInContext"));
+  QuantizedConvOpExecuteQuantizedRT =
+      reinterpret_cast<void (*)(QuantizedConvOp *, void *, ACTIVATION_FORMAT, void *, ACTIVATION_FORMAT, float *,
+                                size_t, size_t, size_t, size_t)>(
+          BINDSYMBOL(handler, "InternalQuantizedConvOpExecuteQuantized"));
+  QuantizedConvOpReleaseWorkspaceRT =
+      reinterpret_cast<void (*)(QuantizedConvOp *)>(BINDSYMBOL(handler, "InternalQuantizedConvOpReleaseWorkspace"));
   QuantizedConvOpFreeRT =
       reinterpret_cast<void (*)(QuantizedConvOp *)>(BINDSYMBOL(handler, "InternalQuantizedConvOpFree"));
   QuantizedFCOpCreateRT = reinterpret_cast<QuantizedFCOp *(*)()>(BINDSYMBOL(handler, "InternalQuantizedFCOpCreate"));
   QuantizedFCOpSetupFCParameterRT = reinterpret_cast<void (*)(QuantizedFCOp *, LAYOUT, size_t, size_t, FC_ALGORITHM)>(
       BINDSYMBOL(handler, "InternalQuantizedFCOpSetupFCParameter"));
+  QuantizedFCOpSetupActivationQuantizationRT = reinterpret_cast<void (*)(QuantizedFCOp *, float *, uint8_t *, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedFCOpSetupActivationQuantization"));
+  QuantizedFCOpSetupOutputQuantizationRT = reinterpret_cast<void (*)(QuantizedFCOp *, float *, uint8_t *, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedFCOpSetupOutputQuantization"));
   QuantizedFCOpInitWeightRT =
       reinterpret_cast<void (*)(QuantizedFCOp *, float *)>(BINDSYMBOL(handler, "InternalQuantizedFCOpInitWeight"));
+  QuantizedFCOpSaveWeightRT = reinterpret_cast<int (*)(QuantizedFCOp *, const char *)>(
+      BINDSYMBOL(handler, "InternalQuantizedFCOpSaveWeight"));
+  QuantizedFCOpLoadWeightRT = reinterpret_cast<int (*)(QuantizedFCOp *, const char *)>(
+      BINDSYMBOL(handler, "InternalQuantizedFCOpLoadWeight"));
   QuantizedFCOpExecuteRT = reinterpret_cast<void (*)(QuantizedFCOp *, float *, float *, float *, size_t, size_t)>(
       BINDSYMBOL(handler, "InternalQuantizedFCOpExecute"));
+  QuantizedFCOpExecuteInContextRT = reinterpret_cast<void (*)(QuantizedFCOp *, QuantizedExecutionContext *, float *,
+                                                              float *, float *, size_t, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedFCOpExecuteInContext"));
+  QuantizedFCOpExecuteQuantizedRT = reinterpret_cast<void (*)(QuantizedFCOp *, void *, ACTIVATION_FORMAT, void *,
+                                                              ACTIVATION_FORMAT, float *, size_t, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedFCOpExecuteQuantized"));
+  QuantizedFCOpReleaseWorkspaceRT =
+      reinterpret_cast<void (*)(QuantizedFCOp *)>(BINDSYMBOL(handler, "InternalQuantizedFCOpReleaseWorkspace"));
   QuantizedFCOpFreeRT = reinterpret_cast<void (*)(QuantizedFCOp *)>(BINDSYMBOL(handler, "InternalQuantizedFCOpFree"));
+  QuantizedShuffledActivationSizeRT =
+      reinterpret_cast<size_t (*)(size_t, size_t)>(BINDSYMBOL(handler, "InternalQuantizedShuffledActivationSize"));
+  QuantizedSetTuningDatabaseRT =
+      reinterpret_cast<int (*)(const char *)>(BINDSYMBOL(handler, "InternalQuantizedSetTuningDatabase"));
+  QuantizedSetThreadingBackendRT = reinterpret_cast<int (*)(THREADING_BACKEND, size_t, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedSetThreadingBackend"));
+  QuantizedExecutionContextCreateRT = reinterpret_cast<QuantizedExecutionContext *(*)(size_t, const int *, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedExecutionContextCreate"));
+  QuantizedBindExecutionContextRT = reinterpret_cast<void (*)(QuantizedExecutionContext *)>(
+      BINDSYMBOL(handler, "InternalQuantizedBindExecutionContext"));
+  QuantizedExecutionContextFreeRT = reinterpret_cast<void (*)(QuantizedExecutionContext *)>(
+      BINDSYMBOL(handler, "InternalQuantizedExecutionContextFree"));
+  QuantizedAllocatorCreateRT = reinterpret_cast<QuantizedAllocator *(*)(ALLOCATOR_KIND)>(
+      BINDSYMBOL(handler, "InternalQuantizedAllocatorCreate"));
+  QuantizedCustomAllocatorCreateRT = reinterpret_cast<QuantizedAllocator *(*)(
+      void *(*)(size_t, size_t, void *), void (*)(void *, void *), void *)>(
+      BINDSYMBOL(handler, "InternalQuantizedCustomAllocatorCreate"));
+  QuantizedSetAllocatorRT =
+      reinterpret_cast<void (*)(QuantizedAllocator *)>(BINDSYMBOL(handler, "InternalQuantizedSetAllocator"));
+  QuantizedBindAllocatorRT =
+      reinterpret_cast<void (*)(QuantizedAllocator *)>(BINDSYMBOL(handler, "InternalQuantizedBindAllocator"));
+  QuantizedGetAllocatorStatsRT = reinterpret_cast<void (*)(QuantizedAllocator *, QuantizedAllocatorStats *)>(
+      BINDSYMBOL(handler, "InternalQuantizedGetAllocatorStats"));
+  QuantizedAllocatorFreeRT =
+      reinterpret_cast<void (*)(QuantizedAllocator *)>(BINDSYMBOL(handler, "InternalQuantizedAllocatorFree"));
+  QuantizedTraceEnableRT = reinterpret_cast<void (*)(size_t)>(BINDSYMBOL(handler, "InternalQuantizedTraceEnable"));
+  QuantizedTraceFetchRT = reinterpret_cast<size_t (*)(QuantizedTraceRecord *, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedTraceFetch"));
+  QuantizedTraceFlushRT = reinterpret_cast<void (*)()>(BINDSYMBOL(handler, "InternalQuantizedTraceFlush"));
+  QuantizedTraceExportChromeRT =
+      reinterpret_cast<int (*)(const char *)>(BINDSYMBOL(handler, "InternalQuantizedTraceExportChrome"));
+  QuantizedPerfCountersEnableRT =
+      reinterpret_cast<int (*)(int)>(BINDSYMBOL(handler, "InternalQuantizedPerfCountersEnable"));
+  QuantizedPerfCountersFetchRT = reinterpret_cast<size_t (*)(QuantizedPerfCounterRecord *, size_t)>(
+      BINDSYMBOL(handler, "InternalQuantizedPerfCountersFetch"));
+  QuantizedPerfCountersResetRT =
+      reinterpret_cast<void (*)()>(BINDSYMBOL(handler, "InternalQuantizedPerfCountersReset"));
   QuantizedConvKernelDescInitRT = reinterpret_cast<void (*)(QuantizedTensorDesc *, size_t, size_t, size_t, size_t)>(
       BINDSYMBOL(handler, "InternalQuantizedConvKernelDescInit"));
   QuantizedConvKernelInitRT =
@@ -290,15 +443,53 @@ void QuantizedConvOpSetupConvParameter(QuantizedConvOp *p, LAYOUT layout, size_t
                                       pad_h, pad_w, dialation_h, dialation_w, fusion_mask, algo);
 }
 
+void QuantizedConvOpSetupBNParameter(QuantizedConvOp *p, float *global_mean, float *variance, float *scale,
+                                     float *shift, float eps) {
+  QuantizedConvOpSetupBNParameterRT(p, global_mean, variance, scale, shift, eps);
+}
+
+void QuantizedConvOpSetupActivationQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point, size_t count) {
+  QuantizedConvOpSetupActivationQuantizationRT(p, scale, zero_point, count);
+}
+
+void QuantizedConvOpSetupOutputQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point, size_t count) {
+  QuantizedConvOpSetupOutputQuantizationRT(p, scale, zero_point, count);
+}
+
 void QuantizedConvOpInitWeight(QuantizedConvOp *p, float *weight) {
   QuantizedConvOpInitWeightRT(p, weight);
 }
 
+int QuantizedConvOpSaveWeight(QuantizedConvOp *p, const char *path) {
+  return QuantizedConvOpSaveWeightRT(p, path);
+}
+
+int QuantizedConvOpLoadWeight(QuantizedConvOp *p, const char *path) {
+  return QuantizedConvOpLoadWeightRT(p, path);
+}
+
 void QuantizedConvOpExecute(QuantizedConvOp *p, float *dst, float *data, float *bias, size_t batch_size,
                             size_t channel_in, size_t height_in, size_t width_in) {
   QuantizedConvOpExecuteRT(p, dst, data, bias, batch_size, channel_in, height_in, width_in);
 }
 
+void QuantizedConvOpExecuteInContext(QuantizedConvOp *p, QuantizedExecutionContext *context, float *dst, float *data,
+                                     float *bias, size_t batch_size, size_t channel_in, size_t height_in,
+                                     size_t width_in) {
+  QuantizedConvOpExecuteInContextRT(p, context, dst, data, bias, batch_size, channel_in, height_in, width_in);
+}
+
+void QuantizedConvOpExecuteQuantized(QuantizedConvOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                     ACTIVATION_FORMAT data_format, float *bias, size_t batch_size, size_t channel_in,
+                                     size_t height_in, size_t width_in) {
+  QuantizedConvOpExecuteQuantizedRT(p, dst, dst_format, data, data_format, bias, batch_size, channel_in, height_in,
+                                    width_in);
+}
+
+void QuantizedConvOpReleaseWorkspace(QuantizedConvOp *p) {
+  QuantizedConvOpReleaseWorkspaceRT(p);
+}
+
 void QuantizedConvOpFree(QuantizedConvOp *p) {
   QuantizedConvOpFreeRT(p);
 }
@@ -312,19 +503,126 @@ void QuantizedFCOpSetupFCParameter(QuantizedFCOp *p, LAYOUT layout, size_t chann
   QuantizedFCOpSetupFCParameterRT(p, layout, channel_out, channel_in, algo);
 }
 
+void QuantizedFCOpSetupActivationQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point, size_t count) {
+  QuantizedFCOpSetupActivationQuantizationRT(p, scale, zero_point, count);
+}
+
+void QuantizedFCOpSetupOutputQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point, size_t count) {
+  QuantizedFCOpSetupOutputQuantizationRT(p, scale, zero_point, count);
+}
+
 void QuantizedFCOpInitWeight(QuantizedFCOp *p, float *weight) {
   QuantizedFCOpInitWeightRT(p, weight);
 }
 
+int QuantizedFCOpSaveWeight(QuantizedFCOp *p, const char *path) {
+  return QuantizedFCOpSaveWeightRT(p, path);
+}
+
+int QuantizedFCOpLoadWeight(QuantizedFCOp *p, const char *path) {
+  return QuantizedFCOpLoadWeightRT(p, path);
+}
+
 void QuantizedFCOpExecute(QuantizedFCOp *p, float *dst, float *data, float *bias, size_t batch_size,
                           size_t channel_in) {
   QuantizedFCOpExecuteRT(p, dst, data, bias, batch_size, channel_in);
 }
 
+void QuantizedFCOpExecuteInContext(QuantizedFCOp *p, QuantizedExecutionContext *context, float *dst, float *data,
+                                   float *bias, size_t batch_size, size_t channel_in) {
+  QuantizedFCOpExecuteInContextRT(p, context, dst, data, bias, batch_size, channel_in);
+}
+
+void QuantizedFCOpExecuteQuantized(QuantizedFCOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                   ACTIVATION_FORMAT data_format, float *bias, size_t batch_size, size_t channel_in) {
+  QuantizedFCOpExecuteQuantizedRT(p, dst, dst_format, data, data_format, bias, batch_size, channel_in);
+}
+
+void QuantizedFCOpReleaseWorkspace(QuantizedFCOp *p) {
+  QuantizedFCOpReleaseWorkspaceRT(p);
+}
+
 void QuantizedFCOpFree(QuantizedFCOp *p) {
   QuantizedFCOpFreeRT(p);
 }
 
+size_t QuantizedShuffledActivationSize(size_t pixels, size_t channels) {
+  return QuantizedShuffledActivationSizeRT(pixels, channels);
+}
+
+int QuantizedSetTuningDatabase(const char *path) {
+  return QuantizedSetTuningDatabaseRT(path);
+}
+
+int QuantizedSetThreadingBackend(THREADING_BACKEND backend, size_t threads_num, size_t max_concurrency) {
+  return QuantizedSetThreadingBackendRT(backend, threads_num, max_concurrency);
+}
+
+QuantizedExecutionContext *QuantizedExecutionContextCreate(size_t threads_num, const int *cpus, size_t cpus_num) {
+  return QuantizedExecutionContextCreateRT(threads_num, cpus, cpus_num);
+}
+
+void QuantizedBindExecutionContext(QuantizedExecutionContext *context) {
+  QuantizedBindExecutionContextRT(context);
+}
+
+void QuantizedExecutionContextFree(QuantizedExecutionContext *context) {
+  QuantizedExecutionContextFreeRT(context);
+}
+
+QuantizedAllocator *QuantizedAllocatorCreate(ALLOCATOR_KIND kind) {
+  return QuantizedAllocatorCreateRT(kind);
+}
+
+QuantizedAllocator *QuantizedCustomAllocatorCreate(void *(*allocate)(size_t, size_t, void *),
+                                                   void (*release)(void *, void *), void *user_data) {
+  return QuantizedCustomAllocatorCreateRT(allocate, release, user_data);
+}
+
+void QuantizedSetAllocator(QuantizedAllocator *allocator) {
+  QuantizedSetAllocatorRT(allocator);
+}
+
+void QuantizedBindAllocator(QuantizedAllocator *allocator) {
+  QuantizedBindAllocatorRT(allocator);
+}
+
+void QuantizedGetAllocatorStats(QuantizedAllocator *allocator, QuantizedAllocatorStats *stats) {
+  QuantizedGetAllocatorStatsRT(allocator, stats);
+}
+
+void QuantizedAllocatorFree(QuantizedAllocator *allocator) {
+  QuantizedAllocatorFreeRT(allocator);
+}
+
+void QuantizedTraceEnable(size_t records_per_thread) {
+  QuantizedTraceEnableRT(records_per_thread);
+}
+
+size_t QuantizedTraceFetch(QuantizedTraceRecord *records, size_t capacity) {
+  return QuantizedTraceFetchRT(records, capacity);
+}
+
+void QuantizedTraceFlush() {
+  QuantizedTraceFlushRT();
+}
+
+int QuantizedTraceExportChrome(const char *path) {
+  return QuantizedTraceExportChromeRT(path);
+}
+
+int QuantizedPerfCountersEnable(int enable) {
+  return QuantizedPerfCountersEnableRT(enable);
+}
+
+size_t QuantizedPerfCountersFetch(QuantizedPerfCounterRecord *records, size_t capacity) {
+  return QuantizedPerfCountersFetchRT(records, capacity);
+}
+
+void QuantizedPerfCountersReset() {
+  QuantizedPerfCountersResetRT();
+}
+
 void QuantizedConvKernelDescInit(QuantizedTensorDesc *quantized_tensor, size_t c_out, size_t c_in, size_t kernel_h,
                                  size_t kernel_w) {
   QuantizedConvKernelDescInitRT(quantized_tensor, c_out, c_in, kernel_h, kernel_w);
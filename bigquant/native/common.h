@@ -23,6 +23,7 @@
 #include <numa.h>
 #endif
 #include "alloc.h"
+#include "parallel.h"
 /*
 INLINE_SPECIFIER void aligned_malloc(void** p, size_t alignment, size_t size) {
   *p = NULL;
@@ -65,20 +66,24 @@ INLINE_SPECIFIER size_t GetAlignmentLength(size_t n, size_t alignment = 1) {
 
 template <typename DType>
 void ComputeMatrixSumPerRow(DType *dst, DType *src, size_t m, size_t n) {
-#pragma omp parallel for
-  for (size_t i = 0; i < m; ++i) {
+  ParallelFor(m, [&](size_t i) {
     DType sum = 0;
     for (size_t j = 0; j < n; ++j) {
       sum += *(src + i * n + j);
     }
     dst[i] = sum;
-  }
+  });
 }
 
+// NUMA nodes of the machine; 1 unless built with NUMA and libnuma finds the kernel support it needs.
 INLINE_SPECIFIER size_t GetSocketNum() {
 #ifdef NUMA
-  return numa_num_configured_nodes();
-  else return 1;
+  if (numa_available() < 0) {
+    return 1;
+  }
+  return std::max(numa_num_configured_nodes(), 1);
+#else
+  return 1;
 #endif
 }
 
@@ -90,74 +95,253 @@ size_t GetBlockNum(size_t buffer_size, size_t tile_size, float ratio = 0.5) {
   return std::max(static_cast<size_t>(ratio * buffer_size / tile_size), static_cast<size_t>(1));
 }
 
+// Threads of the next parallel loop; unlike counting them inside a loop, this does not fork a team.
 size_t GetThreadsNum() {
-#ifdef _OPENMP
-  size_t n;
-#pragma omp parallel
-  {
-#pragma omp master
-    { n = omp_get_num_threads(); }
-  }
-  return n;
-#else
-  return 1;
-#endif
+  return ParallelConcurrency();
 }
 
 size_t GetThreadsNumWrapper() {
   return GetThreadsNum();
 }
 
-// TODO(yan): still need some improvement, cannot detect cache relation, unified or private
-template <size_t tile_m>
-INLINE_SPECIFIER void GetBlocksInfo(size_t m, size_t k, size_t &m_in_l1, size_t &m_in_l2, size_t &m_in_l3) {
-  size_t threads_num = GetThreadsNumWrapper();
+// Cache and core topology of the machine. cpuid is only issued on the first GetCpuTopology() call.
+struct CpuTopology {
+  size_t l1_cache_size_;
+  size_t l2_cache_size_;
+  size_t l3_cache_size_;
+  bool has_l3_;
+  bool l3_inclusive_;
+  size_t logical_cores_per_package_;
+  size_t smt_per_core_;
+};
+
+INLINE_SPECIFIER CpuTopology ProbeCpuTopology() {
+  CpuTopology topology;
   struct cache_info l1_info;
   struct cache_info l2_info;
   struct cache_info l3_info;
+  cpuid_caches(0, l1_info);
+  cpuid_caches(2, l2_info);
+  topology.l1_cache_size_ = l1_info.cache_size;
+  topology.l2_cache_size_ = l2_info.cache_size;
+  topology.has_l3_ = cpuid_caches(3, l3_info) == 0;
+  topology.l3_cache_size_ = topology.has_l3_ ? l3_info.cache_size : 0;
+  topology.l3_inclusive_ = topology.has_l3_ && l3_info.inclusive;
+  topology.logical_cores_per_package_ = std::max(l2_info.logic_cores_per_package & 0xffff, static_cast<size_t>(1));
+  uint32_t eax = 0xb, ebx, ecx = 0, edx;
+  __asm__("cpuid" : "+a"(eax), "=b"(ebx), "+c"(ecx), "=d"(edx));
+  topology.smt_per_core_ = std::max(static_cast<size_t>(ebx & 0xffff), static_cast<size_t>(1));
+  return topology;
+}
+
+INLINE_SPECIFIER const CpuTopology &GetCpuTopology() {
+  static const CpuTopology topology = ProbeCpuTopology();
+  return topology;
+}
+
+// L3 a GEMM started now by this thread may fill. Inside an execution context bound to CPUs it is the share of those
+// CPUs, since other contexts work on the rest of the package.
+INLINE_SPECIFIER size_t GetL3CacheBudget() {
+  const CpuTopology &topology = GetCpuTopology();
+  ThreadPool *pool = ScopedThreadPool();
+  if (pool == NULL || pool->Cpus().empty()) {
+    return topology.l3_cache_size_;
+  }
+  size_t cpus = std::min(pool->Cpus().size(), topology.logical_cores_per_package_);
+  return topology.l3_cache_size_ / topology.logical_cores_per_package_ * cpus;
+}
+
+// Loop schedules of ConvShuffleGEMM. EXCLUSIVE hands whole L3 blocks, sized to one thread's share of the L3, to
+// the threads statically; SHARED walks L3 blocks sized to the whole L3 and spreads their L2 blocks dynamically.
+enum LLC_SCHEDULE { LLC_SCHEDULE_EXCLUSIVE = 0, LLC_SCHEDULE_SHARED = 1 };
+
+// TODO(yan): still need some improvement, cannot detect cache relation, unified or private
+template <size_t tile_m>
+INLINE_SPECIFIER void GetBlocksInfo(size_t m, size_t k, size_t &m_in_l1, size_t &m_in_l2, size_t &m_in_l3,
+                                    LLC_SCHEDULE schedule, size_t threads_num, size_t l3_cache_size) {
+  const CpuTopology &topology = GetCpuTopology();
 
   size_t block_size = GetBlockSize(tile_m, k);
 
-  cpuid_caches(0, l1_info);
-  size_t l1_cache_size = l1_info.cache_size;
+  size_t l1_cache_size = topology.l1_cache_size_;
   size_t block_num_per_L1 = GetBlockNum(l1_cache_size, block_size);
 
-  cpuid_caches(2, l2_info);
-  size_t l2_cache_size = l2_info.cache_size;
+  size_t l2_cache_size = topology.l2_cache_size_;
   size_t block_num_per_L2 = GetBlockNum(l2_cache_size, block_size) / block_num_per_L1 * block_num_per_L1;
 
-  int ret = cpuid_caches(3, l3_info);
-  size_t l3_cache_size = l3_info.cache_size;
+  bool has_l3 = topology.has_l3_;
 
-#if defined(LLC_EXCLUSIVE)
-  l3_cache_size /= threads_num;
-  l3_cache_size += l2_cache_size;
-#else
-  l3_cache_size += l2_cache_size * threads_num;
-#endif
+  if (schedule == LLC_SCHEDULE_EXCLUSIVE) {
+    l3_cache_size /= threads_num;
+    l3_cache_size += l2_cache_size;
+  } else {
+    l3_cache_size += l2_cache_size * threads_num;
+  }
   size_t block_num_per_L3 = GetBlockNum(l3_cache_size, block_size) / block_num_per_L2 * block_num_per_L2;
 
-#if defined(LLC_EXCLUSIVE)
-  if (ret < 0) {
-    m_in_l2 = std::max(std::min(block_num_per_L2 * tile_m, m / threads_num / tile_m * tile_m), tile_m);
-    m_in_l1 = std::max(std::min(block_num_per_L1 * tile_m, m_in_l2 / 2 / tile_m * tile_m), tile_m);
-    m_in_l3 = m_in_l2;
+  if (schedule == LLC_SCHEDULE_EXCLUSIVE) {
+    if (!has_l3) {
+      m_in_l2 = std::max(std::min(block_num_per_L2 * tile_m, m / threads_num / tile_m * tile_m), tile_m);
+      m_in_l1 = std::max(std::min(block_num_per_L1 * tile_m, m_in_l2 / 2 / tile_m * tile_m), tile_m);
+      m_in_l3 = m_in_l2;
+    } else {
+      m_in_l3 = std::max(std::min(block_num_per_L3 * tile_m, m), tile_m);
+      m_in_l2 = std::max(std::min(block_num_per_L2 * tile_m, m_in_l3 / tile_m * tile_m), tile_m);
+      m_in_l1 = std::max(std::min(block_num_per_L1 * tile_m, m_in_l2 / 2 / tile_m * tile_m), tile_m);
+    }
   } else {
-    m_in_l3 = std::max(std::min(block_num_per_L3 * tile_m, m), tile_m);
-    m_in_l2 = std::max(std::min(block_num_per_L2 * tile_m, m_in_l3 / tile_m * tile_m), tile_m);
+    m_in_l3 = std::max(!has_l3 ? m : std::min(block_num_per_L3 * tile_m, m), tile_m);
+    m_in_l2 = std::max(std::min(block_num_per_L2 * tile_m, m_in_l3 / threads_num / tile_m * tile_m), tile_m);
     m_in_l1 = std::max(std::min(block_num_per_L1 * tile_m, m_in_l2 / 2 / tile_m * tile_m), tile_m);
   }
-#endif
-
-#if defined(LLC_SHARED)
-  m_in_l3 = std::max((ret < 0) ? m : std::min(block_num_per_L3 * tile_m, m), tile_m);
-  m_in_l2 = std::max(std::min(block_num_per_L2 * tile_m, m_in_l3 / threads_num / tile_m * tile_m), tile_m);
-  m_in_l1 = std::max(std::min(block_num_per_L1 * tile_m, m_in_l2 / 2 / tile_m * tile_m), tile_m);
-#endif
 
 #if defined(DEBUG)
   std::cerr << "l3:" << l3_cache_size << " l2: " << l2_cache_size << " l1:" << l1_cache_size << std::endl;
   std::cerr << "m:" << m << " m_in_l3:" << m_in_l3 << " m_in_l2: " << m_in_l2 << " m_in_l1:" << m_in_l1 << std::endl;
 #endif
 }
+
+// Blocking and loop order of one (m, n, k) shuffled GEMM. blocks_ holds the outer and inner extents followed by the
+// L3, L2, L1 and tile steps of each, with the longer of m and n outermost. A plan only depends on the shape, the
+// caches and the threads it runs on, so ops keep it across calls instead of blocking every GEMM again.
+struct GemmPlan {
+  GemmPlan()
+      : m_(0),
+        n_(0),
+        k_(0),
+        threads_num_(0),
+        l3_cache_size_(0),
+        mltn_(false),
+        schedule_(LLC_SCHEDULE_EXCLUSIVE),
+        k_slices_(1),
+        k_slice_(0) {
+  }
+
+  bool Matches(size_t m, size_t n, size_t k) const {
+    return (m_ == m) && (n_ == n) && (k_ == k) && (threads_num_ == GetThreadsNumWrapper()) &&
+           (l3_cache_size_ == GetL3CacheBudget());
+  }
+
+  // blocks handed out by the EXCLUSIVE schedule
+  size_t L3BlockNum() const {
+    return ((blocks_[0] + blocks_[2] - 1) / blocks_[2]) * ((blocks_[1] + blocks_[3] - 1) / blocks_[3]);
+  }
+
+  // blocks of one L3 block handed out by the SHARED schedule
+  size_t L2BlockNum() const {
+    return ((blocks_[2] + blocks_[4] - 1) / blocks_[4]) * ((blocks_[3] + blocks_[5] - 1) / blocks_[5]);
+  }
+
+  // tasks the threads share at a time under schedule_
+  size_t ParallelTasks() const {
+    return (schedule_ == LLC_SCHEDULE_SHARED) ? L2BlockNum() : L3BlockNum();
+  }
+
+  // int32 partial sums of a split-K GEMM, one tile per (tile, slice)
+  size_t PartialSumCount() const {
+    return (k_slices_ > 1) ? m_ * n_ * k_slices_ : 0;
+  }
+
+  size_t m_;
+  size_t n_;
+  size_t k_;
+  size_t threads_num_;
+  size_t l3_cache_size_;
+  bool mltn_;
+  LLC_SCHEDULE schedule_;
+  std::array<size_t, 10> blocks_;
+  // split-K: k_slices_ > 1 slices of k_slice_ (a multiple of kernel_k) per tile
+  size_t k_slices_;
+  size_t k_slice_;
+};
+
+// Cache blocking of schedule alone; MakeGemmPlan also partitions it for the thread count.
+template <size_t kernel_m, size_t kernel_n>
+GemmPlan BlockGemmPlan(size_t m, size_t n, size_t k, LLC_SCHEDULE schedule) {
+  GemmPlan plan;
+  plan.m_ = m;
+  plan.n_ = n;
+  plan.k_ = k;
+  plan.threads_num_ = GetThreadsNumWrapper();
+  plan.l3_cache_size_ = GetL3CacheBudget();
+  plan.schedule_ = schedule;
+  size_t m_in_l1, m_in_l2, m_in_l3, n_in_l1, n_in_l2, n_in_l3;
+  GetBlocksInfo<kernel_m>(m, k, m_in_l1, m_in_l2, m_in_l3, schedule, plan.threads_num_, plan.l3_cache_size_);
+  GetBlocksInfo<kernel_n>(n, k, n_in_l1, n_in_l2, n_in_l3, schedule, plan.threads_num_, plan.l3_cache_size_);
+  plan.mltn_ = m < n;
+  if (plan.mltn_) {
+    plan.blocks_ = {{n, m, n_in_l3, m_in_l3, n_in_l2, m_in_l2, n_in_l1, m_in_l1, kernel_n, kernel_m}};
+  } else {
+    plan.blocks_ = {{m, n, m_in_l3, n_in_l3, m_in_l2, n_in_l2, m_in_l1, n_in_l1, kernel_m, kernel_n}};
+  }
+  return plan;
+}
+
+// Halves the blocks the schedule hands to threads, the side with more tiles first, until there are target of them or
+// each is a single tile. Smaller blocks still fit the caches they were sized for; the levels below are clipped to
+// the new block size.
+INLINE_SPECIFIER void PartitionGemmPlan(GemmPlan &plan, size_t target) {
+  std::array<size_t, 10> &blocks = plan.blocks_;
+  size_t level = (plan.schedule_ == LLC_SCHEDULE_SHARED) ? 4 : 2;
+  while (plan.ParallelTasks() < target) {
+    size_t y_tiles = blocks[level] / blocks[8];
+    size_t x_tiles = blocks[level + 1] / blocks[9];
+    if (y_tiles <= 1 && x_tiles <= 1) {
+      break;
+    }
+    if (y_tiles >= x_tiles) {
+      blocks[level] = (y_tiles + 1) / 2 * blocks[8];
+    } else {
+      blocks[level + 1] = (x_tiles + 1) / 2 * blocks[9];
+    }
+  }
+  for (size_t inner = level + 2; inner < 8; ++inner) {
+    blocks[inner] = std::min(blocks[inner], blocks[inner - 2]);
+  }
+}
+
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k>
+GemmPlan MakeGemmPlan(size_t m, size_t n, size_t k, LLC_SCHEDULE schedule) {
+  GemmPlan plan = BlockGemmPlan<kernel_m, kernel_n>(m, n, k, schedule);
+  size_t target = GEMM_TASKS_PER_THREAD * plan.threads_num_;
+  PartitionGemmPlan(plan, target);
+  // Even one tile per task is too coarse: give each tile as many K slices as make up the target.
+  size_t tiles = (m / kernel_m) * (n / kernel_n);
+  size_t chunks = k / kernel_k;
+  size_t min_chunks = std::max(static_cast<size_t>(SPLIT_K_MIN_SLICE) / kernel_k, static_cast<size_t>(1));
+  if (tiles > 0 && tiles < target && chunks >= 2 * min_chunks) {
+    size_t slices = std::min(target / tiles, chunks / min_chunks);
+    if (slices > 1) {
+      plan.k_slice_ = (chunks + slices - 1) / slices * kernel_k;
+      plan.k_slices_ = (k + plan.k_slice_ - 1) / plan.k_slice_;
+    }
+  }
+  return plan;
+}
+
+// Building with LLC_MODE=SHARED or EXCLUSIVE forces one schedule. Otherwise an inclusive L3, which mirrors every L2
+// and so leaves a thread little of its own share, gets SHARED, as does a GEMM whose cache blocking has fewer L3 blocks
+// than threads, which the static EXCLUSIVE schedule could only balance by giving up L3 block size.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k>
+GemmPlan MakeGemmPlan(size_t m, size_t n, size_t k) {
+#if defined(LLC_SHARED)
+  return MakeGemmPlan<kernel_m, kernel_n, kernel_k>(m, n, k, LLC_SCHEDULE_SHARED);
+#elif defined(LLC_EXCLUSIVE)
+  return MakeGemmPlan<kernel_m, kernel_n, kernel_k>(m, n, k, LLC_SCHEDULE_EXCLUSIVE);
+#else
+  GemmPlan blocked = BlockGemmPlan<kernel_m, kernel_n>(m, n, k, LLC_SCHEDULE_EXCLUSIVE);
+  bool shared = GetCpuTopology().l3_inclusive_ || blocked.L3BlockNum() < blocked.threads_num_;
+  return MakeGemmPlan<kernel_m, kernel_n, kernel_k>(m, n, k, shared ? LLC_SCHEDULE_SHARED : LLC_SCHEDULE_EXCLUSIVE);
+#endif
+}
+
+// plan if it was made for this GEMM, otherwise a new one in local_plan.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k>
+const GemmPlan *SelectGemmPlan(const GemmPlan *plan, GemmPlan &local_plan, size_t m, size_t n, size_t k) {
+  if (plan != NULL && plan->Matches(m, n, k)) {
+    return plan;
+  }
+  local_plan = MakeGemmPlan<kernel_m, kernel_n, kernel_k>(m, n, k);
+  return &local_plan;
+}
 #endif
@@ -35,11 +35,34 @@ void InternalQuantizedConvOpSetupConvParameter(QuantizedConvOp *p, LAYOUT layout
                                                size_t stride_w, size_t pad_h, size_t pad_w, size_t dialation_h,
                                                size_t dialation_w, size_t fusion_mask, CONV_ALGORITHM algo);
 
+void InternalQuantizedConvOpSetupBNParameter(QuantizedConvOp *p, float *global_mean, float *variance, float *scale,
+                                             float *shift, float eps);
+
+void InternalQuantizedConvOpSetupActivationQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                        size_t count);
+
+void InternalQuantizedConvOpSetupOutputQuantization(QuantizedConvOp *p, float *scale, uint8_t *zero_point,
+                                                    size_t count);
+
 void InternalQuantizedConvOpInitWeight(QuantizedConvOp *p, float *weight);
 
+int InternalQuantizedConvOpSaveWeight(QuantizedConvOp *p, const char *path);
+
+int InternalQuantizedConvOpLoadWeight(QuantizedConvOp *p, const char *path);
+
 void InternalQuantizedConvOpExecute(QuantizedConvOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                     size_t channel_in, size_t height_in, size_t width_in);
 
+void InternalQuantizedConvOpExecuteInContext(QuantizedConvOp *p, QuantizedExecutionContext *context, float *dst,
+                                             float *data, float *bias, size_t batch_size, size_t channel_in,
+                                             size_t height_in, size_t width_in);
+
+void InternalQuantizedConvOpExecuteQuantized(QuantizedConvOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                             ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                             size_t channel_in, size_t height_in, size_t width_in);
+
+void InternalQuantizedConvOpReleaseWorkspace(QuantizedConvOp *p);
+
 void InternalQuantizedConvOpFree(QuantizedConvOp *p);
 
 QuantizedFCOp *InternalQuantizedFCOpCreate();
@@ -47,11 +70,69 @@ QuantizedFCOp *InternalQuantizedFCOpCreate();
 void InternalQuantizedFCOpSetupFCParameter(QuantizedFCOp *p, LAYOUT layout, size_t channel_out, size_t channel_in,
                                            FC_ALGORITHM algo);
 
+void InternalQuantizedFCOpSetupActivationQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point,
+                                                      size_t count);
+
+void InternalQuantizedFCOpSetupOutputQuantization(QuantizedFCOp *p, float *scale, uint8_t *zero_point, size_t count);
+
 void InternalQuantizedFCOpInitWeight(QuantizedFCOp *p, float *weight);
 
+int InternalQuantizedFCOpSaveWeight(QuantizedFCOp *p, const char *path);
+
+int InternalQuantizedFCOpLoadWeight(QuantizedFCOp *p, const char *path);
+
 void InternalQuantizedFCOpExecute(QuantizedFCOp *p, float *dst, float *data, float *bias, size_t batch_size,
                                   size_t channel_in);
 
+void InternalQuantizedFCOpExecuteInContext(QuantizedFCOp *p, QuantizedExecutionContext *context, float *dst,
+                                           float *data, float *bias, size_t batch_size, size_t channel_in);
+
+void InternalQuantizedFCOpExecuteQuantized(QuantizedFCOp *p, void *dst, ACTIVATION_FORMAT dst_format, void *data,
+                                           ACTIVATION_FORMAT data_format, float *bias, size_t batch_size,
+                                           size_t channel_in);
+
+size_t InternalQuantizedShuffledActivationSize(size_t pixels, size_t channels);
+
+void InternalQuantizedFCOpReleaseWorkspace(QuantizedFCOp *p);
+
+int InternalQuantizedSetTuningDatabase(const char *path);
+
+int InternalQuantizedSetThreadingBackend(THREADING_BACKEND backend, size_t threads_num, size_t max_concurrency);
+
+QuantizedExecutionContext *InternalQuantizedExecutionContextCreate(size_t threads_num, const int *cpus,
+                                                                   size_t cpus_num);
+
+void InternalQuantizedBindExecutionContext(QuantizedExecutionContext *context);
+
+void InternalQuantizedExecutionContextFree(QuantizedExecutionContext *context);
+
+QuantizedAllocator *InternalQuantizedAllocatorCreate(ALLOCATOR_KIND kind);
+
+QuantizedAllocator *InternalQuantizedCustomAllocatorCreate(void *(*allocate)(size_t, size_t, void *),
+                                                           void (*release)(void *, void *), void *user_data);
+
+void InternalQuantizedSetAllocator(QuantizedAllocator *allocator);
+
+void InternalQuantizedBindAllocator(QuantizedAllocator *allocator);
+
+void InternalQuantizedGetAllocatorStats(QuantizedAllocator *allocator, QuantizedAllocatorStats *stats);
+
+void InternalQuantizedAllocatorFree(QuantizedAllocator *allocator);
+
+void InternalQuantizedTraceEnable(size_t records_per_thread);
+
+size_t InternalQuantizedTraceFetch(QuantizedTraceRecord *records, size_t capacity);
+
+void InternalQuantizedTraceFlush();
+
+int InternalQuantizedTraceExportChrome(const char *path);
+
+int InternalQuantizedPerfCountersEnable(int enable);
+
+size_t InternalQuantizedPerfCountersFetch(QuantizedPerfCounterRecord *records, size_t capacity);
+
+void InternalQuantizedPerfCountersReset();
+
 void InternalQuantizedFCOpFree(QuantizedFCOp *p);
 
 void InternalQuantizedConvKernelDescInit(QuantizedTensorDesc *quantized_tensor, size_t c_out, size_t c_in,
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_ACTIVATION_QUANTIZATION_H
+#define NN_ACTIVATION_QUANTIZATION_H
+
+#include "../base.h"
+#include "../common.h"
+#include "../tensor.h"
+
+// Calibrated activation quantization, q = clamp(round(x / scale) + zero_point, 0, threshold), given per tensor
+// (count 1) or per input channel. Parameters are expanded to one entry per input channel.
+//
+// A per-channel scale cannot be applied per GEMM column, so it is folded into the weight instead:
+// sum_k w[k] * x[k] = sum_k (w[k] * scale[k]) * (q[k] - zero_point[k]). The zero point term is constant per output
+// channel and replaces the kernel sum; each data column then has ratio 1 and min 1.
+struct ActivationQuantization {
+  ActivationQuantization(float *scale, uint8_t *zero_point, size_t count, size_t channels, float threshold)
+      : scale_(make_shape(channels), 64), inv_scale_(make_shape(channels), 64), zero_point_(make_shape(channels), 64) {
+    if (count != 1 && count != channels) {
+      fprintf(stderr, "Activation quantization needs 1 or channel_in (%zu) parameters, got %zu.\n", channels, count);
+      exit(-1);
+    }
+    for (size_t c = 0; c < channels; ++c) {
+      size_t i = (count == 1) ? 0 : c;
+      if (!(scale[i] > 0.0f) || zero_point[i] > threshold) {
+        fprintf(stderr, "Invalid activation quantization parameter for channel %zu.\n", c);
+        exit(-1);
+      }
+      scale_.data_[c] = scale[i];
+      inv_scale_.data_[c] = 1.0f / scale[i];
+      zero_point_.data_[c] = zero_point[i];
+    }
+  }
+
+  ActivationQuantization(const ActivationQuantization &) = delete;
+
+  ActivationQuantization &operator=(const ActivationQuantization &) = delete;
+
+  // weight: (channel_out, channel_in_per_group, spatial) in NCHW, (channel_out, spatial, channel_in_per_group) in NHWC
+  void FoldScale(float *dst, float *weight, size_t channel_out, size_t groups, size_t channel_in_per_group,
+                 size_t spatial, LAYOUT layout) {
+    size_t channel_out_per_group = channel_out / groups;
+    ParallelFor(channel_out, [&](size_t o) {
+      float *group_scale = scale_.data_ + o / channel_out_per_group * channel_in_per_group;
+      for (size_t c = 0; c < channel_in_per_group; ++c) {
+        for (size_t s = 0; s < spatial; ++s) {
+          size_t index = (layout == NCHW) ? (o * channel_in_per_group + c) * spatial + s
+                                          : (o * spatial + s) * channel_in_per_group + c;
+          dst[index] = weight[index] * group_scale[c];
+        }
+      }
+    });
+  }
+
+  // Negated zero points of one group along the NHWC gemm_k axis, (spatial, channel_in_per_group).
+  void ZeroPointPerK(float *dst, size_t group, size_t channel_in_per_group, size_t spatial) {
+    for (size_t s = 0; s < spatial; ++s) {
+      for (size_t c = 0; c < channel_in_per_group; ++c) {
+        dst[s * channel_in_per_group + c] = -zero_point_.data_[group * channel_in_per_group + c];
+      }
+    }
+  }
+
+  Tensor<float> scale_;
+  Tensor<float> inv_scale_;
+  Tensor<float> zero_point_;
+};
+
+// uint8 activations are only meaningful with the parameters they were quantized with: input needs the activation
+// quantization of the op, output its output quantization.
+inline void CheckActivationFormat(ACTIVATION_FORMAT out_format, ACTIVATION_FORMAT data_format,
+                                  ActivationQuantization *activation_quantization,
+                                  ActivationQuantization *output_quantization) {
+  if (data_format != FLOAT_ACTIVATION && activation_quantization == NULL) {
+    fprintf(stderr, "uint8 input requires SetupActivationQuantization.\n");
+    exit(-1);
+  }
+  if (out_format != FLOAT_ACTIVATION && output_quantization == NULL) {
+    fprintf(stderr, "uint8 output requires SetupOutputQuantization.\n");
+    exit(-1);
+  }
+}
+
+// Bytes per element of a float or uint8 activation.
+inline size_t ActivationElementSize(ACTIVATION_FORMAT format) {
+  return (format == FLOAT_ACTIVATION) ? sizeof(float) : sizeof(uint8_t);
+}
+
+// The GEMM kernels load the packed data operand with aligned SIMD loads; a shuffled tensor that is not 64-byte aligned
+// is copied into the workspace first.
+inline bool IsShuffledActivationAligned(const void *data) {
+  return reinterpret_cast<uintptr_t>(data) % 64 == 0;
+}
+
+#endif
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_AUTOTUNE_H
+#define NN_AUTOTUNE_H
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include "../base.h"
+#include "../common.h"
+
+// Timed runs per candidate after one warm-up run; the best one counts.
+#define AUTOTUNE_REPEAT 3
+
+// Decisions of AUTO_SELECT_CONV and AUTO_SELECT_FC, keyed by machine, op parameters, input shape and thread count.
+// They live for the process; once a database file is opened they are also appended to it, one "<key> <choice>" line
+// each, so that later runs on the same kind of machine skip the timing.
+struct TuningDatabase {
+  static TuningDatabase &Instance() {
+    static TuningDatabase database;
+    return database;
+  }
+
+  // Loads the decisions recorded in path and appends new ones to it; NULL stops appending. Returns 0 on success.
+  int Open(const char *path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (path == NULL) {
+      path_.clear();
+      return 0;
+    }
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+      file = fopen(path, "a");
+      if (file == NULL) {
+        fprintf(stderr, "Cannot open tuning database %s.\n", path);
+        return -1;
+      }
+      fclose(file);
+      path_ = path;
+      return 0;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file) != NULL) {
+      std::string record(line);
+      size_t separator = record.rfind(' ');
+      if (separator != std::string::npos) {
+        decisions_[record.substr(0, separator)] = atoi(record.c_str() + separator + 1);
+      }
+    }
+    fclose(file);
+    path_ = path;
+    return 0;
+  }
+
+  bool Lookup(const std::string &key, int &choice) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = decisions_.find(key);
+    if (it == decisions_.end()) {
+      return false;
+    }
+    choice = it->second;
+    return true;
+  }
+
+  void Record(const std::string &key, int choice) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decisions_[key] = choice;
+    if (path_.empty()) {
+      return;
+    }
+    FILE *file = fopen(path_.c_str(), "a");
+    if (file == NULL) {
+      fprintf(stderr, "Cannot append to tuning database %s.\n", path_.c_str());
+      return;
+    }
+    fprintf(file, "%s %d\n", key.c_str(), choice);
+    fclose(file);
+  }
+
+ private:
+  TuningDatabase() = default;
+
+  std::mutex mutex_;
+  std::map<std::string, int> decisions_;
+  std::string path_;
+};
+
+// "<op>:<isa>:<cpu signature>:<threads>:<params...>"
+inline std::string TuningKey(const char *op, const std::vector<size_t> &params) {
+  char prefix[64];
+  snprintf(prefix, sizeof(prefix), "%s:%d:%x:%zu", op, static_cast<int>(BUILD_CPU_FEATURE), cpuid_signature(),
+           GetThreadsNum());
+  std::string key(prefix);
+  for (size_t i = 0; i < params.size(); ++i) {
+    key += (i == 0) ? ':' : ',';
+    key += std::to_string(params[i]);
+  }
+  return key;
+}
+
+// Runs the candidate recorded for key, or times every candidate on the real input and records the fastest. run(c)
+// computes the full output with candidate c, so the output always comes from the returned choice. drop(c) is called
+// for every other candidate as soon as it is out of the running, so that at most two of them are set up at a time.
+template <typename Run, typename Drop>
+int SelectTuningCandidate(const std::string &key, const std::vector<int> &candidates, Run run, Drop drop) {
+  int choice;
+  if (TuningDatabase::Instance().Lookup(key, choice) &&
+      std::find(candidates.begin(), candidates.end(), choice) != candidates.end()) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      if (candidates[i] != choice) {
+        drop(candidates[i]);
+      }
+    }
+    run(choice);
+    return choice;
+  }
+  double best_time = DBL_MAX;
+  choice = candidates[0];
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    run(candidates[i]);
+    double candidate_time = DBL_MAX;
+    for (size_t r = 0; r < AUTOTUNE_REPEAT; ++r) {
+      auto start = std::chrono::steady_clock::now();
+      run(candidates[i]);
+      double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      candidate_time = std::min(candidate_time, time);
+    }
+    if (candidate_time < best_time) {
+      if (i != 0) {
+        drop(choice);
+      }
+      best_time = candidate_time;
+      choice = candidates[i];
+    } else {
+      drop(candidates[i]);
+    }
+  }
+  if (choice != candidates.back()) {
+    run(choice);
+  }
+  TuningDatabase::Instance().Record(key, choice);
+  return choice;
+}
+
+template <typename Run>
+int SelectTuningCandidate(const std::string &key, const std::vector<int> &candidates, Run run) {
+  return SelectTuningCandidate(key, candidates, run, [](int) {});
+}
+
+#endif
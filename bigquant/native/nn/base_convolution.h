@@ -21,9 +21,8 @@
 #include "../common.h"
 #include "../tensor.h"
 #include "../ops/ops.h"
-#ifdef TIME_PROFILE
-#include <chrono>
-#endif
+#include "activation_quantization.h"
+#include "packed_weight.h"
 
 struct ConvolutionKernelDesc {
   LAYOUT layout_;
@@ -43,6 +42,17 @@ struct ConvolutionKernelDesc {
   size_t dilation_w_;
 
   size_t fusion_mask_;
+
+  float *global_mean_;
+  float *mul_variance_coeff_;
+  float *scale_;
+  float *shift_;
+
+  ActivationQuantization *activation_quantization_;
+  ActivationQuantization *output_quantization_;
+
+  // LLC schedule of the GEMM plans of SHUFFLE_CONV: 0 leaves it to MakeGemmPlan, 1 + LLC_SCHEDULE forces one
+  size_t gemm_schedule_;
 };
 
 struct ConvolutionDataDesc {
@@ -66,10 +76,21 @@ struct BaseConvolutionAlgo {
   virtual void InitWeight(float *weight, ConvolutionKernelDesc &conv_kernel_desc) = 0;
   virtual void Execute(float *out, float *data, float *bias, ConvolutionDataDesc &conv_data_desc,
                        ConvolutionKernelDesc &conv_kernel_desc) = 0;
-
- protected:
-  size_t height_out_;
-  size_t width_out_;
+  virtual void ExecuteQuantized(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+                                float *bias, ConvolutionDataDesc &conv_data_desc,
+                                ConvolutionKernelDesc &conv_kernel_desc) {
+    fprintf(stderr, "uint8 activations are only supported by SHUFFLE_CONV.\n");
+    exit(-1);
+  }
+  // Serializes the packed weights of InitWeight, or maps them in its place. Algorithms without a packed format
+  // return false.
+  virtual bool SaveWeight(PackedWeightWriter &writer) {
+    return false;
+  }
+  virtual bool LoadWeight(PackedWeightFile &file, ConvolutionKernelDesc &conv_kernel_desc) {
+    return false;
+  }
+  virtual void ReleaseWorkspace() = 0;
 };
 
 #endif
@@ -21,15 +21,22 @@
 #include "../common.h"
 #include "../tensor.h"
 #include "../ops/ops.h"
+#include "activation_quantization.h"
+#include "packed_weight.h"
 
 struct FCKernelDesc {
   LAYOUT layout_;
   size_t channel_out_;
   size_t channel_in_;
+
+  ActivationQuantization *activation_quantization_;
+  ActivationQuantization *output_quantization_;
 };
 struct FCDataDesc {
   size_t batch_size_;
   size_t channel_in_;
+  // Runs batches below FC_SHUFFLE_KERNEL_N through the GEMM tile instead of the GEMV kernel.
+  bool force_gemm_;
 };
 
 struct BaseFCAlgo {
@@ -45,6 +52,20 @@ struct BaseFCAlgo {
   virtual void InitWeight(float *weight, FCKernelDesc &fc_kernel_desc) = 0;
   virtual void Execute(float *out, float *data, float *bias, FCDataDesc &fc_data_desc,
                        FCKernelDesc &fc_kernel_desc) = 0;
+  virtual void ExecuteQuantized(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+                                float *bias, FCDataDesc &fc_data_desc, FCKernelDesc &fc_kernel_desc) {
+    fprintf(stderr, "uint8 activations are only supported by SHUFFLE_FC.\n");
+    exit(-1);
+  }
+  // Serializes the packed weights of InitWeight, or maps them in its place. Algorithms without a packed format
+  // return false.
+  virtual bool SaveWeight(PackedWeightWriter &writer) {
+    return false;
+  }
+  virtual bool LoadWeight(PackedWeightFile &file, FCKernelDesc &fc_kernel_desc) {
+    return false;
+  }
+  virtual void ReleaseWorkspace() = 0;
 };
 
 #endif
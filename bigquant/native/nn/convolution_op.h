@@ -17,21 +17,48 @@
 #ifndef NN_CONVOLUTION_OP_H
 #define NN_CONVOLUTION_OP_H
 
+#include <map>
+#include <mutex>
+#include <tuple>
 #include "base_convolution.h"
 #include "shuffle_convolution.h"
-
-#ifdef TIME_PROFILE
-#include <chrono>
-#endif
+#include "winograd_convolution.h"
+#include "depthwise_convolution.h"
+#include "autotune.h"
+#include "numa_execution.h"
+#include "../trace.h"
 
 // typedef enum CONV_ALGORITHM {SHULLFE_CONV=0} CONV_ALGORITHM;
 
+// Tuning candidates of AUTO_SELECT_CONV are CONV_ALGORITHM + CONV_TUNING_ALGORITHMS * gemm_schedule.
+#define CONV_TUNING_ALGORITHMS 16
+
 struct ConvOp {
-  ConvOp() : algo_id_(AUTO_SELECT_CONV), algo_(NULL) {
+  // an input shape AUTO_SELECT_CONV tunes for: batch, height, width and threads
+  typedef std::tuple<size_t, size_t, size_t, size_t> ConvShape;
+
+  ConvOp()
+      : algo_id_(AUTO_SELECT_CONV),
+        algo_(NULL),
+        algo_choice_(SHUFFLE_CONV),
+        conv_kernel_desc_(),
+        tuning_weight_(NULL),
+        global_mean_(NULL),
+        mul_variance_coeff_(NULL),
+        scale_(NULL),
+        shift_(NULL),
+        activation_quantization_(NULL),
+        output_quantization_(NULL),
+        packed_weight_(NULL),
+        weight_initialized_(false) {
   }
 
   ~ConvOp() {
-    delete algo_;
+    FreeAlgo();
+    delete packed_weight_;
+    FreeBNParameter();
+    delete activation_quantization_;
+    delete output_quantization_;
   }
 
   ConvOp(const ConvOp&) = delete;
@@ -41,43 +68,481 @@ struct ConvOp {
   void SetupConvolutionParameter(LAYOUT layout, size_t channel_out, size_t channel_in, size_t groups, size_t kernel_h,
                                  size_t kernel_w, size_t stride_h, size_t stride_w, size_t pad_h, size_t pad_w,
                                  size_t dilation_h, size_t dilation_w, size_t fusion_mask, CONV_ALGORITHM algo) {
+    if (fusion_mask > CONV_RELU_BN_FUSION) {
+      fprintf(stderr, "Unsupported fusion mask.\n");
+      exit(-1);
+    }
     conv_kernel_desc_ = {
         layout,   channel_out, channel_in, groups, channel_out / groups, channel_in / groups, kernel_h,   kernel_w,
         stride_h, stride_w,    pad_h,      pad_w,  dilation_h,           dilation_w,          fusion_mask};
+    // BN parameters set up for another channel_out would be read past their end by the epilogue.
+    if (global_mean_ != NULL && global_mean_->Count() != channel_out) {
+      FreeBNParameter();
+    }
+    BindBNParameter();
+    delete activation_quantization_;
+    delete output_quantization_;
+    activation_quantization_ = NULL;
+    output_quantization_ = NULL;
+    weight_initialized_ = false;
+    FreeAlgo();
+    delete packed_weight_;
+    packed_weight_ = NULL;
     ChooseAlgo(algo);
   }
 
-  void SetupConvolutionDataParameter(size_t batch_size, size_t channel_in, size_t height_in, size_t width_in) {
-    conv_data_desc_ = {batch_size, channel_in, height_in, width_in};
+  void SetupBNParameter(float *global_mean, float *variance, float *scale, float *shift, float eps) {
+    size_t channel_out = conv_kernel_desc_.channel_out_;
+    if (channel_out == 0) {
+      fprintf(stderr, "SetupBNParameter must be called after SetupConvolutionParameter\n");
+      exit(-1);
+    }
+    FreeBNParameter();
+    global_mean_ = new Tensor<float>(make_shape(channel_out), 64);
+    mul_variance_coeff_ = new Tensor<float>(make_shape(channel_out), 64);
+    memcpy(global_mean_->data_, global_mean, channel_out * sizeof(float));
+    for (size_t c = 0; c < channel_out; ++c) {
+      mul_variance_coeff_->data_[c] = 1.0f / sqrtf(variance[c] + eps);
+    }
+    if (scale != NULL) {
+      scale_ = new Tensor<float>(make_shape(channel_out), 64);
+      memcpy(scale_->data_, scale, channel_out * sizeof(float));
+    }
+    if (shift != NULL) {
+      shift_ = new Tensor<float>(make_shape(channel_out), 64);
+      memcpy(shift_->data_, shift, channel_out * sizeof(float));
+    }
+    BindBNParameter();
+  }
+
+  // Switches Execute to calibrated activation quantization. The scale is folded into the weight, so this has to come
+  // before InitWeight.
+  void SetupActivationQuantization(float *scale, uint8_t *zero_point, size_t count) {
+    if (conv_kernel_desc_.channel_in_ == 0 || weight_initialized_) {
+      fprintf(stderr, "SetupActivationQuantization must be called between SetupConvolutionParameter and InitWeight\n");
+      exit(-1);
+    }
+    delete activation_quantization_;
+    activation_quantization_ =
+        new ActivationQuantization(scale, zero_point, count, conv_kernel_desc_.channel_in_, 127.0f);
+    conv_kernel_desc_.activation_quantization_ = activation_quantization_;
+    FreeAlgo();
+    ChooseAlgo(algo_id_);
+  }
+
+  // Lets ExecuteQuantized requantize the output to uint8 in the GEMM epilogue, for the next op to consume with the
+  // same parameters as its activation quantization.
+  void SetupOutputQuantization(float *scale, uint8_t *zero_point, size_t count) {
+    if (conv_kernel_desc_.channel_out_ == 0 || weight_initialized_) {
+      fprintf(stderr, "SetupOutputQuantization must be called between SetupConvolutionParameter and InitWeight\n");
+      exit(-1);
+    }
+    delete output_quantization_;
+    output_quantization_ = new ActivationQuantization(scale, zero_point, count, conv_kernel_desc_.channel_out_, 127.0f);
+    conv_kernel_desc_.output_quantization_ = output_quantization_;
+    FreeAlgo();
+    ChooseAlgo(algo_id_);
+  }
+
+  void BindBNParameter() {
+    conv_kernel_desc_.global_mean_ = (global_mean_ == NULL) ? NULL : global_mean_->data_;
+    conv_kernel_desc_.mul_variance_coeff_ = (mul_variance_coeff_ == NULL) ? NULL : mul_variance_coeff_->data_;
+    conv_kernel_desc_.scale_ = (scale_ == NULL) ? NULL : scale_->data_;
+    conv_kernel_desc_.shift_ = (shift_ == NULL) ? NULL : shift_->data_;
+  }
+
+  void FreeBNParameter() {
+    delete global_mean_;
+    delete mul_variance_coeff_;
+    delete scale_;
+    delete shift_;
+    global_mean_ = NULL;
+    mul_variance_coeff_ = NULL;
+    scale_ = NULL;
+    shift_ = NULL;
+  }
+
+  BaseConvolutionAlgo *CreateAlgo(CONV_ALGORITHM algo_id) {
+    switch (algo_id) {
+      case WINOGRAD_CONV:
+        return new WinogradConvolutionAlgo(conv_kernel_desc_);
+      case DEPTHWISE_CONV:
+        return new DepthwiseConvolutionAlgo(conv_kernel_desc_);
+      default:
+        return new ShuffleConvolutionAlgo(conv_kernel_desc_);
+    }
+  }
+
+  void SetAlgo(CONV_ALGORITHM algo_id) {
+    algo_choice_ = algo_id;
+    algo_ = CreateAlgo(algo_id);
   }
 
   void ChooseAlgo(CONV_ALGORITHM algo_id) {
     algo_id_ = algo_id;
+    conv_kernel_desc_.gemm_schedule_ = 0;
     switch (algo_id_) {
       case SHUFFLE_CONV: {
-        algo_ = new ShuffleConvolutionAlgo(conv_kernel_desc_);
+        SetAlgo(SHUFFLE_CONV);
+        break;
+      }
+      case WINOGRAD_CONV: {
+        CheckStaticQuantizationSupport();
+        SetAlgo(WINOGRAD_CONV);
+        break;
+      }
+      case DEPTHWISE_CONV: {
+        CheckStaticQuantizationSupport();
+        SetAlgo(DEPTHWISE_CONV);
         break;
       }
       default: {
-        algo_ = new ShuffleConvolutionAlgo(conv_kernel_desc_);
+        if (activation_quantization_ != NULL || output_quantization_ != NULL) {
+          SetAlgo(SHUFFLE_CONV);
+          break;
+        }
+        // Depthwise layers prefer the native kernel. Winograd is slower than SHUFFLE_CONV on the measured layers and
+        // loses accuracy in its transforms, so it only runs when asked for as WINOGRAD_CONV.
+        CONV_ALGORITHM preferred =
+            DepthwiseConvolutionAlgo::IsSupported(conv_kernel_desc_) ? DEPTHWISE_CONV : SHUFFLE_CONV;
+        SetAlgo(preferred);
+        // The applicable algorithms, and the LLC schedules of SHUFFLE_CONV, are timed against it on the first
+        // Execute.
+        const CONV_ALGORITHM algos[] = {preferred, SHUFFLE_CONV, DEPTHWISE_CONV};
+        for (size_t i = 0; i < sizeof(algos) / sizeof(algos[0]); ++i) {
+          bool supported = (algos[i] == SHUFFLE_CONV) ||
+                           (algos[i] == DEPTHWISE_CONV && DepthwiseConvolutionAlgo::IsSupported(conv_kernel_desc_));
+          if (!supported || (i != 0 && algos[i] == preferred)) {
+            continue;
+          }
+#if !defined(LLC_SHARED) && !defined(LLC_EXCLUSIVE)
+          if (algos[i] == SHUFFLE_CONV) {
+            tuning_ids_.push_back(ConvTuningCandidate(SHUFFLE_CONV, 1 + LLC_SCHEDULE_EXCLUSIVE));
+            tuning_ids_.push_back(ConvTuningCandidate(SHUFFLE_CONV, 1 + LLC_SCHEDULE_SHARED));
+            continue;
+          }
+#endif
+          tuning_ids_.push_back(ConvTuningCandidate(algos[i], 0));
+        }
+        if (tuning_ids_.size() < 2) {
+          tuning_ids_.clear();
+        }
         break;
       }
     }
   }
 
+  // A candidate of AUTO_SELECT_CONV: an algorithm and the ConvolutionKernelDesc::gemm_schedule_ it runs with.
+  static int ConvTuningCandidate(CONV_ALGORITHM algo_id, size_t gemm_schedule) {
+    return static_cast<int>(algo_id + CONV_TUNING_ALGORITHMS * gemm_schedule);
+  }
+
+  // The algorithm of a candidate, packed from tuning_weight_ the first time it is timed. Tuning lock held.
+  BaseConvolutionAlgo *TuningAlgo(int candidate) {
+    CONV_ALGORITHM algo_id = static_cast<CONV_ALGORITHM>(candidate % CONV_TUNING_ALGORITHMS);
+    auto iter = tuning_algos_.find(algo_id);
+    if (iter != tuning_algos_.end()) {
+      return iter->second;
+    }
+    BaseConvolutionAlgo *algo = CreateAlgo(algo_id);
+    algo->InitWeight(tuning_weight_->data_, conv_kernel_desc_);
+    tuning_algos_[algo_id] = algo;
+    return algo;
+  }
+
+  // Frees an algorithm packed for tuning unless it is algo_, the choice for some shape, or still in the running in
+  // pending. Tuning lock held.
+  void DropTuningAlgo(CONV_ALGORITHM algo_id, const std::vector<int> &pending) {
+    if (algo_id == algo_choice_) {
+      return;
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+      if (pending[i] % CONV_TUNING_ALGORITHMS == algo_id) {
+        return;
+      }
+    }
+    for (auto iter = shape_choices_.begin(); iter != shape_choices_.end(); ++iter) {
+      if (iter->second % CONV_TUNING_ALGORITHMS == algo_id) {
+        return;
+      }
+    }
+    auto iter = tuning_algos_.find(algo_id);
+    if (iter != tuning_algos_.end()) {
+      numa_replicas_.Clear(iter->second);
+      delete iter->second;
+      tuning_algos_.erase(iter);
+    }
+  }
+
+  // Forgets the choices made so far and frees every algorithm but algo_.
+  void ResetTuning() {
+    for (auto iter = tuning_algos_.begin(); iter != tuning_algos_.end(); ++iter) {
+      if (iter->second != algo_) {
+        numa_replicas_.Clear(iter->second);
+        delete iter->second;
+      }
+    }
+    tuning_algos_.clear();
+    shape_choices_.clear();
+  }
+
+  // Ends AUTO_SELECT_CONV tuning with algo_: frees the other candidates and the weight they are packed from.
+  void DropTuningCandidates() {
+    ResetTuning();
+    tuning_ids_.clear();
+    delete tuning_weight_;
+    tuning_weight_ = NULL;
+  }
+
+  void FreeAlgo() {
+    numa_replicas_.Clear();
+    DropTuningCandidates();
+    delete algo_;
+    algo_ = NULL;
+  }
+
+  void CheckStaticQuantizationSupport() {
+    if (activation_quantization_ != NULL || output_quantization_ != NULL) {
+      fprintf(stderr, "Calibrated activation quantization is only supported by SHUFFLE_CONV.\n");
+      exit(-1);
+    }
+  }
+
+  // AUTO_SELECT_CONV only packs algo_ here; the other candidates are packed from a copy of the weight, which the op
+  // keeps, when the first input of a shape times them.
   void InitWeight(float *weight) {
+    numa_replicas_.Clear();
+    ResetTuning();
     algo_->InitWeight(weight, conv_kernel_desc_);
+    if (!tuning_ids_.empty()) {
+      ConvolutionKernelDesc &desc = conv_kernel_desc_;
+      delete tuning_weight_;
+      tuning_weight_ = new Tensor<float>(
+          make_shape(desc.channel_out_, desc.channel_in_per_group_, desc.kernel_h_, desc.kernel_w_), 64);
+      memcpy(tuning_weight_->data_, weight, tuning_weight_->Size());
+      tuning_algos_[algo_choice_] = algo_;
+    }
+    weight_initialized_ = true;
+  }
+
+  PackedWeightHeader MakeHeader() {
+    ConvolutionKernelDesc &desc = conv_kernel_desc_;
+    return MakePackedWeightHeader(CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K, algo_choice_,
+                                  {desc.layout_, desc.channel_out_, desc.channel_in_, desc.group_, desc.kernel_h_,
+                                   desc.kernel_w_},
+                                  activation_quantization_);
+  }
+
+  // Writes the weights packed by InitWeight to path. Returns 0 on success. AUTO_SELECT_CONV writes the algorithm
+  // chosen for the latest shape it tuned.
+  int SaveWeight(const char *path) {
+    std::lock_guard<std::mutex> lock(tuning_mutex_);
+    PackedWeightWriter writer;
+    if (!weight_initialized_ || !algo_->SaveWeight(writer)) {
+      fprintf(stderr, "SaveWeight needs initialized weights of an algorithm with a packed format.\n");
+      return -1;
+    }
+    return writer.Commit(path, MakeHeader()) ? 0 : -1;
+  }
+
+  // Maps a file written by SaveWeight in place of InitWeight. It must come from the same ISA build and op
+  // parameters; otherwise -1 is returned and the op still needs InitWeight. Only the algorithm the op ran with is
+  // packed in the file, so AUTO_SELECT_CONV takes that one, where it applies, instead of tuning.
+  int LoadWeight(const char *path) {
+    PackedWeightFile *file = new PackedWeightFile();
+    FreeAlgo();
+    ChooseAlgo(algo_id_);
+    DropTuningCandidates();
+    bool mapped = file->Map(path);
+    if (mapped && algo_id_ == AUTO_SELECT_CONV && activation_quantization_ == NULL && output_quantization_ == NULL) {
+      CONV_ALGORITHM packed = static_cast<CONV_ALGORITHM>(file->Header()->algo_);
+      bool supported = (packed == SHUFFLE_CONV) ||
+                       (packed == WINOGRAD_CONV && WinogradConvolutionAlgo::IsSupported(conv_kernel_desc_)) ||
+                       (packed == DEPTHWISE_CONV && DepthwiseConvolutionAlgo::IsSupported(conv_kernel_desc_));
+      if (supported && packed != algo_choice_) {
+        delete algo_;
+        SetAlgo(packed);
+      }
+    }
+    if (!mapped || !file->Matches(MakeHeader()) || !algo_->LoadWeight(*file, conv_kernel_desc_) ||
+        !file->Exhausted()) {
+      FreeAlgo();
+      ChooseAlgo(algo_id_);
+      delete file;
+      weight_initialized_ = false;
+      return -1;
+    }
+    delete packed_weight_;
+    packed_weight_ = file;
+    weight_initialized_ = true;
+    return 0;
   }
 
   void Execute(float *out, float *data, float *bias, size_t batch_size, size_t channel_in, size_t height_in,
                size_t width_in) {
-    SetupConvolutionDataParameter(batch_size, channel_in, height_in, width_in);
-    algo_->Execute(out, data, bias, conv_data_desc_, conv_kernel_desc_);
+    if (conv_kernel_desc_.fusion_mask_ >= CONV_BN_FUSION && conv_kernel_desc_.global_mean_ == NULL) {
+      fprintf(stderr, "BN fusion requested without BN parameters\n");
+      exit(-1);
+    }
+    TraceOpScope trace(this);
+    ConvolutionDataDesc conv_data_desc = {batch_size, channel_in, height_in, width_in};
+    if (tuning_weight_ != NULL) {
+      ExecuteTuned(out, data, bias, conv_data_desc);
+      return;
+    }
+    if (!ExecuteOnNodes(algo_, algo_choice_, conv_kernel_desc_, out, FLOAT_ACTIVATION, data, FLOAT_ACTIVATION, bias,
+                        conv_data_desc)) {
+      algo_->Execute(out, data, bias, conv_data_desc, conv_kernel_desc_);
+    }
+  }
+
+  // AUTO_SELECT_CONV runs each input shape with the candidate chosen for it. The first input of a shape tunes it
+  // while other callers wait.
+  void ExecuteTuned(float *out, float *data, float *bias, ConvolutionDataDesc &conv_data_desc) {
+    ConvShape shape(conv_data_desc.batch_size_, conv_data_desc.height_in_, conv_data_desc.width_in_, GetThreadsNum());
+    std::unique_lock<std::mutex> lock(tuning_mutex_);
+    auto iter = shape_choices_.find(shape);
+    if (iter == shape_choices_.end()) {
+      Tune(shape, out, data, bias, conv_data_desc);
+      return;
+    }
+    int choice = iter->second;
+    BaseConvolutionAlgo *algo = tuning_algos_[static_cast<CONV_ALGORITHM>(choice % CONV_TUNING_ALGORITHMS)];
+    lock.unlock();
+    RunTuningCandidate(algo, choice, out, data, bias, conv_data_desc);
+  }
+
+  // Runs candidate, an algorithm packed as algo and an LLC schedule, on a copy of the kernel desc.
+  void RunTuningCandidate(BaseConvolutionAlgo *algo, int candidate, float *out, float *data, float *bias,
+                          ConvolutionDataDesc &conv_data_desc) {
+    ConvolutionKernelDesc desc = conv_kernel_desc_;
+    desc.gemm_schedule_ = candidate / CONV_TUNING_ALGORITHMS;
+    CONV_ALGORITHM algo_id = static_cast<CONV_ALGORITHM>(candidate % CONV_TUNING_ALGORITHMS);
+    if (!ExecuteOnNodes(algo, algo_id, desc, out, FLOAT_ACTIVATION, data, FLOAT_ACTIVATION, bias, conv_data_desc)) {
+      algo->Execute(out, data, bias, conv_data_desc, desc);
+    }
+  }
+
+  // Times the AUTO_SELECT_CONV candidates on this input, or looks the decision up, and keeps the choice for its
+  // shape; algo_ becomes the algorithm of the choice. Tuning lock held.
+  void Tune(const ConvShape &shape, float *out, float *data, float *bias, ConvolutionDataDesc &conv_data_desc) {
+    ConvolutionKernelDesc &desc = conv_kernel_desc_;
+    std::string key = TuningKey(
+        "conv", {desc.layout_, desc.channel_out_, desc.channel_in_, desc.group_, desc.kernel_h_, desc.kernel_w_,
+                 desc.stride_h_, desc.stride_w_, desc.pad_h_, desc.pad_w_, desc.dilation_h_, desc.dilation_w_,
+                 desc.fusion_mask_, conv_data_desc.batch_size_, conv_data_desc.height_in_, conv_data_desc.width_in_});
+    std::vector<int> pending = tuning_ids_;
+    int choice = SelectTuningCandidate(
+        key, tuning_ids_,
+        [&](int candidate) { RunTuningCandidate(TuningAlgo(candidate), candidate, out, data, bias, conv_data_desc); },
+        [&](int candidate) {
+          pending.erase(std::remove(pending.begin(), pending.end(), candidate), pending.end());
+          DropTuningAlgo(static_cast<CONV_ALGORITHM>(candidate % CONV_TUNING_ALGORITHMS), pending);
+        });
+    shape_choices_[shape] = choice;
+    CONV_ALGORITHM previous = algo_choice_;
+    algo_choice_ = static_cast<CONV_ALGORITHM>(choice % CONV_TUNING_ALGORITHMS);
+    algo_ = tuning_algos_[algo_choice_];
+    DropTuningAlgo(previous, std::vector<int>());
+  }
+
+  void ExecuteQuantized(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+                        float *bias, size_t batch_size, size_t channel_in, size_t height_in, size_t width_in) {
+    if (conv_kernel_desc_.fusion_mask_ >= CONV_BN_FUSION && conv_kernel_desc_.global_mean_ == NULL) {
+      fprintf(stderr, "BN fusion requested without BN parameters\n");
+      exit(-1);
+    }
+    CheckActivationFormat(out_format, data_format, activation_quantization_, output_quantization_);
+    if (out_format == FLOAT_ACTIVATION && data_format == FLOAT_ACTIVATION) {
+      Execute(static_cast<float *>(out), static_cast<float *>(data), bias, batch_size, channel_in, height_in, width_in);
+      return;
+    }
+    TraceOpScope trace(this);
+    ConvolutionDataDesc conv_data_desc = {batch_size, channel_in, height_in, width_in};
+    if (!ExecuteOnNodes(algo_, algo_choice_, conv_kernel_desc_, out, out_format, data, data_format, bias,
+                        conv_data_desc)) {
+      algo_->ExecuteQuantized(out, out_format, data, data_format, bias, conv_data_desc, conv_kernel_desc_);
+    }
+  }
+
+  // NUMA mode: a batch of NCHW or NHWC activations runs as one slice of images per node, against the weight replica
+  // of the node; algo_id is the algorithm of algo, which the replicas are loaded into, and desc the kernel desc it runs
+  // with. Calls inside an execution context return false and run as usual.
+  bool ExecuteOnNodes(BaseConvolutionAlgo *algo, CONV_ALGORITHM algo_id, ConvolutionKernelDesc &desc, void *out,
+                      ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format, float *bias,
+                      ConvolutionDataDesc &conv_data_desc) {
+    NumaTeams &teams = NumaTeams::Instance();
+    size_t nodes = teams.Nodes();
+    if (nodes < 2 || ScopedThreadPool() != NULL || conv_data_desc.batch_size_ < 2 ||
+        out_format == SHUFFLED_UINT8_ACTIVATION || data_format == SHUFFLED_UINT8_ACTIVATION) {
+      return false;
+    }
+    const std::vector<BaseConvolutionAlgo *> &replicas =
+        numa_replicas_.Get(algo, desc, [&]() { return CreateAlgo(algo_id); });
+    if (replicas.empty()) {
+      return false;
+    }
+    size_t height_out =
+        GetConvOutSize(conv_data_desc.height_in_, desc.kernel_h_, desc.stride_h_, desc.pad_h_, desc.dilation_h_);
+    size_t width_out =
+        GetConvOutSize(conv_data_desc.width_in_, desc.kernel_w_, desc.stride_w_, desc.pad_w_, desc.dilation_w_);
+    size_t out_image = desc.channel_out_ * height_out * width_out * ActivationElementSize(out_format);
+    size_t data_image = conv_data_desc.channel_in_ * conv_data_desc.height_in_ * conv_data_desc.width_in_ *
+                        ActivationElementSize(data_format);
+    teams.Run([&](size_t node) {
+      size_t begin, count;
+      NumaBatchSlice(conv_data_desc.batch_size_, nodes, node, begin, count);
+      if (count == 0) {
+        return;
+      }
+      TraceOpScope trace(this);
+      ConvolutionDataDesc slice = conv_data_desc;
+      slice.batch_size_ = count;
+      void *slice_out = static_cast<char *>(out) + begin * out_image;
+      void *slice_data = static_cast<char *>(data) + begin * data_image;
+      if (out_format == FLOAT_ACTIVATION && data_format == FLOAT_ACTIVATION) {
+        replicas[node]->Execute(static_cast<float *>(slice_out), static_cast<float *>(slice_data), bias, slice, desc);
+      } else {
+        replicas[node]->ExecuteQuantized(slice_out, out_format, slice_data, data_format, bias, slice, desc);
+      }
+    });
+    return true;
+  }
+
+  void ReleaseWorkspace() {
+    std::lock_guard<std::mutex> lock(tuning_mutex_);
+    algo_->ReleaseWorkspace();
+    numa_replicas_.ReleaseWorkspace();
+    for (auto iter = tuning_algos_.begin(); iter != tuning_algos_.end(); ++iter) {
+      if (iter->second != algo_) {
+        iter->second->ReleaseWorkspace();
+      }
+    }
   }
 
   CONV_ALGORITHM algo_id_;
   BaseConvolutionAlgo *algo_;
+  // the algorithm of algo_, which AUTO_SELECT_CONV leaves open
+  CONV_ALGORITHM algo_choice_;
   ConvolutionKernelDesc conv_kernel_desc_;
-  ConvolutionDataDesc conv_data_desc_;
+  // AUTO_SELECT_CONV candidates, those of the default algorithm first, empty when there is nothing to choose from.
+  // The op keeps the weight they are packed from, the choice for every input shape tuned so far and the algorithms of
+  // those choices, algo_ among them; the tuning lock guards the latter two.
+  std::vector<int> tuning_ids_;
+  Tensor<float> *tuning_weight_;
+  std::map<ConvShape, int> shape_choices_;
+  std::map<CONV_ALGORITHM, BaseConvolutionAlgo *> tuning_algos_;
+  std::mutex tuning_mutex_;
+
+  Tensor<float> *global_mean_;
+  Tensor<float> *mul_variance_coeff_;
+  Tensor<float> *scale_;
+  Tensor<float> *shift_;
+
+  ActivationQuantization *activation_quantization_;
+  ActivationQuantization *output_quantization_;
+  PackedWeightFile *packed_weight_;
+  bool weight_initialized_;
+  NumaWeightReplicas<BaseConvolutionAlgo, ConvolutionKernelDesc> numa_replicas_;
 };
 #endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_DEPTHWISE_CONVOLUTION_H
+#define NN_DEPTHWISE_CONVOLUTION_H
+
+#include "base_convolution.h"
+#include "workspace_pool.h"
+
+// Per-call state of DepthwiseConvolutionAlgo, grow-only like ShuffleConvolutionWorkspace.
+struct DepthwiseConvolutionWorkspace {
+  DepthwiseConvolutionWorkspace()
+      : data_workspace_(NULL), quantized_data_(NULL), ratio_data_(NULL), scale_data_(NULL) {
+  }
+
+  ~DepthwiseConvolutionWorkspace() {
+    delete data_workspace_;
+    delete quantized_data_;
+    delete ratio_data_;
+    delete scale_data_;
+  }
+
+  DepthwiseConvolutionWorkspace(const DepthwiseConvolutionWorkspace &) = delete;
+
+  DepthwiseConvolutionWorkspace &operator=(const DepthwiseConvolutionWorkspace &) = delete;
+
+  void Reserve(ConvolutionDataDesc &conv_data_desc, bool layout_transform) {
+    size_t data_size =
+        conv_data_desc.batch_size_ * conv_data_desc.height_in_ * conv_data_desc.width_in_ * conv_data_desc.channel_in_;
+    size_t ratio_size = conv_data_desc.batch_size_ * conv_data_desc.channel_in_;
+    if (quantized_data_ == NULL || quantized_data_->Count() < data_size) {
+      delete quantized_data_;
+      quantized_data_ = new Tensor<int8_t>(make_shape(data_size), 64);
+    }
+    if (ratio_data_ == NULL || ratio_data_->Count() < ratio_size) {
+      delete ratio_data_;
+      delete scale_data_;
+      ratio_data_ = new Tensor<float>(make_shape(ratio_size), 64);
+      scale_data_ = new Tensor<float>(make_shape(ratio_size), 64);
+    }
+    if (layout_transform && (data_workspace_ == NULL || data_workspace_->Count() < data_size)) {
+      delete data_workspace_;
+      data_workspace_ = new Tensor<float>(make_shape(conv_data_desc.batch_size_, conv_data_desc.height_in_,
+                                                     conv_data_desc.width_in_, conv_data_desc.channel_in_),
+                                          64);
+    }
+  }
+
+  Tensor<float> *data_workspace_;
+  Tensor<int8_t> *quantized_data_;
+  Tensor<float> *ratio_data_;
+  Tensor<float> *scale_data_;
+};
+
+// Depthwise convolution (one input and one output channel per group) as a single int8 pass over all channels,
+// instead of one padded M=1 GEMM per group.
+struct DepthwiseConvolutionAlgo : public BaseConvolutionAlgo {
+  DepthwiseConvolutionAlgo(const ConvolutionKernelDesc &conv_kernel_desc) : internal_layout_(NHWC) {
+    if (!IsSupported(conv_kernel_desc)) {
+      fprintf(stderr, "Depthwise convolution requires group == channel_in == channel_out.\n");
+      exit(-1);
+    }
+    weight_threshold_ = 127.0f;
+    data_threshold_ = 127.0f;
+    quantized_weight_ = NULL;
+    ratio_weight_ = NULL;
+  }
+
+  ~DepthwiseConvolutionAlgo() {
+    delete quantized_weight_;
+    delete ratio_weight_;
+  }
+
+  static bool IsSupported(const ConvolutionKernelDesc &conv_kernel_desc) {
+    return (conv_kernel_desc.group_ > 1) && (conv_kernel_desc.group_ == conv_kernel_desc.channel_in_) &&
+           (conv_kernel_desc.group_ == conv_kernel_desc.channel_out_);
+  }
+
+  // NCHW (c, 1, kh, kw) and NHWC (c, kh, kw, 1) weights share the same memory order.
+  void InitWeight(float *weight, ConvolutionKernelDesc &conv_kernel_desc) {
+    size_t channels = conv_kernel_desc.channel_out_;
+    size_t kernel_size = conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_;
+    quantized_weight_ = new Tensor<int8_t>(make_shape(kernel_size, channels), 64);
+    ratio_weight_ = new Tensor<float>(make_shape(channels), 64);
+    depthwise::QuantizeKernel(quantized_weight_->data_, ratio_weight_->data_, weight, channels, kernel_size,
+                              weight_threshold_);
+  }
+
+  bool SaveWeight(PackedWeightWriter &writer) {
+    writer.Append(*quantized_weight_);
+    writer.Append(*ratio_weight_);
+    return true;
+  }
+
+  bool LoadWeight(PackedWeightFile &file, ConvolutionKernelDesc &conv_kernel_desc) {
+    size_t channels = conv_kernel_desc.channel_out_;
+    size_t kernel_size = conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_;
+    quantized_weight_ = new Tensor<int8_t>(make_shape(kernel_size, channels));
+    ratio_weight_ = new Tensor<float>(make_shape(channels));
+    return file.Load(*quantized_weight_) && file.Load(*ratio_weight_);
+  }
+
+  void InitData(float *srcdata, ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc,
+                bool layout_transform, DepthwiseConvolutionWorkspace &workspace) {
+    workspace.Reserve(conv_data_desc, layout_transform);
+    size_t spatial_size = conv_data_desc.height_in_ * conv_data_desc.width_in_;
+    if (layout_transform) {
+      TransformLayout(internal_layout_, conv_kernel_desc.layout_, workspace.data_workspace_->data_, srcdata,
+                      conv_data_desc.batch_size_, conv_data_desc.channel_in_, spatial_size);
+      srcdata = workspace.data_workspace_->data_;
+    }
+    depthwise::NHWCQuantizeData(workspace.quantized_data_->data_, workspace.ratio_data_->data_,
+                                workspace.scale_data_->data_, srcdata, conv_data_desc.batch_size_,
+                                conv_data_desc.channel_in_, spatial_size, data_threshold_);
+  }
+
+  void Execute(float *out, float *data, float *bias, ConvolutionDataDesc &conv_data_desc,
+               ConvolutionKernelDesc &conv_kernel_desc) {
+    bool transpose_data = (conv_kernel_desc.layout_ != internal_layout_) ? true : false;
+    size_t height_out = GetConvOutSize(conv_data_desc.height_in_, conv_kernel_desc.kernel_h_,
+                                       conv_kernel_desc.stride_h_, conv_kernel_desc.pad_h_,
+                                       conv_kernel_desc.dilation_h_);
+    size_t width_out = GetConvOutSize(conv_data_desc.width_in_, conv_kernel_desc.kernel_w_, conv_kernel_desc.stride_w_,
+                                      conv_kernel_desc.pad_w_, conv_kernel_desc.dilation_w_);
+    DepthwiseConvolutionWorkspace *workspace = workspace_pool_.Acquire();
+    InitData(data, conv_data_desc, conv_kernel_desc, transpose_data, *workspace);
+    depthwise::NHWCDepthwiseConv(
+        out, workspace->quantized_data_->data_, quantized_weight_->data_, workspace->ratio_data_->data_,
+        ratio_weight_->data_, bias, conv_data_desc.batch_size_, conv_data_desc.channel_in_, conv_data_desc.height_in_,
+        conv_data_desc.width_in_, conv_kernel_desc.kernel_h_, conv_kernel_desc.kernel_w_, conv_kernel_desc.stride_h_,
+        conv_kernel_desc.stride_w_, conv_kernel_desc.pad_h_, conv_kernel_desc.pad_w_, conv_kernel_desc.dilation_h_,
+        conv_kernel_desc.dilation_w_, height_out, width_out, conv_kernel_desc.layout_,
+        conv_kernel_desc.fusion_mask_ == CONV_RELU_FUSION, conv_kernel_desc.fusion_mask_ == CONV_BN_FUSION,
+        conv_kernel_desc.fusion_mask_ == CONV_BN_RELU_FUSION, conv_kernel_desc.fusion_mask_ == CONV_RELU_BN_FUSION,
+        conv_kernel_desc.global_mean_, conv_kernel_desc.mul_variance_coeff_, conv_kernel_desc.scale_,
+        conv_kernel_desc.shift_);
+    workspace_pool_.Release(workspace);
+  }
+
+  void ReleaseWorkspace() {
+    workspace_pool_.Clear();
+  }
+
+ private:
+  Tensor<int8_t> *quantized_weight_;
+  Tensor<float> *ratio_weight_;
+  WorkspacePool<DepthwiseConvolutionWorkspace> workspace_pool_;
+
+  const LAYOUT internal_layout_;
+
+  float weight_threshold_;
+  float data_threshold_;
+};
+#endif
@@ -17,15 +17,29 @@
 #ifndef NN_FC_OP_H
 #define NN_FC_OP_H
 
+#include <atomic>
+#include <mutex>
 #include "base_fc.h"
 #include "shuffle_fc.h"
+#include "autotune.h"
+#include "numa_execution.h"
+#include "../trace.h"
+
+// Choices of AUTO_SELECT_FC as recorded in the tuning database.
+#define FC_GEMV_PATH 0
+#define FC_GEMM_PATH 1
 
 struct FCOp {
-  FCOp() : algo_id_(AUTO_SELECT_FC), algo_(NULL) {
+  FCOp() : algo_id_(AUTO_SELECT_FC), algo_(NULL), fc_kernel_desc_(), activation_quantization_(NULL),
+           output_quantization_(NULL), packed_weight_(NULL), weight_initialized_(false) {
+    ResetTunedPaths();
   }
 
   ~FCOp() {
     delete algo_;
+    delete packed_weight_;
+    delete activation_quantization_;
+    delete output_quantization_;
   }
 
   FCOp(const FCOp&) = delete;
@@ -34,11 +48,42 @@ struct FCOp {
 
   void SetupFCKernelParameter(LAYOUT layout, size_t channel_out, size_t channel_in, FC_ALGORITHM algo) {
     fc_kernel_desc_ = {layout, channel_out, channel_in};
+    delete activation_quantization_;
+    delete output_quantization_;
+    activation_quantization_ = NULL;
+    output_quantization_ = NULL;
+    weight_initialized_ = false;
+    numa_replicas_.Clear();
+    delete algo_;
+    delete packed_weight_;
+    packed_weight_ = NULL;
+    ResetTunedPaths();
     ChooseAlgo(algo);
   }
 
-  void SetupFCDataParameter(size_t batch_size, size_t channel_in) {
-    fc_data_desc_ = {batch_size, channel_in};
+  // Same contract as ConvOp::SetupActivationQuantization.
+  void SetupActivationQuantization(float *scale, uint8_t *zero_point, size_t count) {
+    if (fc_kernel_desc_.channel_in_ == 0 || weight_initialized_) {
+      fprintf(stderr, "SetupActivationQuantization must be called between SetupFCKernelParameter and InitWeight\n");
+      exit(-1);
+    }
+    delete activation_quantization_;
+    activation_quantization_ =
+        new ActivationQuantization(scale, zero_point, count, fc_kernel_desc_.channel_in_, 127.0f);
+    fc_kernel_desc_.activation_quantization_ = activation_quantization_;
+    ResetTunedPaths();
+  }
+
+  // Same contract as ConvOp::SetupOutputQuantization.
+  void SetupOutputQuantization(float *scale, uint8_t *zero_point, size_t count) {
+    if (fc_kernel_desc_.channel_out_ == 0 || weight_initialized_) {
+      fprintf(stderr, "SetupOutputQuantization must be called between SetupFCKernelParameter and InitWeight\n");
+      exit(-1);
+    }
+    delete output_quantization_;
+    output_quantization_ = new ActivationQuantization(scale, zero_point, count, fc_kernel_desc_.channel_out_, 127.0f);
+    fc_kernel_desc_.output_quantization_ = output_quantization_;
+    ResetTunedPaths();
   }
 
   void ChooseAlgo(FC_ALGORITHM algo_id) {
@@ -56,18 +101,158 @@ struct FCOp {
   }
 
   void InitWeight(float *weight) {
+    numa_replicas_.Clear();
     algo_->InitWeight(weight, fc_kernel_desc_);
+    weight_initialized_ = true;
+  }
+
+  PackedWeightHeader MakeHeader() {
+    return MakePackedWeightHeader(FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_N, FC_SHUFFLE_KERNEL_K, algo_id_,
+                                  {fc_kernel_desc_.layout_, fc_kernel_desc_.channel_out_, fc_kernel_desc_.channel_in_},
+                                  activation_quantization_);
+  }
+
+  // Same contract as ConvOp::SaveWeight.
+  int SaveWeight(const char *path) {
+    PackedWeightWriter writer;
+    if (!weight_initialized_ || !algo_->SaveWeight(writer)) {
+      fprintf(stderr, "SaveWeight needs initialized weights of an algorithm with a packed format.\n");
+      return -1;
+    }
+    return writer.Commit(path, MakeHeader()) ? 0 : -1;
+  }
+
+  // Same contract as ConvOp::LoadWeight.
+  int LoadWeight(const char *path) {
+    PackedWeightFile *file = new PackedWeightFile();
+    numa_replicas_.Clear();
+    delete algo_;
+    ChooseAlgo(algo_id_);
+    if (!file->Map(path) || !file->Matches(MakeHeader()) || !algo_->LoadWeight(*file, fc_kernel_desc_) ||
+        !file->Exhausted()) {
+      delete algo_;
+      ChooseAlgo(algo_id_);
+      delete file;
+      weight_initialized_ = false;
+      return -1;
+    }
+    delete packed_weight_;
+    packed_weight_ = file;
+    weight_initialized_ = true;
+    return 0;
   }
 
   void Execute(float *out, float *data, float *bias, size_t batch_size, size_t channel_in) {
-    SetupFCDataParameter(batch_size, channel_in);
-    algo_->Execute(out, data, bias, fc_data_desc_, fc_kernel_desc_);
+    ExecuteQuantized(out, FLOAT_ACTIVATION, data, FLOAT_ACTIVATION, bias, batch_size, channel_in);
+  }
+
+  // AUTO_SELECT_FC times the GEMV kernel against the GEMM tile for batches small enough to take either. The op keeps
+  // the path for each of them and only goes to the tuning database the first time a batch size comes up.
+  void ExecuteQuantized(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+                        float *bias, size_t batch_size, size_t channel_in) {
+    CheckActivationFormat(out_format, data_format, activation_quantization_, output_quantization_);
+    TraceOpScope trace(this);
+    FCDataDesc fc_data_desc = {batch_size, channel_in, false};
+    auto run = [&]() {
+      if (!ExecuteOnNodes(out, out_format, data, data_format, bias, fc_data_desc)) {
+        RunAlgo(algo_, out, out_format, data, data_format, bias, fc_data_desc);
+      }
+    };
+    if (algo_id_ != AUTO_SELECT_FC || batch_size >= FC_SHUFFLE_KERNEL_N || data_format == SHUFFLED_UINT8_ACTIVATION) {
+      run();
+      return;
+    }
+    std::atomic<size_t> &tuned = tuned_paths_[batch_size][data_format][out_format];
+    size_t threads_num = GetThreadsNum();
+    size_t tuned_path = tuned.load(std::memory_order_acquire);
+    if (tuned_path / 2 != threads_num) {
+      // other callers of the batch size wait for the first one to decide
+      std::lock_guard<std::mutex> lock(tuning_mutex_);
+      tuned_path = tuned.load(std::memory_order_relaxed);
+      if (tuned_path / 2 != threads_num) {
+        std::string key = TuningKey("fc", {fc_kernel_desc_.layout_, fc_kernel_desc_.channel_out_,
+                                           fc_kernel_desc_.channel_in_, batch_size, out_format, data_format});
+        int path = SelectTuningCandidate(key, {FC_GEMV_PATH, FC_GEMM_PATH}, [&](int candidate) {
+          fc_data_desc.force_gemm_ = (candidate == FC_GEMM_PATH);
+          run();
+        });
+        tuned.store(threads_num * 2 + path, std::memory_order_release);
+        return;
+      }
+    }
+    fc_data_desc.force_gemm_ = (tuned_path % 2 == FC_GEMM_PATH);
+    run();
+  }
+
+  void ResetTunedPaths() {
+    for (size_t b = 0; b < FC_SHUFFLE_KERNEL_N; ++b) {
+      for (size_t i = 0; i < 2; ++i) {
+        for (size_t o = 0; o < 3; ++o) {
+          tuned_paths_[b][i][o].store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+  void RunAlgo(BaseFCAlgo *algo, void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+               float *bias, FCDataDesc &fc_data_desc) {
+    if (out_format == FLOAT_ACTIVATION && data_format == FLOAT_ACTIVATION) {
+      algo->Execute(static_cast<float *>(out), static_cast<float *>(data), bias, fc_data_desc, fc_kernel_desc_);
+    } else {
+      algo->ExecuteQuantized(out, out_format, data, data_format, bias, fc_data_desc, fc_kernel_desc_);
+    }
+  }
+
+  // NUMA mode: a batch of row-major activations runs as one slice per node, against the weight replica of the node.
+  // Returns false when the batch is left to algo_, as it is inside an execution context, which has CPUs of its own.
+  bool ExecuteOnNodes(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format, float *bias,
+                      FCDataDesc &fc_data_desc) {
+    NumaTeams &teams = NumaTeams::Instance();
+    size_t nodes = teams.Nodes();
+    if (nodes < 2 || ScopedThreadPool() != NULL || fc_data_desc.batch_size_ < 2 ||
+        out_format == SHUFFLED_UINT8_ACTIVATION || data_format == SHUFFLED_UINT8_ACTIVATION) {
+      return false;
+    }
+    const std::vector<BaseFCAlgo *> &replicas =
+        numa_replicas_.Get(algo_, fc_kernel_desc_, []() -> BaseFCAlgo * { return new ShuffleFCAlgo(); });
+    if (replicas.empty()) {
+      return false;
+    }
+    size_t out_row = fc_kernel_desc_.channel_out_ * ActivationElementSize(out_format);
+    size_t data_row = fc_data_desc.channel_in_ * ActivationElementSize(data_format);
+    teams.Run([&](size_t node) {
+      size_t begin, count;
+      NumaBatchSlice(fc_data_desc.batch_size_, nodes, node, begin, count);
+      if (count == 0) {
+        return;
+      }
+      TraceOpScope trace(this);
+      FCDataDesc slice = fc_data_desc;
+      slice.batch_size_ = count;
+      RunAlgo(replicas[node], static_cast<char *>(out) + begin * out_row, out_format,
+              static_cast<char *>(data) + begin * data_row, data_format, bias, slice);
+    });
+    return true;
+  }
+
+  void ReleaseWorkspace() {
+    algo_->ReleaseWorkspace();
+    numa_replicas_.ReleaseWorkspace();
   }
 
   FC_ALGORITHM algo_id_;
   BaseFCAlgo *algo_;
   FCKernelDesc fc_kernel_desc_;
-  FCDataDesc fc_data_desc_;
+
+  ActivationQuantization *activation_quantization_;
+  ActivationQuantization *output_quantization_;
+  PackedWeightFile *packed_weight_;
+  bool weight_initialized_;
+  NumaWeightReplicas<BaseFCAlgo, FCKernelDesc> numa_replicas_;
+  // AUTO_SELECT_FC path by batch size, data format and output format, as 2 * threads + path for the thread count it
+  // was decided for; 0 until then
+  std::atomic<size_t> tuned_paths_[FC_SHUFFLE_KERNEL_N][2][3];
+  std::mutex tuning_mutex_;
 };
 
 #endif
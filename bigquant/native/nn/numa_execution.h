@@ -0,0 +1,298 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_NUMA_EXECUTION_H
+#define NN_NUMA_EXECUTION_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../base.h"
+#include "../common.h"
+#include "packed_weight.h"
+
+// NUMA mode (built with NUMA=TRUE): on a machine with several nodes, an op runs a batch as one slice per node, each on
+// a thread team bound to that node and against a copy of the packed weights in that node's memory, so that no weight
+// is read across the socket interconnect. Without the build flag, or on a single node, ops run as before. The
+// BIGQUANT_NUMA_TEAMS environment variable sets the number of teams instead, spread round-robin over the nodes.
+
+// A batch handed to every team by NumaTeams::Run; pending_ counts the teams that have not finished it.
+struct NumaJob {
+  const std::function<void(size_t)> *task_;
+  // the phase the caller of Run counts for
+  PerfPhaseCounts *phase_;
+  size_t pending_;
+};
+
+// One long-lived worker per node. A worker binds itself to the CPUs of its node before its first parallel loop, so
+// the OpenMP team it forks, and keeps across calls, stays on that node. Under THREAD_POOL_BACKEND the worker starts
+// a pool of its own instead, whose threads inherit that binding.
+struct NumaTeams {
+  static NumaTeams &Instance() {
+    static NumaTeams teams;
+    return teams;
+  }
+
+  // 0 on a single node
+  size_t Nodes() const {
+    return workers_.size();
+  }
+
+  // the NUMA node the team runs on
+  size_t NodeOf(size_t team) const {
+    return team % sockets_;
+  }
+
+  // Runs task(node) on the team of every node and returns once all are done. Calls from several threads queue up;
+  // every team takes the jobs in order, so the job of one caller can run on a team that is done with the previous one
+  // while another team still works on that.
+  void Run(const std::function<void(size_t)> &task) {
+    NumaJob job = {&task, CurrentPerfPhase(), workers_.size()};
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.push_back(&job);
+    wake_.notify_all();
+    done_.wait(lock, [&]() { return job.pending_ == 0; });
+    // a job is only finished once all teams have taken it, and so every job queued before it
+    while (!jobs_.empty() && jobs_.front()->pending_ == 0) {
+      jobs_.pop_front();
+      ++first_job_;
+    }
+  }
+
+ private:
+  // The threads of the first caller are shared out evenly between the nodes.
+  NumaTeams() : sockets_(GetSocketNum()), first_job_(0), stop_(false) {
+    size_t nodes = sockets_;
+    const char *teams = getenv("BIGQUANT_NUMA_TEAMS");
+    if (teams != NULL && atoi(teams) > 0) {
+      nodes = atoi(teams);
+    }
+    if (nodes < 2) {
+      return;
+    }
+    size_t threads_num = std::max(GetThreadsNum() / nodes, static_cast<size_t>(1));
+    for (size_t node = 0; node < nodes; ++node) {
+      workers_.push_back(std::thread(&NumaTeams::Work, this, node, threads_num));
+    }
+  }
+
+  ~NumaTeams() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      workers_[i].join();
+    }
+  }
+
+  NumaTeams(const NumaTeams &) = delete;
+
+  NumaTeams &operator=(const NumaTeams &) = delete;
+
+  void Work(size_t node, size_t threads_num) {
+#ifdef NUMA
+    numa_run_on_node(NodeOf(node));
+#endif
+#ifdef _OPENMP
+    omp_set_num_threads(threads_num);
+#endif
+    ThreadPool *pool = NULL;
+    // sequence number of the next job this team takes
+    size_t next_job = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&]() { return stop_ || next_job < first_job_ + jobs_.size(); });
+      if (stop_) {
+        delete pool;
+        return;
+      }
+      NumaJob *job = jobs_[next_job - first_job_];
+      ++next_job;
+      lock.unlock();
+      bool pooled = ParallelBackend::Instance().Settings()->backend_ == THREAD_POOL_BACKEND;
+      if (pool == NULL && pooled) {
+        pool = new ThreadPool(threads_num - 1);
+      }
+      {
+        ThreadPoolScope scope(pooled ? pool : NULL);
+        PerfWorkerScope counting(job->phase_);
+        (*job->task_)(node);
+      }
+      lock.lock();
+      if (--job->pending_ == 0) {
+        done_.notify_all();
+      }
+    }
+  }
+
+  size_t sockets_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  // jobs not yet finished by every team, the first of them with sequence number first_job_
+  std::deque<NumaJob *> jobs_;
+  size_t first_job_;
+  bool stop_;
+};
+
+// Rows [begin, begin + count) of a batch of batch_size for node; count is 0 when there are more nodes than rows.
+inline void NumaBatchSlice(size_t batch_size, size_t nodes, size_t node, size_t &begin, size_t &count) {
+  begin = node * batch_size / nodes;
+  count = (node + 1) * batch_size / nodes - begin;
+}
+
+// Per-node copies of the packed weights of an algorithm, each loaded into an algorithm instance of its own, which
+// then also keeps its own workspaces and GEMM plans for the team of its node. The copies of several algorithms, such
+// as those AUTO_SELECT_CONV chose for different input shapes, are kept side by side.
+template <typename Algo, typename KernelDesc>
+struct NumaWeightReplicas {
+  NumaWeightReplicas() {
+  }
+
+  ~NumaWeightReplicas() {
+    Release();
+  }
+
+  NumaWeightReplicas(const NumaWeightReplicas &) = delete;
+
+  NumaWeightReplicas &operator=(const NumaWeightReplicas &) = delete;
+
+  // The replicas of source, one per node, made on first use. Empty outside NUMA mode and for algorithms without a
+  // packed format; create returns a new instance of the algorithm of source, without weights.
+  template <typename Create>
+  const std::vector<Algo *> &Get(Algo *source, KernelDesc &kernel_desc, Create create) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = replicas_.find(source);
+    if (iter != replicas_.end()) {
+      return iter->second->algos_;
+    }
+    size_t nodes = NumaTeams::Instance().Nodes();
+    PackedWeightWriter writer;
+    if (nodes < 2 || !source->SaveWeight(writer)) {
+      return none_;
+    }
+    Replicas *replicas = new Replicas(PackedWeightOffset(writer.payload_.size()));
+    replicas_[source] = replicas;
+    for (size_t node = 0; node < nodes; ++node) {
+      char *addr = replicas->Allocate(node);
+      memcpy(addr, writer.payload_.data(), writer.payload_.size());
+      replicas->files_.push_back(new PackedWeightFile());
+      replicas->files_.back()->Attach(addr, replicas->size_);
+      replicas->algos_.push_back(create());
+      if (!replicas->algos_.back()->LoadWeight(*replicas->files_.back(), kernel_desc)) {
+        fprintf(stderr, "Cannot replicate packed weights on NUMA node %zu.\n", node);
+        replicas->Release();
+        break;
+      }
+    }
+    return replicas->algos_;
+  }
+
+  // To be called whenever the weights of the op change.
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Release();
+  }
+
+  // To be called before source is deleted.
+  void Clear(Algo *source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = replicas_.find(source);
+    if (iter != replicas_.end()) {
+      delete iter->second;
+      replicas_.erase(iter);
+    }
+  }
+
+  void ReleaseWorkspace() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto iter = replicas_.begin(); iter != replicas_.end(); ++iter) {
+      for (size_t i = 0; i < iter->second->algos_.size(); ++i) {
+        iter->second->algos_[i]->ReleaseWorkspace();
+      }
+    }
+  }
+
+ private:
+  // The copies of one source; left empty when one of them cannot be loaded, so that the source runs unreplicated.
+  struct Replicas {
+    explicit Replicas(size_t size) : size_(size) {
+    }
+
+    ~Replicas() {
+      Release();
+    }
+
+    char *Allocate(size_t node) {
+#ifdef NUMA
+      void *addr = numa_alloc_onnode(size_, NumaTeams::Instance().NodeOf(node));
+      if (addr == NULL) {
+        fprintf(stderr, "Failed to Allocate Memory.\n");
+        exit(-1);
+      }
+#else
+      void *addr;
+      aligned_malloc(&addr, PACKED_WEIGHT_ALIGNMENT, size_);
+#endif
+      memory_.push_back(static_cast<char *>(addr));
+      return memory_.back();
+    }
+
+    void Release() {
+      for (size_t i = 0; i < algos_.size(); ++i) {
+        delete algos_[i];
+      }
+      for (size_t i = 0; i < files_.size(); ++i) {
+        delete files_[i];
+      }
+      for (size_t i = 0; i < memory_.size(); ++i) {
+#ifdef NUMA
+        numa_free(memory_[i], size_);
+#else
+        aligned_free(memory_[i]);
+#endif
+      }
+      algos_.clear();
+      files_.clear();
+      memory_.clear();
+    }
+
+    size_t size_;
+    std::vector<char *> memory_;
+    std::vector<PackedWeightFile *> files_;
+    std::vector<Algo *> algos_;
+  };
+
+  void Release() {
+    for (auto iter = replicas_.begin(); iter != replicas_.end(); ++iter) {
+      delete iter->second;
+    }
+    replicas_.clear();
+  }
+
+  std::mutex mutex_;
+  std::map<Algo *, Replicas *> replicas_;
+  const std::vector<Algo *> none_;
+};
+
+#endif
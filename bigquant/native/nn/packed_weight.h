@@ -0,0 +1,228 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_PACKED_WEIGHT_H
+#define NN_PACKED_WEIGHT_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../base.h"
+#include "../common.h"
+#include "../tensor.h"
+#include "activation_quantization.h"
+
+// Prepacked weight file: a header followed by the packed tensors of one op, each starting on a
+// PACKED_WEIGHT_ALIGNMENT boundary. Loading maps the file read-only and points the tensors into the mapping, so every
+// process that loads the same file shares one page cache copy.
+#define PACKED_WEIGHT_MAGIC "BQPACKED"
+#define PACKED_WEIGHT_VERSION 2
+#define PACKED_WEIGHT_ALIGNMENT 64
+
+// A payload is only valid for the build (ISA and GEMM tile) and the op parameters it was packed for.
+struct PackedWeightHeader {
+  char magic_[8];
+  uint32_t version_;
+  uint32_t cpu_feature_;
+  uint32_t kernel_m_;
+  uint32_t kernel_n_;
+  uint32_t kernel_k_;
+  uint32_t algo_;
+  uint64_t desc_[8];
+  uint64_t quantization_hash_;
+  uint64_t size_;
+};
+
+inline PackedWeightHeader MakePackedWeightHeader(size_t kernel_m, size_t kernel_n, size_t kernel_k, size_t algo,
+                                                 std::vector<uint64_t> desc,
+                                                 ActivationQuantization *activation_quantization) {
+  PackedWeightHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic_, PACKED_WEIGHT_MAGIC, sizeof(header.magic_));
+  header.version_ = PACKED_WEIGHT_VERSION;
+  header.cpu_feature_ = BUILD_CPU_FEATURE;
+  header.kernel_m_ = kernel_m;
+  header.kernel_n_ = kernel_n;
+  header.kernel_k_ = kernel_k;
+  header.algo_ = algo;
+  assert(desc.size() <= 8);
+  std::copy(desc.begin(), desc.end(), header.desc_);
+  // the activation scale is folded into the packed weight, so the parameters are part of its identity (FNV-1a)
+  uint64_t hash = 14695981039346656037ULL;
+  if (activation_quantization != NULL) {
+    size_t count = activation_quantization->scale_.Count();
+    const unsigned char *scale = reinterpret_cast<const unsigned char *>(activation_quantization->scale_.data_);
+    const unsigned char *zero_point =
+        reinterpret_cast<const unsigned char *>(activation_quantization->zero_point_.data_);
+    for (size_t i = 0; i < count * sizeof(float); ++i) {
+      hash = (hash ^ scale[i]) * 1099511628211ULL;
+      hash = (hash ^ zero_point[i]) * 1099511628211ULL;
+    }
+  }
+  header.quantization_hash_ = hash;
+  return header;
+}
+
+inline size_t PackedWeightOffset(size_t offset) {
+  return GetAlignmentLength(offset, PACKED_WEIGHT_ALIGNMENT);
+}
+
+struct PackedWeightWriter {
+  PackedWeightWriter() : payload_(PackedWeightOffset(sizeof(PackedWeightHeader)), 0) {
+  }
+
+  template <typename DType>
+  void Append(Tensor<DType> &tensor) {
+    size_t offset = PackedWeightOffset(payload_.size());
+    payload_.resize(offset + tensor.Size(), 0);
+    memcpy(payload_.data() + offset, tensor.data_, tensor.Size());
+  }
+
+  template <typename SrcType, typename DstType>
+  void Append(QuantizedTensor<SrcType, DstType> &tensor) {
+    Append(static_cast<Tensor<DstType> &>(tensor));
+    Append(tensor.min_);
+    Append(tensor.max_);
+    Append(tensor.ratio_);
+  }
+
+  // The file is written next to path and renamed into place, so a process mapping path never sees a partial file.
+  bool Commit(const char *path, PackedWeightHeader header) {
+    payload_.resize(PackedWeightOffset(payload_.size()), 0);
+    header.size_ = payload_.size();
+    memcpy(payload_.data(), &header, sizeof(header));
+    std::string temp_path = std::string(path) + ".tmp." + std::to_string(getpid());
+    FILE *file = fopen(temp_path.c_str(), "wb");
+    if (file == NULL) {
+      fprintf(stderr, "Cannot write packed weight file %s.\n", temp_path.c_str());
+      return false;
+    }
+    bool written = fwrite(payload_.data(), 1, payload_.size(), file) == payload_.size();
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(temp_path.c_str(), path) != 0) {
+      fprintf(stderr, "Cannot write packed weight file %s.\n", path);
+      unlink(temp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  std::vector<char> payload_;
+};
+
+// Read-only mapping of a packed weight file. Tensors loaded from it do not own their data and must not outlive it.
+struct PackedWeightFile {
+  PackedWeightFile() : addr_(NULL), size_(0), offset_(0), mapped_(false) {
+  }
+
+  ~PackedWeightFile() {
+    if (addr_ != NULL && mapped_) {
+      munmap(addr_, size_);
+    }
+  }
+
+  PackedWeightFile(const PackedWeightFile &) = delete;
+
+  PackedWeightFile &operator=(const PackedWeightFile &) = delete;
+
+  bool Map(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      fprintf(stderr, "Cannot open packed weight file %s.\n", path);
+      return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(PackedWeightHeader)) {
+      fprintf(stderr, "Invalid packed weight file %s.\n", path);
+      close(fd);
+      return false;
+    }
+    size_ = file_stat.st_size;
+    void *addr = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+      fprintf(stderr, "Cannot map packed weight file %s.\n", path);
+      return false;
+    }
+    addr_ = static_cast<char *>(addr);
+    offset_ = PackedWeightOffset(sizeof(PackedWeightHeader));
+    mapped_ = true;
+    return true;
+  }
+
+  // Reads the payload of a PackedWeightWriter from memory the caller owns and keeps alive, instead of from a file.
+  void Attach(char *addr, size_t size) {
+    addr_ = addr;
+    size_ = size;
+    offset_ = PackedWeightOffset(sizeof(PackedWeightHeader));
+  }
+
+  const PackedWeightHeader *Header() const {
+    return reinterpret_cast<const PackedWeightHeader *>(addr_);
+  }
+
+  bool Matches(const PackedWeightHeader &expected) {
+    const PackedWeightHeader *header = Header();
+    if (memcmp(header->magic_, expected.magic_, sizeof(header->magic_)) != 0 || header->version_ != expected.version_ ||
+        header->size_ != size_) {
+      fprintf(stderr, "Packed weight file is corrupt or of another version.\n");
+      return false;
+    }
+    if (header->cpu_feature_ != expected.cpu_feature_ || header->kernel_m_ != expected.kernel_m_ ||
+        header->kernel_n_ != expected.kernel_n_ || header->kernel_k_ != expected.kernel_k_) {
+      fprintf(stderr, "Packed weight file was written for another ISA or GEMM tile.\n");
+      return false;
+    }
+    if (header->algo_ != expected.algo_ || memcmp(header->desc_, expected.desc_, sizeof(header->desc_)) != 0 ||
+        header->quantization_hash_ != expected.quantization_hash_) {
+      fprintf(stderr, "Packed weight file was written for other op parameters.\n");
+      return false;
+    }
+    return true;
+  }
+
+  // Points tensor, whose shapes are set up but which owns no data, at the next packed tensor.
+  template <typename DType>
+  bool Load(Tensor<DType> &tensor) {
+    size_t offset = PackedWeightOffset(offset_);
+    if (offset + tensor.Size() > size_) {
+      fprintf(stderr, "Packed weight file is truncated.\n");
+      return false;
+    }
+    tensor.SetData(reinterpret_cast<DType *>(addr_ + offset));
+    offset_ = offset + tensor.Size();
+    return true;
+  }
+
+  template <typename SrcType, typename DstType>
+  bool Load(QuantizedTensor<SrcType, DstType> &tensor) {
+    return Load(static_cast<Tensor<DstType> &>(tensor)) && Load(tensor.min_) && Load(tensor.max_) &&
+           Load(tensor.ratio_);
+  }
+
+  // Every byte of the payload has been claimed by a tensor.
+  bool Exhausted() {
+    return PackedWeightOffset(offset_) == size_;
+  }
+
+  char *addr_;
+  size_t size_;
+  size_t offset_;
+  bool mapped_;
+};
+
+#endif
@@ -17,6 +17,110 @@
 #ifndef NN_SHUFFLE_CONVOLUTION_H
 #define NN_SHUFFLE_CONVOLUTION_H
 #include "base_convolution.h"
+#include "workspace_pool.h"
+
+// Per-call state of ShuffleConvolutionAlgo. Buffers only grow, so repeated batch/height/width reuse the buffers of
+// the largest shape seen so far.
+struct ShuffleConvolutionWorkspace {
+  ShuffleConvolutionWorkspace()
+      : gemm_schedule_(0),
+        data_workspace_(NULL),
+        activation_workspace_(NULL),
+        partial_sums_(NULL),
+        workspace_gemm_n_(0) {
+  }
+
+  ~ShuffleConvolutionWorkspace() {
+    for (size_t g = 0; g < quantized_data_.size(); ++g) {
+      delete quantized_data_[g];
+    }
+    for (size_t g = 0; g < min_per_channel_.size(); ++g) {
+      delete min_per_channel_[g];
+      delete max_per_channel_[g];
+    }
+    delete data_workspace_;
+    delete activation_workspace_;
+    delete partial_sums_;
+  }
+
+  ShuffleConvolutionWorkspace(const ShuffleConvolutionWorkspace &) = delete;
+
+  ShuffleConvolutionWorkspace &operator=(const ShuffleConvolutionWorkspace &) = delete;
+
+  void Reserve(ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc, size_t gemm_k,
+               size_t aligned_gemm_k, bool layout_transform, bool skip_extreme) {
+    size_t group = conv_kernel_desc.group_;
+    size_t spatial_size = conv_data_desc.batch_size_ * conv_data_desc.height_in_ * conv_data_desc.width_in_;
+    if (gemm_n_ > workspace_gemm_n_ || quantized_data_.size() != group) {
+      for (size_t g = 0; g < quantized_data_.size(); ++g) {
+        delete quantized_data_[g];
+      }
+      quantized_data_.resize(group);
+      for (size_t g = 0; g < group; ++g) {
+        quantized_data_[g] = new QuantizedTensor<float, uint8_t>(make_shape(aligned_gemm_n_, aligned_gemm_k),
+                                                                 make_shape(gemm_n_), make_shape(gemm_n_, gemm_k), 64);
+      }
+      workspace_gemm_n_ = gemm_n_;
+    }
+    if (!skip_extreme && (min_per_channel_.size() != group || min_per_channel_[0]->Count() < spatial_size)) {
+      for (size_t g = 0; g < min_per_channel_.size(); ++g) {
+        delete min_per_channel_[g];
+        delete max_per_channel_[g];
+      }
+      min_per_channel_.resize(group);
+      max_per_channel_.resize(group);
+      for (size_t g = 0; g < group; ++g) {
+        min_per_channel_[g] = new Tensor<float>(make_shape(spatial_size), 64);
+        max_per_channel_[g] = new Tensor<float>(make_shape(spatial_size), 64);
+      }
+    }
+    size_t data_size = spatial_size * conv_data_desc.channel_in_;
+    if (layout_transform && (data_workspace_ == NULL || data_workspace_->Count() < data_size)) {
+      delete data_workspace_;
+      data_workspace_ = new Tensor<float>(make_shape(conv_data_desc.batch_size_, conv_data_desc.height_in_,
+                                                     conv_data_desc.width_in_, conv_data_desc.channel_in_),
+                                          64);
+    }
+  }
+
+  // NHWC copy of uint8 NCHW input
+  void ReserveActivation(size_t data_size) {
+    if (activation_workspace_ == NULL || activation_workspace_->Count() < data_size) {
+      delete activation_workspace_;
+      activation_workspace_ = new Tensor<uint8_t>(make_shape(data_size), 64);
+    }
+  }
+
+  // split-K sums of gemm_plan_, NULL when it does not split K
+  int *ReservePartialSums() {
+    size_t count = gemm_plan_.PartialSumCount();
+    if (count == 0) {
+      return NULL;
+    }
+    if (partial_sums_ == NULL || partial_sums_->Count() < count) {
+      delete partial_sums_;
+      partial_sums_ = new Tensor<int>(make_shape(count), 64);
+    }
+    return partial_sums_->data_;
+  }
+
+  size_t height_out_;
+  size_t width_out_;
+  size_t gemm_n_;
+  size_t aligned_gemm_n_;
+  // blocking of the aligned_gemm_m x aligned_gemm_n_ x aligned_gemm_k GEMM, shared by all groups, and the
+  // ConvolutionKernelDesc::gemm_schedule_ it was made for
+  GemmPlan gemm_plan_;
+  size_t gemm_schedule_;
+
+  std::vector<QuantizedTensor<float, uint8_t> *> quantized_data_;
+  std::vector<Tensor<float> *> min_per_channel_;
+  std::vector<Tensor<float> *> max_per_channel_;
+  Tensor<float> *data_workspace_;
+  Tensor<uint8_t> *activation_workspace_;
+  Tensor<int> *partial_sums_;
+  size_t workspace_gemm_n_;
+};
 
 struct ShuffleConvolutionAlgo : public BaseConvolutionAlgo {
   ShuffleConvolutionAlgo(const ConvolutionKernelDesc &conv_kernel_desc) : internal_layout_(NHWC) {
@@ -24,7 +128,6 @@ struct ShuffleConvolutionAlgo : public BaseConvolutionAlgo {
     data_threshold_ = 127.0f;
     transformed_kernel_ = NULL;
     sum_per_channel_out_ = NULL;
-    data_workspace_ = NULL;
   }
 
   ~ShuffleConvolutionAlgo() {
@@ -41,6 +144,18 @@ struct ShuffleConvolutionAlgo : public BaseConvolutionAlgo {
     }
   }
 
+  // 1x1 kernels without padding read one NHWC pixel per GEMM column, so the data is quantized in place of im2col.
+  static bool IsDirect1x1(const ConvolutionKernelDesc &conv_kernel_desc) {
+    return (conv_kernel_desc.kernel_h_ == 1) && (conv_kernel_desc.kernel_w_ == 1) && (conv_kernel_desc.pad_h_ == 0) &&
+           (conv_kernel_desc.pad_w_ == 0) && (conv_kernel_desc.group_ == 1);
+  }
+
+  // Without striding the im2col of a direct 1x1 convolution is the identity, so the packed GEMM operand can be
+  // produced by the previous op.
+  static bool AcceptsShuffledInput(const ConvolutionKernelDesc &conv_kernel_desc) {
+    return IsDirect1x1(conv_kernel_desc) && (conv_kernel_desc.stride_h_ == 1) && (conv_kernel_desc.stride_w_ == 1);
+  }
+
   void QuantizeKernel(float sw_threshold) {
     for (size_t g = 0; g < group_weight_.size(); ++g) {
       shuffle::PadQuantizeShuffle2D<float, CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(
@@ -67,16 +182,44 @@ struct ShuffleConvolutionAlgo : public BaseConvolutionAlgo {
         conv_kernel_desc.channel_in_per_group_ * conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_);
   }
 
+  // With calibrated activations the kernel sum is replaced by the zero point correction of each output channel.
+  void ComputeZeroPointCorrection(const ConvolutionKernelDesc &conv_kernel_desc) {
+    size_t spatial = conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_;
+    std::vector<float> zero_point(gemm_k_);
+    for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
+      conv_kernel_desc.activation_quantization_->ZeroPointPerK(zero_point.data(), g,
+                                                               conv_kernel_desc.channel_in_per_group_, spatial);
+      shuffle::ShuffledMatrixVectorProduct<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(
+          sum_per_channel_out_->data_ + g * conv_kernel_desc.channel_out_per_group_, quantized_weight_[g]->data_,
+          gemm_m_, gemm_k_, aligned_gemm_k_, quantized_weight_[g]->ratio_.data_, zero_point.data());
+    }
+  }
+
+  void SetupGemmShape(const ConvolutionKernelDesc &conv_kernel_desc) {
+    gemm_m_ = conv_kernel_desc.channel_out_per_group_;
+    gemm_k_ = conv_kernel_desc.channel_in_per_group_ * conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_;
+    aligned_gemm_m_ = GetAlignmentLength(gemm_m_, CONV_SHUFFLE_KERNEL_M);
+    aligned_gemm_k_ = GetAlignmentLength(gemm_k_, CONV_SHUFFLE_KERNEL_K);
+  }
+
   void InitWeight(float *weight, ConvolutionKernelDesc &conv_kernel_desc) {
+    // only needed until the weight is packed
+    Tensor<float> scaled_kernel(make_shape(conv_kernel_desc.channel_out_, conv_kernel_desc.channel_in_per_group_,
+                                           conv_kernel_desc.kernel_h_, conv_kernel_desc.kernel_w_));
+    if (conv_kernel_desc.activation_quantization_ != NULL) {
+      scaled_kernel.Allocate();
+      conv_kernel_desc.activation_quantization_->FoldScale(
+          scaled_kernel.data_, weight, conv_kernel_desc.channel_out_, conv_kernel_desc.group_,
+          conv_kernel_desc.channel_in_per_group_, conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_,
+          conv_kernel_desc.layout_);
+      weight = scaled_kernel.data_;
+    }
     ComputeKernelSum(weight, conv_kernel_desc);
     if (conv_kernel_desc.layout_ != internal_layout_) {
       KernelLayoutTransform(weight, conv_kernel_desc);
       weight = transformed_kernel_->data_;
     }
-    gemm_m_ = conv_kernel_desc.channel_out_per_group_;
-    gemm_k_ = conv_kernel_desc.channel_in_per_group_ * conv_kernel_desc.kernel_h_ * conv_kernel_desc.kernel_w_;
-    aligned_gemm_m_ = GetAlignmentLength(gemm_m_, CONV_SHUFFLE_KERNEL_M);
-    aligned_gemm_k_ = GetAlignmentLength(gemm_k_, CONV_SHUFFLE_KERNEL_K);
+    SetupGemmShape(conv_kernel_desc);
     group_weight_.resize(conv_kernel_desc.group_);
     quantized_weight_.resize(conv_kernel_desc.group_);
     for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
@@ -109,113 +252,243 @@ struct ShuffleConvolutionAlgo : public BaseConvolutionAlgo {
       }
     }
     QuantizeKernel(weight_threshold_);
+    if (conv_kernel_desc.activation_quantization_ != NULL) {
+      ComputeZeroPointCorrection(conv_kernel_desc);
+    }
   }
 
-  void InitData(float *srcdata, ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc,
-                float sw_threshold, bool layout_transform) {
-    // Allocate Memory
-    height_out_ = GetConvOutSize(conv_data_desc.height_in_, conv_kernel_desc.kernel_h_, conv_kernel_desc.stride_h_,
-                                 conv_kernel_desc.pad_h_, conv_kernel_desc.dilation_h_);
-    width_out_ = GetConvOutSize(conv_data_desc.width_in_, conv_kernel_desc.kernel_w_, conv_kernel_desc.stride_w_,
-                                conv_kernel_desc.pad_w_, conv_kernel_desc.dilation_w_);
-    gemm_n_ = conv_data_desc.batch_size_ * height_out_ * width_out_;
-    aligned_gemm_n_ = GetAlignmentLength(gemm_n_, CONV_SHUFFLE_KERNEL_N);
-    quantized_data_.resize(conv_kernel_desc.group_);
-    for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
-      quantized_data_[g] = new QuantizedTensor<float, uint8_t>(make_shape(aligned_gemm_n_, aligned_gemm_k_),
-                                                               make_shape(gemm_n_), make_shape(gemm_n_, gemm_k_), 64);
+  bool SaveWeight(PackedWeightWriter &writer) {
+    for (size_t g = 0; g < quantized_weight_.size(); ++g) {
+      writer.Append(*quantized_weight_[g]);
     }
-    if (layout_transform) {
-      data_workspace_ = new Tensor<float>(make_shape(conv_data_desc.batch_size_, conv_data_desc.height_in_,
-                                                     conv_data_desc.width_in_, conv_data_desc.channel_in_),
-                                          64);
+    writer.Append(*sum_per_channel_out_);
+    return true;
+  }
+
+  bool LoadWeight(PackedWeightFile &file, ConvolutionKernelDesc &conv_kernel_desc) {
+    SetupGemmShape(conv_kernel_desc);
+    group_weight_.assign(conv_kernel_desc.group_, NULL);
+    quantized_weight_.resize(conv_kernel_desc.group_);
+    for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
+      quantized_weight_[g] = new QuantizedTensor<float, int8_t>(make_shape(aligned_gemm_m_, aligned_gemm_k_),
+                                                                make_shape(gemm_m_), make_shape(gemm_m_, gemm_k_));
+      if (!file.Load(*quantized_weight_[g])) {
+        return false;
+      }
     }
+    sum_per_channel_out_ = new Tensor<float>(make_shape(conv_kernel_desc.channel_out_));
+    return file.Load(*sum_per_channel_out_);
+  }
+
+  void ReserveWorkspace(ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc,
+                        bool layout_transform, bool skip_extreme, ShuffleConvolutionWorkspace &workspace) {
+    workspace.height_out_ = GetConvOutSize(conv_data_desc.height_in_, conv_kernel_desc.kernel_h_,
+                                           conv_kernel_desc.stride_h_, conv_kernel_desc.pad_h_,
+                                           conv_kernel_desc.dilation_h_);
+    workspace.width_out_ = GetConvOutSize(conv_data_desc.width_in_, conv_kernel_desc.kernel_w_,
+                                          conv_kernel_desc.stride_w_, conv_kernel_desc.pad_w_,
+                                          conv_kernel_desc.dilation_w_);
+    workspace.gemm_n_ = conv_data_desc.batch_size_ * workspace.height_out_ * workspace.width_out_;
+    workspace.aligned_gemm_n_ = GetAlignmentLength(workspace.gemm_n_, CONV_SHUFFLE_KERNEL_N);
+    workspace.Reserve(conv_data_desc, conv_kernel_desc, gemm_k_, aligned_gemm_k_, layout_transform, skip_extreme);
+  }
+
+  void InitData(float *srcdata, ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc,
+                float sw_threshold, bool layout_transform, ShuffleConvolutionWorkspace &workspace) {
+    // Allocate Memory
+    ActivationQuantization *activation_quantization = conv_kernel_desc.activation_quantization_;
+    bool direct_1x1 = IsDirect1x1(conv_kernel_desc) && !layout_transform;
+    ReserveWorkspace(conv_data_desc, conv_kernel_desc, layout_transform, direct_1x1 || activation_quantization != NULL,
+                     workspace);
     // Init data
     std::vector<uint8_t *> quantized_data(conv_kernel_desc.group_);
     std::vector<float *> min(conv_kernel_desc.group_);
     std::vector<float *> max(conv_kernel_desc.group_);
     std::vector<float *> ratio(conv_kernel_desc.group_);
+    std::vector<float *> min_per_channel(conv_kernel_desc.group_);
+    std::vector<float *> max_per_channel(conv_kernel_desc.group_);
     for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
-      quantized_data[g] = quantized_data_[g]->data_;
-      min[g] = quantized_data_[g]->min_.data_;
-      max[g] = quantized_data_[g]->max_.data_;
-      ratio[g] = quantized_data_[g]->ratio_.data_;
+      quantized_data[g] = workspace.quantized_data_[g]->data_;
+      min[g] = workspace.quantized_data_[g]->min_.data_;
+      max[g] = workspace.quantized_data_[g]->max_.data_;
+      ratio[g] = workspace.quantized_data_[g]->ratio_.data_;
+      min_per_channel[g] = (workspace.min_per_channel_.empty()) ? NULL : workspace.min_per_channel_[g]->data_;
+      max_per_channel[g] = (workspace.max_per_channel_.empty()) ? NULL : workspace.max_per_channel_[g]->data_;
     }
-#ifdef TIME_PROFILE
-    auto start = std::chrono::system_clock::now();
-#endif
-    if (conv_kernel_desc.layout_ == NCHW && layout_transform == false) {
+    size_t input_size = conv_data_desc.batch_size_ * conv_data_desc.channel_in_ * conv_data_desc.height_in_ *
+                        conv_data_desc.width_in_;
+    TraceScope trace(TRACE_IM2COL,
+                     sizeof(float) * input_size + conv_kernel_desc.group_ * workspace.aligned_gemm_n_ * aligned_gemm_k_,
+                     0);
+    if (activation_quantization != NULL) {
+      if (layout_transform) {
+        TransformLayout(internal_layout_, conv_kernel_desc.layout_, workspace.data_workspace_->data_, srcdata,
+                        conv_data_desc.batch_size_, conv_data_desc.channel_in_,
+                        conv_data_desc.height_in_ * conv_data_desc.width_in_);
+        srcdata = workspace.data_workspace_->data_;
+      }
+      shuffle::StaticQuantizeShuffleNHWCIm2col<float, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+          srcdata, conv_data_desc.batch_size_, conv_kernel_desc.channel_in_per_group_, conv_kernel_desc.group_,
+          conv_data_desc.height_in_, conv_data_desc.width_in_, conv_kernel_desc.kernel_h_, conv_kernel_desc.kernel_w_,
+          conv_kernel_desc.pad_h_, conv_kernel_desc.pad_w_, conv_kernel_desc.stride_h_, conv_kernel_desc.stride_w_,
+          conv_kernel_desc.dilation_h_, conv_kernel_desc.dilation_w_, quantized_data.data(),
+          activation_quantization->inv_scale_.data_, activation_quantization->zero_point_.data_, sw_threshold);
+      for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
+        std::fill(ratio[g], ratio[g] + workspace.gemm_n_, 1.0f);
+        std::fill(min[g], min[g] + workspace.gemm_n_, 1.0f);
+      }
+    } else if (direct_1x1) {
+      shuffle::PadQuantizeShuffleNHWC1x1Wrapper<float>(
+          srcdata, conv_data_desc.batch_size_, conv_kernel_desc.channel_in_, conv_data_desc.height_in_,
+          conv_data_desc.width_in_, conv_kernel_desc.stride_h_, conv_kernel_desc.stride_w_, quantized_data[0], min[0],
+          max[0], ratio[0], sw_threshold);
+    } else if (conv_kernel_desc.layout_ == NCHW && layout_transform == false) {
       shuffle::PadQuantizeShuffleIm2colWrapper<float, NCHW>(
           srcdata, conv_data_desc.batch_size_, conv_kernel_desc.channel_in_per_group_, conv_kernel_desc.group_,
           conv_data_desc.height_in_, conv_data_desc.width_in_, conv_kernel_desc.kernel_h_, conv_kernel_desc.kernel_w_,
           conv_kernel_desc.pad_h_, conv_kernel_desc.pad_w_, conv_kernel_desc.stride_h_, conv_kernel_desc.stride_w_,
           conv_kernel_desc.dilation_h_, conv_kernel_desc.dilation_w_, quantized_data.data(), min.data(), max.data(),
-          ratio.data(), data_workspace_->data_, sw_threshold, layout_transform);
+          ratio.data(), workspace.data_workspace_->data_, sw_threshold, layout_transform);
     } else {
       shuffle::PadQuantizeShuffleIm2colWrapper<float, NHWC>(
           srcdata, conv_data_desc.batch_size_, conv_kernel_desc.channel_in_per_group_, conv_kernel_desc.group_,
           conv_data_desc.height_in_, conv_data_desc.width_in_, conv_kernel_desc.kernel_h_, conv_kernel_desc.kernel_w_,
           conv_kernel_desc.pad_h_, conv_kernel_desc.pad_w_, conv_kernel_desc.stride_h_, conv_kernel_desc.stride_w_,
           conv_kernel_desc.dilation_h_, conv_kernel_desc.dilation_w_, quantized_data.data(), min.data(), max.data(),
-          ratio.data(), NULL, sw_threshold, layout_transform);
+          ratio.data(), (layout_transform) ? workspace.data_workspace_->data_ : NULL, sw_threshold, layout_transform,
+          min_per_channel.data(), max_per_channel.data());
     }
+  }
 
-#ifdef TIME_PROFILE
-    auto end = std::chrono::system_clock::now();
-    auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    std::cerr << "im2col " << diff.count() << "us" << std::endl;
-#endif
+  // uint8 input was quantized by the previous op with this op's activation quantization: a plain tensor only goes
+  // through im2col and a shuffled one is used as the GEMM operand directly.
+  void InitQuantizedData(uint8_t *srcdata, ACTIVATION_FORMAT data_format, ConvolutionDataDesc &conv_data_desc,
+                         ConvolutionKernelDesc &conv_kernel_desc, bool layout_transform,
+                         ShuffleConvolutionWorkspace &workspace) {
+    if (data_format == SHUFFLED_UINT8_ACTIVATION && !AcceptsShuffledInput(conv_kernel_desc)) {
+      fprintf(stderr, "Shuffled uint8 input needs a 1x1, stride 1, unpadded and ungrouped convolution.\n");
+      exit(-1);
+    }
+    ReserveWorkspace(conv_data_desc, conv_kernel_desc, false, true, workspace);
+    if (data_format == SHUFFLED_UINT8_ACTIVATION && !IsShuffledActivationAligned(srcdata)) {
+      memcpy(workspace.quantized_data_[0]->data_, srcdata, workspace.aligned_gemm_n_ * aligned_gemm_k_);
+    } else if (data_format == UINT8_ACTIVATION) {
+      size_t input_size = conv_data_desc.batch_size_ * conv_data_desc.channel_in_ * conv_data_desc.height_in_ *
+                          conv_data_desc.width_in_;
+      TraceScope trace(TRACE_IM2COL, input_size + conv_kernel_desc.group_ * workspace.aligned_gemm_n_ * aligned_gemm_k_,
+                       0);
+      if (layout_transform) {
+        size_t spatial_size = conv_data_desc.height_in_ * conv_data_desc.width_in_;
+        workspace.ReserveActivation(conv_data_desc.batch_size_ * conv_data_desc.channel_in_ * spatial_size);
+        TransformLayout(internal_layout_, conv_kernel_desc.layout_, workspace.activation_workspace_->data_, srcdata,
+                        conv_data_desc.batch_size_, conv_data_desc.channel_in_, spatial_size);
+        srcdata = workspace.activation_workspace_->data_;
+      }
+      std::vector<uint8_t *> quantized_data(conv_kernel_desc.group_);
+      for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
+        quantized_data[g] = workspace.quantized_data_[g]->data_;
+      }
+      ActivationQuantization *activation_quantization = conv_kernel_desc.activation_quantization_;
+      shuffle::StaticQuantizeShuffleNHWCIm2col<uint8_t, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+          srcdata, conv_data_desc.batch_size_, conv_kernel_desc.channel_in_per_group_, conv_kernel_desc.group_,
+          conv_data_desc.height_in_, conv_data_desc.width_in_, conv_kernel_desc.kernel_h_, conv_kernel_desc.kernel_w_,
+          conv_kernel_desc.pad_h_, conv_kernel_desc.pad_w_, conv_kernel_desc.stride_h_, conv_kernel_desc.stride_w_,
+          conv_kernel_desc.dilation_h_, conv_kernel_desc.dilation_w_, quantized_data.data(),
+          activation_quantization->inv_scale_.data_, activation_quantization->zero_point_.data_, data_threshold_);
+    }
+    for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
+      QuantizedTensor<float, uint8_t> *quantized_data = workspace.quantized_data_[g];
+      std::fill(quantized_data->ratio_.data_, quantized_data->ratio_.data_ + workspace.gemm_n_, 1.0f);
+      std::fill(quantized_data->min_.data_, quantized_data->min_.data_ + workspace.gemm_n_, 1.0f);
+    }
   }
 
   void Execute(float *out, float *data, float *bias, ConvolutionDataDesc &conv_data_desc,
                ConvolutionKernelDesc &conv_kernel_desc) {
+    ExecuteQuantized(out, FLOAT_ACTIVATION, data, FLOAT_ACTIVATION, bias, conv_data_desc, conv_kernel_desc);
+  }
+
+  void ExecuteQuantized(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+                        float *bias, ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc) {
     // Allocate memory
     bool transpose_data = (conv_kernel_desc.layout_ != internal_layout_) ? true : false;
-    InitData(data, conv_data_desc, conv_kernel_desc, data_threshold_, transpose_data);
+    ShuffleConvolutionWorkspace *workspace = workspace_pool_.Acquire();
+    if (data_format == FLOAT_ACTIVATION) {
+      InitData(static_cast<float *>(data), conv_data_desc, conv_kernel_desc, data_threshold_, transpose_data,
+               *workspace);
+    } else {
+      InitQuantizedData(static_cast<uint8_t *>(data), data_format, conv_data_desc, conv_kernel_desc, transpose_data,
+                        *workspace);
+    }
+    float *float_out = (out_format == FLOAT_ACTIVATION) ? static_cast<float *>(out) : NULL;
+    shuffle::RequantizeDesc requantize = {static_cast<uint8_t *>(out), NULL, NULL, data_threshold_, 0, 0, 0};
+    if (out_format != FLOAT_ACTIVATION) {
+      requantize.inv_scale_ = conv_kernel_desc.output_quantization_->inv_scale_.data_;
+      requantize.zero_point_ = conv_kernel_desc.output_quantization_->zero_point_.data_;
+    }
+    if (out_format == SHUFFLED_UINT8_ACTIVATION) {
+      requantize.shuffle_rows_ = ACTIVATION_SHUFFLE_ROWS;
+      requantize.shuffle_cols_ = ACTIVATION_SHUFFLE_COLS;
+      requantize.aligned_channels_ = GetAlignmentLength(conv_kernel_desc.channel_out_, ACTIVATION_SHUFFLE_COLS);
+    }
+    shuffle::RequantizeDesc *requantize_desc = (out_format == FLOAT_ACTIVATION) ? NULL : &requantize;
+    size_t gemm_n = workspace->gemm_n_;
+    size_t aligned_gemm_n = workspace->aligned_gemm_n_;
+    bool conv_relu_fusion = (conv_kernel_desc.fusion_mask_ == CONV_RELU_FUSION);
+    bool conv_bn_fusion = (conv_kernel_desc.fusion_mask_ == CONV_BN_FUSION);
+    bool conv_bn_relu_fusion = (conv_kernel_desc.fusion_mask_ == CONV_BN_RELU_FUSION);
+    bool conv_relu_bn_fusion = (conv_kernel_desc.fusion_mask_ == CONV_RELU_BN_FUSION);
+    size_t schedule = conv_kernel_desc.gemm_schedule_;
+    if (!workspace->gemm_plan_.Matches(aligned_gemm_m_, aligned_gemm_n, aligned_gemm_k_) ||
+        schedule != workspace->gemm_schedule_) {
+      workspace->gemm_plan_ =
+          (schedule == 0)
+              ? MakeGemmPlan<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+                    aligned_gemm_m_, aligned_gemm_n, aligned_gemm_k_)
+              : MakeGemmPlan<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+                    aligned_gemm_m_, aligned_gemm_n, aligned_gemm_k_, static_cast<LLC_SCHEDULE>(schedule - 1));
+      workspace->gemm_schedule_ = schedule;
+    }
+    int *partial_sums = workspace->ReservePartialSums();
     // Run
     for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
-#ifdef TIME_PROFILE
-      auto start = std::chrono::system_clock::now();
-#endif
-      float *tempbias = (bias == NULL) ? bias : bias + g * conv_kernel_desc.channel_out_per_group_;
+      size_t channel_offset = g * conv_kernel_desc.channel_out_per_group_;
+      float *tempbias = (bias == NULL) ? bias : bias + channel_offset;
+      float *global_mean =
+          (conv_kernel_desc.global_mean_ == NULL) ? NULL : conv_kernel_desc.global_mean_ + channel_offset;
+      float *mul_variance_coeff =
+          (conv_kernel_desc.mul_variance_coeff_ == NULL) ? NULL : conv_kernel_desc.mul_variance_coeff_ + channel_offset;
+      float *scale = (conv_kernel_desc.scale_ == NULL) ? NULL : conv_kernel_desc.scale_ + channel_offset;
+      float *shift = (conv_kernel_desc.shift_ == NULL) ? NULL : conv_kernel_desc.shift_ + channel_offset;
+      bool shuffled_in_place = (data_format == SHUFFLED_UINT8_ACTIVATION) && IsShuffledActivationAligned(data);
+      uint8_t *data_col = shuffled_in_place ? static_cast<uint8_t *>(data) : workspace->quantized_data_[g]->data_;
       if (conv_kernel_desc.layout_ == NCHW) {
         shuffle::ConvShuffleGEMM<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K, NCHW>(
-            quantized_weight_[g]->data_, quantized_data_[g]->data_, out, aligned_gemm_m_, aligned_gemm_n_,
-            aligned_gemm_k_, quantized_weight_[g]->ratio_.data_, quantized_data_[g]->ratio_.data_,
-            sum_per_channel_out_->data_ + g * conv_kernel_desc.channel_out_per_group_, quantized_data_[g]->min_.data_,
-            tempbias, conv_data_desc.batch_size_, conv_kernel_desc.group_,
-            conv_kernel_desc.channel_out_ / conv_kernel_desc.group_, g, height_out_, width_out_, 0.5,
-            aligned_gemm_m_ - gemm_m_, aligned_gemm_n_ - gemm_n_);
+            quantized_weight_[g]->data_, data_col, float_out, aligned_gemm_m_, aligned_gemm_n,
+            aligned_gemm_k_, quantized_weight_[g]->ratio_.data_, workspace->quantized_data_[g]->ratio_.data_,
+            sum_per_channel_out_->data_ + g * conv_kernel_desc.channel_out_per_group_,
+            workspace->quantized_data_[g]->min_.data_, tempbias, conv_data_desc.batch_size_, conv_kernel_desc.group_,
+            conv_kernel_desc.channel_out_ / conv_kernel_desc.group_, g, workspace->height_out_, workspace->width_out_,
+            0.5, aligned_gemm_m_ - gemm_m_, aligned_gemm_n - gemm_n, conv_relu_fusion, conv_bn_fusion,
+            conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift, requantize_desc,
+            &workspace->gemm_plan_, partial_sums);
       } else {
         shuffle::ConvShuffleGEMM<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K, NHWC>(
-            quantized_weight_[g]->data_, quantized_data_[g]->data_, out, aligned_gemm_m_, aligned_gemm_n_,
-            aligned_gemm_k_, quantized_weight_[g]->ratio_.data_, quantized_data_[g]->ratio_.data_,
-            sum_per_channel_out_->data_ + g * conv_kernel_desc.channel_out_per_group_, quantized_data_[g]->min_.data_,
-            tempbias, conv_data_desc.batch_size_, conv_kernel_desc.group_,
-            conv_kernel_desc.channel_out_ / conv_kernel_desc.group_, g, height_out_, width_out_, 0.5,
-            aligned_gemm_m_ - gemm_m_, aligned_gemm_n_ - gemm_n_);
+            quantized_weight_[g]->data_, data_col, float_out, aligned_gemm_m_, aligned_gemm_n,
+            aligned_gemm_k_, quantized_weight_[g]->ratio_.data_, workspace->quantized_data_[g]->ratio_.data_,
+            sum_per_channel_out_->data_ + g * conv_kernel_desc.channel_out_per_group_,
+            workspace->quantized_data_[g]->min_.data_, tempbias, conv_data_desc.batch_size_, conv_kernel_desc.group_,
+            conv_kernel_desc.channel_out_ / conv_kernel_desc.group_, g, workspace->height_out_, workspace->width_out_,
+            0.5, aligned_gemm_m_ - gemm_m_, aligned_gemm_n - gemm_n, conv_relu_fusion, conv_bn_fusion,
+            conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift, requantize_desc,
+            &workspace->gemm_plan_, partial_sums);
       }
-#ifdef TIME_PROFILE
-      auto end = std::chrono::system_clock::now();
-      auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-      std::cerr << aligned_gemm_m_ << "," << aligned_gemm_n_ << "," << aligned_gemm_k_ << ",";
-      std::cerr << diff.count() << "us, "
-                << (2.0 * aligned_gemm_m_ * aligned_gemm_n_ * aligned_gemm_k_) / diff.count() / 1.0e3 << " glops"
-                << std::endl;
-
-#endif
     }
-    FreeMemory(conv_kernel_desc);
+    workspace_pool_.Release(workspace);
   }
 
-  void FreeMemory(ConvolutionKernelDesc &conv_kernel_desc) {
-    for (size_t g = 0; g < conv_kernel_desc.group_; ++g) {
-      delete quantized_data_[g];
-    }
-    if (data_workspace_) {
-      delete data_workspace_;
-      data_workspace_ = NULL;
-    }
+  void ReleaseWorkspace() {
+    workspace_pool_.Clear();
   }
 
  private:
@@ -223,16 +496,13 @@ struct ShuffleConvolutionAlgo : public BaseConvolutionAlgo {
   Tensor<float> *sum_per_channel_out_;
   std::vector<Tensor<float> *> group_weight_;
   std::vector<QuantizedTensor<float, int8_t> *> quantized_weight_;
-  Tensor<float> *data_workspace_;
-  std::vector<QuantizedTensor<float, uint8_t> *> quantized_data_;
+  WorkspacePool<ShuffleConvolutionWorkspace> workspace_pool_;
 
   const LAYOUT internal_layout_;
 
   size_t gemm_m_;
-  size_t gemm_n_;
   size_t gemm_k_;
   size_t aligned_gemm_m_;
-  size_t aligned_gemm_n_;
   size_t aligned_gemm_k_;
 
   float weight_threshold_;
@@ -17,10 +17,72 @@
 #ifndef NN_SHUFFLE_FC_H
 #define NN_SHUFFLE_FC_H
 
+#include <atomic>
+#include <mutex>
 #include "base_fc.h"
+#include "workspace_pool.h"
+
+static_assert((FC_SHUFFLE_KERNEL_N == ACTIVATION_SHUFFLE_ROWS) && (FC_SHUFFLE_KERNEL_K == ACTIVATION_SHUFFLE_COLS),
+              "shuffled activations must match the FC GEMM tile");
+
+// Per-call state of ShuffleFCAlgo. The quantized data buffer only grows with the batch size.
+struct ShuffleFCWorkspace {
+  ShuffleFCWorkspace() : quantized_data_(NULL), partial_sums_(NULL), workspace_fc_n_(0), workspace_size_(0) {
+  }
+
+  ~ShuffleFCWorkspace() {
+    delete quantized_data_;
+    delete partial_sums_;
+  }
+
+  ShuffleFCWorkspace(const ShuffleFCWorkspace &) = delete;
+
+  ShuffleFCWorkspace &operator=(const ShuffleFCWorkspace &) = delete;
+
+  void Reserve(size_t fc_n, size_t fc_k, size_t aligned_fc_n, size_t aligned_fc_k) {
+    fc_n_ = fc_n;
+    aligned_fc_n_ = aligned_fc_n;
+    if (quantized_data_ == NULL || fc_n_ > workspace_fc_n_ || aligned_fc_n_ * aligned_fc_k > workspace_size_) {
+      delete quantized_data_;
+      size_t fc_n_capacity = std::max(fc_n_, workspace_fc_n_);
+      size_t size_capacity = std::max(aligned_fc_n_ * aligned_fc_k, workspace_size_);
+      quantized_data_ = new QuantizedTensor<float, uint8_t>(make_shape(size_capacity), make_shape(fc_n_capacity),
+                                                            make_shape(fc_n_, fc_k), 64);
+      workspace_fc_n_ = fc_n_capacity;
+      workspace_size_ = size_capacity;
+    }
+  }
+
+  // split-K sums of plan, NULL when it does not split K
+  int *ReservePartialSums(const GemmPlan &plan) {
+    size_t count = plan.PartialSumCount();
+    if (count == 0) {
+      return NULL;
+    }
+    if (partial_sums_ == NULL || partial_sums_->Count() < count) {
+      delete partial_sums_;
+      partial_sums_ = new Tensor<int>(make_shape(count), 64);
+    }
+    return partial_sums_->data_;
+  }
+
+  size_t fc_n_;
+  size_t aligned_fc_n_;
+  // blockings of the last GEMM and GEMV call
+  GemmPlan gemm_plan_;
+  GemmPlan gemv_plan_;
+
+  QuantizedTensor<float, uint8_t> *quantized_data_;
+  Tensor<int> *partial_sums_;
+  size_t workspace_fc_n_;
+  size_t workspace_size_;
+};
 
 struct ShuffleFCAlgo : public BaseFCAlgo {
   ShuffleFCAlgo() {
+    sum_per_channel_out_ = NULL;
+    quantized_kernel_ = NULL;
+    gemv_kernel_ = NULL;
     weight_threshold_ = 64.0f;
     data_threshold_ = 127.0f;
   }
@@ -34,13 +96,27 @@ struct ShuffleFCAlgo : public BaseFCAlgo {
       delete quantized_kernel_;
       quantized_kernel_ = NULL;
     }
+    delete gemv_kernel_.load();
   }
 
-  void InitWeight(float *weight, FCKernelDesc &fc_kernel_desc) {
+  void SetupGemmShape(const FCKernelDesc &fc_kernel_desc) {
     fc_m_ = fc_kernel_desc.channel_out_;
     fc_k_ = fc_kernel_desc.channel_in_;
     aligned_fc_m_ = GetAlignmentLength(fc_m_, FC_SHUFFLE_KERNEL_M);
     aligned_fc_k_ = GetAlignmentLength(fc_k_, FC_SHUFFLE_KERNEL_K);
+    aligned_gemv_m_ = GetAlignmentLength(fc_m_, FC_GEMV_KERNEL_M);
+    aligned_gemv_k_ = GetAlignmentLength(fc_k_, FC_GEMV_KERNEL_K);
+  }
+
+  void InitWeight(float *weight, FCKernelDesc &fc_kernel_desc) {
+    SetupGemmShape(fc_kernel_desc);
+    // only needed until the weight is packed
+    Tensor<float> scaled_kernel(make_shape(fc_m_, fc_k_));
+    if (fc_kernel_desc.activation_quantization_ != NULL) {
+      scaled_kernel.Allocate();
+      fc_kernel_desc.activation_quantization_->FoldScale(scaled_kernel.data_, weight, fc_m_, 1, fc_k_, 1, NCHW);
+      weight = scaled_kernel.data_;
+    }
 
     sum_per_channel_out_ = new Tensor<float>(make_shape(fc_kernel_desc.channel_out_), 64);
     ComputeMatrixSumPerRow<float>(sum_per_channel_out_->data_, weight, fc_kernel_desc.channel_out_,
@@ -50,45 +126,197 @@ struct ShuffleFCAlgo : public BaseFCAlgo {
     shuffle::PadQuantizeShuffle2D<float, FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_K>(
         quantized_kernel_->data_, fc_m_, fc_k_, aligned_fc_m_, aligned_fc_k_, weight, quantized_kernel_->min_.data_,
         quantized_kernel_->max_.data_, quantized_kernel_->ratio_.data_, weight_threshold_);
+    // The GEMV packing quantizes every row identically, so one zero point correction serves GEMM and GEMV.
+    if (fc_kernel_desc.activation_quantization_ != NULL) {
+      std::vector<float> zero_point(fc_k_);
+      fc_kernel_desc.activation_quantization_->ZeroPointPerK(zero_point.data(), 0, fc_k_, 1);
+      shuffle::ShuffledMatrixVectorProduct<FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_K>(
+          sum_per_channel_out_->data_, quantized_kernel_->data_, fc_m_, fc_k_, aligned_fc_k_,
+          quantized_kernel_->ratio_.data_, zero_point.data());
+    }
+  }
+
+  bool SaveWeight(PackedWeightWriter &writer) {
+    writer.Append(*quantized_kernel_);
+    writer.Append(*sum_per_channel_out_);
+    return true;
+  }
+
+  bool LoadWeight(PackedWeightFile &file, FCKernelDesc &fc_kernel_desc) {
+    SetupGemmShape(fc_kernel_desc);
+    quantized_kernel_ = new QuantizedTensor<float, int8_t>(make_shape(aligned_fc_m_, aligned_fc_k_), make_shape(fc_m_),
+                                                           make_shape(fc_m_, fc_k_));
+    sum_per_channel_out_ = new Tensor<float>(make_shape(fc_m_));
+    return file.Load(*quantized_kernel_) && file.Load(*sum_per_channel_out_);
+  }
+
+  // The weight packed for the GEMV kernel, moved over from the GEMM packing on the first small batch, so that ops
+  // that never see one do not hold the weight twice.
+  QuantizedTensor<float, int8_t> *GemvKernel() {
+    QuantizedTensor<float, int8_t> *gemv_kernel = gemv_kernel_.load(std::memory_order_acquire);
+    if (gemv_kernel != NULL) {
+      return gemv_kernel;
+    }
+    std::lock_guard<std::mutex> lock(gemv_mutex_);
+    gemv_kernel = gemv_kernel_.load(std::memory_order_relaxed);
+    if (gemv_kernel == NULL) {
+      gemv_kernel = new QuantizedTensor<float, int8_t>(make_shape(aligned_gemv_m_, aligned_gemv_k_), make_shape(fc_m_),
+                                                       make_shape(fc_m_, fc_k_));
+      gemv_kernel->Allocate(64);
+      shuffle::RepackShuffle2D<FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_K, FC_GEMV_KERNEL_M, FC_GEMV_KERNEL_K>(
+          gemv_kernel->data_, quantized_kernel_->data_, fc_m_, aligned_fc_k_, aligned_gemv_m_, aligned_gemv_k_);
+      gemv_kernel->min_.SetData(quantized_kernel_->min_.data_);
+      gemv_kernel->max_.SetData(quantized_kernel_->max_.data_);
+      gemv_kernel->ratio_.SetData(quantized_kernel_->ratio_.data_);
+      gemv_kernel_.store(gemv_kernel, std::memory_order_release);
+    }
+    return gemv_kernel;
+  }
+
+  // Quantizes and packs the batch into shuffle_rows x shuffle_cols tiles, either scanning each row for its range or
+  // with the calibrated activation parameters, and returns the packed operand. Shuffled uint8 input already is it.
+  template <size_t shuffle_rows, size_t shuffle_cols>
+  uint8_t *QuantizeData(void *data, ACTIVATION_FORMAT data_format, size_t fc_n, size_t aligned_fc_n,
+                        size_t aligned_fc_k, FCKernelDesc &fc_kernel_desc, ShuffleFCWorkspace &workspace) {
+    TraceScope trace(TRACE_IM2COL, ActivationElementSize(data_format) * fc_n * fc_k_ + aligned_fc_n * aligned_fc_k, 0);
+    QuantizedTensor<float, uint8_t> *quantized_data = workspace.quantized_data_;
+    ActivationQuantization *activation_quantization = fc_kernel_desc.activation_quantization_;
+    if (activation_quantization == NULL) {
+      shuffle::PadQuantizeShuffle2D<float, shuffle_rows, shuffle_cols>(
+          quantized_data->data_, fc_n, fc_k_, aligned_fc_n, aligned_fc_k, static_cast<float *>(data),
+          quantized_data->min_.data_, quantized_data->max_.data_, quantized_data->ratio_.data_, data_threshold_);
+      return quantized_data->data_;
+    }
+    // the batch is a 1 x fc_n NHWC image with fc_k channels under a 1x1 kernel
+    uint8_t *data_col = quantized_data->data_;
+    if (data_format == SHUFFLED_UINT8_ACTIVATION && IsShuffledActivationAligned(data)) {
+      data_col = static_cast<uint8_t *>(data);
+    } else if (data_format == SHUFFLED_UINT8_ACTIVATION) {
+      memcpy(data_col, data, aligned_fc_n * aligned_fc_k);
+    } else if (data_format == UINT8_ACTIVATION) {
+      shuffle::StaticQuantizeShuffleNHWCIm2col<uint8_t, shuffle_rows, shuffle_cols>(
+          static_cast<uint8_t *>(data), 1, fc_k_, 1, 1, fc_n, 1, 1, 0, 0, 1, 1, 1, 1, &data_col,
+          activation_quantization->inv_scale_.data_, activation_quantization->zero_point_.data_, data_threshold_);
+    } else {
+      shuffle::StaticQuantizeShuffleNHWCIm2col<float, shuffle_rows, shuffle_cols>(
+          static_cast<float *>(data), 1, fc_k_, 1, 1, fc_n, 1, 1, 0, 0, 1, 1, 1, 1, &data_col,
+          activation_quantization->inv_scale_.data_, activation_quantization->zero_point_.data_, data_threshold_);
+    }
+    std::fill(quantized_data->ratio_.data_, quantized_data->ratio_.data_ + fc_n, 1.0f);
+    std::fill(quantized_data->min_.data_, quantized_data->min_.data_ + fc_n, 1.0f);
+    return data_col;
   }
 
   void Execute(float *out, float *data, float *bias, FCDataDesc &fc_data_desc, FCKernelDesc &fc_kernel_desc) {
-    fc_n_ = fc_data_desc.batch_size_;
-    aligned_fc_n_ = GetAlignmentLength(fc_n_, FC_SHUFFLE_KERNEL_N);
-    quantized_data_ = new QuantizedTensor<float, uint8_t>(make_shape(aligned_fc_n_, aligned_fc_k_), make_shape(fc_n_),
-                                                          make_shape(fc_n_, fc_k_), 64);
-
-    shuffle::PadQuantizeShuffle2D<float, FC_SHUFFLE_KERNEL_N, FC_SHUFFLE_KERNEL_K>(
-        quantized_data_->data_, fc_n_, fc_k_, aligned_fc_n_, aligned_fc_k_, data, quantized_data_->min_.data_,
-        quantized_data_->max_.data_, quantized_data_->ratio_.data_, data_threshold_);
+    ExecuteQuantized(out, FLOAT_ACTIVATION, data, FLOAT_ACTIVATION, bias, fc_data_desc, fc_kernel_desc);
+  }
+
+  // Shuffled uint8 input is packed for the GEMM tile, so it never takes the GEMV path.
+  void ExecuteQuantized(void *out, ACTIVATION_FORMAT out_format, void *data, ACTIVATION_FORMAT data_format,
+                        float *bias, FCDataDesc &fc_data_desc, FCKernelDesc &fc_kernel_desc) {
+    ShuffleFCWorkspace *workspace = workspace_pool_.Acquire();
+    shuffle::RequantizeDesc requantize = {static_cast<uint8_t *>(out), NULL, NULL, data_threshold_, 0, 0, 0};
+    if (out_format != FLOAT_ACTIVATION) {
+      requantize.inv_scale_ = fc_kernel_desc.output_quantization_->inv_scale_.data_;
+      requantize.zero_point_ = fc_kernel_desc.output_quantization_->zero_point_.data_;
+    }
+    if (out_format == SHUFFLED_UINT8_ACTIVATION) {
+      requantize.shuffle_rows_ = ACTIVATION_SHUFFLE_ROWS;
+      requantize.shuffle_cols_ = ACTIVATION_SHUFFLE_COLS;
+      requantize.aligned_channels_ = GetAlignmentLength(fc_m_, ACTIVATION_SHUFFLE_COLS);
+    }
+    float *float_out = (out_format == FLOAT_ACTIVATION) ? static_cast<float *>(out) : NULL;
+    shuffle::RequantizeDesc *requantize_desc = (out_format == FLOAT_ACTIVATION) ? NULL : &requantize;
+    if (fc_data_desc.batch_size_ < FC_SHUFFLE_KERNEL_N && data_format != SHUFFLED_UINT8_ACTIVATION &&
+        !fc_data_desc.force_gemm_) {
+      ExecuteGEMV(float_out, data, data_format, bias, fc_data_desc, fc_kernel_desc, requantize_desc, *workspace);
+    } else {
+      ExecuteGEMM(float_out, data, data_format, bias, fc_data_desc, fc_kernel_desc, requantize_desc, *workspace);
+    }
+    workspace_pool_.Release(workspace);
+  }
+
+  void ExecuteGEMM(float *out, void *data, ACTIVATION_FORMAT data_format, float *bias, FCDataDesc &fc_data_desc,
+                   FCKernelDesc &fc_kernel_desc, shuffle::RequantizeDesc *requantize, ShuffleFCWorkspace &workspace) {
+    size_t fc_n = fc_data_desc.batch_size_;
+    size_t aligned_fc_n = GetAlignmentLength(fc_n, FC_SHUFFLE_KERNEL_N);
+    workspace.Reserve(fc_n, fc_k_, aligned_fc_n, aligned_fc_k_);
+    QuantizedTensor<float, uint8_t> *quantized_data = workspace.quantized_data_;
+
+    uint8_t *data_col = QuantizeData<FC_SHUFFLE_KERNEL_N, FC_SHUFFLE_KERNEL_K>(
+        data, data_format, fc_n, aligned_fc_n, aligned_fc_k_, fc_kernel_desc, workspace);
+    if (!workspace.gemm_plan_.Matches(aligned_fc_m_, aligned_fc_n, aligned_fc_k_)) {
+      workspace.gemm_plan_ = MakeGemmPlan<FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_N, FC_SHUFFLE_KERNEL_K>(
+          aligned_fc_m_, aligned_fc_n, aligned_fc_k_);
+    }
+    int *partial_sums = workspace.ReservePartialSums(workspace.gemm_plan_);
     if (fc_kernel_desc.layout_ == NCHW) {
       shuffle::ConvShuffleGEMM<FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_N, FC_SHUFFLE_KERNEL_K, NCHW>(
-          quantized_kernel_->data_, quantized_data_->data_, out, aligned_fc_m_, aligned_fc_n_, aligned_fc_k_,
-          quantized_kernel_->ratio_.data_, quantized_data_->ratio_.data_, sum_per_channel_out_->data_,
-          quantized_data_->min_.data_, bias, fc_data_desc.batch_size_, 1, fc_kernel_desc.channel_out_, 0, 1, 1, 0.5,
-          aligned_fc_m_ - fc_m_, aligned_fc_n_ - fc_n_, false);
+          quantized_kernel_->data_, data_col, out, aligned_fc_m_, aligned_fc_n, aligned_fc_k_,
+          quantized_kernel_->ratio_.data_, quantized_data->ratio_.data_, sum_per_channel_out_->data_,
+          quantized_data->min_.data_, bias, fc_data_desc.batch_size_, 1, fc_kernel_desc.channel_out_, 0, 1, 1, 0.5,
+          aligned_fc_m_ - fc_m_, aligned_fc_n - fc_n, false, false, false, false, NULL, NULL, NULL, NULL, requantize,
+          &workspace.gemm_plan_, partial_sums);
     } else {
       shuffle::ConvShuffleGEMM<FC_SHUFFLE_KERNEL_M, FC_SHUFFLE_KERNEL_N, FC_SHUFFLE_KERNEL_K, NHWC>(
-          quantized_kernel_->data_, quantized_data_->data_, out, aligned_fc_m_, aligned_fc_n_, aligned_fc_k_,
-          quantized_kernel_->ratio_.data_, quantized_data_->ratio_.data_, sum_per_channel_out_->data_,
-          quantized_data_->min_.data_, bias, fc_data_desc.batch_size_, 1, fc_kernel_desc.channel_out_, 0, 1, 1, 0.5,
-          aligned_fc_m_ - fc_m_, aligned_fc_n_ - fc_n_, false);
+          quantized_kernel_->data_, data_col, out, aligned_fc_m_, aligned_fc_n, aligned_fc_k_,
+          quantized_kernel_->ratio_.data_, quantized_data->ratio_.data_, sum_per_channel_out_->data_,
+          quantized_data->min_.data_, bias, fc_data_desc.batch_size_, 1, fc_kernel_desc.channel_out_, 0, 1, 1, 0.5,
+          aligned_fc_m_ - fc_m_, aligned_fc_n - fc_n, false, false, false, false, NULL, NULL, NULL, NULL, requantize,
+          &workspace.gemm_plan_, partial_sums);
     }
-    delete quantized_data_;
-    quantized_data_ = NULL;
+  }
+
+  // Small batches: every sample is one column, so nothing is padded along the batch dimension.
+  void ExecuteGEMV(float *out, void *data, ACTIVATION_FORMAT data_format, float *bias, FCDataDesc &fc_data_desc,
+                   FCKernelDesc &fc_kernel_desc, shuffle::RequantizeDesc *requantize, ShuffleFCWorkspace &workspace) {
+    size_t fc_n = fc_data_desc.batch_size_;
+    QuantizedTensor<float, int8_t> *gemv_kernel = GemvKernel();
+    workspace.Reserve(fc_n, fc_k_, fc_n, aligned_gemv_k_);
+    QuantizedTensor<float, uint8_t> *quantized_data = workspace.quantized_data_;
+
+    uint8_t *data_col = QuantizeData<FC_GEMV_KERNEL_N, FC_GEMV_KERNEL_K>(data, data_format, fc_n, fc_n,
+                                                                         aligned_gemv_k_, fc_kernel_desc, workspace);
+    if (!workspace.gemv_plan_.Matches(aligned_gemv_m_, fc_n, aligned_gemv_k_)) {
+      workspace.gemv_plan_ =
+          MakeGemmPlan<FC_GEMV_KERNEL_M, FC_GEMV_KERNEL_N, FC_GEMV_KERNEL_K>(aligned_gemv_m_, fc_n, aligned_gemv_k_);
+    }
+    int *partial_sums = workspace.ReservePartialSums(workspace.gemv_plan_);
+    if (fc_kernel_desc.layout_ == NCHW) {
+      shuffle::ConvShuffleGEMM<FC_GEMV_KERNEL_M, FC_GEMV_KERNEL_N, FC_GEMV_KERNEL_K, NCHW>(
+          gemv_kernel->data_, data_col, out, aligned_gemv_m_, fc_n, aligned_gemv_k_, gemv_kernel->ratio_.data_,
+          quantized_data->ratio_.data_, sum_per_channel_out_->data_, quantized_data->min_.data_, bias,
+          fc_data_desc.batch_size_, 1, fc_kernel_desc.channel_out_, 0, 1, 1, 0.5, aligned_gemv_m_ - fc_m_, 0, false,
+          false, false, false, NULL, NULL, NULL, NULL, requantize, &workspace.gemv_plan_,
+          partial_sums);
+    } else {
+      shuffle::ConvShuffleGEMM<FC_GEMV_KERNEL_M, FC_GEMV_KERNEL_N, FC_GEMV_KERNEL_K, NHWC>(
+          gemv_kernel->data_, data_col, out, aligned_gemv_m_, fc_n, aligned_gemv_k_, gemv_kernel->ratio_.data_,
+          quantized_data->ratio_.data_, sum_per_channel_out_->data_, quantized_data->min_.data_, bias,
+          fc_data_desc.batch_size_, 1, fc_kernel_desc.channel_out_, 0, 1, 1, 0.5, aligned_gemv_m_ - fc_m_, 0, false,
+          false, false, false, NULL, NULL, NULL, NULL, requantize, &workspace.gemv_plan_,
+          partial_sums);
+    }
+  }
+
+  void ReleaseWorkspace() {
+    workspace_pool_.Clear();
   }
 
  private:
   size_t fc_m_;
-  size_t fc_n_;
   size_t fc_k_;
   size_t aligned_fc_m_;
-  size_t aligned_fc_n_;
   size_t aligned_fc_k_;
+  size_t aligned_gemv_m_;
+  size_t aligned_gemv_k_;
 
   Tensor<float> *sum_per_channel_out_;
   QuantizedTensor<float, int8_t> *quantized_kernel_;
-  QuantizedTensor<float, uint8_t> *quantized_data_;
+  std::atomic<QuantizedTensor<float, int8_t> *> gemv_kernel_;
+  std::mutex gemv_mutex_;
+
+  WorkspacePool<ShuffleFCWorkspace> workspace_pool_;
 
   float weight_threshold_;
   float data_threshold_;
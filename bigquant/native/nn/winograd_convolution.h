@@ -0,0 +1,219 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_WINOGRAD_CONVOLUTION_H
+#define NN_WINOGRAD_CONVOLUTION_H
+
+#include "base_convolution.h"
+#include "workspace_pool.h"
+
+// Per-call state of WinogradConvolutionAlgo, grow-only like ShuffleConvolutionWorkspace.
+struct WinogradConvolutionWorkspace {
+  WinogradConvolutionWorkspace()
+      : data_workspace_(NULL),
+        transformed_data_(NULL),
+        quantized_data_(NULL),
+        intermedia_out_(NULL),
+        workspace_patch_num_(0) {
+  }
+
+  ~WinogradConvolutionWorkspace() {
+    delete data_workspace_;
+    delete transformed_data_;
+    delete quantized_data_;
+    delete intermedia_out_;
+  }
+
+  WinogradConvolutionWorkspace(const WinogradConvolutionWorkspace &) = delete;
+
+  WinogradConvolutionWorkspace &operator=(const WinogradConvolutionWorkspace &) = delete;
+
+  void Reserve(ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc, size_t aligned_k,
+               bool layout_transform) {
+    if (patch_num_ > workspace_patch_num_) {
+      delete transformed_data_;
+      delete quantized_data_;
+      delete intermedia_out_;
+      transformed_data_ = new Tensor<float>(make_shape(WINOGRAD_POINTS, patch_num_, conv_kernel_desc.channel_in_), 64);
+      quantized_data_ = new QuantizedTensor<float, uint8_t>(make_shape(WINOGRAD_POINTS * aligned_patch_num_, aligned_k),
+                                                            make_shape(WINOGRAD_POINTS * patch_num_), 64);
+      intermedia_out_ = new Tensor<float>(make_shape(WINOGRAD_POINTS, patch_num_, conv_kernel_desc.channel_out_), 64);
+      workspace_patch_num_ = patch_num_;
+    }
+    size_t data_size =
+        conv_data_desc.batch_size_ * conv_data_desc.height_in_ * conv_data_desc.width_in_ * conv_data_desc.channel_in_;
+    if (layout_transform && (data_workspace_ == NULL || data_workspace_->Count() < data_size)) {
+      delete data_workspace_;
+      data_workspace_ = new Tensor<float>(make_shape(conv_data_desc.batch_size_, conv_data_desc.height_in_,
+                                                     conv_data_desc.width_in_, conv_data_desc.channel_in_),
+                                          64);
+    }
+  }
+
+  size_t height_out_;
+  size_t width_out_;
+  size_t patch_y_num_;
+  size_t patch_x_num_;
+  size_t patch_num_;
+  size_t aligned_patch_num_;
+
+  Tensor<float> *data_workspace_;
+  Tensor<float> *transformed_data_;
+  QuantizedTensor<float, uint8_t> *quantized_data_;
+  Tensor<float> *intermedia_out_;
+  size_t workspace_patch_num_;
+};
+
+// Quantized F(2x2, 3x3) Winograd for 3x3, stride 1, dilation 1, ungrouped convolution.
+struct WinogradConvolutionAlgo : public BaseConvolutionAlgo {
+  WinogradConvolutionAlgo(const ConvolutionKernelDesc &conv_kernel_desc) : internal_layout_(NHWC) {
+    if (!IsSupported(conv_kernel_desc)) {
+      fprintf(stderr, "Winograd convolution only supports 3x3, stride 1, dilation 1 and group 1.\n");
+      exit(-1);
+    }
+    weight_threshold_ = 64.0f;
+    data_threshold_ = 127.0f;
+    sum_per_channel_out_ = NULL;
+    quantized_weight_ = NULL;
+  }
+
+  ~WinogradConvolutionAlgo() {
+    delete sum_per_channel_out_;
+    delete quantized_weight_;
+  }
+
+  static bool IsSupported(const ConvolutionKernelDesc &conv_kernel_desc) {
+    return (conv_kernel_desc.kernel_h_ == 3) && (conv_kernel_desc.kernel_w_ == 3) &&
+           (conv_kernel_desc.stride_h_ == 1) && (conv_kernel_desc.stride_w_ == 1) &&
+           (conv_kernel_desc.dilation_h_ == 1) && (conv_kernel_desc.dilation_w_ == 1) && (conv_kernel_desc.group_ == 1);
+  }
+
+  void InitWeight(float *weight, ConvolutionKernelDesc &conv_kernel_desc) {
+    size_t channel_out = conv_kernel_desc.channel_out_;
+    size_t channel_in = conv_kernel_desc.channel_in_;
+    Tensor<float> *nhwc_weight = NULL;
+    if (conv_kernel_desc.layout_ != internal_layout_) {
+      nhwc_weight = new Tensor<float>(make_shape(channel_out, 3, 3, channel_in), 64);
+      TransformLayout(internal_layout_, conv_kernel_desc.layout_, nhwc_weight->data_, weight, channel_out, channel_in,
+                      9);
+      weight = nhwc_weight->data_;
+    }
+    Tensor<float> transformed_kernel(make_shape(WINOGRAD_POINTS, channel_out, channel_in), 64);
+    winograd::NHWCWinograd3x3KernelProcess(transformed_kernel.data_, weight, channel_out, channel_in, 3, 3);
+    delete nhwc_weight;
+
+    aligned_m_ = GetAlignmentLength(channel_out, CONV_SHUFFLE_KERNEL_M);
+    aligned_k_ = GetAlignmentLength(channel_in, CONV_SHUFFLE_KERNEL_K);
+    sum_per_channel_out_ = new Tensor<float>(make_shape(WINOGRAD_POINTS * channel_out), 64);
+    ComputeMatrixSumPerRow<float>(sum_per_channel_out_->data_, transformed_kernel.data_, WINOGRAD_POINTS * channel_out,
+                                  channel_in);
+    quantized_weight_ = new QuantizedTensor<float, int8_t>(make_shape(WINOGRAD_POINTS * aligned_m_, aligned_k_),
+                                                           make_shape(WINOGRAD_POINTS * channel_out), 64);
+    winograd::NHWCWinogradQuantizeKernelByChannel(
+        quantized_weight_->data_, transformed_kernel.data_, channel_out, channel_in, aligned_m_, aligned_k_,
+        quantized_weight_->min_.data_, quantized_weight_->max_.data_, quantized_weight_->ratio_.data_,
+        weight_threshold_);
+  }
+
+  bool SaveWeight(PackedWeightWriter &writer) {
+    writer.Append(*quantized_weight_);
+    writer.Append(*sum_per_channel_out_);
+    return true;
+  }
+
+  bool LoadWeight(PackedWeightFile &file, ConvolutionKernelDesc &conv_kernel_desc) {
+    size_t channel_out = conv_kernel_desc.channel_out_;
+    aligned_m_ = GetAlignmentLength(channel_out, CONV_SHUFFLE_KERNEL_M);
+    aligned_k_ = GetAlignmentLength(conv_kernel_desc.channel_in_, CONV_SHUFFLE_KERNEL_K);
+    quantized_weight_ = new QuantizedTensor<float, int8_t>(make_shape(WINOGRAD_POINTS * aligned_m_, aligned_k_),
+                                                           make_shape(WINOGRAD_POINTS * channel_out),
+                                                           make_shape(WINOGRAD_POINTS * channel_out,
+                                                                      conv_kernel_desc.channel_in_));
+    sum_per_channel_out_ = new Tensor<float>(make_shape(WINOGRAD_POINTS * channel_out));
+    return file.Load(*quantized_weight_) && file.Load(*sum_per_channel_out_);
+  }
+
+  void InitData(float *srcdata, ConvolutionDataDesc &conv_data_desc, ConvolutionKernelDesc &conv_kernel_desc,
+                bool layout_transform, WinogradConvolutionWorkspace &workspace) {
+    workspace.height_out_ = GetConvOutSize(conv_data_desc.height_in_, 3, 1, conv_kernel_desc.pad_h_, 1);
+    workspace.width_out_ = GetConvOutSize(conv_data_desc.width_in_, 3, 1, conv_kernel_desc.pad_w_, 1);
+    workspace.patch_y_num_ = GetAlignmentLength(workspace.height_out_, WINOGRAD_OUT_PATCH) / WINOGRAD_OUT_PATCH;
+    workspace.patch_x_num_ = GetAlignmentLength(workspace.width_out_, WINOGRAD_OUT_PATCH) / WINOGRAD_OUT_PATCH;
+    workspace.patch_num_ = conv_data_desc.batch_size_ * workspace.patch_y_num_ * workspace.patch_x_num_;
+    workspace.aligned_patch_num_ = GetAlignmentLength(workspace.patch_num_, CONV_SHUFFLE_KERNEL_N);
+    workspace.Reserve(conv_data_desc, conv_kernel_desc, aligned_k_, layout_transform);
+
+    if (layout_transform) {
+      TransformLayout(internal_layout_, conv_kernel_desc.layout_, workspace.data_workspace_->data_, srcdata,
+                      conv_data_desc.batch_size_, conv_data_desc.channel_in_,
+                      conv_data_desc.height_in_ * conv_data_desc.width_in_);
+      srcdata = workspace.data_workspace_->data_;
+    }
+    winograd::NHWCWinograd3x3DataProcess(workspace.transformed_data_->data_, srcdata, conv_data_desc.batch_size_,
+                                         conv_data_desc.channel_in_, conv_data_desc.height_in_,
+                                         conv_data_desc.width_in_, conv_kernel_desc.pad_h_, conv_kernel_desc.pad_w_,
+                                         workspace.patch_y_num_, workspace.patch_x_num_);
+    size_t patch_num = workspace.patch_num_;
+    size_t aligned_patch_num = workspace.aligned_patch_num_;
+    size_t channel_in = conv_data_desc.channel_in_;
+    QuantizedTensor<float, uint8_t> *quantized_data = workspace.quantized_data_;
+    for (size_t p = 0; p < WINOGRAD_POINTS; ++p) {
+      shuffle::PadQuantizeShuffle2D<float, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+          quantized_data->data_ + p * aligned_patch_num * aligned_k_, patch_num, channel_in, aligned_patch_num,
+          aligned_k_, workspace.transformed_data_->data_ + p * patch_num * channel_in,
+          quantized_data->min_.data_ + p * patch_num, quantized_data->max_.data_ + p * patch_num,
+          quantized_data->ratio_.data_ + p * patch_num, data_threshold_);
+    }
+  }
+
+  void Execute(float *out, float *data, float *bias, ConvolutionDataDesc &conv_data_desc,
+               ConvolutionKernelDesc &conv_kernel_desc) {
+    bool transpose_data = (conv_kernel_desc.layout_ != internal_layout_) ? true : false;
+    WinogradConvolutionWorkspace *workspace = workspace_pool_.Acquire();
+    InitData(data, conv_data_desc, conv_kernel_desc, transpose_data, *workspace);
+    winograd::NHWCWinograd3x3ElementWiseBatchMul(
+        workspace->intermedia_out_->data_, quantized_weight_->data_, workspace->quantized_data_->data_,
+        conv_data_desc.batch_size_, workspace->patch_y_num_, workspace->patch_x_num_, conv_kernel_desc.channel_in_,
+        conv_kernel_desc.channel_out_, quantized_weight_->ratio_.data_, sum_per_channel_out_->data_,
+        workspace->quantized_data_->ratio_.data_, workspace->quantized_data_->min_.data_);
+    winograd::NHWCWinograd3x3PostProcess(
+        out, workspace->intermedia_out_->data_, conv_data_desc.batch_size_, workspace->patch_y_num_,
+        workspace->patch_x_num_, conv_kernel_desc.channel_out_, workspace->height_out_, workspace->width_out_, bias,
+        conv_kernel_desc.layout_, conv_kernel_desc.fusion_mask_ == CONV_RELU_FUSION,
+        conv_kernel_desc.fusion_mask_ == CONV_BN_FUSION, conv_kernel_desc.fusion_mask_ == CONV_BN_RELU_FUSION,
+        conv_kernel_desc.fusion_mask_ == CONV_RELU_BN_FUSION, conv_kernel_desc.global_mean_,
+        conv_kernel_desc.mul_variance_coeff_, conv_kernel_desc.scale_, conv_kernel_desc.shift_);
+    workspace_pool_.Release(workspace);
+  }
+
+  void ReleaseWorkspace() {
+    workspace_pool_.Clear();
+  }
+
+ private:
+  Tensor<float> *sum_per_channel_out_;
+  QuantizedTensor<float, int8_t> *quantized_weight_;
+  WorkspacePool<WinogradConvolutionWorkspace> workspace_pool_;
+
+  const LAYOUT internal_layout_;
+
+  size_t aligned_m_;
+  size_t aligned_k_;
+
+  float weight_threshold_;
+  float data_threshold_;
+};
+#endif
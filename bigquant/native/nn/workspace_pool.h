@@ -0,0 +1,66 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NN_WORKSPACE_POOL_H
+#define NN_WORKSPACE_POOL_H
+
+#include <mutex>
+#include <vector>
+
+// Hands out one workspace per in-flight Execute, so concurrent calls on the same op never share scratch buffers.
+// Idle workspaces are kept (with their buffers) for the next call.
+template <typename Workspace>
+struct WorkspacePool {
+  WorkspacePool() = default;
+
+  WorkspacePool(const WorkspacePool &) = delete;
+
+  WorkspacePool &operator=(const WorkspacePool &) = delete;
+
+  ~WorkspacePool() {
+    Clear();
+  }
+
+  Workspace *Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_.empty()) {
+      return new Workspace();
+    }
+    Workspace *workspace = idle_.back();
+    idle_.pop_back();
+    return workspace;
+  }
+
+  void Release(Workspace *workspace) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(workspace);
+  }
+
+  // Only idle workspaces are freed; the ones held by running calls return to the pool when those calls finish.
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < idle_.size(); ++i) {
+      delete idle_[i];
+    }
+    idle_.clear();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<Workspace *> idle_;
+};
+
+#endif
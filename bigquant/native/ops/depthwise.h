@@ -0,0 +1,125 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPS_DEPTHWISE_H
+#define OPS_DEPTHWISE_H
+
+#include "../base.h"
+#include "../common.h"
+#include "./kernel-common.h"
+
+// Channels accumulated together per output pixel; the int32 accumulators of one block stay in registers.
+#define DEPTHWISE_CHANNEL_BLOCK 64
+
+// Depthwise convolution (group == channel_in == channel_out) on NHWC data. Weights and data are both quantized
+// symmetrically to int8, so padding is a plain zero and no min/kernel-sum correction is needed. Every inner loop runs
+// over contiguous channels and is left to the vectorizer.
+namespace depthwise {
+
+// weight: (channels, kernel_size); quantized_weight: (kernel_size, channels), one scale per channel.
+void QuantizeKernel(int8_t *quantized_weight, float *ratio, float *weight, size_t channels, size_t kernel_size,
+                    float threshold) {
+  ParallelFor(channels, [&](size_t c) {
+    float max_abs = 0.0f;
+    for (size_t k = 0; k < kernel_size; ++k) {
+      max_abs = fmaxf(max_abs, fabsf(weight[c * kernel_size + k]));
+    }
+    float scale = (max_abs == 0.0f) ? 0.0f : threshold / max_abs;
+    ratio[c] = max_abs / threshold;
+    for (size_t k = 0; k < kernel_size; ++k) {
+      quantized_weight[k * channels + c] = static_cast<int8_t>(std::round(weight[c * kernel_size + k] * scale));
+    }
+  });
+}
+
+// data: NHWC; one scale per (batch, channel), ratio and scale are (batch_size, channels).
+void NHWCQuantizeData(int8_t *quantized_data, float *ratio, float *scale, float *data, size_t batch_size,
+                      size_t channels, size_t spatial_size, float threshold) {
+  size_t channel_blocks = GetAlignmentLength(channels, DEPTHWISE_CHANNEL_BLOCK) / DEPTHWISE_CHANNEL_BLOCK;
+  ParallelFor2D(batch_size, channel_blocks, [&](size_t b, size_t block) {
+    size_t c0 = block * DEPTHWISE_CHANNEL_BLOCK;
+    size_t block_size = std::min(static_cast<size_t>(DEPTHWISE_CHANNEL_BLOCK), channels - c0);
+    float max_abs[DEPTHWISE_CHANNEL_BLOCK] = {0.0f};
+    for (size_t s = 0; s < spatial_size; ++s) {
+      float *src = data + (b * spatial_size + s) * channels + c0;
+      for (size_t c = 0; c < block_size; ++c) {
+        max_abs[c] = fmaxf(max_abs[c], fabsf(src[c]));
+      }
+    }
+    for (size_t c = 0; c < block_size; ++c) {
+      scale[b * channels + c0 + c] = (max_abs[c] == 0.0f) ? 0.0f : threshold / max_abs[c];
+      ratio[b * channels + c0 + c] = max_abs[c] / threshold;
+    }
+  });
+  ParallelFor2D(batch_size, spatial_size, [&](size_t b, size_t s) {
+    float *src = data + (b * spatial_size + s) * channels;
+    int8_t *dst = quantized_data + (b * spatial_size + s) * channels;
+    float *channel_scale = scale + b * channels;
+    for (size_t c = 0; c < channels; ++c) {
+      dst[c] = static_cast<int8_t>(std::round(src[c] * channel_scale[c]));
+    }
+  });
+}
+
+// One parallel region over all output rows; out is written in the requested layout.
+void NHWCDepthwiseConv(float *out, int8_t *quantized_data, int8_t *quantized_weight, float *ratio_data,
+                       float *ratio_weight, float *bias, size_t batch_size, size_t channels, size_t height,
+                       size_t width, size_t kernel_h, size_t kernel_w, size_t stride_h, size_t stride_w, size_t pad_h,
+                       size_t pad_w, size_t dilation_h, size_t dilation_w, size_t height_out, size_t width_out,
+                       LAYOUT layout, bool conv_relu_fusion, bool conv_bn_fusion, bool conv_bn_relu_fusion,
+                       bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale,
+                       float *shift) {
+  ParallelFor2D(batch_size, height_out, [&](size_t b, size_t o_y) {
+    for (size_t o_x = 0; o_x < width_out; ++o_x) {
+      for (size_t c0 = 0; c0 < channels; c0 += DEPTHWISE_CHANNEL_BLOCK) {
+        size_t block_size = std::min(static_cast<size_t>(DEPTHWISE_CHANNEL_BLOCK), channels - c0);
+        int32_t acc[DEPTHWISE_CHANNEL_BLOCK] = {0};
+        for (size_t y = 0; y < kernel_h; ++y) {
+          long in_y = static_cast<long>(o_y * stride_h + y * dilation_h) - static_cast<long>(pad_h);
+          if (in_y < 0 || in_y >= static_cast<long>(height)) {
+            continue;
+          }
+          for (size_t x = 0; x < kernel_w; ++x) {
+            long in_x = static_cast<long>(o_x * stride_w + x * dilation_w) - static_cast<long>(pad_w);
+            if (in_x < 0 || in_x >= static_cast<long>(width)) {
+              continue;
+            }
+            const int8_t *src = quantized_data + ((b * height + in_y) * width + in_x) * channels + c0;
+            const int8_t *w = quantized_weight + (y * kernel_w + x) * channels + c0;
+            for (size_t c = 0; c < block_size; ++c) {
+              acc[c] += static_cast<int32_t>(src[c]) * static_cast<int32_t>(w[c]);
+            }
+          }
+        }
+        for (size_t c = 0; c < block_size; ++c) {
+          size_t channel = c0 + c;
+          float value = acc[c] * ratio_weight[channel] * ratio_data[b * channels + channel] +
+                        ((bias == NULL) ? 0.0f : bias[channel]);
+          ScalarFusionPostProcess(value, channel, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                                  conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+          if (layout == NHWC) {
+            out[((b * height_out + o_y) * width_out + o_x) * channels + channel] = value;
+          } else {
+            out[((b * channels + channel) * height_out + o_y) * width_out + o_x] = value;
+          }
+        }
+      }
+    }
+  });
+}
+}
+
+#endif
@@ -18,6 +18,7 @@
 #define OPS_FIND_EXTREME_H
 
 #include "../base.h"
+#include "../parallel.h"
 
 template <typename DType>
 void GenericFindMinMaxValue(const DType *p, size_t length, DType &min, DType &max) {
@@ -140,17 +141,17 @@ void FindMinMaxValue<float>(const float *p, size_t length, float &min, float &ma
 
 template <typename DType>
 void OMPFindMinMaxValue(DType *p, size_t length, DType &min_value, DType &max_value) {
-  DType min = FLT_MAX;
-  DType max = -FLT_MAX;
-#pragma omp parallel for reduction(min : min) reduction(max : max)
-  for (size_t i = 0; i < length; ++i) {
-    DType value = p[i];
-    min = fminf(min, value);
-    max = fmaxf(max, value);
-  }
-  // such assignment is because icpc openmp cannot support reference reduction
-  min_value = min;
-  max_value = max;
+  std::vector<DType> min(ParallelConcurrency(), FLT_MAX);
+  std::vector<DType> max(min.size(), -FLT_MAX);
+  size_t chunks = ParallelChunks(length, [&](size_t chunk, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      DType value = p[i];
+      min[chunk] = fminf(min[chunk], value);
+      max[chunk] = fmaxf(max[chunk], value);
+    }
+  });
+  min_value = *std::min_element(min.begin(), min.begin() + chunks);
+  max_value = *std::max_element(max.begin(), max.begin() + chunks);
 }
 
 #endif
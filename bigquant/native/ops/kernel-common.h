@@ -99,4 +99,80 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE ScalarBN(float &result, const floa
   result += shift;
 }
 
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE FusionPostProcess(SIMDPSTYPE &result, size_t channel,
+                                                                bool conv_relu_fusion, bool conv_bn_fusion,
+                                                                bool conv_bn_relu_fusion, bool conv_relu_bn_fusion,
+                                                                float *global_mean, float *mul_variance_coeff,
+                                                                float *scale, float *shift) {
+  const SIMDPSTYPE zero = ZERO_PS();
+  if (conv_relu_fusion) {
+    PRELU(result, zero);
+    return;
+  }
+  if (!(conv_bn_fusion || conv_bn_relu_fusion || conv_relu_bn_fusion)) {
+    return;
+  }
+  SIMDPSTYPE simd_global_mean = SET1_PS(global_mean[channel]);
+  SIMDPSTYPE simd_mul_variance_coeff = SET1_PS(mul_variance_coeff[channel]);
+  SIMDPSTYPE simd_scale = SET1_PS((scale == NULL) ? 1.0f : scale[channel]);
+  SIMDPSTYPE simd_shift = SET1_PS((shift == NULL) ? 0.0f : shift[channel]);
+  if (conv_relu_bn_fusion) {
+    PRELU(result, zero);
+  }
+  BN(result, simd_global_mean, simd_mul_variance_coeff, simd_scale, simd_shift);
+  if (conv_bn_relu_fusion) {
+    PRELU(result, zero);
+  }
+}
+
+#if defined(AVX512)
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE FusionPostProcess(SIMDPSTYPEHALF &result, size_t channel,
+                                                                bool conv_relu_fusion, bool conv_bn_fusion,
+                                                                bool conv_bn_relu_fusion, bool conv_relu_bn_fusion,
+                                                                float *global_mean, float *mul_variance_coeff,
+                                                                float *scale, float *shift) {
+  const SIMDPSTYPEHALF zero = ZERO_PS_HALF();
+  if (conv_relu_fusion) {
+    result = MAX_PS_HALF(result, zero);
+    return;
+  }
+  if (!(conv_bn_fusion || conv_bn_relu_fusion || conv_relu_bn_fusion)) {
+    return;
+  }
+  if (conv_relu_bn_fusion) {
+    result = MAX_PS_HALF(result, zero);
+  }
+  result = SUB_PS_HALF(result, SET1_PS_HALF(global_mean[channel]));
+  result = MUL_PS_HALF(result, SET1_PS_HALF(mul_variance_coeff[channel]));
+  result = FMA_PS_HALF(result, SET1_PS_HALF((scale == NULL) ? 1.0f : scale[channel]),
+                       SET1_PS_HALF((shift == NULL) ? 0.0f : shift[channel]));
+  if (conv_bn_relu_fusion) {
+    result = MAX_PS_HALF(result, zero);
+  }
+}
+#endif
+
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE ScalarFusionPostProcess(float &result, size_t channel,
+                                                                      bool conv_relu_fusion, bool conv_bn_fusion,
+                                                                      bool conv_bn_relu_fusion,
+                                                                      bool conv_relu_bn_fusion, float *global_mean,
+                                                                      float *mul_variance_coeff, float *scale,
+                                                                      float *shift) {
+  if (conv_relu_fusion) {
+    result = fmaxf(result, 0.0f);
+    return;
+  }
+  if (!(conv_bn_fusion || conv_bn_relu_fusion || conv_relu_bn_fusion)) {
+    return;
+  }
+  if (conv_relu_bn_fusion) {
+    result = fmaxf(result, 0.0f);
+  }
+  ScalarBN(result, global_mean[channel], mul_variance_coeff[channel], (scale == NULL) ? 1.0f : scale[channel],
+           (shift == NULL) ? 0.0f : shift[channel]);
+  if (conv_bn_relu_fusion) {
+    result = fmaxf(result, 0.0f);
+  }
+}
+
 #endif
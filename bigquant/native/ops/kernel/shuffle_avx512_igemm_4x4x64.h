@@ -287,7 +287,9 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE CommitResult(SIMDSITYPE &sum00, SI
                                      MASK_REDUCEADD_EPI32(high_mask, sum10), MASK_REDUCEADD_EPI32(low_mask, sum10),
                                      MASK_REDUCEADD_EPI32(high_mask, sum01), MASK_REDUCEADD_EPI32(low_mask, sum01),
                                      MASK_REDUCEADD_EPI32(high_mask, sum00), MASK_REDUCEADD_EPI32(low_mask, sum00));
-  int *tmp = reinterpret_cast<int *>(&accumulator);
+  // through memory, reading the vector as int lets the compiler drop the reduction
+  int tmp[kernel_m * kernel_n];
+  STOREU_SI(reinterpret_cast<SIMDSITYPE *>(tmp), accumulator);
   for (size_t m = 0; m < length; ++m) {
     for (size_t n = 0; n < valid_lanes; ++n) {
       *(reinterpret_cast<int *>(result[m]) + n) = tmp[m * kernel_n + n];
@@ -312,7 +314,8 @@ FMAResult(SIMDSITYPE &sum00, SIMDSITYPE &sum01, SIMDSITYPE &sum10, SIMDSITYPE &s
                                      MASK_REDUCEADD_EPI32(high_mask, sum10), MASK_REDUCEADD_EPI32(low_mask, sum10),
                                      MASK_REDUCEADD_EPI32(high_mask, sum01), MASK_REDUCEADD_EPI32(low_mask, sum01),
                                      MASK_REDUCEADD_EPI32(high_mask, sum00), MASK_REDUCEADD_EPI32(low_mask, sum00));
-  int *tmp = reinterpret_cast<int *>(&accumulator);
+  int tmp[kernel_m * kernel_n];
+  STOREU_SI(reinterpret_cast<SIMDSITYPE *>(tmp), accumulator);
   for (size_t m = 0; m < length; ++m) {
     for (size_t n = 0; n < valid_lanes; ++n) {
       *(reinterpret_cast<float *>(result[m * kernel_n + n])) =
@@ -17,6 +17,7 @@
 #ifndef OPS_SHUFFLE_KERNEL_AVX512_IGEMM_8X8X8_H
 #define OPS_SHUFFLE_KERNEL_AVX512_IGEMM_8X8X8_H
 #include "../../base.h"
+#include "../kernel-common.h"
 
 #if defined(AVX512)
 namespace kernel {
@@ -355,9 +356,10 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE CommitResult(SIMDSITYPE sum[], voi
   sum[6] = PERMUTEX_EPI32(permute_mask, sum[6]);
   sum[7] = PERMUTEX_EPI32(permute_mask, sum[7]);
 
+  int tmp[16];
   for (size_t m = 0; m < length; ++m) {
+    STOREU_SI(tmp, sum[m]);
     for (size_t n = 0; n < valid_lanes; ++n) {
-      int *tmp = reinterpret_cast<int *>(&sum[m]);
       *(reinterpret_cast<int *>(result[m]) + n) = tmp[n];
     }
   }
@@ -439,6 +441,10 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE NCHWBlockFMA(SIMDSITYPE sum[], flo
                                FMA_PS_HALF(simd_min_b, SET1_PS_HALF(kernel_sum[i_index + 6]), simd_bias[6]));
   simd_result[7] = FMA_PS_HALF(EPI32TOPS_HALF(CASTSI512TOSI256(sum[7])), simd_coeffi[7],
                                FMA_PS_HALF(simd_min_b, SET1_PS_HALF(kernel_sum[i_index + 7]), simd_bias[7]));
+  for (size_t m = 0; m < 8; ++m) {
+    FusionPostProcess(simd_result[m], i_index + m, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                      conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+  }
 
   STOREU_PS_HALF(result[0 * kernel_n], simd_result[0]);
   STOREU_PS_HALF(result[1 * kernel_n], simd_result[1]);
@@ -526,6 +532,10 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE NHWCBlockFMA(SIMDSITYPE sum[], flo
                                FMA_PS_HALF(simd_min_b, SET1_PS_HALF(kernel_sum[i_index + 6]), simd_bias[6]));
   simd_result[7] = FMA_PS_HALF(EPI32TOPS_HALF(CASTSI512TOSI256(sum[7])), simd_coeffi[7],
                                FMA_PS_HALF(simd_min_b, SET1_PS_HALF(kernel_sum[i_index + 7]), simd_bias[7]));
+  for (size_t m = 0; m < 8; ++m) {
+    FusionPostProcess(simd_result[m], i_index + m, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                      conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+  }
   // a1,a2,a3,a4,a5,a6,a7,a8
   // b1,b2,b3,b4,b5,b6,b7,b8
   // c1,c2,c3,c4,c5,c6,c7,c8
@@ -636,12 +646,15 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE FMAResult(SIMDSITYPE sum[], float
   sum[6] = PERMUTEX_EPI32(permute_mask, sum[6]);
   sum[7] = PERMUTEX_EPI32(permute_mask, sum[7]);
 
+  int tmp[16];
   for (size_t m = 0; m < length; ++m) {
+    STOREU_SI(tmp, sum[m]);
     for (size_t n = 0; n < valid_lanes; ++n) {
-      int *tmp = reinterpret_cast<int *>(&sum[m]);
       *(reinterpret_cast<float *>(result[m * kernel_n + n])) = ratio_a[i_index + m] * ratio_b[j_index + n] * tmp[n] +
                                                                kernel_sum[i_index + m] * min_b[j_index + n] +
                                                                ((bias == NULL) ? 0.0f : bias[i_index + m]);
+      ScalarFusionPostProcess(*(result[m * kernel_n + n]), i_index + m, conv_relu_fusion, conv_bn_fusion,
+                              conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
     }
   }
 }
@@ -688,6 +701,35 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyKernelWrapper(
   }
 }
 
+// The float epilogue of ApplyKernelWrapper on int32 sums that are already reduced, row kx of the tile at
+// sum[kx * kernel_n], as the split-K GEMM leaves them. The postprocess adds the lane pairs the kernel accumulates, so
+// every sum goes to the even lane of its pair with a zero beside it.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyEpilogueWrapper(
+    const int *sum, float *result[], size_t length, size_t valid_lanes, size_t i_index, size_t j_index, float *ratio_a,
+    float *ratio_b, float *min_b, float *kernel_sum, float *bias, bool conv_relu_fusion, bool conv_bn_fusion,
+    bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale,
+    float *shift, bool is_block) {
+  assert((kernel_m == 8) && (kernel_n == 8) && (kernel_k == 8));
+  SIMDSITYPE pairs[8];
+  for (size_t kx = 0; kx < kernel_m; ++kx) {
+    pairs[kx] = EPU32TOEPI64(LOADU_SI_HALF(reinterpret_cast<const SIMDSITYPEHALF *>(sum + kx * kernel_n)));
+  }
+  if (!is_block) {
+    FMAResult<kernel_m, kernel_n>(pairs, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b,
+                                  kernel_sum, bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                                  conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+  } else if (layout == NCHW) {
+    NCHWBlockFMA<kernel_m, kernel_n>(pairs, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b,
+                                     kernel_sum, bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                                     conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+  } else {
+    NHWCBlockFMA<kernel_m, kernel_n>(pairs, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b,
+                                     kernel_sum, bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                                     conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+  }
+}
+
 template <typename DType, size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER bool INLINE_ATTRIBUTE NHWCRTGenrateTargetAddr(DType *result[], DType *pc, size_t valid_m,
                                                                       size_t valid_n, size_t i_index, size_t j_index,
@@ -17,6 +17,8 @@
 #ifndef IGEMM4X1XK_X64
 #define IGEMM4X1XK_X64
 #include "../../base.h"
+#include "../kernel-common.h"
+// Matrix-vector kernel: 4 rows of A against 1 column of B, K is one SIMD register (64/32/16 bytes).
 namespace kernel {
 namespace igemm4x1 {
 
@@ -38,7 +40,7 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE KernelReduce(int8_t *&pa, uint8_t
   reduce(c1, c2, c3, c4, sum1, sum2, sum3, sum4);
 }
 
-static INLINE_SPECIFIER void INLINE_ATTRIBUTE Kernel4x1x32(int8_t *&pa, uint8_t *&pb, SIMDSITYPE &c1, SIMDSITYPE &c2,
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE Kernel4x1(int8_t *&pa, uint8_t *&pb, SIMDSITYPE &c1, SIMDSITYPE &c2,
                                                            SIMDSITYPE &c3, SIMDSITYPE &c4) {
   SIMDSITYPE b = LOAD_SI(reinterpret_cast<SIMDSITYPE *>(pb));
   SIMDSITYPE a1 = LOAD_SI(reinterpret_cast<SIMDSITYPE *>(pa));
@@ -68,11 +70,18 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE Reduce(SIMDSITYPE &c1, SIMDSITYPE
 }
 
 static INLINE_SPECIFIER void INLINE_ATTRIBUTE PostReduce(SIMDSITYPE &sum1, SIMDSITYPE &sum2, SIMDSITYPE &sum3,
-                                                         SIMDSITYPE &sum4, SIMDSITYPEHALF &accumulator) {
+                                                         SIMDSITYPE &sum4, __m128i &accumulator) {
+#if defined(AVX512)
+  accumulator =
+      _mm_setr_epi32(REDUCE_ADD_EPI32(sum1), REDUCE_ADD_EPI32(sum2), REDUCE_ADD_EPI32(sum3), REDUCE_ADD_EPI32(sum4));
+#elif defined(__AVX2__)
   SIMDSITYPE tmp1 = HADD_EPI32(sum1, sum2);
   SIMDSITYPE tmp2 = HADD_EPI32(sum3, sum4);
   SIMDSITYPE tmp = HADD_EPI32(tmp1, tmp2);
   accumulator = EXTRACT_SI128(ADD_EPI32(tmp, PERMUTE_SI128(tmp, tmp, 1)), 0);
+#else
+  accumulator = HADD_EPI32(HADD_EPI32(sum1, sum2), HADD_EPI32(sum3, sum4));
+#endif
 }
 
 template <size_t kernel_k, typename kernel_function, typename sum_function, typename postprocess_function>
@@ -80,7 +89,7 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyStreamKernel(int8_t *&pa, uin
                                                                 float fault_tolerance, void *result[], size_t length,
                                                                 size_t valid_lanes, kernel_function kernel,
                                                                 sum_function sum, postprocess_function postprocess) {
-  SIMDSITYPEHALF accumulator;
+  __m128i accumulator;
   INIT(c1);
   INIT(c2);
   INIT(c3);
@@ -109,7 +118,7 @@ ApplyStreamKernel(int8_t *&pa, uint8_t *&pb, size_t k, float fault_tolerance, fl
                   float *kernel_sum, float *bias, bool conv_relu_fusion, bool conv_bn_fusion, bool conv_bn_relu_fusion,
                   bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale, float *shift,
                   kernel_function kernel, sum_function sum, postprocess_function postprocess) {
-  SIMDSITYPEHALF accumulator;
+  __m128i accumulator;
   INIT(c1);
   INIT(c2);
   INIT(c3);
@@ -133,35 +142,31 @@ ApplyStreamKernel(int8_t *&pa, uint8_t *&pb, size_t k, float fault_tolerance, fl
               mul_variance_coeff, scale, shift);
 }
 
-static INLINE_SPECIFIER void INLINE_ATTRIBUTE CommitResult(SIMDSITYPEHALF &accumulator, void *result[], size_t length,
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE CommitResult(__m128i &accumulator, void *result[], size_t length,
                                                            size_t valid_lanes) {
-  if (length == 4) {
-    *(reinterpret_cast<int *>(result[0])) = EXTRACT_EPI32_HALF(accumulator, 0);
-    *(reinterpret_cast<int *>(result[1])) = EXTRACT_EPI32_HALF(accumulator, 1);
-    *(reinterpret_cast<int *>(result[2])) = EXTRACT_EPI32_HALF(accumulator, 2);
-    *(reinterpret_cast<int *>(result[3])) = EXTRACT_EPI32_HALF(accumulator, 3);
-  } else if (length == 3) {
-    *(reinterpret_cast<int *>(result[0])) = EXTRACT_EPI32_HALF(accumulator, 0);
-    *(reinterpret_cast<int *>(result[1])) = EXTRACT_EPI32_HALF(accumulator, 1);
-    *(reinterpret_cast<int *>(result[2])) = EXTRACT_EPI32_HALF(accumulator, 2);
-  } else if (length == 2) {
-    *(reinterpret_cast<int *>(result[0])) = EXTRACT_EPI32_HALF(accumulator, 0);
-    *(reinterpret_cast<int *>(result[1])) = EXTRACT_EPI32_HALF(accumulator, 1);
-  } else {
-    *(reinterpret_cast<int *>(result[0])) = EXTRACT_EPI32_HALF(accumulator, 0);
+  int tmp[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(tmp), accumulator);
+  for (size_t m = 0; m < length; ++m) {
+    *(reinterpret_cast<int *>(result[m])) = tmp[m];
   }
 }
 
 template <size_t kernel_m, size_t kernel_n>
 static INLINE_SPECIFIER void INLINE_ATTRIBUTE
-StreamFMAResult(SIMDSITYPEHALF &accumulator, float *result[], size_t length, size_t valid_lanes, size_t i_index,
+StreamFMAResult(__m128i &accumulator, float *result[], size_t length, size_t valid_lanes, size_t i_index,
                 size_t j_index, float *ratio_a, float *ratio_b, float *min_b, float *kernel_sum, float *bias,
                 bool conv_relu_fusion, bool conv_bn_fusion, bool conv_bn_relu_fusion, bool conv_relu_bn_fusion,
                 float *global_mean, float *mul_variance_coeff, float *scale, float *shift) {
-  int *tmp = reinterpret_cast<int *>(&accumulator);
+  int tmp[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(tmp), accumulator);
   for (size_t m = 0; m < length; ++m) {
-    *(reinterpret_cast<float *>(result[m])) =
-        ratio_a[i_index + m] * ratio_b[j_index] * tmp[m] + kernel_sum[i_index + m] * min_b[j_index] + bias[i_index + m];
+    float value = ratio_a[i_index + m] * ratio_b[j_index] * tmp[m] + kernel_sum[i_index + m] * min_b[j_index];
+    if (bias != NULL) {
+      value += bias[i_index + m];
+    }
+    ScalarFusionPostProcess(value, i_index + m, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                            conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+    *(result[m]) = value;
   }
 }
 
@@ -169,12 +174,12 @@ template <size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyKernelWrapper(int8_t *&pa, uint8_t *&pb, size_t k,
                                                                  float fault_tolerance, void *result[], size_t length,
                                                                  size_t valid_lanes) {
-  assert((kernel_m == 4) && (kernel_n == 1) && (kernel_k == 32));
+  assert((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH));
   if ((length >= kernel_m) && (valid_lanes >= kernel_n)) {
-    ApplyStreamKernel<kernel_k>(pa, pb, k, fault_tolerance, result, kernel_m, kernel_n, Kernel4x1x32, Reduce,
+    ApplyStreamKernel<kernel_k>(pa, pb, k, fault_tolerance, result, kernel_m, kernel_n, Kernel4x1, Reduce,
                                 CommitResult);
   } else {
-    ApplyStreamKernel<kernel_k>(pa, pb, k, fault_tolerance, result, length, valid_lanes, Kernel4x1x32, Reduce,
+    ApplyStreamKernel<kernel_k>(pa, pb, k, fault_tolerance, result, length, valid_lanes, Kernel4x1, Reduce,
                                 CommitResult);
   }
 }
@@ -185,20 +190,35 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyKernelWrapper(
     size_t i_index, size_t j_index, float *ratio_a, float *ratio_b, float *min_b, float *kernel_sum, float *bias,
     bool conv_relu_fusion, bool conv_bn_fusion, bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean,
     float *mul_variance_coeff, float *scale, float *shift, bool is_block) {
-  assert((kernel_m == 4) && (kernel_n == 1) && (kernel_k == 32));
+  assert((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH));
   ApplyStreamKernel<kernel_k>(pa, pb, k, fault_tolerance, result, std::min(length, kernel_m),
                               std::min(valid_lanes, kernel_n), i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum,
                               bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion,
-                              global_mean, mul_variance_coeff, scale, shift, Kernel4x1x32, Reduce,
+                              global_mean, mul_variance_coeff, scale, shift, Kernel4x1, Reduce,
                               StreamFMAResult<kernel_m, kernel_n>);
 }
 
+// The float epilogue of ApplyKernelWrapper on the int32 sums of the 4 rows, already reduced.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyEpilogueWrapper(
+    const int *sum, float *result[], size_t length, size_t valid_lanes, size_t i_index, size_t j_index, float *ratio_a,
+    float *ratio_b, float *min_b, float *kernel_sum, float *bias, bool conv_relu_fusion, bool conv_bn_fusion,
+    bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale,
+    float *shift, bool is_block) {
+  assert((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH));
+  __m128i accumulator = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sum));
+  StreamFMAResult<kernel_m, kernel_n>(accumulator, result, std::min(length, kernel_m), std::min(valid_lanes, kernel_n),
+                                      i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias, conv_relu_fusion,
+                                      conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean,
+                                      mul_variance_coeff, scale, shift);
+}
+
 template <typename DType, size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER bool INLINE_ATTRIBUTE NHWCRTGenrateTargetAddr(DType *result[], DType *pc, size_t valid_m,
                                                                       size_t valid_n, size_t i_index, size_t j_index,
                                                                       size_t cur_group, size_t channel_per_group,
                                                                       size_t total_channels) {
-  NHWCGenrateTargetAddr<float, kernel_m, kernel_n>(result, pc, valid_m, valid_n, i_index, j_index, cur_group,
+  NHWCGenrateTargetAddr<DType, kernel_m, kernel_n>(result, pc, valid_m, valid_n, i_index, j_index, cur_group,
                                                    channel_per_group, total_channels);
   return false;
 }
@@ -207,7 +227,7 @@ template <typename DType, size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER int INLINE_ATTRIBUTE NCHWRTGenrateTargetAddr(
     DType *result[], DType *pc, size_t valid_m, size_t valid_n, size_t i_index, size_t j_index, size_t cur_group,
     size_t feature_map_size_per_image, size_t feature_map_size_per_group, size_t feature_map_size_per_channel) {
-  NCHWGenrateTargetAddr<float, kernel_m, kernel_n>(result, pc, valid_m, valid_n, i_index, j_index, cur_group,
+  NCHWGenrateTargetAddr<DType, kernel_m, kernel_n>(result, pc, valid_m, valid_n, i_index, j_index, cur_group,
                                                    feature_map_size_per_image, feature_map_size_per_group,
                                                    feature_map_size_per_channel);
   return false;
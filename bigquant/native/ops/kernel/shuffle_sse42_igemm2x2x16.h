@@ -17,6 +17,7 @@
 #ifndef OPS_SHUFFLE_KERNEL_SSE42_IGEMM2X2X16_H
 #define OPS_SHUFFLE_KERNEL_SSE42_IGEMM2X2X16_H
 #include "../../base.h"
+#include "../kernel-common.h"
 
 #if !defined(__AVX2__) && defined(__SSE4_2__)
 namespace kernel {
@@ -223,6 +224,10 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE FMAResult(SIMDSITYPE &sum, float *
                                      kernel_sum[i_index] * min_b[j_index + ky] +
                                      ((bias == NULL) ? 0.0f : bias[i_index]);
     }
+    for (size_t l = 0; l < length; ++l) {
+      ScalarFusionPostProcess(*(result[l * kernel_n + ky]), i_index + l, conv_relu_fusion, conv_bn_fusion,
+                              conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+    }
     sum = SRLI_SI128(sum, 4);
     sum_hi = SRLI_SI128(sum_hi, 4);
   }
@@ -255,6 +260,22 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyKernelWrapper(
                         SSE42Kernel2x2x16, ReduceWrapper, Reduce, FMAResult<kernel_m, kernel_n>);
 }
 
+// The float epilogue of ApplyKernelWrapper on int32 sums that are already reduced, row kx of the tile at
+// sum[kx * kernel_n], which is the lane order of the kernel's register.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE ApplyEpilogueWrapper(
+    const int *sum, float *result[], size_t length, size_t valid_lanes, size_t i_index, size_t j_index, float *ratio_a,
+    float *ratio_b, float *min_b, float *kernel_sum, float *bias, bool conv_relu_fusion, bool conv_bn_fusion,
+    bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale,
+    float *shift, bool is_block) {
+  assert((kernel_m == 2) && (kernel_n == 2) && (kernel_k == 16));
+  SIMDSITYPE tile = LOADU_SI128(reinterpret_cast<const SIMDSITYPE *>(sum));
+  FMAResult<kernel_m, kernel_n>(tile, result, std::min(length, kernel_m), std::min(valid_lanes, kernel_n), i_index,
+                                j_index, ratio_a, ratio_b, min_b, kernel_sum, bias, conv_relu_fusion, conv_bn_fusion,
+                                conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale,
+                                shift);
+}
+
 template <typename DType, size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER bool INLINE_ATTRIBUTE NHWCRTGenrateTargetAddr(DType *result[], DType *pc, size_t valid_m,
                                                                       size_t valid_n, size_t i_index, size_t j_index,
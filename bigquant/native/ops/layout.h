@@ -18,10 +18,8 @@
 #define OPS_LAYOUT_H
 
 #include "../base.h"
-
-#ifdef TIME_PROFILE
-#include <chrono>
-#endif
+#include "../parallel.h"
+#include "../trace.h"
 
 /*
 #if defined(MKL_TRANSPOSE)
@@ -64,61 +62,39 @@ hxw) {
 
 template <typename DType>
 void Transpose(DType *dst, DType *src, size_t m, size_t n) {
-#ifdef TIME_PROFILE
-  auto start = std::chrono::system_clock::now();
-#endif
+  TraceScope trace(TRACE_LAYOUT_TRANSFORM, 2 * sizeof(DType) * m * n, 0);
   for (size_t y = 0; y < n; ++y) {
     for (size_t x = 0; x < m; ++x) {
       *(dst + y * m + x) = *(src + x * n + y);
     }
   }
-#ifdef TIME_PROFILE
-  auto end = std::chrono::system_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  std::cerr << "layout transform " << diff.count() << "us"
-            << " " << m << " " << n << std::endl;
-#endif
 }
 
 template <typename DType>
 void TransformLayout(LAYOUT dst_layout, LAYOUT src_layout, DType *dst, DType *src, size_t batch_size, size_t channels,
                      size_t hxw) {
-#ifdef TIME_PROFILE
-  auto start = std::chrono::system_clock::now();
-#endif
+  TraceScope trace(TRACE_LAYOUT_TRANSFORM, 2 * sizeof(DType) * batch_size * channels * hxw, 0);
   if ((dst_layout == NHWC) && (src_layout == NCHW)) {
-#pragma omp parallel for collapse(2) schedule(static, 1)
-    for (size_t n = 0; n < batch_size; ++n) {
-      for (size_t s = 0; s < hxw; ++s) {
-        size_t batch_offset = n * channels * hxw;
-        size_t offset = batch_offset + s * channels;
-        DType *src_per_pixel = src + batch_offset + s;
-        DType *dst_per_pixel = dst + offset;
-        for (size_t c = 0; c < channels; ++c) {
-          *(dst_per_pixel + c) = *(src_per_pixel + c * hxw);
-        }
+    ParallelFor2D(batch_size, hxw, [&](size_t n, size_t s) {
+      size_t batch_offset = n * channels * hxw;
+      size_t offset = batch_offset + s * channels;
+      DType *src_per_pixel = src + batch_offset + s;
+      DType *dst_per_pixel = dst + offset;
+      for (size_t c = 0; c < channels; ++c) {
+        *(dst_per_pixel + c) = *(src_per_pixel + c * hxw);
       }
-    }
+    });
   } else if ((dst_layout == NCHW) && (src_layout == NHWC)) {
-#pragma omp parallel for collapse(2) schedule(static, 1)
-    for (size_t n = 0; n < batch_size; ++n) {
-      for (size_t c = 0; c < channels; ++c) {
-        size_t batch_offset = n * channels * hxw;
-        size_t offset = batch_offset + c * hxw;
-        DType *dst_per_channel = dst + offset;
-        DType *src_per_channel = src + batch_offset + c;
-        for (size_t s = 0; s < hxw; ++s) {
-          *(dst_per_channel + s) = *(src_per_channel + s * channels);
-        }
+    ParallelFor2D(batch_size, channels, [&](size_t n, size_t c) {
+      size_t batch_offset = n * channels * hxw;
+      size_t offset = batch_offset + c * hxw;
+      DType *dst_per_channel = dst + offset;
+      DType *src_per_channel = src + batch_offset + c;
+      for (size_t s = 0; s < hxw; ++s) {
+        *(dst_per_channel + s) = *(src_per_channel + s * channels);
       }
-    }
+    });
   }
-#ifdef TIME_PROFILE
-  auto end = std::chrono::system_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  std::cerr << "layout transform " << diff.count() << "us"
-            << " " << batch_size << " " << channels << " " << hxw << std::endl;
-#endif
 }
 
 #endif
@@ -87,12 +87,30 @@ template <typename DType, size_t shuffle_rows, size_t shuffle_cols>
 void PadQuantizeShuffle2D(uint8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n, DType *src, DType *min,
                           DType *max, DType *ratio, float sw_threshold);
 
+template <size_t shuffle_rows, size_t shuffle_cols>
+void PadRequantizeShuffle2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n, int8_t *src, float *src_min,
+                            float *src_max, float *min, float *max, float *ratio, float sw_threshold);
+
 template <typename DType, LAYOUT layout>
 void PadQuantizeShuffleIm2colWrapper(DType *data, size_t batch_size, size_t channels_per_group, size_t groups,
                                      size_t height, size_t width, size_t kernel_h, size_t kernel_w, size_t pad_h,
                                      size_t pad_w, size_t stride_h, size_t stride_w, size_t dilation_h,
                                      size_t dilation_w, uint8_t *data_col[], DType *min[], DType *max[], DType *ratio[],
-                                     DType *workspace, float sw_threshold = 255.0f, bool transpose = false);
+                                     DType *workspace, float sw_threshold = 255.0f, bool transpose = false,
+                                     DType *min_workspace[] = NULL, DType *max_workspace[] = NULL);
+
+// uint8 output of ConvShuffleGEMM, q = clamp(round(v * inv_scale[c]) + zero_point[c], 0, threshold) per output
+// channel c. shuffle_rows == 0 writes the GEMM layout (NCHW or NHWC); otherwise q is packed as the data operand of a
+// following GEMM, pixels along n and channels along k padded to aligned_channels.
+struct RequantizeDesc {
+  uint8_t *dst_;
+  float *inv_scale_;
+  float *zero_point_;
+  float threshold_;
+  size_t shuffle_rows_;
+  size_t shuffle_cols_;
+  size_t aligned_channels_;
+};
 
 template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
 void ConvShuffleGEMM(int8_t *pa, uint8_t *pb, float *pc, size_t m, size_t n, size_t k, float *ratio_a, float *ratio_b,
@@ -101,7 +119,8 @@ void ConvShuffleGEMM(int8_t *pa, uint8_t *pb, float *pc, size_t m, size_t n, siz
                      float fault_tolerance = 0.5, size_t pad_m = 0, size_t pad_n = 0, bool conv_relu_fusion = false,
                      bool conv_bn_fusion = false, bool conv_bn_relu_fusion = false, bool conv_relu_bn_fusion = false,
                      float *global_mean = NULL, float *mul_variance_coeff = NULL, float *scale = NULL,
-                     float *shift = NULL);
+                     float *shift = NULL, RequantizeDesc *requantize = NULL, const GemmPlan *plan = NULL,
+                     int *partial_sums = NULL);
 }
 
 namespace dot {
@@ -117,14 +136,39 @@ void NHWCWinograd3x3KernelProcess(float *transformed_weight, float *weight, int
                                   int width);
 
 void NHWCWinogradQuantizeKernelByChannel(int8_t *quantized_kernel, float *transformed_kernel, size_t m, size_t n,
-                                         size_t pad_m, size_t pad_n, float *min, float *max, float *ratio);
+                                         size_t pad_m, size_t pad_n, float *min, float *max, float *ratio,
+                                         float threshold);
+
+void NHWCWinograd3x3DataProcess(float *transformed_data, float *data, size_t batch_size, size_t channel_in,
+                                size_t height, size_t width, size_t pad_h, size_t pad_w, size_t patch_y_num,
+                                size_t patch_x_num);
 
 void NHWCWinograd3x3ElementWiseBatchMul(float *intermedia_out, int8_t *transformed_kernel, uint8_t *transformed_data,
                                         size_t batch_size, size_t patch_y_num, size_t patch_x_num, size_t channel_in,
                                         size_t channel_out, float *ratio_a, float *sum_a, float *ratio_b, float *min_b);
 
 void NHWCWinograd3x3PostProcess(float *out, float *intermedia_out, size_t batch_size, size_t patch_y_num,
-                                size_t patch_x_num, size_t channel_out, size_t height_out, size_t width_out);
+                                size_t patch_x_num, size_t channel_out, size_t height_out, size_t width_out,
+                                float *bias, LAYOUT layout, bool conv_relu_fusion, bool conv_bn_fusion,
+                                bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean,
+                                float *mul_variance_coeff, float *scale, float *shift);
+}
+
+namespace depthwise {
+
+void QuantizeKernel(int8_t *quantized_weight, float *ratio, float *weight, size_t channels, size_t kernel_size,
+                    float threshold);
+
+void NHWCQuantizeData(int8_t *quantized_data, float *ratio, float *scale, float *data, size_t batch_size,
+                      size_t channels, size_t spatial_size, float threshold);
+
+void NHWCDepthwiseConv(float *out, int8_t *quantized_data, int8_t *quantized_weight, float *ratio_data,
+                       float *ratio_weight, float *bias, size_t batch_size, size_t channels, size_t height,
+                       size_t width, size_t kernel_h, size_t kernel_w, size_t stride_h, size_t stride_w, size_t pad_h,
+                       size_t pad_w, size_t dilation_h, size_t dilation_w, size_t height_out, size_t width_out,
+                       LAYOUT layout, bool conv_relu_fusion, bool conv_bn_fusion, bool conv_bn_relu_fusion,
+                       bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale,
+                       float *shift);
 }
 
 #include "find_extreme.h"
@@ -136,4 +180,6 @@ void NHWCWinograd3x3PostProcess(float *out, float *intermedia_out, size_t batch_
 #include "./shuffle/shuffle_igemm.h"
 #include "./mixprecison_gemm.h"
 #include "./dot.h"
+#include "./winograd.h"
+#include "./depthwise.h"
 #endif
@@ -18,9 +18,26 @@
 #define OPS_QUANTIZE_H
 
 #include "../base.h"
+#include "../parallel.h"
 #include "./find_extreme.h"
 
+// std::round of every lane, halves away from zero: trunc(x) + trunc(2 * (x - trunc(x))), each step exact.
+INLINE_SPECIFIER SIMDPSTYPE INLINE_ATTRIBUTE RoundHalfAwayPS(const SIMDPSTYPE &x) {
+  SIMDPSTYPE integer = ROUND_PS(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  SIMDPSTYPE fraction = SUB_PS(x, integer);
+  return ADD_PS(integer, ROUND_PS(ADD_PS(fraction, fraction), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+}
+
 #if defined(AVX512)
+// Stores the low byte of each of the 16 int32 lanes of x.
+INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX512Kernel16StoreEpi8(uint8_t *dst, const SIMDSITYPE &x) {
+  SIMDSITYPE shuffle8mask = SET1_EPI32((12 << 24) + (8 << 16) + (4 << 8) + 0);
+  SIMDSITYPE PERMUTE_INDEX = SET_EPI32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 12, 8, 4, 0);
+  SIMDSITYPE int_result = PERMUTEX_EPI32(PERMUTE_INDEX, SHUFFLE_EPI8(x, shuffle8mask));
+  SIMDSITYPEQUARTER result = EXTRACT_SI128(int_result, 0);                // Get Low 16B
+  STOREU_SI_QUARTER(reinterpret_cast<SIMDSITYPEQUARTER *>(dst), result);  // store
+}
+
 INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX512Kernel8Quantize(uint8_t *dst, float *src, const SIMDPSTYPE &scale,
                                                              const SIMDPSTYPE &bias) {
   SIMDSITYPE shuffle8mask = SET1_EPI32((12 << 24) + (8 << 16) + (4 << 8) + 0);
@@ -34,13 +51,15 @@ INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX512Kernel8Quantize(uint8_t *dst, float
 
 INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX512Kernel16Quantize(uint8_t *dst, float *src, const SIMDPSTYPE &scale,
                                                               const SIMDPSTYPE &bias) {
-  SIMDSITYPE shuffle8mask = SET1_EPI32((12 << 24) + (8 << 16) + (4 << 8) + 0);
-  SIMDSITYPE PERMUTE_INDEX = SET_EPI32(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 12, 8, 4, 0);
-  SIMDPSTYPE data = LOADU_PS(src);  // Load 64B of data
-  SIMDSITYPE int_result = PERMUTEX_EPI32(PERMUTE_INDEX, SHUFFLE_EPI8(PSTOEPI32(FMA_PS(data, scale, bias)),
-                                                                     shuffle8mask));  // FMA then convert float to int
-  SIMDSITYPEQUARTER result = EXTRACT_SI128(int_result, 0);                            // Get Low 16B
-  STOREU_SI_QUARTER(reinterpret_cast<SIMDSITYPEQUARTER *>(dst), result);              // store
+  SIMDPSTYPE data = LOADU_PS(src);                                   // Load 64B of data
+  AVX512Kernel16StoreEpi8(dst, PSTOEPI32(FMA_PS(data, scale, bias)));  // FMA then convert float to int
+}
+
+// dst = std::round((src - offset) * scale), as the scalar loops compute it.
+INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX512Kernel16QuantizeRound(uint8_t *dst, const float *src,
+                                                                   const SIMDPSTYPE &offset, const SIMDPSTYPE &scale) {
+  SIMDPSTYPE data = MUL_PS(SUB_PS(LOADU_PS(src), offset), scale);
+  AVX512Kernel16StoreEpi8(dst, PSTOEPI32(RoundHalfAwayPS(data)));
 }
 
 INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX512Kernel64Quantize(uint8_t *dst, float *src, const SIMDPSTYPE &scale,
@@ -89,18 +108,29 @@ INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX2Kernel32Quantize(uint8_t *dst, float
   STOREU_SI256(reinterpret_cast<SIMDSITYPE *>(dst), data);
 }
 
-INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX2Kernel8Quantize(uint8_t *dst, float *src, const SIMDPSTYPE &scale,
-                                                           const SIMDPSTYPE &bias) {
+// Stores the low byte of each of the 8 int32 lanes of x.
+INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX2Kernel8StoreEpi8(uint8_t *dst, const SIMDSITYPE &x) {
   SIMDSITYPE shuffle8mask = SET_EPI8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0, -1, -1, -1, -1, -1,
                                      -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0);
   SIMDSITYPE shuffle32mask = SET_EPI32(0, 0, 0, 0, 0, 0, 4, 0);
-  SIMDPSTYPE data = LOADU256_PS(src);                                           // Load 32B of data
-  SIMDSITYPE int_result = PSTOEPI32(FMA_PS(data, scale, bias));                 // FMA then convert float to int
-  SIMDSITYPE shuffle_result_per_lane = SHUFFLE_EPI8(int_result, shuffle8mask);  // Get byte 0, 4, 8, 12
+  SIMDSITYPE shuffle_result_per_lane = SHUFFLE_EPI8(x, shuffle8mask);  // Get byte 0, 4, 8, 12
   SIMDSITYPE shuffle_result = PERMUTE_EPI32(shuffle_result_per_lane, shuffle32mask);
   SIMDSITYPEHALF result = EXTRACT_SI128(shuffle_result, 0);             // Get Low
   STORELO_EPI64_HALF(reinterpret_cast<SIMDSITYPEHALF *>(dst), result);  // store
 }
+
+INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX2Kernel8Quantize(uint8_t *dst, float *src, const SIMDPSTYPE &scale,
+                                                           const SIMDPSTYPE &bias) {
+  SIMDPSTYPE data = LOADU256_PS(src);                               // Load 32B of data
+  AVX2Kernel8StoreEpi8(dst, PSTOEPI32(FMA_PS(data, scale, bias)));  // FMA then convert float to int
+}
+
+// dst = std::round((src - offset) * scale), as the scalar loops compute it.
+INLINE_SPECIFIER void INLINE_ATTRIBUTE AVX2Kernel8QuantizeRound(uint8_t *dst, const float *src,
+                                                                const SIMDPSTYPE &offset, const SIMDPSTYPE &scale) {
+  SIMDPSTYPE data = MUL_PS(SUB_PS(LOADU256_PS(src), offset), scale);
+  AVX2Kernel8StoreEpi8(dst, PSTOEPI32(RoundHalfAwayPS(data)));
+}
 #else
 INLINE_SPECIFIER void INLINE_ATTRIBUTE SSE42Kernel8Quantize(uint8_t *dst, float *src, SIMDPSTYPE &scale,
                                                             SIMDPSTYPE &bias) {
@@ -117,9 +147,17 @@ INLINE_SPECIFIER void INLINE_ATTRIBUTE SSE42Kernel8Quantize(uint8_t *dst, float
   STORELO_EPI64(reinterpret_cast<SIMDSITYPE *>(dst), result);
 }
 
+// Stores the low byte of each of the 4 int32 lanes of x1, x2, x3 and x4, in this order.
+INLINE_SPECIFIER void INLINE_ATTRIBUTE SSE42Kernel16StoreEpi8(uint8_t *dst, const SIMDSITYPE &x1, const SIMDSITYPE &x2,
+                                                              const SIMDSITYPE &x3, const SIMDSITYPE &x4) {
+  SIMDSITYPE shuffle8mask = SET_EPI8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0);
+  SIMDSITYPE result1 = UNPACKLO_EPI32(SHUFFLE_EPI8(x1, shuffle8mask), SHUFFLE_EPI8(x2, shuffle8mask));
+  SIMDSITYPE result2 = UNPACKLO_EPI32(SHUFFLE_EPI8(x3, shuffle8mask), SHUFFLE_EPI8(x4, shuffle8mask));
+  STOREU_SI(reinterpret_cast<SIMDSITYPE *>(dst), UNPACKLO_EPI64(result1, result2));
+}
+
 INLINE_SPECIFIER void INLINE_ATTRIBUTE SSE42Kernel16Quantize(uint8_t *dst, float *src, SIMDPSTYPE &scale,
                                                              SIMDPSTYPE &bias) {
-  SIMDSITYPE shuffle8mask = SET_EPI8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 12, 8, 4, 0);
   SIMDPSTYPE data1 = LOADU_PS(src);
   SIMDPSTYPE data2 = LOADU_PS(src + 4);
   SIMDPSTYPE data3 = LOADU_PS(src + 8);
@@ -128,20 +166,31 @@ INLINE_SPECIFIER void INLINE_ATTRIBUTE SSE42Kernel16Quantize(uint8_t *dst, float
   SIMDPSTYPE fma_data2 = FMA_PS(data2, scale, bias);
   SIMDPSTYPE fma_data3 = FMA_PS(data3, scale, bias);
   SIMDPSTYPE fma_data4 = FMA_PS(data4, scale, bias);
-  SIMDSITYPE int_fma_data1 = PSTOEPI32(fma_data1);
-  SIMDSITYPE int_fma_data2 = PSTOEPI32(fma_data2);
-  SIMDSITYPE int_fma_data3 = PSTOEPI32(fma_data3);
-  SIMDSITYPE int_fma_data4 = PSTOEPI32(fma_data4);
-  SIMDSITYPE int_fma_data1_shuffle = SHUFFLE_EPI8(int_fma_data1, shuffle8mask);
-  SIMDSITYPE int_fma_data2_shuffle = SHUFFLE_EPI8(int_fma_data2, shuffle8mask);
-  SIMDSITYPE int_fma_data3_shuffle = SHUFFLE_EPI8(int_fma_data3, shuffle8mask);
-  SIMDSITYPE int_fma_data4_shuffle = SHUFFLE_EPI8(int_fma_data4, shuffle8mask);
-  SIMDSITYPE result1 = UNPACKLO_EPI32(int_fma_data1_shuffle, int_fma_data2_shuffle);
-  SIMDSITYPE result2 = UNPACKLO_EPI32(int_fma_data3_shuffle, int_fma_data4_shuffle);
-  STOREU_SI(reinterpret_cast<SIMDSITYPE *>(dst), UNPACKLO_EPI64(result1, result2));
+  SSE42Kernel16StoreEpi8(dst, PSTOEPI32(fma_data1), PSTOEPI32(fma_data2), PSTOEPI32(fma_data3), PSTOEPI32(fma_data4));
+}
+
+// dst = std::round((src - offset) * scale), as the scalar loops compute it.
+INLINE_SPECIFIER void INLINE_ATTRIBUTE SSE42Kernel16QuantizeRound(uint8_t *dst, const float *src,
+                                                                  const SIMDPSTYPE &offset, const SIMDPSTYPE &scale) {
+  SIMDSITYPE data[4];
+  for (int i = 0; i < 4; ++i) {
+    data[i] = PSTOEPI32(RoundHalfAwayPS(MUL_PS(SUB_PS(LOADU_PS(src + 4 * i), offset), scale)));
+  }
+  SSE42Kernel16StoreEpi8(dst, data[0], data[1], data[2], data[3]);
 }
 #endif
 
+#if defined(AVX512)
+#define QUANTIZE_ROUND_KERNEL_WIDTH 16
+#define QUANTIZE_ROUND_KERNEL_FUNC AVX512Kernel16QuantizeRound
+#elif defined(__AVX2__)
+#define QUANTIZE_ROUND_KERNEL_WIDTH 8
+#define QUANTIZE_ROUND_KERNEL_FUNC AVX2Kernel8QuantizeRound
+#else
+#define QUANTIZE_ROUND_KERNEL_WIDTH 16
+#define QUANTIZE_ROUND_KERNEL_FUNC SSE42Kernel16QuantizeRound
+#endif
+
 template <typename SrcType>
 void PadQuantize(int8_t *dst, size_t length, size_t pad_length, SrcType *src, SrcType &min, SrcType &max,
                  SrcType &ratio, float threshold) {
@@ -203,10 +252,9 @@ void ParallelPadQuantize(int8_t *dst, size_t length, size_t pad_length, SrcType
                          SrcType &ratio, float threshold) {
   OMPFindMinMaxValue(src, length, min, max);
   ratio = (std::abs(max) > std::abs(min)) ? (threshold / std::abs(max)) : (threshold / std::abs(min));
-#pragma omp parallel for
-  for (size_t i = 0; i < length; ++i) {
+  ParallelFor(length, [&](size_t i) {
     dst[i] = static_cast<int8_t>(std::round(src[i] * ratio));
-  }
+  });
   memset(dst + length, 0, pad_length - length);
 }
 
@@ -215,18 +263,16 @@ void ParallelPadQuantize(uint8_t *dst, size_t length, size_t pad_length, SrcType
                          SrcType &ratio, float threshold) {
   OMPFindMinMaxValue(src, length, min, max);
   ratio = threshold / (max - min);
-#pragma omp parallel for
-  for (size_t i = 0; i < length; ++i) {
+  ParallelFor(length, [&](size_t i) {
     dst[i] = static_cast<uint8_t>(std::round((src[i] - min) * ratio));
-  }
+  });
   memset(dst + length, 0, pad_length - length);
 }
 
 template <typename DType>
 void PadQuantize2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n, DType *src, DType *min, DType *max,
                    DType *ratio, float sw_threshold) {
-#pragma omp parallel for proc_bind(close)
-  for (size_t i = 0; i < pad_m; ++i) {
+  ParallelFor(pad_m, [&](size_t i) {
     size_t src_offset = i * n;
     size_t dst_offset = i * pad_n;
     if (i < m) {
@@ -234,14 +280,13 @@ void PadQuantize2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n,
     } else {
       memset(dst + dst_offset, 0, pad_n);
     }
-  }
+  });
 }
 
 template <typename DType>
 void PadQuantize2D(uint8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n, DType *src, DType *min, DType *max,
                    DType *ratio, float sw_threshold) {
-#pragma omp parallel for proc_bind(close)
-  for (size_t i = 0; i < pad_m; ++i) {
+  ParallelFor(pad_m, [&](size_t i) {
     size_t src_offset = i * n;
     size_t dst_offset = i * pad_n;
     if (i < m) {
@@ -249,7 +294,7 @@ void PadQuantize2D(uint8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n,
     } else {
       memset(dst + dst_offset, 0, pad_n);
     }
-  }
+  });
 }
 
 template <typename DType, LAYOUT layout>
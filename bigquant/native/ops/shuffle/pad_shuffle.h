@@ -18,6 +18,8 @@
 #define PAD_SHUFFLE_H
 
 #include "../../base.h"
+#include "../../parallel.h"
+#include "../quantize.h"
 namespace shuffle {
 template <typename DType, size_t shuffle_rows, size_t shuffle_cols>
 void PadShuffle2D(DType *dst, size_t m, size_t n, DType *src) {
@@ -25,8 +27,7 @@ void PadShuffle2D(DType *dst, size_t m, size_t n, DType *src) {
   size_t pad_n = GetAlignmentLength(n, shuffle_cols);
   size_t shuffle_cols_num = n / shuffle_cols * shuffle_cols;
   size_t patch_size = shuffle_cols * shuffle_rows;
-#pragma omp parallel for proc_bind(close)
-  for (size_t i = 0; i < pad_m; ++i) {
+  ParallelFor(pad_m, [&](size_t i) {
     size_t x_block_id = i / shuffle_rows;
     size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
     size_t dst_index = x_block_id * shuffle_rows * pad_n + offset_in_block;
@@ -54,7 +55,7 @@ void PadShuffle2D(DType *dst, size_t m, size_t n, DType *src) {
     for (j = n; j < pad_n; ++j) {
       dst[dst_index++] = 0;
     }
-  }
+  });
 }
 
 template <typename DType, size_t shuffle_rows, size_t shuffle_cols>
@@ -67,8 +68,7 @@ void PadQuantizeShuffle(int8_t *dst, size_t m, size_t n, DType *src, DType &min,
   OMPFindMinMaxValue(src, m * n, min, max);
   float scale = std::abs(((max + min) > 0) ? (1.0 * sw_threshold / max) : (1.0 * sw_threshold / min));
   ratio = 1.0 / scale;
-#pragma omp parallel for proc_bind(close)
-  for (size_t i = 0; i < pad_m; ++i) {
+  ParallelFor(pad_m, [&](size_t i) {
     size_t x_block_id = i / shuffle_rows;
     size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
     size_t dst_index = x_block_id * shuffle_rows * pad_n + offset_in_block;
@@ -94,7 +94,46 @@ void PadQuantizeShuffle(int8_t *dst, size_t m, size_t n, DType *src, DType &min,
       }
       memset(&dst[dst_index], 0, pad_n - shuffle_cols_num);
     }
+  });
+}
+
+// Quantizes length values of a row, a multiple of shuffle_cols, to std::round((src - offset) * scale) and writes each
+// shuffle_cols of them patch_size apart, from dst on.
+template <size_t shuffle_cols, typename QType, typename DType>
+void QuantizeShuffleRow(QType *dst, size_t patch_size, const DType *src, size_t length, DType offset, DType scale) {
+  for (size_t j = 0; j < length; j += shuffle_cols, dst += patch_size) {
+    for (size_t k = 0; k < shuffle_cols; ++k) {
+      dst[k] = static_cast<QType>(std::round((src[j + k] - offset) * scale));
+    }
+  }
+}
+
+// The same on the quantize kernel of the ISA, with the rounding of the scalar loop. Blocks narrower than the kernel
+// are quantized a kernel width at a time and then scattered.
+template <size_t shuffle_cols, typename QType>
+void QuantizeShuffleRow(QType *dst, size_t patch_size, const float *src, size_t length, float offset, float scale) {
+  const size_t width = QUANTIZE_ROUND_KERNEL_WIDTH;
+  SIMDPSTYPE simd_offset = SET1_PS(offset);
+  SIMDPSTYPE simd_scale = SET1_PS(scale);
+  uint8_t *out = reinterpret_cast<uint8_t *>(dst);
+  size_t j = 0;
+  if (shuffle_cols % width == 0) {
+    for (; j < length; j += shuffle_cols, out += patch_size) {
+      for (size_t k = 0; k < shuffle_cols; k += width) {
+        QUANTIZE_ROUND_KERNEL_FUNC(out + k, src + j + k, simd_offset, simd_scale);
+      }
+    }
+  } else if (width % shuffle_cols == 0) {
+    uint8_t bytes[QUANTIZE_ROUND_KERNEL_WIDTH];
+    for (; j + width <= length; j += width) {
+      QUANTIZE_ROUND_KERNEL_FUNC(bytes, src + j, simd_offset, simd_scale);
+      for (size_t k = 0; k < width; k += shuffle_cols, out += patch_size) {
+        memcpy(out, bytes + k, shuffle_cols);
+      }
+    }
   }
+  QuantizeShuffleRow<shuffle_cols, QType, float>(reinterpret_cast<QType *>(out), patch_size, src + j, length - j,
+                                                 offset, scale);
 }
 
 template <typename DType, size_t shuffle_rows, size_t shuffle_cols>
@@ -104,8 +143,7 @@ void PadQuantizeShuffle2D(uint8_t *dst, size_t m, size_t n, size_t pad_m, size_t
   assert(GetAlignmentLength(n, shuffle_cols) == pad_n);
   size_t shuffle_cols_num = n / shuffle_cols * shuffle_cols;
   size_t patch_size = shuffle_cols * shuffle_rows;
-#pragma omp parallel for proc_bind(close)
-  for (size_t i = 0; i < pad_m; ++i) {
+  ParallelFor(pad_m, [&](size_t i) {
     size_t x_block_id = i / shuffle_rows;
     size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
     size_t dst_index = x_block_id * shuffle_rows * pad_n + offset_in_block;
@@ -116,13 +154,9 @@ void PadQuantizeShuffle2D(uint8_t *dst, size_t m, size_t n, size_t pad_m, size_t
       FindMinMaxValue(src + src_index, n, min[i], max[i]);
       DType scale = sw_threshold / (max[i] - min[i]);
       ratio[i] = 1.0 / scale;
-      for (j = 0; j < shuffle_cols_num; j += shuffle_cols) {
-        for (size_t k = 0; k < shuffle_cols; ++k) {
-          dst[dst_index + k] = static_cast<uint8_t>(std::round((src[src_index + k] - min[i]) * scale));
-        }
-        dst_index += patch_size;
-        src_index += shuffle_cols;
-      }
+      QuantizeShuffleRow<shuffle_cols>(dst + dst_index, patch_size, src + src_index, shuffle_cols_num, min[i], scale);
+      dst_index += shuffle_cols_num / shuffle_cols * patch_size;
+      src_index += shuffle_cols_num;
       for (j = shuffle_cols_num; j < n; ++j) {
         dst[dst_index++] = static_cast<uint8_t>(std::round((src[src_index++] - min[i]) * scale));
       }
@@ -134,7 +168,7 @@ void PadQuantizeShuffle2D(uint8_t *dst, size_t m, size_t n, size_t pad_m, size_t
       }
       memset(&dst[dst_index], 0, pad_n - shuffle_cols_num);
     }
-  }
+  });
 }
 
 template <typename DType, size_t shuffle_rows, size_t shuffle_cols>
@@ -144,8 +178,7 @@ void PadQuantizeShuffle2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t
   assert(GetAlignmentLength(n, shuffle_cols) == pad_n);
   size_t shuffle_cols_num = n / shuffle_cols * shuffle_cols;
   size_t patch_size = shuffle_cols * shuffle_rows;
-#pragma omp parallel for proc_bind(close)
-  for (size_t i = 0; i < pad_m; ++i) {
+  ParallelFor(pad_m, [&](size_t i) {
     size_t x_block_id = i / shuffle_rows;
     size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
     size_t dst_index = x_block_id * shuffle_rows * pad_n + offset_in_block;
@@ -157,13 +190,9 @@ void PadQuantizeShuffle2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t
       DType scale =
           std::abs(max[i]) > std::abs(min[i]) ? (sw_threshold / std::abs(max[i])) : (sw_threshold / std::abs(min[i]));
       ratio[i] = 1.0 / scale;
-      for (j = 0; j < shuffle_cols_num; j += shuffle_cols) {
-        for (size_t k = 0; k < shuffle_cols; ++k) {
-          dst[dst_index + k] = static_cast<int8_t>(std::round(src[src_index + k] * scale));
-        }
-        dst_index += patch_size;
-        src_index += shuffle_cols;
-      }
+      QuantizeShuffleRow<shuffle_cols>(dst + dst_index, patch_size, src + src_index, shuffle_cols_num, DType(0), scale);
+      dst_index += shuffle_cols_num / shuffle_cols * patch_size;
+      src_index += shuffle_cols_num;
       for (j = shuffle_cols_num; j < n; ++j) {
         dst[dst_index++] = static_cast<int8_t>(std::round(src[src_index++] * scale));
       }
@@ -175,7 +204,128 @@ void PadQuantizeShuffle2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t
       }
       memset(&dst[dst_index], 0, pad_n - shuffle_cols_num);
     }
+  });
+}
+
+// dst[i] = ratio[i] * sum_j A(i, j) * vec[j], where A (m x n) was packed by the int8 PadQuantizeShuffle2D.
+template <size_t shuffle_rows, size_t shuffle_cols>
+void ShuffledMatrixVectorProduct(float *dst, int8_t *src, size_t m, size_t n, size_t pad_n, float *ratio, float *vec) {
+  ParallelFor(m, [&](size_t i) {
+    int8_t *row = src + i / shuffle_rows * shuffle_rows * pad_n + (i % shuffle_rows) * shuffle_cols;
+    float sum = 0.0f;
+    for (size_t j = 0; j < n; ++j) {
+      sum += row[j / shuffle_cols * shuffle_rows * shuffle_cols + j % shuffle_cols] * vec[j];
+    }
+    dst[i] = ratio[i] * sum;
+  });
+}
+
+// Moves the m rows of an int8 matrix packed by PadQuantizeShuffle2D into src_rows x src_cols tiles over to
+// dst_rows x dst_cols tiles, as if it had been packed for those; the padding is zero.
+template <size_t src_rows, size_t src_cols, size_t dst_rows, size_t dst_cols>
+void RepackShuffle2D(int8_t *dst, const int8_t *src, size_t m, size_t src_pad_n, size_t dst_pad_m, size_t dst_pad_n) {
+  static_assert(dst_cols % src_cols == 0, "a destination tile row must hold whole source tile rows");
+  ParallelFor(dst_pad_m, [&](size_t i) {
+    int8_t *dst_row = dst + i / dst_rows * dst_rows * dst_pad_n + (i % dst_rows) * dst_cols;
+    const int8_t *src_row = src + i / src_rows * src_rows * src_pad_n + (i % src_rows) * src_cols;
+    for (size_t j = 0; j < dst_pad_n; j += src_cols) {
+      int8_t *to = dst_row + j / dst_cols * dst_rows * dst_cols + j % dst_cols;
+      if (i < m && j < src_pad_n) {
+        memcpy(to, src_row + j / src_cols * src_rows * src_cols, src_cols);
+      } else {
+        memset(to, 0, src_cols);
+      }
+    }
+  });
+}
+
+// dst[k] = round(src[k] * scale), rounding halves away from zero like std::round.
+inline void RescaleInt8(int8_t *dst, const int8_t *src, size_t n, float scale) {
+  size_t k = 0;
+#if defined(__AVX2__)
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  for (; k + 8 <= n; k += 8) {
+    __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + k));
+    __m256 value = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(packed)), vscale);
+    __m256 rounded = _mm256_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 carry = _mm256_cmp_ps(_mm256_andnot_ps(sign_mask, _mm256_sub_ps(value, rounded)), half, _CMP_GE_OQ);
+    rounded = _mm256_add_ps(rounded, _mm256_and_ps(carry, _mm256_or_ps(one, _mm256_and_ps(value, sign_mask))));
+    __m256i result = _mm256_cvttps_epi32(rounded);
+    __m128i result16 = _mm_packs_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + k), _mm_packs_epi16(result16, result16));
+  }
+#else
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 one = _mm_set1_ps(1.0f);
+  for (; k + 4 <= n; k += 4) {
+    int32_t word;
+    memcpy(&word, src + k, sizeof(word));
+    __m128 value = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(word))), vscale);
+    __m128 rounded = _mm_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m128 carry = _mm_cmpge_ps(_mm_andnot_ps(sign_mask, _mm_sub_ps(value, rounded)), half);
+    rounded = _mm_add_ps(rounded, _mm_and_ps(carry, _mm_or_ps(one, _mm_and_ps(value, sign_mask))));
+    __m128i result16 = _mm_packs_epi32(_mm_cvttps_epi32(rounded), _mm_setzero_si128());
+    word = _mm_cvtsi128_si32(_mm_packs_epi16(result16, result16));
+    memcpy(dst + k, &word, sizeof(word));
   }
+#endif
+  for (; k < n; ++k) {
+    dst[k] = static_cast<int8_t>(std::round(src[k] * scale));
+  }
+}
+
+// Packs an int8 model (m x n, symmetric per row: value = src * max(|src_min|, |src_max|) / 127) like the int8
+// PadQuantizeShuffle2D packs its dequantized fp32 form, without materializing it. A row whose largest |src| equals
+// sw_threshold is copied as is; any other row is rescaled to sw_threshold.
+template <size_t shuffle_rows, size_t shuffle_cols>
+void PadRequantizeShuffle2D(int8_t *dst, size_t m, size_t n, size_t pad_m, size_t pad_n, int8_t *src, float *src_min,
+                            float *src_max, float *min, float *max, float *ratio, float sw_threshold) {
+  assert(GetAlignmentLength(m, shuffle_rows) == pad_m);
+  assert(GetAlignmentLength(n, shuffle_cols) == pad_n);
+  size_t shuffle_cols_num = n / shuffle_cols * shuffle_cols;
+  size_t patch_size = shuffle_cols * shuffle_rows;
+  ParallelFor(pad_m, [&](size_t i) {
+    size_t x_block_id = i / shuffle_rows;
+    size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
+    size_t dst_index = x_block_id * shuffle_rows * pad_n + offset_in_block;
+    size_t src_index = i * n;
+    if (i >= m) {
+      for (size_t j = 0; j < shuffle_cols_num; j += shuffle_cols) {
+        memset(&dst[dst_index], 0, shuffle_cols);
+        dst_index += patch_size;
+      }
+      memset(&dst[dst_index], 0, pad_n - shuffle_cols_num);
+      return;
+    }
+    int row_min = 0;
+    int row_max = 0;
+    for (size_t j = 0; j < n; ++j) {
+      row_min = std::min(row_min, static_cast<int>(src[src_index + j]));
+      row_max = std::max(row_max, static_cast<int>(src[src_index + j]));
+    }
+    float unit = fmaxf(std::abs(src_max[i]), std::abs(src_min[i])) / 127.0f;
+    float row_abs_max = static_cast<float>(std::max(-row_min, row_max));
+    min[i] = row_min * unit;
+    max[i] = row_max * unit;
+    ratio[i] = row_abs_max * unit / sw_threshold;
+    float scale = (row_abs_max == 0.0f) ? 0.0f : sw_threshold / row_abs_max;
+    for (size_t j = 0; j < shuffle_cols_num; j += shuffle_cols) {
+      if (scale == 1.0f) {
+        memcpy(&dst[dst_index], &src[src_index], shuffle_cols);
+      } else {
+        RescaleInt8(&dst[dst_index], &src[src_index], shuffle_cols, scale);
+      }
+      dst_index += patch_size;
+      src_index += shuffle_cols;
+    }
+    RescaleInt8(&dst[dst_index], &src[src_index], n - shuffle_cols_num, scale);
+    memset(&dst[dst_index + n - shuffle_cols_num], 0, pad_n - n);
+  });
 }
 }
 #endif
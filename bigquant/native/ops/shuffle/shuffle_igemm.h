@@ -19,6 +19,7 @@
 
 #include "../../base.h"
 #include "../../common.h"
+#include "../../trace.h"
 #include "../kernel-common.h"
 #define UNROLL_NUM 4
 
@@ -26,55 +27,98 @@
 #include "../kernel/shuffle_avx512_igemm_8x8x8.h"
 #elif defined(__AVX2__)
 #include "../kernel/shuffle_avx2_sse42_igemm_4xnx8-x64.h"
-#include "../kernel/shuffle_avx2_igemm4x1x32.h"
 #elif !defined(__AVX2__) && defined(__SSE4_2__)
 #include "../kernel/shuffle_sse42_igemm2x2x16.h"
 #endif
+#include "../kernel/shuffle_igemm4x1.h"
 
 namespace shuffle {
 
-template <size_t kernel_m, size_t kernel_n, size_t kernel_k, typename GEMM_KERNEL>
-void ShuffleGEMM(int8_t *pa, uint8_t *pb, int *pc, size_t m, size_t n, size_t k, float fault_tolerance, size_t pad_m,
-                 size_t pad_n, GEMM_KERNEL kernel) {
-  assert((fault_tolerance <= 1.0f) && (fault_tolerance >= 0.0f));
-  size_t m_in_l1, m_in_l2, m_in_l3, n_in_l1, n_in_l2, n_in_l3;
-  GetBlocksInfo<kernel_m>(m, k, m_in_l1, m_in_l2, m_in_l3);
-  GetBlocksInfo<kernel_n>(n, k, n_in_l1, n_in_l2, n_in_l3);
-  size_t valid_m = m - pad_m;
-  size_t valid_n = n - pad_n;
-  bool mltn = m < n;
-  std::array<size_t, 10> blocks1 = {n, m, n_in_l3, m_in_l3, n_in_l2, m_in_l2, n_in_l1, m_in_l1, kernel_n, kernel_m};
-  std::array<size_t, 10> blocks2 = {m, n, m_in_l3, n_in_l3, m_in_l2, n_in_l2, m_in_l1, n_in_l1, kernel_m, kernel_n};
-  std::array<size_t, 10> &blocks = (mltn) ? blocks1 : blocks2;
-#pragma omp parallel proc_bind(close)
-  {
-    for (size_t y3 = 0; y3 < blocks[0]; y3 += blocks[2]) {
-      for (size_t x3 = 0; x3 < blocks[1]; x3 += blocks[3]) {
-#pragma omp for collapse(2) schedule(dynamic) nowait
+// Calls tile(i, j) for every tile of the L2 block at (y2, x2) of the L3 block at (y3, x3). A block size need not
+// divide its parent's, so the last L2 and L1 blocks are clipped rather than running into their neighbours.
+template <typename Tile>
+static INLINE_SPECIFIER void ForEachTileInL2Block(const GemmPlan &plan, size_t y3, size_t x3, size_t y2, size_t x2,
+                                                  Tile &tile) {
+  const std::array<size_t, 10> &blocks = plan.blocks_;
+  bool mltn = plan.mltn_;
+  size_t y_l2 = std::min(blocks[4], blocks[2] - y2);
+  size_t x_l2 = std::min(blocks[5], blocks[3] - x2);
+  for (size_t y1 = 0; y1 < y_l2; y1 += blocks[6]) {
+    for (size_t x1 = 0; x1 < x_l2; x1 += blocks[7]) {
+      size_t y_l1 = std::min(blocks[6], y_l2 - y1);
+      size_t x_l1 = std::min(blocks[7], x_l2 - x1);
+      for (size_t y0 = 0; y0 < y_l1; y0 += blocks[8]) {
+        for (size_t x0 = 0; x0 < x_l1; x0 += blocks[9]) {
+          auto y_sum = y3 + y2 + y1 + y0;
+          auto x_sum = x3 + x2 + x1 + x0;
+          auto j_index = mltn ? y_sum : x_sum;
+          auto i_index = mltn ? x_sum : y_sum;
+          if ((j_index < plan.n_) && (i_index < plan.m_)) {
+            tile(i_index, j_index);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Runs tile(i, j) over the whole GEMM of plan under the LLC schedule it was blocked for.
+template <typename Tile>
+void ForEachGemmTile(const GemmPlan &plan, Tile tile) {
+  const std::array<size_t, 10> &blocks = plan.blocks_;
+  if (ThreadPoolActive()) {
+    // the pool balances by stealing, so each task is one L2 block; SHARED keeps the L3 blocks in sequence
+    size_t y2_num = (blocks[2] + blocks[4] - 1) / blocks[4];
+    size_t x2_num = (blocks[3] + blocks[5] - 1) / blocks[5];
+    if (plan.schedule_ == LLC_SCHEDULE_SHARED) {
+      for (size_t y3 = 0; y3 < blocks[0]; y3 += blocks[2]) {
+        for (size_t x3 = 0; x3 < blocks[1]; x3 += blocks[3]) {
+          ParallelFor2D(y2_num, x2_num, [&](size_t y2, size_t x2) {
+            ForEachTileInL2Block(plan, y3, x3, y2 * blocks[4], x2 * blocks[5], tile);
+          });
+        }
+      }
+    } else {
+      size_t y3_num = (blocks[0] + blocks[2] - 1) / blocks[2];
+      size_t x3_num = (blocks[1] + blocks[3] - 1) / blocks[3];
+      ParallelFor2D(y3_num, x3_num, [&](size_t y3, size_t x3) {
         for (size_t y2 = 0; y2 < blocks[2]; y2 += blocks[4]) {
           for (size_t x2 = 0; x2 < blocks[3]; x2 += blocks[5]) {
-            for (size_t y1 = 0; y1 < blocks[4]; y1 += blocks[6]) {
-              for (size_t x1 = 0; x1 < blocks[5]; x1 += blocks[7]) {
-                for (size_t y0 = 0; y0 < blocks[6]; y0 += blocks[8]) {
-                  for (size_t x0 = 0; x0 < blocks[7]; x0 += blocks[9]) {
-                    auto y_sum = y3 + y2 + y1 + y0;
-                    auto x_sum = x3 + x2 + x1 + x0;
-                    auto j_index = mltn ? y_sum : x_sum;
-                    auto i_index = mltn ? x_sum : y_sum;
-                    if ((j_index < n) && (i_index < m)) {
-                      int8_t *local_pa = pa + i_index * k;
-                      uint8_t *local_pb = pb + j_index * k;
-                      void *result[kernel_m];
-                      for (size_t kx = 0; kx < kernel_m; ++kx) {
-                        size_t dst_addr = (i_index + kx) * valid_n + j_index;
-                        result[kx] = reinterpret_cast<void *>(pc + dst_addr);
-                      }
-                      kernel(local_pa, local_pb, k, fault_tolerance, result, std::min(valid_m - i_index, kernel_m),
-                             std::min(valid_n - j_index, kernel_n));
-                    }
-                  }
-                }
-              }
+            ForEachTileInL2Block(plan, y3 * blocks[2], x3 * blocks[3], y2, x2, tile);
+          }
+        }
+      });
+    }
+  } else if (plan.schedule_ == LLC_SCHEDULE_SHARED) {
+    // chunks of up to 4 L2 blocks, as long as there are still GEMM_TASKS_PER_THREAD chunks per thread
+    size_t chunk = plan.L2BlockNum() / (GEMM_TASKS_PER_THREAD * plan.threads_num_);
+    chunk = std::min(std::max(chunk, static_cast<size_t>(1)), static_cast<size_t>(4));
+    PerfPhaseCounts *phase = CurrentPerfPhase();
+#pragma omp parallel num_threads(plan.threads_num_) proc_bind(close)
+    {
+      PerfWorkerScope counting(phase);
+      for (size_t y3 = 0; y3 < blocks[0]; y3 += blocks[2]) {
+        for (size_t x3 = 0; x3 < blocks[1]; x3 += blocks[3]) {
+#pragma omp for collapse(2) schedule(dynamic, chunk) nowait
+          for (size_t y2 = 0; y2 < blocks[2]; y2 += blocks[4]) {
+            for (size_t x2 = 0; x2 < blocks[3]; x2 += blocks[5]) {
+              ForEachTileInL2Block(plan, y3, x3, y2, x2, tile);
+            }
+          }
+        }
+      }
+    }
+  } else {
+    PerfPhaseCounts *phase = CurrentPerfPhase();
+#pragma omp parallel num_threads(plan.threads_num_)
+    {
+      PerfWorkerScope counting(phase);
+#pragma omp for collapse(2) schedule(static)
+      for (size_t y3 = 0; y3 < blocks[0]; y3 += blocks[2]) {
+        for (size_t x3 = 0; x3 < blocks[1]; x3 += blocks[3]) {
+          for (size_t y2 = 0; y2 < blocks[2]; y2 += blocks[4]) {
+            for (size_t x2 = 0; x2 < blocks[3]; x2 += blocks[5]) {
+              ForEachTileInL2Block(plan, y3, x3, y2, x2, tile);
             }
           }
         }
@@ -83,6 +127,27 @@ void ShuffleGEMM(int8_t *pa, uint8_t *pb, int *pc, size_t m, size_t n, size_t k,
   }
 }
 
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, typename GEMM_KERNEL>
+void ShuffleGEMM(int8_t *pa, uint8_t *pb, int *pc, size_t m, size_t n, size_t k, float fault_tolerance, size_t pad_m,
+                 size_t pad_n, GEMM_KERNEL kernel, const GemmPlan *plan = NULL) {
+  assert((fault_tolerance <= 1.0f) && (fault_tolerance >= 0.0f));
+  GemmPlan local_plan;
+  plan = SelectGemmPlan<kernel_m, kernel_n, kernel_k>(plan, local_plan, m, n, k);
+  size_t valid_m = m - pad_m;
+  size_t valid_n = n - pad_n;
+  ForEachGemmTile(*plan, [&](size_t i_index, size_t j_index) {
+    int8_t *local_pa = pa + i_index * k;
+    uint8_t *local_pb = pb + j_index * k;
+    void *result[kernel_m];
+    for (size_t kx = 0; kx < kernel_m; ++kx) {
+      size_t dst_addr = (i_index + kx) * valid_n + j_index;
+      result[kx] = reinterpret_cast<void *>(pc + dst_addr);
+    }
+    kernel(local_pa, local_pb, k, fault_tolerance, result, std::min(valid_m - i_index, kernel_m),
+           std::min(valid_n - j_index, kernel_n));
+  });
+}
+
 // Common Convolution. It's one purely gemm which can be used in wider application.
 template <size_t kernel_m, size_t kernel_n, size_t kernel_k, typename GEMM_KERNEL>
 void InternalMixPrecisionGemm(ORDER order, enum TRANSPOSE transA, enum TRANSPOSE transB, int m, int n, int k, int8_t *a,
@@ -100,18 +165,12 @@ void InternalMixPrecisionGemm(ORDER order, enum TRANSPOSE transA, enum TRANSPOSE
   aligned_malloc(reinterpret_cast<void **>(&pad_b), 64, sizeof(uint8_t) * n_out * k_out);
   PadShuffle2D<int8_t, kernel_m, kernel_k>(pad_a, m, k, a);
   PadShuffle2D<uint8_t, kernel_n, kernel_k>(pad_b, n, k, b);
-#ifdef TIME_PROFILE
-  auto start = std::chrono::system_clock::now();
-#endif
-  // TODO(yandai) better wrapper
-  ShuffleGEMM<kernel_m, kernel_n, kernel_k>(pad_a, pad_b, c, m_out, n_out, k_out, fault_tolerance, m_out - m, n_out - n,
-                                            kernel);
-#ifdef TIME_PROFILE
-  auto end = std::chrono::system_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  std::cerr << std::endl << "time = " << diff.count() << "us" << std::endl;
-  std::cerr << "flops = " << (2.0 * m * n * k / (diff.count() / 1.0e6)) / 1.0e9 << std::endl;
-#endif
+  {
+    TraceScope trace(TRACE_GEMM, (m_out + n_out) * k_out + sizeof(int) * m * n, 2 * m_out * n_out * k_out);
+    // TODO(yandai) better wrapper
+    ShuffleGEMM<kernel_m, kernel_n, kernel_k>(pad_a, pad_b, c, m_out, n_out, k_out, fault_tolerance, m_out - m,
+                                              n_out - n, kernel);
+  }
   aligned_free(pad_a);
   aligned_free(pad_b);
 }
@@ -122,6 +181,13 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE QuantizedGemmSelect(
     size_t i_index, size_t j_index, float *ratio_a, float *ratio_b, float *min_b, float *kernel_sum, float *bias,
     bool conv_relu_fusion, bool conv_bn_fusion, bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean,
     float *mul_variance_coeff, float *scale, float *shift, bool is_block) {
+  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH)) {
+    kernel::igemm4x1::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k, layout>(
+        pa, pb, k, fault_tolerance, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum,
+        bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean,
+        mul_variance_coeff, scale, shift, is_block);
+    return;
+  }
 #if defined(AVX512)
   if ((kernel_m == 8) && (kernel_n == 8) && (kernel_k == 8)) {
     kernel::avx512_igemm8x8x8::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k, layout>(
@@ -136,12 +202,6 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE QuantizedGemmSelect(
         bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean,
         mul_variance_coeff, scale, shift, is_block);
   }
-  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == 32)) {
-    kernel::igemm4x1::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k, layout>(
-        pa, pb, k, fault_tolerance, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum,
-        bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean,
-        mul_variance_coeff, scale, shift, is_block);
-  }
 #else
   /*
   if ((kernel_m == 4) && (kernel_n == 4) && (kernel_k == 8)) {
@@ -163,11 +223,80 @@ static INLINE_SPECIFIER void INLINE_ATTRIBUTE QuantizedGemmSelect(
 #endif
 }
 
+// int32 dot products of one tile, row kx of the tile written to result[kx][0, valid_lanes).
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k>
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE IntGemmSelect(int8_t *pa, uint8_t *pb, size_t k, float fault_tolerance,
+                                                            void *result[], size_t length, size_t valid_lanes) {
+  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH)) {
+    kernel::igemm4x1::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k>(pa, pb, k, fault_tolerance, result, length,
+                                                                       valid_lanes);
+    return;
+  }
+#if defined(AVX512)
+  if ((kernel_m == 8) && (kernel_n == 8) && (kernel_k == 8)) {
+    kernel::avx512_igemm8x8x8::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k>(pa, pb, k, fault_tolerance, result,
+                                                                                length, valid_lanes);
+  }
+#elif defined(__AVX2__)
+  if ((kernel_m == 4) && (kernel_n == 8) && (kernel_k == 8)) {
+    kernel::igemm4xn::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k>(pa, pb, k, fault_tolerance, result, length,
+                                                                       valid_lanes);
+  }
+#else
+  if ((kernel_m == 2) && (kernel_n == 2) && (kernel_k == 16)) {
+    kernel::sse42_igemm2x2x16::ApplyKernelWrapper<kernel_m, kernel_n, kernel_k>(pa, pb, k, fault_tolerance, result,
+                                                                                length, valid_lanes);
+  }
+#endif
+}
+
+// The float epilogue of QuantizedGemmSelect on a tile of int32 sums already reduced, row kx at sum[kx * kernel_n].
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE EpilogueSelect(
+    const int *sum, float *result[], size_t length, size_t valid_lanes, size_t i_index, size_t j_index, float *ratio_a,
+    float *ratio_b, float *min_b, float *kernel_sum, float *bias, bool conv_relu_fusion, bool conv_bn_fusion,
+    bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff, float *scale,
+    float *shift, bool is_block) {
+  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH)) {
+    kernel::igemm4x1::ApplyEpilogueWrapper<kernel_m, kernel_n, kernel_k, layout>(
+        sum, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+        conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+        scale, shift, is_block);
+    return;
+  }
+#if defined(AVX512)
+  if ((kernel_m == 8) && (kernel_n == 8) && (kernel_k == 8)) {
+    kernel::avx512_igemm8x8x8::ApplyEpilogueWrapper<kernel_m, kernel_n, kernel_k, layout>(
+        sum, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+        conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+        scale, shift, is_block);
+  }
+#elif defined(__AVX2__)
+  if ((kernel_m == 4) && (kernel_n == 8) && (kernel_k == 8)) {
+    kernel::igemm4xn::ApplyEpilogueWrapper<kernel_m, kernel_n, kernel_k, layout>(
+        sum, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+        conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+        scale, shift, is_block);
+  }
+#else
+  if ((kernel_m == 2) && (kernel_n == 2) && (kernel_k == 16)) {
+    kernel::sse42_igemm2x2x16::ApplyEpilogueWrapper<kernel_m, kernel_n, kernel_k, layout>(
+        sum, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+        conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+        scale, shift, is_block);
+  }
+#endif
+}
+
 template <typename DType, size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER bool INLINE_ATTRIBUTE NHWCRTGenrateTargetAddr(DType *result[], DType *pc, size_t valid_m,
                                                                       size_t valid_n, size_t i_index, size_t j_index,
                                                                       size_t cur_group, size_t channel_per_group,
                                                                       size_t total_channels) {
+  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH)) {
+    return kernel::igemm4x1::NHWCRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(
+        result, pc, valid_m, valid_n, i_index, j_index, cur_group, channel_per_group, total_channels);
+  }
 #if defined(AVX512)
   if ((kernel_m == 8) && (kernel_n == 8) && (kernel_k == 8)) {
     return kernel::avx512_igemm8x8x8::NHWCRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(
@@ -178,10 +307,6 @@ static INLINE_SPECIFIER bool INLINE_ATTRIBUTE NHWCRTGenrateTargetAddr(DType *res
     return kernel::igemm4xn::NHWCRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(
         result, pc, valid_m, valid_n, i_index, j_index, cur_group, channel_per_group, total_channels);
   }
-  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == 32)) {
-    // return kernel::igemm4x1::NHWCRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(result, pc, valid_m,
-    // valid_n, i_index, j_index, cur_group, channel_per_group, total_channels);
-  }
 #else
   /*
   if ((kernel_m == 4) && (kernel_n == 4) && (kernel_k == 8)) {
@@ -200,6 +325,11 @@ template <typename DType, size_t kernel_m, size_t kernel_n, size_t kernel_k>
 static INLINE_SPECIFIER int INLINE_ATTRIBUTE NCHWRTGenrateTargetAddr(
     DType *result[], DType *pc, size_t valid_m, size_t valid_n, size_t i_index, size_t j_index, size_t cur_group,
     size_t feature_map_size_per_image, size_t feature_map_size_per_group, size_t feature_map_size_per_channel) {
+  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == OPERAND_WIDTH)) {
+    return kernel::igemm4x1::NCHWRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(
+        result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
+        feature_map_size_per_group, feature_map_size_per_channel);
+  }
 #if defined(AVX512)
   if ((kernel_m == 8) && (kernel_n == 8) && (kernel_k == 8)) {
     return kernel::avx512_igemm8x8x8::NCHWRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(
@@ -212,11 +342,6 @@ static INLINE_SPECIFIER int INLINE_ATTRIBUTE NCHWRTGenrateTargetAddr(
         result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
         feature_map_size_per_group, feature_map_size_per_channel);
   }
-  if ((kernel_m == 4) && (kernel_n == 1) && (kernel_k == 32)) {
-    return kernel::igemm4x1::NCHWRTGenrateTargetAddr<DType, kernel_m, kernel_n, kernel_k>(
-        result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
-        feature_map_size_per_group, feature_map_size_per_channel);
-  }
 #else
   /*
   if ((kernel_m == 4) && (kernel_n == 4) && (kernel_k == 8)) {
@@ -235,166 +360,195 @@ static INLINE_SPECIFIER int INLINE_ATTRIBUTE NCHWRTGenrateTargetAddr(
 #endif
 }
 
-#if defined(LLC_SHARED)
+// Writes a finished float tile, value (ky, kx) at tile[ky * kernel_m + kx], as uint8 requantized per channel.
+template <size_t kernel_m, LAYOUT layout>
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE StoreRequantizedTile(const float *tile, size_t length, size_t valid_lanes,
+                                                                   size_t i_index, size_t j_index, size_t cur_group,
+                                                                   size_t channel_per_group, size_t total_channels,
+                                                                   size_t feature_map_size_per_channel,
+                                                                   const RequantizeDesc &requantize) {
+  size_t rows = requantize.shuffle_rows_;
+  size_t cols = requantize.shuffle_cols_;
+  for (size_t ky = 0; ky < valid_lanes; ++ky) {
+    size_t j = j_index + ky;
+    for (size_t kx = 0; kx < length; ++kx) {
+      size_t c = cur_group * channel_per_group + i_index + kx;
+      float value = tile[ky * kernel_m + kx] * requantize.inv_scale_[c] + requantize.zero_point_[c] + 0.5f;
+      size_t index;
+      if (rows != 0) {
+        index = j / rows * rows * requantize.aligned_channels_ + c / cols * cols * rows + j % rows * cols + c % cols;
+      } else if (layout == NHWC) {
+        index = j * total_channels + c;
+      } else {
+        index = (j / feature_map_size_per_channel * total_channels + c) * feature_map_size_per_channel +
+                j % feature_map_size_per_channel;
+      }
+      requantize.dst_[index] = static_cast<uint8_t>(fminf(fmaxf(value, 0.0f), requantize.threshold_));
+    }
+  }
+}
+
+// Requantizing epilogue: the tile is finished in a local NHWC block (kernel_n pixels of kernel_m channels) by the
+// regular float epilogue and only its uint8 values are written out.
 template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
-void ConvShuffleGEMM(int8_t *pa, uint8_t *pb, float *pc, size_t m, size_t n, size_t k, float *ratio_a, float *ratio_b,
-                     float *kernel_sum, float *min_b, float *bias, size_t batch_size, size_t groups,
-                     size_t channel_per_group, size_t cur_group, size_t height_out, size_t width_out,
-                     float fault_tolerance, size_t pad_m, size_t pad_n, bool conv_relu_fusion, bool conv_bn_fusion,
-                     bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff,
-                     float *scale, float *shift) {
-#ifdef TIME_PROFILE
-  auto start = std::chrono::system_clock::now();
-#endif
-  assert((fault_tolerance <= 1.0f) && (fault_tolerance >= 0.0f));
-  assert((layout == NCHW) || (layout == NHWC));
-  size_t feature_map_size_per_channel = height_out * width_out;
+static INLINE_SPECIFIER void INLINE_ATTRIBUTE RequantizedGemmTile(
+    int8_t *pa, uint8_t *pb, size_t k, float fault_tolerance, size_t length, size_t valid_lanes, size_t i_index,
+    size_t j_index, float *ratio_a, float *ratio_b, float *min_b, float *kernel_sum, float *bias, size_t cur_group,
+    size_t channel_per_group, size_t total_channels, size_t feature_map_size_per_channel, bool conv_relu_fusion,
+    bool conv_bn_fusion, bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean,
+    float *mul_variance_coeff, float *scale, float *shift, const RequantizeDesc &requantize) {
+  float tile[kernel_m * kernel_n];
+  float *result[kernel_m * kernel_n];
+  bool is_block = NHWCRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(result, tile, length, valid_lanes, 0, 0,
+                                                                               0, 0, kernel_m);
+  QuantizedGemmSelect<kernel_m, kernel_n, kernel_k, NHWC>(
+      pa, pb, k, fault_tolerance, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum,
+      bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+      scale, shift, is_block);
+  StoreRequantizedTile<kernel_m, layout>(tile, length, valid_lanes, i_index, j_index, cur_group, channel_per_group,
+                                         total_channels, feature_map_size_per_channel, requantize);
+}
+
+// Split-K: every tile is cut along K into the plan's slices. Each (tile, slice) task stores its int32 partial sums in
+// partial, plan.PartialSumCount() of them, then each tile adds its slices in slice order and runs the regular float
+// epilogue on the sums.
+template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
+void SplitKConvShuffleGEMM(int8_t *pa, uint8_t *pb, float *pc, size_t m, size_t n, size_t k, float *ratio_a,
+                           float *ratio_b, float *kernel_sum, float *min_b, float *bias, size_t groups,
+                           size_t channel_per_group, size_t cur_group, size_t feature_map_size_per_channel,
+                           float fault_tolerance, size_t valid_m, size_t valid_n, bool conv_relu_fusion,
+                           bool conv_bn_fusion, bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean,
+                           float *mul_variance_coeff, float *scale, float *shift, RequantizeDesc *requantize,
+                           const GemmPlan &plan, int *partial) {
+  size_t tiles_n = n / kernel_n;
+  size_t tiles = m / kernel_m * tiles_n;
+  size_t slices = plan.k_slices_;
   size_t total_channels = channel_per_group * groups;
-  size_t feature_map_size_per_image = total_channels * height_out * width_out;
-  size_t feature_map_size_per_group = height_out * width_out * channel_per_group;
-  size_t m_in_l1, m_in_l2, m_in_l3, n_in_l1, n_in_l2, n_in_l3;
-  GetBlocksInfo<kernel_m>(m, k, m_in_l1, m_in_l2, m_in_l3);
-  GetBlocksInfo<kernel_n>(n, k, n_in_l1, n_in_l2, n_in_l3);
-  size_t valid_m = m - pad_m;
-  size_t valid_n = n - pad_n;
-  bool mltn = m < n;
-  std::array<size_t, 10> blocks1 = {n, m, n_in_l3, m_in_l3, n_in_l2, m_in_l2, n_in_l1, m_in_l1, kernel_n, kernel_m};
-  std::array<size_t, 10> blocks2 = {m, n, m_in_l3, n_in_l3, m_in_l2, n_in_l2, m_in_l1, n_in_l1, kernel_m, kernel_n};
-  std::array<size_t, 10> &blocks = (mltn) ? blocks1 : blocks2;
-#pragma omp parallel proc_bind(close)
-  {
-    for (size_t y3 = 0; y3 < blocks[0]; y3 += blocks[2]) {
-      for (size_t x3 = 0; x3 < blocks[1]; x3 += blocks[3]) {
-#pragma omp for collapse(2) schedule(dynamic, 4) nowait
-        for (size_t y2 = 0; y2 < blocks[2]; y2 += blocks[4]) {
-          for (size_t x2 = 0; x2 < blocks[3]; x2 += blocks[5]) {
-            for (size_t y1 = 0; y1 < blocks[4]; y1 += blocks[6]) {
-              for (size_t x1 = 0; x1 < blocks[5]; x1 += blocks[7]) {
-                for (size_t y0 = 0; y0 < blocks[6]; y0 += blocks[8]) {
-                  for (size_t x0 = 0; x0 < blocks[7]; x0 += blocks[9]) {
-                    auto y_sum = y3 + y2 + y1 + y0;
-                    auto x_sum = x3 + x2 + x1 + x0;
-                    auto j_index = mltn ? y_sum : x_sum;
-                    auto i_index = mltn ? x_sum : y_sum;
-                    if ((j_index < n) && (i_index < m)) {
-                      float *result[kernel_m * kernel_n];
-                      int8_t *local_pa = pa + i_index * k;
-                      uint8_t *local_pb = pb + j_index * k;
-                      bool is_block;
-                      if (layout == NCHW) {
-                        is_block = NCHWRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
-                            result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
-                            feature_map_size_per_group, feature_map_size_per_channel);
-                      } else {
-                        is_block = NHWCRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
-                            result, pc, valid_m, valid_n, i_index, j_index, cur_group, channel_per_group,
-                            total_channels);
-                      }
-                      QuantizedGemmSelect<kernel_m, kernel_n, kernel_k, layout>(
-                          local_pa, local_pb, k, fault_tolerance, result, std::min(valid_m - i_index, kernel_m),
-                          std::min(valid_n - j_index, kernel_n), i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum,
-                          bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean,
-                          mul_variance_coeff, scale, shift, is_block);
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
+  size_t feature_map_size_per_image = total_channels * feature_map_size_per_channel;
+  size_t feature_map_size_per_group = channel_per_group * feature_map_size_per_channel;
+  ParallelFor2D(tiles, slices, [&](size_t t, size_t s) {
+    size_t i_index = t / tiles_n * kernel_m;
+    size_t j_index = t % tiles_n * kernel_n;
+    size_t k_index = s * plan.k_slice_;
+    int *sum = partial + (t * slices + s) * kernel_m * kernel_n;
+    void *result[kernel_m];
+    for (size_t kx = 0; kx < kernel_m; ++kx) {
+      result[kx] = sum + kx * kernel_n;
+    }
+    IntGemmSelect<kernel_m, kernel_n, kernel_k>(pa + i_index * k + k_index * kernel_m,
+                                                pb + j_index * k + k_index * kernel_n,
+                                                std::min(plan.k_slice_, k - k_index), fault_tolerance, result,
+                                                kernel_m, kernel_n);
+  });
+  // the slice sums, then a scale, an offset and the bias per output
+  TraceScope trace(TRACE_EPILOGUE, sizeof(int) * plan.PartialSumCount() + sizeof(float) * valid_m * valid_n,
+                   m * n * (slices - 1) + 5 * valid_m * valid_n);
+  ParallelFor(tiles, [&](size_t t) {
+    size_t i_index = t / tiles_n * kernel_m;
+    size_t j_index = t % tiles_n * kernel_n;
+    if (i_index >= valid_m || j_index >= valid_n) {
+      return;
+    }
+    size_t length = std::min(valid_m - i_index, kernel_m);
+    size_t valid_lanes = std::min(valid_n - j_index, kernel_n);
+    int *sum = partial + t * slices * kernel_m * kernel_n;
+    for (size_t s = 1; s < slices; ++s) {
+      for (size_t x = 0; x < kernel_m * kernel_n; ++x) {
+        sum[x] += sum[s * kernel_m * kernel_n + x];
       }
     }
-  }
-#ifdef TIME_PROFILE
-  auto end = std::chrono::system_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  std::cerr << m << "," << n << "," << k << ",";
-  std::cerr << diff.count() << "us, "
-            << (2.0 * m * n * k) / diff.count() / 1.0e3 << " glops"
-            << std::endl;
-#endif
+    float *result[kernel_m * kernel_n];
+    if (requantize != NULL) {
+      float tile[kernel_m * kernel_n];
+      bool is_block = NHWCRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(result, tile, length, valid_lanes,
+                                                                                   0, 0, 0, 0, kernel_m);
+      EpilogueSelect<kernel_m, kernel_n, kernel_k, NHWC>(
+          sum, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+          conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+          scale, shift, is_block);
+      StoreRequantizedTile<kernel_m, layout>(tile, length, valid_lanes, i_index, j_index, cur_group,
+                                             channel_per_group, total_channels, feature_map_size_per_channel,
+                                             *requantize);
+      return;
+    }
+    bool is_block;
+    if (layout == NCHW) {
+      is_block = NCHWRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
+          result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
+          feature_map_size_per_group, feature_map_size_per_channel);
+    } else {
+      is_block = NHWCRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
+          result, pc, valid_m, valid_n, i_index, j_index, cur_group, channel_per_group, total_channels);
+    }
+    EpilogueSelect<kernel_m, kernel_n, kernel_k, layout>(
+        sum, result, length, valid_lanes, i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+        conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+        scale, shift, is_block);
+  });
 }
-#endif
-#if defined(LLC_EXCLUSIVE)
+
 template <size_t kernel_m, size_t kernel_n, size_t kernel_k, LAYOUT layout>
 void ConvShuffleGEMM(int8_t *pa, uint8_t *pb, float *pc, size_t m, size_t n, size_t k, float *ratio_a, float *ratio_b,
                      float *kernel_sum, float *min_b, float *bias, size_t batch_size, size_t groups,
                      size_t channel_per_group, size_t cur_group, size_t height_out, size_t width_out,
                      float fault_tolerance, size_t pad_m, size_t pad_n, bool conv_relu_fusion, bool conv_bn_fusion,
                      bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean, float *mul_variance_coeff,
-                     float *scale, float *shift) {
-#ifdef TIME_PROFILE
-  auto start = std::chrono::system_clock::now();
-#endif
+                     float *scale, float *shift, RequantizeDesc *requantize, const GemmPlan *plan,
+                     int *partial_sums) {
+  size_t out_bytes = (requantize != NULL) ? sizeof(uint8_t) : sizeof(float);
+  TraceScope trace(TRACE_GEMM, (m + n) * k + out_bytes * (m - pad_m) * (n - pad_n), 2 * m * n * k);
   assert((fault_tolerance <= 1.0f) && (fault_tolerance >= 0.0f));
   assert((layout == NCHW) || (layout == NHWC));
   size_t feature_map_size_per_channel = height_out * width_out;
   size_t total_channels = channel_per_group * groups;
   size_t feature_map_size_per_image = total_channels * height_out * width_out;
   size_t feature_map_size_per_group = height_out * width_out * channel_per_group;
-  size_t m_in_l1, m_in_l2, m_in_l3, n_in_l1, n_in_l2, n_in_l3;
-  GetBlocksInfo<kernel_m>(m, k, m_in_l1, m_in_l2, m_in_l3);
-  GetBlocksInfo<kernel_n>(n, k, n_in_l1, n_in_l2, n_in_l3);
+  GemmPlan local_plan;
+  plan = SelectGemmPlan<kernel_m, kernel_n, kernel_k>(plan, local_plan, m, n, k);
   size_t valid_m = m - pad_m;
   size_t valid_n = n - pad_n;
-  bool mltn = m < n;
-  std::array<size_t, 10> blocks1 = {n, m, n_in_l3, m_in_l3, n_in_l2, m_in_l2, n_in_l1, m_in_l1, kernel_n, kernel_m};
-  std::array<size_t, 10> blocks2 = {m, n, m_in_l3, n_in_l3, m_in_l2, n_in_l2, m_in_l1, n_in_l1, kernel_m, kernel_n};
-  std::array<size_t, 10> &blocks = (mltn) ? blocks1 : blocks2;
-  {
-#pragma omp parallel for collapse(2) schedule(static)
-    for (size_t y3 = 0; y3 < blocks[0]; y3 += blocks[2]) {
-      for (size_t x3 = 0; x3 < blocks[1]; x3 += blocks[3]) {
-        for (size_t y2 = 0; y2 < blocks[2]; y2 += blocks[4]) {
-          for (size_t x2 = 0; x2 < blocks[3]; x2 += blocks[5]) {
-            for (size_t y1 = 0; y1 < blocks[4]; y1 += blocks[6]) {
-              for (size_t x1 = 0; x1 < blocks[5]; x1 += blocks[7]) {
-                for (size_t y0 = 0; y0 < blocks[6]; y0 += blocks[8]) {
-                  for (size_t x0 = 0; x0 < blocks[7]; x0 += blocks[9]) {
-                    auto y_sum = y3 + y2 + y1 + y0;
-                    auto x_sum = x3 + x2 + x1 + x0;
-                    auto j_index = mltn ? y_sum : x_sum;
-                    auto i_index = mltn ? x_sum : y_sum;
-                    if ((j_index < n) && (i_index < m)) {
-                      float *result[kernel_m * kernel_n];
-                      int8_t *local_pa = pa + i_index * k;
-                      uint8_t *local_pb = pb + j_index * k;
-                      bool is_block;
-                      if (layout == NCHW) {
-                        is_block = NCHWRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
-                            result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
-                            feature_map_size_per_group, feature_map_size_per_channel);
-                      } else {
-                        is_block = NHWCRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
-                            result, pc, valid_m, valid_n, i_index, j_index, cur_group, channel_per_group,
-                            total_channels);
-                      }
-                      QuantizedGemmSelect<kernel_m, kernel_n, kernel_k, layout>(
-                          local_pa, local_pb, k, fault_tolerance, result, std::min(valid_m - i_index, kernel_m),
-                          std::min(valid_n - j_index, kernel_n), i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum,
-                          bias, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean,
-                          mul_variance_coeff, scale, shift, is_block);
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
+  if (plan->k_slices_ > 1) {
+    // partial_sums is sized for the caller's plan; without one, or when it went stale, split-K allocates its own
+    std::vector<int> local_partial_sums;
+    if (partial_sums == NULL || plan == &local_plan) {
+      local_partial_sums.resize(plan->PartialSumCount());
+      partial_sums = local_partial_sums.data();
     }
+    SplitKConvShuffleGEMM<kernel_m, kernel_n, kernel_k, layout>(
+        pa, pb, pc, m, n, k, ratio_a, ratio_b, kernel_sum, min_b, bias, groups, channel_per_group, cur_group,
+        feature_map_size_per_channel, fault_tolerance, valid_m, valid_n, conv_relu_fusion, conv_bn_fusion,
+        conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift, requantize, *plan,
+        partial_sums);
+    return;
   }
-#ifdef TIME_PROFILE
-  auto end = std::chrono::system_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  std::cerr << m << "," << n << "," << k << ",";
-  std::cerr << diff.count() << "us, "
-            << (2.0 * m * n * k) / diff.count() / 1.0e3 << " glops"
-            << std::endl;
-#endif
-
+  ForEachGemmTile(*plan, [&](size_t i_index, size_t j_index) {
+    float *result[kernel_m * kernel_n];
+    int8_t *local_pa = pa + i_index * k;
+    uint8_t *local_pb = pb + j_index * k;
+    if (requantize != NULL) {
+      RequantizedGemmTile<kernel_m, kernel_n, kernel_k, layout>(
+          local_pa, local_pb, k, fault_tolerance, std::min(valid_m - i_index, kernel_m),
+          std::min(valid_n - j_index, kernel_n), i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+          cur_group, channel_per_group, total_channels, feature_map_size_per_channel, conv_relu_fusion,
+          conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift,
+          *requantize);
+      return;
+    }
+    bool is_block;
+    if (layout == NCHW) {
+      is_block = NCHWRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
+          result, pc, valid_m, valid_n, i_index, j_index, cur_group, feature_map_size_per_image,
+          feature_map_size_per_group, feature_map_size_per_channel);
+    } else {
+      is_block = NHWCRTGenrateTargetAddr<float, kernel_m, kernel_n, kernel_k>(
+          result, pc, valid_m, valid_n, i_index, j_index, cur_group, channel_per_group, total_channels);
+    }
+    QuantizedGemmSelect<kernel_m, kernel_n, kernel_k, layout>(
+        local_pa, local_pb, k, fault_tolerance, result, std::min(valid_m - i_index, kernel_m),
+        std::min(valid_n - j_index, kernel_n), i_index, j_index, ratio_a, ratio_b, min_b, kernel_sum, bias,
+        conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion, conv_relu_bn_fusion, global_mean, mul_variance_coeff,
+        scale, shift, is_block);
+  });
 }
-
-#endif
 }
 #endif
@@ -17,6 +17,7 @@
 #ifndef OPS_SHUFFLE_SHUFFLE_IM2COL_H
 #define OPS_SHUFFLE_SHUFFLE_IM2COL_H
 #include "../../base.h"
+#include "../../trace.h"
 #include "../ops.h"
 #include "../im2col_common.h"
 
@@ -59,7 +60,8 @@ void PadQuantizeShuffleNCHWIm2col(DType *data, size_t batch_size, size_t channel
   size_t input_size_per_channel = height * width;
   size_t patch_size = channels_per_group * kernel_size;
   size_t pad_patch_size = GetAlignmentLength(patch_size, shuffle_cols);  // Get Pad Size
-  size_t pad_output_spatial_size = GetAlignmentLength(batch_size * output_h * output_w, shuffle_rows);
+  size_t output_spatial_size = batch_size * output_h * output_w;
+  size_t pad_output_spatial_size = GetAlignmentLength(output_spatial_size, shuffle_rows);
   std::vector<DType *> min_per_channel(groups);
   std::vector<DType *> max_per_channel(groups);
   for (size_t g = 0; g < groups; ++g) {
@@ -69,77 +71,74 @@ void PadQuantizeShuffleNCHWIm2col(DType *data, size_t batch_size, size_t channel
   }
   FindMinMaxAlongChannel<DType, NCHW>(data, groups, min_per_channel.data(), max_per_channel.data(), batch_size,
                                       channels_per_group, height * width, NULL);
-#pragma omp parallel for collapse(2)
-  for (size_t batch = 0; batch < batch_size; ++batch) {                   // total batch size
-    for (size_t o_y = 0; o_y < output_h; ++o_y) {    // total output rows
-      for (size_t o_x = 0; o_x < output_w; ++o_x) {  // total output cols
-        // index of output cols
-        size_t out_spatial_id = batch * output_h * output_w + o_y * output_w + o_x;
-        // name is weird but go on
-        size_t col_block = out_spatial_id / shuffle_rows;
-        size_t offset_in_block = (out_spatial_id % shuffle_rows) * shuffle_cols;
-        int conv_window_y = -pad_h + o_y * stride_h;  // startline of input rows
-        int conv_window_x = -pad_w + o_x * stride_w;  // startline of input cols
-        for (size_t g = 0; g < groups; ++g) {            // IT Mat Hurt Performance
-          uint8_t *addr =
-              data_col[g] + col_block * pad_patch_size * shuffle_rows + offset_in_block;  // Get Destination Address
-          DType local_min = FLT_MAX;
-          DType local_max = -FLT_MAX;
-          for (size_t y = 0; y < kernel_h; ++y) {
-            int in_y = conv_window_y + y * dilation_h;
-            for (size_t x = 0; x < kernel_w; ++x) {
-              int in_x = conv_window_x + x * dilation_w;
+  ParallelFor2D(batch_size, output_h, [&](size_t batch, size_t o_y) {  // output rows of each image
+    for (size_t o_x = 0; o_x < output_w; ++o_x) {  // total output cols
+      // index of output cols
+      size_t out_spatial_id = batch * output_h * output_w + o_y * output_w + o_x;
+      // name is weird but go on
+      size_t col_block = out_spatial_id / shuffle_rows;
+      size_t offset_in_block = (out_spatial_id % shuffle_rows) * shuffle_cols;
+      int conv_window_y = -pad_h + o_y * stride_h;  // startline of input rows
+      int conv_window_x = -pad_w + o_x * stride_w;  // startline of input cols
+      for (size_t g = 0; g < groups; ++g) {            // IT Mat Hurt Performance
+        uint8_t *addr =
+            data_col[g] + col_block * pad_patch_size * shuffle_rows + offset_in_block;  // Get Destination Address
+        DType local_min = FLT_MAX;
+        DType local_max = -FLT_MAX;
+        for (size_t y = 0; y < kernel_h; ++y) {
+          int in_y = conv_window_y + y * dilation_h;
+          for (size_t x = 0; x < kernel_w; ++x) {
+            int in_x = conv_window_x + x * dilation_w;
+            if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
+              local_max =
+                  fmaxf(max_per_channel[g][batch * height * width + in_y * width + in_x], local_max);
+              local_min =
+                  fminf(min_per_channel[g][batch * height * width + in_y * width + in_x], local_min);
+            } else {
+              DType value = 0;
+              local_max = fmaxf(value, local_max);
+              local_min = fminf(value, local_min);
+            }
+          }
+        }
+        DType scale = sw_threshold / (local_max - local_min);
+        min[g][out_spatial_id] = local_min;
+        max[g][out_spatial_id] = local_max;
+        ratio[g][out_spatial_id] = 1.0f / scale;
+        DType shift = -local_min * scale;
+        uint8_t zerofill = static_cast<uint8_t>(std::round((shift)));
+        // The following code is for NCHW
+        int src_base_index =
+            batch * channels_per_group * groups * height * width + g * channels_per_group * input_size_per_channel;
+        for (size_t c = 0; c < channels_per_group; ++c) {  // total channel && real start of one patch
+          size_t channel_offset = src_base_index + c * input_size_per_channel;
+          size_t offset = c * kernel_size / shuffle_cols * (shuffle_rows * shuffle_cols);
+          offset += (c * kernel_size) % shuffle_cols;
+          for (size_t h = 0; h < kernel_h; ++h) {  // total kernel height
+            int in_y = conv_window_y + h * dilation_h;
+            size_t y_offset = channel_offset + in_y * width;
+            for (size_t w = 0; w < kernel_w; ++w) {  // total kernel width
+              int in_x = conv_window_x + w * dilation_w;
               if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
-                local_max =
-                    fmaxf(max_per_channel[g][batch * height * width + in_y * width + in_x], local_max);
-                local_min =
-                    fminf(min_per_channel[g][batch * height * width + in_y * width + in_x], local_min);
+                *(addr + offset++) =
+                    static_cast<uint8_t>(std::round((data[y_offset + in_x] - local_min) * scale));
               } else {
-                DType value = 0;
-                local_max = fmaxf(value, local_max);
-                local_min = fminf(value, local_min);
+                *(addr + offset++) = zerofill;
               }
-            }
-          }
-          DType scale = sw_threshold / (local_max - local_min);
-          min[g][out_spatial_id] = local_min;
-          max[g][out_spatial_id] = local_max;
-          ratio[g][out_spatial_id] = 1.0f / scale;
-          DType shift = -local_min * scale;
-          uint8_t zerofill = static_cast<uint8_t>(std::round((shift)));
-          // The following code is for NCHW
-          int src_base_index =
-              batch * channels_per_group * groups * height * width + g * channels_per_group * input_size_per_channel;
-          for (size_t c = 0; c < channels_per_group; ++c) {  // total channel && real start of one patch
-            size_t channel_offset = src_base_index + c * input_size_per_channel;
-            size_t offset = c * kernel_size / shuffle_cols * (shuffle_rows * shuffle_cols);
-            offset += (c * kernel_size) % shuffle_cols;
-            for (size_t h = 0; h < kernel_h; ++h) {  // total kernel height
-              int in_y = conv_window_y + h * dilation_h;
-              size_t y_offset = channel_offset + in_y * width;
-              for (size_t w = 0; w < kernel_w; ++w) {  // total kernel width
-                int in_x = conv_window_x + w * dilation_w;
-                if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
-                  *(addr + offset++) =
-                      static_cast<uint8_t>(std::round((data[y_offset + in_x] - local_min) * scale));
-                } else {
-                  *(addr + offset++) = zerofill;
-                }
-                if ((offset % shuffle_cols) == 0) {
-                  offset += (shuffle_rows - 1) * shuffle_cols;
-                }
+              if ((offset % shuffle_cols) == 0) {
+                offset += (shuffle_rows - 1) * shuffle_cols;
               }
             }
           }
-          // the above code is for NCHW only
-          size_t offset = pad_patch_size * shuffle_rows - (shuffle_cols * shuffle_rows) + patch_size % shuffle_cols;
-          memset(addr + offset, 0, pad_patch_size - patch_size);
         }
+        // the above code is for NCHW only
+        size_t offset = pad_patch_size * shuffle_rows - (shuffle_cols * shuffle_rows) + patch_size % shuffle_cols;
+        memset(addr + offset, 0, pad_patch_size - patch_size);
       }
     }
-  }
-#pragma omp parallel for
-  for (size_t i = batch_size * output_h * output_w; i < pad_output_spatial_size; ++i) {
+  });
+  ParallelFor(pad_output_spatial_size - output_spatial_size, [&](size_t tail) {
+    size_t i = output_spatial_size + tail;
     for (size_t g = 0; g < groups; ++g) {
       size_t col_block = i / shuffle_rows;
       size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
@@ -151,7 +150,7 @@ void PadQuantizeShuffleNCHWIm2col(DType *data, size_t batch_size, size_t channel
         offset += shuffle_cols * shuffle_rows;
       }
     }
-  }
+  });
   for (size_t g = 0; g < groups; ++g) {
     aligned_free(min_per_channel[g]);
     aligned_free(max_per_channel[g]);
@@ -169,7 +168,8 @@ void PadQuantizeShuffleNCHWIm2col(DType *data, size_t batch_size, size_t channel
   size_t input_size_per_channel = height * width;
   size_t patch_size = channels_per_group * kernel_size;
   size_t pad_patch_size = GetAlignmentLength(patch_size, shuffle_cols);  // Get Pad Size
-  size_t pad_output_spatial_size = GetAlignmentLength(batch_size * output_h * output_w, shuffle_rows);
+  size_t output_spatial_size = batch_size * output_h * output_w;
+  size_t pad_output_spatial_size = GetAlignmentLength(output_spatial_size, shuffle_rows);
   std::vector<DType *> min_per_channel(groups);
   std::vector<DType *> max_per_channel(groups);
   for (size_t g = 0; g < groups; ++g) {
@@ -179,77 +179,72 @@ void PadQuantizeShuffleNCHWIm2col(DType *data, size_t batch_size, size_t channel
   }
   FindMinMaxAlongChannel<DType, NCHW>(data, groups, min_per_channel.data(), max_per_channel.data(), batch_size,
                                       channels_per_group, height * width, NULL);
-#pragma omp parallel for collapse(3)
-  for (size_t batch = 0; batch < batch_size; ++batch) {                   // total batch size
-    for (size_t o_y = 0; o_y < output_h; ++o_y) {    // total output rows
-      for (size_t o_x = 0; o_x < output_w; ++o_x) {  // total output cols
-        // index of output cols
-        size_t out_spatial_id = batch * output_h * output_w + o_y * output_w + o_x;
-        // name is weird but go on
-        size_t col_block = out_spatial_id / shuffle_rows;
-        size_t offset_in_block = (out_spatial_id % shuffle_rows) * shuffle_cols;
-        int conv_window_y = -pad_h + o_y * stride_h;  // startline of input rows
-        int conv_window_x = -pad_w + o_x * stride_w;  // startline of input cols
-        for (size_t g = 0; g < groups; ++g) {            // IT Mat Hurt Performance
-          uint8_t *addr =
-              data_col[g] + col_block * pad_patch_size * shuffle_rows + offset_in_block;  // Get Destination Address
-          DType local_min = FLT_MAX;
-          DType local_max = -FLT_MAX;
-          for (size_t y = 0; y < kernel_h; ++y) {
-            int in_y = conv_window_y + y * dilation_h;
-            for (size_t x = 0; x < kernel_w; ++x) {
-              int in_x = conv_window_x + x * dilation_w;
-              if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
-                local_max =
-                    fmaxf(max_per_channel[g][batch * height * width + in_y * width + in_x], local_max);
-                local_min =
-                    fminf(min_per_channel[g][batch * height * width + in_y * width + in_x], local_min);
-              } else {
-                DType value = 0;
-                local_max = fmaxf(value, local_max);
-                local_min = fminf(value, local_min);
-              }
-            }
+  ParallelFor3D(batch_size, output_h, output_w, [&](size_t batch, size_t o_y, size_t o_x) {  // output pixels
+    // index of output cols
+    size_t out_spatial_id = batch * output_h * output_w + o_y * output_w + o_x;
+    // name is weird but go on
+    size_t col_block = out_spatial_id / shuffle_rows;
+    size_t offset_in_block = (out_spatial_id % shuffle_rows) * shuffle_cols;
+    int conv_window_y = -pad_h + o_y * stride_h;  // startline of input rows
+    int conv_window_x = -pad_w + o_x * stride_w;  // startline of input cols
+    for (size_t g = 0; g < groups; ++g) {            // IT Mat Hurt Performance
+      uint8_t *addr =
+          data_col[g] + col_block * pad_patch_size * shuffle_rows + offset_in_block;  // Get Destination Address
+      DType local_min = FLT_MAX;
+      DType local_max = -FLT_MAX;
+      for (size_t y = 0; y < kernel_h; ++y) {
+        int in_y = conv_window_y + y * dilation_h;
+        for (size_t x = 0; x < kernel_w; ++x) {
+          int in_x = conv_window_x + x * dilation_w;
+          if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
+            local_max =
+                fmaxf(max_per_channel[g][batch * height * width + in_y * width + in_x], local_max);
+            local_min =
+                fminf(min_per_channel[g][batch * height * width + in_y * width + in_x], local_min);
+          } else {
+            DType value = 0;
+            local_max = fmaxf(value, local_max);
+            local_min = fminf(value, local_min);
           }
-          DType scale = sw_threshold / (local_max - local_min);
-          min[g][out_spatial_id] = local_min;
-          max[g][out_spatial_id] = local_max;
-          ratio[g][out_spatial_id] = 1.0f / scale;
-          DType shift = -local_min * scale;
-          uint8_t zerofill = static_cast<uint8_t>(std::round(shift));
-          // The following code is for NCHW
-          int src_base_index =
-              batch * channels_per_group * groups * height * width + g * channels_per_group * input_size_per_channel;
-          for (size_t c = 0; c < channels_per_group; ++c) {  // total channel && real start of one patch
-            size_t channel_offset = src_base_index + c * input_size_per_channel;
-            size_t offset = c * kernel_size / shuffle_cols * (shuffle_rows * shuffle_cols);
-            offset += (c * kernel_size) % shuffle_cols;
-            for (size_t h = 0; h < kernel_h; ++h) {  // total kernel height
-              int in_y = conv_window_y + h * dilation_h;
-              size_t y_offset = channel_offset + in_y * width;
-              for (size_t w = 0; w < kernel_w; ++w) {  // total kernel width
-                int in_x = conv_window_x + w * dilation_w;
-                if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
-                  *(addr + offset++) =
-                      static_cast<uint8_t>(std::round((data[y_offset + in_x] - local_min) * scale));
-                } else {
-                  *(addr + offset++) = zerofill;
-                }
-                if ((offset % shuffle_cols) == 0) {
-                  offset += (shuffle_rows - 1) * shuffle_cols;
-                }
-              }
+        }
+      }
+      DType scale = sw_threshold / (local_max - local_min);
+      min[g][out_spatial_id] = local_min;
+      max[g][out_spatial_id] = local_max;
+      ratio[g][out_spatial_id] = 1.0f / scale;
+      DType shift = -local_min * scale;
+      uint8_t zerofill = static_cast<uint8_t>(std::round(shift));
+      // The following code is for NCHW
+      int src_base_index =
+          batch * channels_per_group * groups * height * width + g * channels_per_group * input_size_per_channel;
+      for (size_t c = 0; c < channels_per_group; ++c) {  // total channel && real start of one patch
+        size_t channel_offset = src_base_index + c * input_size_per_channel;
+        size_t offset = c * kernel_size / shuffle_cols * (shuffle_rows * shuffle_cols);
+        offset += (c * kernel_size) % shuffle_cols;
+        for (size_t h = 0; h < kernel_h; ++h) {  // total kernel height
+          int in_y = conv_window_y + h * dilation_h;
+          size_t y_offset = channel_offset + in_y * width;
+          for (size_t w = 0; w < kernel_w; ++w) {  // total kernel width
+            int in_x = conv_window_x + w * dilation_w;
+            if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
+              *(addr + offset++) =
+                  static_cast<uint8_t>(std::round((data[y_offset + in_x] - local_min) * scale));
+            } else {
+              *(addr + offset++) = zerofill;
+            }
+            if ((offset % shuffle_cols) == 0) {
+              offset += (shuffle_rows - 1) * shuffle_cols;
             }
           }
-          // the above code is for NCHW only
-          size_t offset = pad_patch_size * shuffle_rows - (shuffle_cols * shuffle_rows) + patch_size % shuffle_cols;
-          memset(addr + offset, 0, pad_patch_size - patch_size);
         }
       }
+      // the above code is for NCHW only
+      size_t offset = pad_patch_size * shuffle_rows - (shuffle_cols * shuffle_rows) + patch_size % shuffle_cols;
+      memset(addr + offset, 0, pad_patch_size - patch_size);
     }
-  }
-#pragma omp parallel for
-  for (size_t i = batch_size * output_h * output_w; i < pad_output_spatial_size; ++i) {
+  });
+  ParallelFor(pad_output_spatial_size - output_spatial_size, [&](size_t tail) {
+    size_t i = output_spatial_size + tail;
     for (size_t g = 0; g < groups; ++g) {
       size_t col_block = i / shuffle_rows;
       size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
@@ -261,7 +256,7 @@ void PadQuantizeShuffleNCHWIm2col(DType *data, size_t batch_size, size_t channel
         offset += shuffle_cols * shuffle_rows;
       }
     }
-  }
+  });
   for (size_t g = 0; g < groups; ++g) {
     aligned_free(min_per_channel[g]);
     aligned_free(max_per_channel[g]);
@@ -275,7 +270,8 @@ void PadQuantizeShuffleNHWCIm2col(DType *data, size_t batch_size, size_t channel
                                   size_t pad_w, size_t stride_h, size_t stride_w, size_t dilation_h, size_t dilation_w,
                                   uint8_t *data_col[], DType *min[], DType *max[], DType *ratio[], DType *workspace,
                                   float sw_threshold, findextreme_function findextreme,
-                                  quantizekernel_function quantizekernel) {
+                                  quantizekernel_function quantizekernel, DType *min_workspace[],
+                                  DType *max_workspace[]) {
   size_t output_h = GetConvOutSize(height, kernel_h, stride_h, pad_h, dilation_h);
   size_t output_w = GetConvOutSize(width, kernel_w, stride_w, pad_w, dilation_w);
   size_t kernel_size = kernel_h * kernel_w;
@@ -286,185 +282,181 @@ void PadQuantizeShuffleNHWCIm2col(DType *data, size_t batch_size, size_t channel
 
   size_t patch_size = channels_per_group * kernel_size;
   size_t pad_patch_size = GetAlignmentLength(patch_size, shuffle_cols);  // Get Pad Size
-  size_t pad_output_spatial_size = GetAlignmentLength(batch_size * output_h * output_w, shuffle_rows);
+  size_t output_spatial_size = batch_size * output_h * output_w;
+  size_t pad_output_spatial_size = GetAlignmentLength(output_spatial_size, shuffle_rows);
   std::vector<DType *> min_per_channel(groups);
   std::vector<DType *> max_per_channel(groups);
   for (size_t g = 0; g < groups; ++g) {
-    aligned_malloc(reinterpret_cast<void **>(&min_per_channel[g]), 64, sizeof(DType) * batch_size * height * width);
-    aligned_malloc(reinterpret_cast<void **>(&max_per_channel[g]), 64, sizeof(DType) * batch_size * height * width);
+    if (min_workspace != NULL && max_workspace != NULL) {
+      min_per_channel[g] = min_workspace[g];
+      max_per_channel[g] = max_workspace[g];
+    } else {
+      aligned_malloc(reinterpret_cast<void **>(&min_per_channel[g]), 64, sizeof(DType) * batch_size * height * width);
+      aligned_malloc(reinterpret_cast<void **>(&max_per_channel[g]), 64, sizeof(DType) * batch_size * height * width);
+    }
   }
-#ifdef TIME_PROFILE
-  auto start = std::chrono::system_clock::now();
-#endif
-  findextreme(data, groups, min_per_channel.data(), max_per_channel.data(), batch_size, channels_per_group,
-              height * width, workspace);
-#ifdef TIME_PROFILE
-  auto end = std::chrono::system_clock::now();
-  auto diff = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-  std::cerr << "im2col findextreme per channel " << diff.count() << "us" << std::endl;
-#endif
-#pragma omp parallel for collapse(3)
-  for (size_t batch = 0; batch < batch_size; ++batch) {                   // total batch size
-    for (size_t o_y = 0; o_y < output_h; ++o_y) {    // total output rows
-      for (size_t o_x = 0; o_x < output_w; ++o_x) {  // total output cols
-        // index of output cols
-        size_t out_spatial_id = batch * output_h * output_w + o_y * output_w + o_x;
-        // name is weird but go on
-        size_t col_block = out_spatial_id / shuffle_rows;
-        size_t offset_in_block = (out_spatial_id % shuffle_rows) * shuffle_cols;
-        size_t base_offset = col_block * pad_patch_size * shuffle_rows + offset_in_block;
-        int conv_window_y = -pad_h + o_y * stride_h;  // startline of input rows
-        int conv_window_x = -pad_w + o_x * stride_w;  // startline of input cols
-        size_t batch_offset = batch * height * width;
-        for (size_t g = 0; g < groups; ++g) {  // Get min && max && ratio
-          DType local_min = FLT_MAX;
-          DType local_max = -FLT_MAX;
-          for (size_t y = 0; y < kernel_h; ++y) {
-            int in_y = conv_window_y + y * dilation_h;
-            for (size_t x = 0; x < kernel_w; ++x) {
-              int in_x = conv_window_x + x * dilation_w;
-              if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
-                local_max = fmaxf(max_per_channel[g][batch_offset + in_y * width + in_x], local_max);
-                local_min = fminf(min_per_channel[g][batch_offset + in_y * width + in_x], local_min);
-              } else {
-                DType value = 0;
-                local_max = fmaxf(value, local_max);
-                local_min = fminf(value, local_min);
-              }
+  {
+    TraceScope trace(TRACE_FIND_EXTREME, sizeof(DType) * batch_size * input_feature_size_per_batch, 0);
+    findextreme(data, groups, min_per_channel.data(), max_per_channel.data(), batch_size, channels_per_group,
+                height * width, workspace);
+  }
+  ParallelFor3D(batch_size, output_h, output_w, [&](size_t batch, size_t o_y, size_t o_x) {  // output pixels
+    // index of output cols
+    size_t out_spatial_id = batch * output_h * output_w + o_y * output_w + o_x;
+    // name is weird but go on
+    size_t col_block = out_spatial_id / shuffle_rows;
+    size_t offset_in_block = (out_spatial_id % shuffle_rows) * shuffle_cols;
+    size_t base_offset = col_block * pad_patch_size * shuffle_rows + offset_in_block;
+    int conv_window_y = -pad_h + o_y * stride_h;  // startline of input rows
+    int conv_window_x = -pad_w + o_x * stride_w;  // startline of input cols
+    size_t batch_offset = batch * height * width;
+    for (size_t g = 0; g < groups; ++g) {  // Get min && max && ratio
+      DType local_min = FLT_MAX;
+      DType local_max = -FLT_MAX;
+      for (size_t y = 0; y < kernel_h; ++y) {
+        int in_y = conv_window_y + y * dilation_h;
+        for (size_t x = 0; x < kernel_w; ++x) {
+          int in_x = conv_window_x + x * dilation_w;
+          if (x_ge_0_and_x_lt_bound(in_y, height) && x_ge_0_and_x_lt_bound(in_x, width)) {
+            local_max = fmaxf(max_per_channel[g][batch_offset + in_y * width + in_x], local_max);
+            local_min = fminf(min_per_channel[g][batch_offset + in_y * width + in_x], local_min);
+          } else {
+            DType value = 0;
+            local_max = fmaxf(value, local_max);
+            local_min = fminf(value, local_min);
+          }
+        }
+      }
+      DType scale = sw_threshold / (local_max - local_min);
+      min[g][out_spatial_id] = local_min;
+      max[g][out_spatial_id] = local_max;
+      ratio[g][out_spatial_id] = 1.0f / scale;
+      /* why here shift doesn't plusto 0.5
+      * It seems that when converting sse/simd FP32 to Int32, the default mode is round to nearest. So there's no
+      * need to plus 0.5 here
+      */
+      DType shift = -local_min * scale;
+      uint8_t zerofill = static_cast<uint8_t>(shift);
+      uint8_t *addr = data_col[g] + base_offset;
+      size_t src_base_index = batch * input_feature_size_per_batch;
+      SIMDPSTYPE simdscale = SET1_PS(scale);
+      SIMDPSTYPE simdshift = SET1_PS(shift);
+      for (size_t h = 0; h < kernel_h; ++h) {
+        int in_y = conv_window_y + h * dilation_h;
+        size_t y_offset = src_base_index + in_y * input_feature_size_per_height;
+        bool valid_row = x_ge_0_and_x_lt_bound(in_y, height);
+        if ((dilation_w == 1) && valid_row && (groups == 1) && x_ge_0_and_x_lt_bound(conv_window_x, width) &&
+            x_ge_0_and_x_lt_bound(conv_window_x + kernel_w, width)) {
+          const size_t offset_in_row = h * kernel_w * channels_per_group;
+          const size_t shuffle_col_id = offset_in_row / shuffle_cols;
+          const size_t shuffle_col_remain_index = offset_in_row % shuffle_cols;
+          size_t shuffle_offset_in_row =
+              shuffle_col_id * (shuffle_rows * shuffle_cols) + shuffle_col_remain_index;
+          size_t src_index = y_offset + conv_window_x * input_feature_size_per_width;
+          size_t length = kernel_w * channels_per_group;
+          size_t z = 0;
+          size_t remain =
+              (shuffle_col_remain_index == 0) ? 0 : std::min(shuffle_cols - shuffle_col_remain_index, length);
+          for (; z < remain; ++z) {
+            *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + z] * scale + shift);
+            if ((shuffle_offset_in_row % shuffle_cols) == 0) {
+              shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
             }
           }
-          DType scale = sw_threshold / (local_max - local_min);
-          min[g][out_spatial_id] = local_min;
-          max[g][out_spatial_id] = local_max;
-          ratio[g][out_spatial_id] = 1.0f / scale;
-          /* why here shift doesn't plusto 0.5
-          * It seems that when converting sse/simd FP32 to Int32, the default mode is round to nearest. So there's no
-          * need to plus 0.5 here
-          */
-          DType shift = -local_min * scale;
-          uint8_t zerofill = static_cast<uint8_t>(shift);
-          uint8_t *addr = data_col[g] + base_offset;
-          size_t src_base_index = batch * input_feature_size_per_batch;
-          SIMDPSTYPE simdscale = SET1_PS(scale);
-          SIMDPSTYPE simdshift = SET1_PS(shift);
-          for (size_t h = 0; h < kernel_h; ++h) {
-            int in_y = conv_window_y + h * dilation_h;
-            size_t y_offset = src_base_index + in_y * input_feature_size_per_height;
-            bool valid_row = x_ge_0_and_x_lt_bound(in_y, height);
-            if ((dilation_w == 1) && valid_row && (groups == 1) && x_ge_0_and_x_lt_bound(conv_window_x, width) &&
-                x_ge_0_and_x_lt_bound(conv_window_x + kernel_w, width)) {
-              const size_t offset_in_row = h * kernel_w * channels_per_group;
-              const size_t shuffle_col_id = offset_in_row / shuffle_cols;
-              const size_t shuffle_col_remain_index = offset_in_row % shuffle_cols;
-              size_t shuffle_offset_in_row =
-                  shuffle_col_id * (shuffle_rows * shuffle_cols) + shuffle_col_remain_index;
-              size_t src_index = y_offset + conv_window_x * input_feature_size_per_width;
-              size_t length = kernel_w * channels_per_group;
-              size_t z = 0;
-              size_t remain =
-                  (shuffle_col_remain_index == 0) ? 0 : std::min(shuffle_cols - shuffle_col_remain_index, length);
-              for (; z < remain; ++z) {
-                *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + z] * scale + shift);
-                if ((shuffle_offset_in_row % shuffle_cols) == 0) {
-                  shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
-                }
-              }
-              size_t total_kernel = (length - remain) / shuffle_cols;
-              DType *src_base = data + src_index + z;
-              uint8_t *dst_base = addr + shuffle_offset_in_row;
-              for (size_t k = 0; k < total_kernel; ++k) {
-                quantizekernel(dst_base + k * shuffle_rows * shuffle_cols, src_base + k * shuffle_cols, simdscale,
-                               simdshift);
-              }
-              shuffle_offset_in_row += total_kernel * shuffle_rows * shuffle_cols;
-              z += total_kernel * shuffle_cols;
-              for (z = remain + (length - remain) / shuffle_cols * shuffle_cols; z < length; ++z) {
-                *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + z] * scale + shift);
-              }
-            } else {
-              for (size_t w = 0; w < kernel_w; ++w) {
-                int in_x = conv_window_x + w * dilation_w;
-                size_t x_offset = y_offset + in_x * input_feature_size_per_width;
-                bool valid_col = x_ge_0_and_x_lt_bound(in_x, width);
-                const size_t offset_in_row = (h * kernel_w + w) * channels_per_group;
-                const size_t shuffle_col_id = offset_in_row / shuffle_cols;
-                const size_t shuffle_col_remain_index = offset_in_row % shuffle_cols;
-                size_t shuffle_offset_in_row =
-                    shuffle_col_id * (shuffle_rows * shuffle_cols) + shuffle_col_remain_index;
-                if (valid_row && valid_col) {
-                  size_t src_index = x_offset + g * channels_per_group;
-                  if (channels_per_group < shuffle_cols) {
-                    if ((shuffle_col_remain_index + channels_per_group) < shuffle_cols) {
-                      for (size_t c = 0; c < channels_per_group; ++c) {
-                        *(addr + shuffle_offset_in_row + c) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
-                      }
-                      shuffle_offset_in_row += channels_per_group;
-                    } else {
-                      for (size_t c = 0; c < channels_per_group; ++c) {
-                        *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
-                        if ((shuffle_offset_in_row % shuffle_cols) == 0) {
-                          shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
-                        }
-                      }
-                    }
-                  } else {
-                    size_t c = 0;
-                    size_t remain = (shuffle_col_remain_index == 0)
-                                        ? 0
-                                        : std::min(shuffle_cols - shuffle_col_remain_index, channels_per_group);
-                    for (; c < remain; ++c) {
-                      *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
-                      if ((shuffle_offset_in_row % shuffle_cols) == 0) {
-                        shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
-                      }
-                    }
-                    size_t total_kernel = (channels_per_group - remain) / shuffle_cols;
-                    DType *src_base = data + src_index + c;
-                    uint8_t *dst_base = addr + shuffle_offset_in_row;
-                    for (size_t k = 0; k < total_kernel; ++k) {
-                      quantizekernel(dst_base + k * shuffle_rows * shuffle_cols, src_base + k * shuffle_cols, simdscale,
-                                     simdshift);
-                    }
-                    shuffle_offset_in_row += total_kernel * shuffle_rows * shuffle_cols;
-                    c += total_kernel * shuffle_cols;
-                    for (c = remain + (channels_per_group - remain) / shuffle_cols * shuffle_cols;
-                         c < channels_per_group; ++c) {
-                      *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
-                    }
+          size_t total_kernel = (length - remain) / shuffle_cols;
+          DType *src_base = data + src_index + z;
+          uint8_t *dst_base = addr + shuffle_offset_in_row;
+          for (size_t k = 0; k < total_kernel; ++k) {
+            quantizekernel(dst_base + k * shuffle_rows * shuffle_cols, src_base + k * shuffle_cols, simdscale,
+                           simdshift);
+          }
+          shuffle_offset_in_row += total_kernel * shuffle_rows * shuffle_cols;
+          z += total_kernel * shuffle_cols;
+          for (z = remain + (length - remain) / shuffle_cols * shuffle_cols; z < length; ++z) {
+            *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + z] * scale + shift);
+          }
+        } else {
+          for (size_t w = 0; w < kernel_w; ++w) {
+            int in_x = conv_window_x + w * dilation_w;
+            size_t x_offset = y_offset + in_x * input_feature_size_per_width;
+            bool valid_col = x_ge_0_and_x_lt_bound(in_x, width);
+            const size_t offset_in_row = (h * kernel_w + w) * channels_per_group;
+            const size_t shuffle_col_id = offset_in_row / shuffle_cols;
+            const size_t shuffle_col_remain_index = offset_in_row % shuffle_cols;
+            size_t shuffle_offset_in_row =
+                shuffle_col_id * (shuffle_rows * shuffle_cols) + shuffle_col_remain_index;
+            if (valid_row && valid_col) {
+              size_t src_index = x_offset + g * channels_per_group;
+              if (channels_per_group < shuffle_cols) {
+                if ((shuffle_col_remain_index + channels_per_group) < shuffle_cols) {
+                  for (size_t c = 0; c < channels_per_group; ++c) {
+                    *(addr + shuffle_offset_in_row + c) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
                   }
+                  shuffle_offset_in_row += channels_per_group;
                 } else {
-                  size_t c = 0;
-                  size_t remain = (shuffle_col_remain_index == 0)
-                                      ? 0
-                                      : std::min(shuffle_cols - shuffle_col_remain_index, channels_per_group);
-                  for (; c < remain; ++c) {
-                    *(addr + shuffle_offset_in_row++) = zerofill;
+                  for (size_t c = 0; c < channels_per_group; ++c) {
+                    *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
                     if ((shuffle_offset_in_row % shuffle_cols) == 0) {
                       shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
                     }
                   }
-                  for (; c < (channels_per_group - remain) / shuffle_cols * shuffle_cols; c += shuffle_cols) {
-                    memset(addr + shuffle_offset_in_row, zerofill, shuffle_cols);
-                    shuffle_offset_in_row += shuffle_rows * shuffle_cols;
-                  }
-                  for (c = remain + (channels_per_group - remain) / shuffle_cols * shuffle_cols; c < channels_per_group;
-                       ++c) {
-                    *(addr + shuffle_offset_in_row++) = zerofill;
+                }
+              } else {
+                size_t c = 0;
+                size_t remain = (shuffle_col_remain_index == 0)
+                                    ? 0
+                                    : std::min(shuffle_cols - shuffle_col_remain_index, channels_per_group);
+                for (; c < remain; ++c) {
+                  *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
+                  if ((shuffle_offset_in_row % shuffle_cols) == 0) {
+                    shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
                   }
                 }
+                size_t total_kernel = (channels_per_group - remain) / shuffle_cols;
+                DType *src_base = data + src_index + c;
+                uint8_t *dst_base = addr + shuffle_offset_in_row;
+                for (size_t k = 0; k < total_kernel; ++k) {
+                  quantizekernel(dst_base + k * shuffle_rows * shuffle_cols, src_base + k * shuffle_cols, simdscale,
+                                 simdshift);
+                }
+                shuffle_offset_in_row += total_kernel * shuffle_rows * shuffle_cols;
+                c += total_kernel * shuffle_cols;
+                for (c = remain + (channels_per_group - remain) / shuffle_cols * shuffle_cols;
+                     c < channels_per_group; ++c) {
+                  *(addr + shuffle_offset_in_row++) = static_cast<uint8_t>(data[src_index + c] * scale + shift);
+                }
+              }
+            } else {
+              size_t c = 0;
+              size_t remain = (shuffle_col_remain_index == 0)
+                                  ? 0
+                                  : std::min(shuffle_cols - shuffle_col_remain_index, channels_per_group);
+              for (; c < remain; ++c) {
+                *(addr + shuffle_offset_in_row++) = zerofill;
+                if ((shuffle_offset_in_row % shuffle_cols) == 0) {
+                  shuffle_offset_in_row += (shuffle_rows - 1) * shuffle_cols;
+                }
+              }
+              for (; c < (channels_per_group - remain) / shuffle_cols * shuffle_cols; c += shuffle_cols) {
+                memset(addr + shuffle_offset_in_row, zerofill, shuffle_cols);
+                shuffle_offset_in_row += shuffle_rows * shuffle_cols;
+              }
+              for (c = remain + (channels_per_group - remain) / shuffle_cols * shuffle_cols; c < channels_per_group;
+                   ++c) {
+                *(addr + shuffle_offset_in_row++) = zerofill;
               }
             }
           }
-          size_t shuffle_offset_in_row =
-              pad_patch_size * shuffle_rows - (shuffle_cols * shuffle_rows) + patch_size % shuffle_cols;
-          memset(data_col[g] + base_offset + shuffle_offset_in_row, 0, pad_patch_size - patch_size);
         }
       }
+      size_t shuffle_offset_in_row =
+          pad_patch_size * shuffle_rows - (shuffle_cols * shuffle_rows) + patch_size % shuffle_cols;
+      memset(data_col[g] + base_offset + shuffle_offset_in_row, 0, pad_patch_size - patch_size);
     }
-  }
+  });
 
-#pragma omp parallel for
-  for (size_t i = batch_size * output_h * output_w; i < pad_output_spatial_size; ++i) {
+  ParallelFor(pad_output_spatial_size - output_spatial_size, [&](size_t tail) {
+    size_t i = output_spatial_size + tail;
     for (size_t g = 0; g < groups; ++g) {
       size_t col_block = i / shuffle_rows;
       size_t offset_in_block = (i % shuffle_rows) * shuffle_cols;
@@ -476,19 +468,129 @@ void PadQuantizeShuffleNHWCIm2col(DType *data, size_t batch_size, size_t channel
         offset += shuffle_cols * shuffle_rows;
       }
     }
-  }
-  for (size_t g = 0; g < groups; ++g) {
-    aligned_free(min_per_channel[g]);
-    aligned_free(max_per_channel[g]);
+  });
+  if (min_workspace == NULL || max_workspace == NULL) {
+    for (size_t g = 0; g < groups; ++g) {
+      aligned_free(min_per_channel[g]);
+      aligned_free(max_per_channel[g]);
+    }
   }
 }
 
-template <typename DType, LAYOUT layout>
-void PadQuantizeShuffleIm2colWrapper(DType *data, size_t batch_size, size_t channels_per_group, size_t groups,
+// A 1x1, pad 0 convolution over NHWC data needs no im2col: every output pixel reads exactly one input pixel, which is
+// a contiguous row of channels. Each row gets its min/max and is quantized into the shuffled layout while it is still
+// in cache. Strides > 1 gather every stride-th pixel.
+template <typename DType, size_t shuffle_rows, size_t shuffle_cols, typename quantizekernel_function>
+void PadQuantizeShuffleNHWC1x1(DType *data, size_t batch_size, size_t channels, size_t height, size_t width,
+                               size_t stride_h, size_t stride_w, uint8_t *data_col, DType *min, DType *max,
+                               DType *ratio, float sw_threshold, quantizekernel_function quantizekernel) {
+  size_t output_h = GetConvOutSize(height, 1, stride_h, 0, 1);
+  size_t output_w = GetConvOutSize(width, 1, stride_w, 0, 1);
+  size_t output_spatial_size = batch_size * output_h * output_w;
+  size_t pad_output_spatial_size = GetAlignmentLength(output_spatial_size, shuffle_rows);
+  size_t pad_channels = GetAlignmentLength(channels, shuffle_cols);
+  size_t full_channels = channels / shuffle_cols * shuffle_cols;
+  size_t patch_size = shuffle_rows * shuffle_cols;
+  ParallelFor(pad_output_spatial_size, [&](size_t i) {
+    uint8_t *addr = data_col + i / shuffle_rows * shuffle_rows * pad_channels + (i % shuffle_rows) * shuffle_cols;
+    if (i >= output_spatial_size) {
+      for (size_t c = 0; c < pad_channels; c += shuffle_cols) {
+        memset(addr, 0, shuffle_cols);
+        addr += patch_size;
+      }
+      return;
+    }
+    size_t batch = i / (output_h * output_w);
+    size_t o_y = i / output_w % output_h;
+    size_t o_x = i % output_w;
+    DType *src = data + ((batch * height + o_y * stride_h) * width + o_x * stride_w) * channels;
+    FindMinMaxValue(src, channels, min[i], max[i]);
+    DType scale = sw_threshold / (max[i] - min[i]);
+    DType shift = -min[i] * scale;
+    ratio[i] = 1.0f / scale;
+    SIMDPSTYPE simdscale = SET1_PS(scale);
+    SIMDPSTYPE simdshift = SET1_PS(shift);
+    size_t c = 0;
+    for (; c < full_channels; c += shuffle_cols) {
+      quantizekernel(addr, src + c, simdscale, simdshift);
+      addr += patch_size;
+    }
+    for (; c < channels; ++c) {
+      *(addr++) = static_cast<uint8_t>(src[c] * scale + shift);
+    }
+    memset(addr, 0, pad_channels - channels);
+  });
+}
+
+static INLINE_SPECIFIER uint8_t INLINE_ATTRIBUTE StaticQuantize(float value, float inv_scale, float zero_point,
+                                                                float sw_threshold) {
+  return static_cast<uint8_t>(fminf(fmaxf(value * inv_scale + zero_point + 0.5f, 0.0f), sw_threshold));
+}
+
+// uint8 input was requantized by the producing op with the same parameters.
+static INLINE_SPECIFIER uint8_t INLINE_ATTRIBUTE StaticQuantize(uint8_t value, float inv_scale, float zero_point,
+                                                                float sw_threshold) {
+  return value;
+}
+
+// Calibrated quantization, q = clamp(round(x * inv_scale[c] + zero_point[c]), 0, threshold), per input channel.
+// Nothing has to be scanned first, so each output window is quantized into a contiguous patch (padding holds the
+// zero point) and copied into the shuffled layout in the same pass.
+template <typename DType, size_t shuffle_rows, size_t shuffle_cols>
+void StaticQuantizeShuffleNHWCIm2col(DType *data, size_t batch_size, size_t channels_per_group, size_t groups,
                                      size_t height, size_t width, size_t kernel_h, size_t kernel_w, size_t pad_h,
                                      size_t pad_w, size_t stride_h, size_t stride_w, size_t dilation_h,
-                                     size_t dilation_w, uint8_t *data_col[], DType *min[], DType *max[], DType *ratio[],
-                                     DType *workspace, float sw_threshold, bool transpose) {
+                                     size_t dilation_w, uint8_t *data_col[], float *inv_scale, float *zero_point,
+                                     float sw_threshold) {
+  size_t output_h = GetConvOutSize(height, kernel_h, stride_h, pad_h, dilation_h);
+  size_t output_w = GetConvOutSize(width, kernel_w, stride_w, pad_w, dilation_w);
+  size_t total_channels = groups * channels_per_group;
+  size_t patch_size = channels_per_group * kernel_h * kernel_w;
+  size_t pad_patch_size = GetAlignmentLength(patch_size, shuffle_cols);
+  size_t output_spatial_size = batch_size * output_h * output_w;
+  size_t pad_output_spatial_size = GetAlignmentLength(output_spatial_size, shuffle_rows);
+  ParallelChunks(groups * pad_output_spatial_size, [&](size_t chunk, size_t begin, size_t end) {
+    std::vector<uint8_t> patch(pad_patch_size, 0);
+    for (size_t index = begin; index < end; ++index) {
+      size_t g = index / pad_output_spatial_size;
+      size_t i = index % pad_output_spatial_size;
+      uint8_t *addr =
+          data_col[g] + i / shuffle_rows * shuffle_rows * pad_patch_size + (i % shuffle_rows) * shuffle_cols;
+      if (i < output_spatial_size) {
+        size_t batch = i / (output_h * output_w);
+        size_t o_y = i / output_w % output_h;
+        size_t o_x = i % output_w;
+        float *group_inv_scale = inv_scale + g * channels_per_group;
+        float *group_zero_point = zero_point + g * channels_per_group;
+        for (size_t y = 0; y < kernel_h; ++y) {
+          long in_y = static_cast<long>(o_y * stride_h + y * dilation_h) - static_cast<long>(pad_h);
+          for (size_t x = 0; x < kernel_w; ++x) {
+            long in_x = static_cast<long>(o_x * stride_w + x * dilation_w) - static_cast<long>(pad_w);
+            uint8_t *dst = patch.data() + (y * kernel_w + x) * channels_per_group;
+            if (in_y >= 0 && in_y < static_cast<long>(height) && in_x >= 0 && in_x < static_cast<long>(width)) {
+              DType *src = data + ((batch * height + in_y) * width + in_x) * total_channels + g * channels_per_group;
+              for (size_t c = 0; c < channels_per_group; ++c) {
+                dst[c] = StaticQuantize(src[c], group_inv_scale[c], group_zero_point[c], sw_threshold);
+              }
+            } else {
+              for (size_t c = 0; c < channels_per_group; ++c) {
+                dst[c] = static_cast<uint8_t>(group_zero_point[c]);
+              }
+            }
+          }
+        }
+        for (size_t j = 0; j < pad_patch_size; j += shuffle_cols) {
+          memcpy(addr + j * shuffle_rows, patch.data() + j, shuffle_cols);
+        }
+      } else {
+        for (size_t j = 0; j < pad_patch_size; j += shuffle_cols) {
+          memset(addr + j * shuffle_rows, 0, shuffle_cols);
+        }
+      }
+    }
+  });
+}
+
 #if defined(AVX512)
 #define QUANTIZE_KERNEL_FUNC AVX512Kernel8Quantize
 #elif defined(__AVX2__)
@@ -497,6 +599,13 @@ void PadQuantizeShuffleIm2colWrapper(DType *data, size_t batch_size, size_t chan
 #define QUANTIZE_KERNEL_FUNC SSE42Kernel16Quantize
 #endif
 
+template <typename DType, LAYOUT layout>
+void PadQuantizeShuffleIm2colWrapper(DType *data, size_t batch_size, size_t channels_per_group, size_t groups,
+                                     size_t height, size_t width, size_t kernel_h, size_t kernel_w, size_t pad_h,
+                                     size_t pad_w, size_t stride_h, size_t stride_w, size_t dilation_h,
+                                     size_t dilation_w, uint8_t *data_col[], DType *min[], DType *max[], DType *ratio[],
+                                     DType *workspace, float sw_threshold, bool transpose, DType *min_workspace[],
+                                     DType *max_workspace[]) {
   if (layout == NCHW) {
     if ((kernel_h == 1) && (kernel_w == 1)) {
       PadQuantizeShuffleNCHWIm2col<DType, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K, 1, 1>(
@@ -520,7 +629,7 @@ void PadQuantizeShuffleIm2colWrapper(DType *data, size_t batch_size, size_t chan
       PadQuantizeShuffleNHWCIm2col<DType, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
           data, batch_size, channels_per_group, groups, height, width, kernel_h, kernel_w, pad_h, pad_w, stride_h,
           stride_w, dilation_h, dilation_w, data_col, min, max, ratio, NULL, sw_threshold,
-          FindMinMaxAlongChannel<DType, NHWC>, QUANTIZE_KERNEL_FUNC);
+          FindMinMaxAlongChannel<DType, NHWC>, QUANTIZE_KERNEL_FUNC, min_workspace, max_workspace);
     } else {
       DType *tmp;
       if (workspace == NULL) {
@@ -532,12 +641,21 @@ void PadQuantizeShuffleIm2colWrapper(DType *data, size_t batch_size, size_t chan
       PadQuantizeShuffleNHWCIm2col<DType, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
           data, batch_size, channels_per_group, groups, height, width, kernel_h, kernel_w, pad_h, pad_w, stride_h,
           stride_w, dilation_h, dilation_w, data_col, min, max, ratio, tmp, sw_threshold,
-          FindMinMaxAlongChannelThenTranspose<DType, NHWC>, QUANTIZE_KERNEL_FUNC);
+          FindMinMaxAlongChannelThenTranspose<DType, NHWC>, QUANTIZE_KERNEL_FUNC, min_workspace, max_workspace);
       if (workspace == NULL) {
         aligned_free(tmp);
       }
     }
   }
 }
+
+template <typename DType>
+void PadQuantizeShuffleNHWC1x1Wrapper(DType *data, size_t batch_size, size_t channels, size_t height, size_t width,
+                                      size_t stride_h, size_t stride_w, uint8_t *data_col, DType *min, DType *max,
+                                      DType *ratio, float sw_threshold) {
+  PadQuantizeShuffleNHWC1x1<DType, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+      data, batch_size, channels, height, width, stride_h, stride_w, data_col, min, max, ratio, sw_threshold,
+      QUANTIZE_KERNEL_FUNC);
+}
 }
 #endif
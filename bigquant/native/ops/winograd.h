@@ -0,0 +1,197 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPS_WINOGRAD_H
+#define OPS_WINOGRAD_H
+
+#include "../base.h"
+#include "../common.h"
+#include "./kernel-common.h"
+
+// F(2x2, 3x3): Y = A^T [(G g G^T) .* (B^T d B)] A.
+// Every 4x4 input patch yields a 2x2 output patch. Transformed tensors are stored point-major, [16][rows][channels],
+// so that each of the 16 points is one quantized GEMM over channel_in.
+#define WINOGRAD_PATCH 4
+#define WINOGRAD_OUT_PATCH 2
+#define WINOGRAD_POINTS 16
+
+namespace winograd {
+
+// weight: NHWC (channel_out, 3, 3, channel_in); transformed_weight: [16][channel_out][channel_in]
+void NHWCWinograd3x3KernelProcess(float *transformed_weight, float *weight, int channel_out, int channel_in, int height,
+                                  int width) {
+  assert((height == 3) && (width == 3));
+  size_t point_stride = static_cast<size_t>(channel_out) * channel_in;
+  ParallelFor(channel_out, [&](size_t o) {
+    for (int c = 0; c < channel_in; ++c) {
+      float g[3][3];
+      for (int y = 0; y < 3; ++y) {
+        for (int x = 0; x < 3; ++x) {
+          g[y][x] = weight[((o * 3 + y) * 3 + x) * channel_in + c];
+        }
+      }
+      // G g
+      float tmp[4][3];
+      for (int x = 0; x < 3; ++x) {
+        tmp[0][x] = g[0][x];
+        tmp[1][x] = 0.5f * (g[0][x] + g[1][x] + g[2][x]);
+        tmp[2][x] = 0.5f * (g[0][x] - g[1][x] + g[2][x]);
+        tmp[3][x] = g[2][x];
+      }
+      // (G g) G^T
+      float *dst = transformed_weight + o * channel_in + c;
+      for (int y = 0; y < 4; ++y) {
+        dst[(y * 4 + 0) * point_stride] = tmp[y][0];
+        dst[(y * 4 + 1) * point_stride] = 0.5f * (tmp[y][0] + tmp[y][1] + tmp[y][2]);
+        dst[(y * 4 + 2) * point_stride] = 0.5f * (tmp[y][0] - tmp[y][1] + tmp[y][2]);
+        dst[(y * 4 + 3) * point_stride] = tmp[y][2];
+      }
+    }
+  });
+}
+
+// One symmetric int8 scale per (point, channel_out); each point is padded and shuffled for the conv GEMM kernel.
+void NHWCWinogradQuantizeKernelByChannel(int8_t *quantized_kernel, float *transformed_kernel, size_t m, size_t n,
+                                         size_t pad_m, size_t pad_n, float *min, float *max, float *ratio,
+                                         float threshold) {
+  for (size_t p = 0; p < WINOGRAD_POINTS; ++p) {
+    shuffle::PadQuantizeShuffle2D<float, CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(
+        quantized_kernel + p * pad_m * pad_n, m, n, pad_m, pad_n, transformed_kernel + p * m * n, min + p * m,
+        max + p * m, ratio + p * m, threshold);
+  }
+}
+
+// data: NHWC; transformed_data: [16][batch_size * patch_y_num * patch_x_num][channel_in]
+void NHWCWinograd3x3DataProcess(float *transformed_data, float *data, size_t batch_size, size_t channel_in,
+                                size_t height, size_t width, size_t pad_h, size_t pad_w, size_t patch_y_num,
+                                size_t patch_x_num) {
+  size_t patch_num = batch_size * patch_y_num * patch_x_num;
+  size_t point_stride = patch_num * channel_in;
+  ParallelFor(patch_num, [&](size_t patch) {
+    size_t b = patch / (patch_y_num * patch_x_num);
+    size_t py = patch / patch_x_num % patch_y_num;
+    size_t px = patch % patch_x_num;
+    // rows of the 4x4 patch; NULL marks padding
+    float *src[4][4];
+    for (size_t y = 0; y < 4; ++y) {
+      for (size_t x = 0; x < 4; ++x) {
+        long h = static_cast<long>(py * WINOGRAD_OUT_PATCH + y) - static_cast<long>(pad_h);
+        long w = static_cast<long>(px * WINOGRAD_OUT_PATCH + x) - static_cast<long>(pad_w);
+        bool inside = (h >= 0) && (h < static_cast<long>(height)) && (w >= 0) && (w < static_cast<long>(width));
+        src[y][x] = inside ? data + ((b * height + h) * width + w) * channel_in : NULL;
+      }
+    }
+    float *dst = transformed_data + patch * channel_in;
+    for (size_t c = 0; c < channel_in; ++c) {
+      float d[4][4];
+      for (size_t y = 0; y < 4; ++y) {
+        for (size_t x = 0; x < 4; ++x) {
+          d[y][x] = (src[y][x] == NULL) ? 0.0f : src[y][x][c];
+        }
+      }
+      // B^T d
+      float tmp[4][4];
+      for (size_t x = 0; x < 4; ++x) {
+        tmp[0][x] = d[0][x] - d[2][x];
+        tmp[1][x] = d[1][x] + d[2][x];
+        tmp[2][x] = d[2][x] - d[1][x];
+        tmp[3][x] = d[1][x] - d[3][x];
+      }
+      // (B^T d) B
+      for (size_t y = 0; y < 4; ++y) {
+        dst[(y * 4 + 0) * point_stride + c] = tmp[y][0] - tmp[y][2];
+        dst[(y * 4 + 1) * point_stride + c] = tmp[y][1] + tmp[y][2];
+        dst[(y * 4 + 2) * point_stride + c] = tmp[y][2] - tmp[y][1];
+        dst[(y * 4 + 3) * point_stride + c] = tmp[y][1] - tmp[y][3];
+      }
+    }
+  });
+}
+
+// One GEMM per point: intermedia_out[p] (patches x channel_out) = transformed_data[p] * transformed_kernel[p]^T
+void NHWCWinograd3x3ElementWiseBatchMul(float *intermedia_out, int8_t *transformed_kernel, uint8_t *transformed_data,
+                                        size_t batch_size, size_t patch_y_num, size_t patch_x_num, size_t channel_in,
+                                        size_t channel_out, float *ratio_a, float *sum_a, float *ratio_b,
+                                        float *min_b) {
+  size_t patch_num = batch_size * patch_y_num * patch_x_num;
+  size_t aligned_m = GetAlignmentLength(channel_out, CONV_SHUFFLE_KERNEL_M);
+  size_t aligned_n = GetAlignmentLength(patch_num, CONV_SHUFFLE_KERNEL_N);
+  size_t aligned_k = GetAlignmentLength(channel_in, CONV_SHUFFLE_KERNEL_K);
+  GemmPlan plan = MakeGemmPlan<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K>(
+      aligned_m, aligned_n, aligned_k);
+  for (size_t p = 0; p < WINOGRAD_POINTS; ++p) {
+    shuffle::ConvShuffleGEMM<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_N, CONV_SHUFFLE_KERNEL_K, NHWC>(
+        transformed_kernel + p * aligned_m * aligned_k, transformed_data + p * aligned_n * aligned_k,
+        intermedia_out + p * patch_num * channel_out, aligned_m, aligned_n, aligned_k, ratio_a + p * channel_out,
+        ratio_b + p * patch_num, sum_a + p * channel_out, min_b + p * patch_num, NULL, batch_size, 1, channel_out, 0,
+        patch_num, 1, 0.5, aligned_m - channel_out, aligned_n - patch_num, false, false, false, false, NULL, NULL, NULL,
+        NULL, NULL, &plan);
+  }
+}
+
+// Output transform, bias and fused epilogue; out is written in the requested layout.
+void NHWCWinograd3x3PostProcess(float *out, float *intermedia_out, size_t batch_size, size_t patch_y_num,
+                                size_t patch_x_num, size_t channel_out, size_t height_out, size_t width_out,
+                                float *bias, LAYOUT layout, bool conv_relu_fusion, bool conv_bn_fusion,
+                                bool conv_bn_relu_fusion, bool conv_relu_bn_fusion, float *global_mean,
+                                float *mul_variance_coeff, float *scale, float *shift) {
+  size_t patch_num = batch_size * patch_y_num * patch_x_num;
+  size_t point_stride = patch_num * channel_out;
+  ParallelFor(patch_num, [&](size_t patch) {
+    size_t b = patch / (patch_y_num * patch_x_num);
+    size_t py = patch / patch_x_num % patch_y_num;
+    size_t px = patch % patch_x_num;
+    size_t valid_y = std::min(height_out - py * WINOGRAD_OUT_PATCH, static_cast<size_t>(WINOGRAD_OUT_PATCH));
+    size_t valid_x = std::min(width_out - px * WINOGRAD_OUT_PATCH, static_cast<size_t>(WINOGRAD_OUT_PATCH));
+    float *src = intermedia_out + patch * channel_out;
+    for (size_t o = 0; o < channel_out; ++o) {
+      float m[4][4];
+      for (size_t y = 0; y < 4; ++y) {
+        for (size_t x = 0; x < 4; ++x) {
+          m[y][x] = src[(y * 4 + x) * point_stride + o];
+        }
+      }
+      // A^T m A
+      float tmp[2][4];
+      for (size_t x = 0; x < 4; ++x) {
+        tmp[0][x] = m[0][x] + m[1][x] + m[2][x];
+        tmp[1][x] = m[1][x] - m[2][x] - m[3][x];
+      }
+      float result[2][2];
+      for (size_t y = 0; y < 2; ++y) {
+        result[y][0] = tmp[y][0] + tmp[y][1] + tmp[y][2];
+        result[y][1] = tmp[y][1] - tmp[y][2] - tmp[y][3];
+      }
+      for (size_t y = 0; y < valid_y; ++y) {
+        for (size_t x = 0; x < valid_x; ++x) {
+          float value = result[y][x] + ((bias == NULL) ? 0.0f : bias[o]);
+          ScalarFusionPostProcess(value, o, conv_relu_fusion, conv_bn_fusion, conv_bn_relu_fusion,
+                                  conv_relu_bn_fusion, global_mean, mul_variance_coeff, scale, shift);
+          size_t h = py * WINOGRAD_OUT_PATCH + y;
+          size_t w = px * WINOGRAD_OUT_PATCH + x;
+          if (layout == NHWC) {
+            out[((b * height_out + h) * width_out + w) * channel_out + o] = value;
+          } else {
+            out[((b * channel_out + o) * height_out + h) * width_out + w] = value;
+          }
+        }
+      }
+    }
+  });
+}
+}
+
+#endif
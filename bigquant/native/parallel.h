@@ -0,0 +1,519 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "bigquant.h"
+#include "perf_counters.h"
+
+// Parallel loops of all ops run on one of two backends. OPENMP_BACKEND forks an OpenMP team on every calling thread.
+// THREAD_POOL_BACKEND hands each loop to one process-wide pool of persistent workers that all calling threads share,
+// so that many concurrent calls do not add up to many teams.
+
+// Grains a slot of a ParallelJob starts with; more balance stealing, fewer keep the per-grain overhead down.
+#define PARALLEL_GRAINS_PER_SLOT 16
+
+// Set while a thread runs iterations of a ParallelJob; a loop started there runs serially on that thread.
+inline bool &InParallelJob() {
+  static thread_local bool in_job = false;
+  return in_job;
+}
+
+// One parallel loop handed to a ThreadPool. The iterations start out split evenly over the slots, one per thread the
+// loop may use. A thread that joins claims a slot and runs its range from the front, a grain at a time; once the range
+// is empty it steals the back half of the fullest slot. Unclaimed slots are stolen from like the others, so the
+// calling thread alone finishes the loop when no worker is free.
+struct ParallelJob {
+  ParallelJob(size_t n, size_t slots, void (*run)(void *, size_t, size_t), void *body)
+      : run_(run),
+        body_(body),
+        grain_(std::max(n / (slots * PARALLEL_GRAINS_PER_SLOT), static_cast<size_t>(1))),
+        slots_(slots),
+        claimed_(1),
+        active_(0),
+        remaining_(n),
+        phase_(CurrentPerfPhase()) {
+    for (size_t s = 0; s < slots; ++s) {
+      slots_[s].range_.store(Pack(s * n / slots, (s + 1) * n / slots));
+    }
+  }
+
+  ParallelJob(const ParallelJob &) = delete;
+
+  ParallelJob &operator=(const ParallelJob &) = delete;
+
+  bool Joinable() const {
+    return claimed_ < slots_.size();
+  }
+
+  void Join() {
+    ++active_;
+  }
+
+  void Leave() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_ == 0) {
+      done_.notify_all();
+    }
+  }
+
+  // Runs grains until no slot has any left.
+  void Work(size_t slot) {
+    PerfWorkerScope counting(phase_);
+    bool nested = InParallelJob();
+    InParallelJob() = true;
+    size_t begin, end;
+    while (true) {
+      if (!Pop(slot, begin, end)) {
+        if (!Steal(slot)) {
+          break;
+        }
+        continue;
+      }
+      run_(body_, begin, end);
+      if (remaining_.fetch_sub(end - begin) == end - begin) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_.notify_all();
+      }
+    }
+    InParallelJob() = nested;
+  }
+
+  // Until every iteration has run and every worker has left the job.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return remaining_ == 0 && active_ == 0; });
+  }
+
+  // [begin, end) packed as begin << 32 | end, so that the owner and thieves update a slot with one CAS.
+  static uint64_t Pack(size_t begin, size_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+  }
+
+  bool Pop(size_t slot, size_t &begin, size_t &end) {
+    std::atomic<uint64_t> &range = slots_[slot].range_;
+    uint64_t value = range.load();
+    while (true) {
+      size_t first = value >> 32;
+      size_t last = value & 0xffffffff;
+      if (first >= last) {
+        return false;
+      }
+      size_t next = std::min(first + grain_, last);
+      if (range.compare_exchange_weak(value, Pack(next, last))) {
+        begin = first;
+        end = next;
+        return true;
+      }
+    }
+  }
+
+  bool Steal(size_t slot) {
+    while (true) {
+      size_t victim = slot;
+      size_t most = 0;
+      for (size_t s = 0; s < slots_.size(); ++s) {
+        uint64_t value = slots_[s].range_.load();
+        size_t length = (value & 0xffffffff) - std::min(value >> 32, value & 0xffffffff);
+        if (s != slot && length > most) {
+          victim = s;
+          most = length;
+        }
+      }
+      if (victim == slot) {
+        return false;
+      }
+      std::atomic<uint64_t> &range = slots_[victim].range_;
+      uint64_t value = range.load();
+      size_t first = value >> 32;
+      size_t last = value & 0xffffffff;
+      if (first >= last) {
+        continue;
+      }
+      size_t middle = first + (last - first) / 2;
+      if (range.compare_exchange_strong(value, Pack(first, middle))) {
+        slots_[slot].range_.store(Pack(middle, last));
+        return true;
+      }
+    }
+  }
+
+  struct Slot {
+    std::atomic<uint64_t> range_;
+    char padding_[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  void (*run_)(void *, size_t, size_t);
+  void *body_;
+  size_t grain_;
+  std::vector<Slot> slots_;
+  // guarded by the mutex of the pool
+  size_t claimed_;
+  std::atomic<size_t> active_;
+  std::atomic<size_t> remaining_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  // the phase the thread that started the loop counts for
+  PerfPhaseCounts *phase_;
+};
+
+// Restricts the calling thread to cpus and returns the CPUs it could run on before in previous. False when cpus is
+// empty or the platform has no CPU affinity.
+inline bool PinCallingThread(const std::vector<int> &cpus, std::vector<int> &previous) {
+#ifdef __linux__
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    return false;
+  }
+  previous.clear();
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      previous.push_back(cpu);
+    }
+  }
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    CPU_SET(cpus[i], &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+inline bool ValidCpuSet(const std::vector<int> &cpus) {
+#ifdef __linux__
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    if (cpus[i] < 0 || cpus[i] >= CPU_SETSIZE) {
+      return false;
+    }
+  }
+  return true;
+#else
+  return cpus.empty();
+#endif
+}
+
+// Persistent workers that sleep until a loop has a slot left for them. Workers of a pool with CPUs run on those only.
+struct ThreadPool {
+  explicit ThreadPool(size_t threads_num, const std::vector<int> &cpus = std::vector<int>())
+      : cpus_(cpus), stop_(false) {
+    for (size_t i = 0; i < threads_num; ++i) {
+      workers_.push_back(std::thread(&ThreadPool::Work, this));
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      workers_[i].join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t Size() const {
+    return workers_.size();
+  }
+
+  const std::vector<int> &Cpus() const {
+    return cpus_;
+  }
+
+  // Runs job on the calling thread, which takes slot 0, and on as many idle workers as it has other slots.
+  void Run(ParallelJob &job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back(&job);
+    }
+    for (size_t i = 1; i < job.slots_.size(); ++i) {
+      wake_.notify_one();
+    }
+    job.Work(0);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+    }
+    job.Wait();
+  }
+
+ private:
+  ParallelJob *Joinable() {
+    for (size_t i = 0; i < jobs_.size(); ++i) {
+      if (jobs_[i]->Joinable()) {
+        return jobs_[i];
+      }
+    }
+    return NULL;
+  }
+
+  void Work() {
+    std::vector<int> previous;
+    PinCallingThread(cpus_, previous);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ParallelJob *job = NULL;
+      wake_.wait(lock, [&]() { return stop_ || (job = Joinable()) != NULL; });
+      if (stop_) {
+        return;
+      }
+      size_t slot = job->claimed_++;
+      job->Join();
+      lock.unlock();
+      job->Work(slot);
+      job->Leave();
+      lock.lock();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::vector<ParallelJob *> jobs_;
+  const std::vector<int> cpus_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_;
+};
+
+// Backend as one QuantizedSetThreadingBackend call left it. Loops hold the settings they started with, so a pool that
+// a later call replaces only goes away once the last loop on it returns.
+struct ParallelSettings {
+  ParallelSettings(THREADING_BACKEND backend, ThreadPool *pool, size_t max_concurrency)
+      : backend_(backend), pool_(pool), max_concurrency_(max_concurrency) {
+  }
+
+  const THREADING_BACKEND backend_;
+  const std::unique_ptr<ThreadPool> pool_;
+  const size_t max_concurrency_;
+};
+
+// Process-wide backend, set through QuantizedSetThreadingBackend.
+struct ParallelBackend {
+  static ParallelBackend &Instance() {
+    static ParallelBackend backend;
+    return backend;
+  }
+
+  std::shared_ptr<const ParallelSettings> Settings() const {
+    return std::atomic_load(&settings_);
+  }
+
+  // Loops already running finish on the settings they started with. Returns 0 on success.
+  int Configure(THREADING_BACKEND backend, size_t threads_num, size_t max_concurrency) {
+    if (backend != OPENMP_BACKEND && backend != THREAD_POOL_BACKEND) {
+      fprintf(stderr, "Unknown threading backend %d.\n", backend);
+      return -1;
+    }
+    ThreadPool *pool = NULL;
+    if (backend == THREAD_POOL_BACKEND) {
+      if (threads_num == 0) {
+        threads_num = std::max(std::thread::hardware_concurrency(), 1u);
+      }
+      // the calling thread is one of the threads of a loop
+      pool = new ThreadPool(threads_num - 1);
+    }
+    std::shared_ptr<const ParallelSettings> settings(
+        new ParallelSettings(backend, pool, (max_concurrency == 0) ? SIZE_MAX : max_concurrency));
+    std::atomic_store(&settings_, settings);
+    return 0;
+  }
+
+ private:
+  ParallelBackend() : settings_(new ParallelSettings(OPENMP_BACKEND, NULL, SIZE_MAX)) {
+  }
+
+  std::shared_ptr<const ParallelSettings> settings_;
+};
+
+// Pool that loops started by this thread run on instead of the process-wide one, for the scope of a ThreadPoolScope.
+inline ThreadPool *&ScopedThreadPool() {
+  static thread_local ThreadPool *pool = NULL;
+  return pool;
+}
+
+struct ThreadPoolScope {
+  explicit ThreadPoolScope(ThreadPool *pool) : previous_(ScopedThreadPool()) {
+    ScopedThreadPool() = pool;
+  }
+
+  ~ThreadPoolScope() {
+    ScopedThreadPool() = previous_;
+  }
+
+  ThreadPool *previous_;
+};
+
+// An execution context (QuantizedExecutionContextCreate) is a ThreadPool of its own. The ops a thread executes in it
+// run their loops on its workers, with the thread itself restricted to the CPUs of the context meanwhile.
+struct ExecutionContextScope {
+  explicit ExecutionContextScope(ThreadPool *context) : pool_(context), pinned_(false) {
+    if (context != NULL) {
+      pinned_ = PinCallingThread(context->Cpus(), previous_cpus_);
+    }
+  }
+
+  ~ExecutionContextScope() {
+    if (pinned_) {
+      std::vector<int> cpus;
+      PinCallingThread(previous_cpus_, cpus);
+    }
+  }
+
+  ExecutionContextScope(const ExecutionContextScope &) = delete;
+
+  ExecutionContextScope &operator=(const ExecutionContextScope &) = delete;
+
+  ThreadPoolScope pool_;
+  bool pinned_;
+  std::vector<int> previous_cpus_;
+};
+
+// Keeps the calling thread in context until the next call; NULL returns it to the process-wide backend.
+inline void BindExecutionContext(ThreadPool *context) {
+  static thread_local std::unique_ptr<ExecutionContextScope> binding;
+  binding.reset();
+  if (context != NULL) {
+    binding.reset(new ExecutionContextScope(context));
+  }
+}
+
+// The pool a loop started by this thread under settings runs on, NULL for OpenMP.
+inline ThreadPool *ActiveThreadPool(const ParallelSettings &settings) {
+  if (ScopedThreadPool() != NULL) {
+    return ScopedThreadPool();
+  }
+  return (settings.backend_ == THREAD_POOL_BACKEND) ? settings.pool_.get() : NULL;
+}
+
+// Whether a loop started now by this thread runs on a pool rather than OpenMP.
+inline bool ThreadPoolActive() {
+  return ActiveThreadPool(*ParallelBackend::Instance().Settings()) != NULL;
+}
+
+// Threads a loop started by this thread under settings runs on.
+inline size_t ParallelConcurrency(const ParallelSettings &settings) {
+  if (InParallelJob()) {
+    return 1;
+  }
+  ThreadPool *pool = ActiveThreadPool(settings);
+  if (pool != NULL) {
+    return std::min(pool->Size() + 1, settings.max_concurrency_);
+  }
+#ifdef _OPENMP
+  return std::min(static_cast<size_t>(omp_get_max_threads()), settings.max_concurrency_);
+#else
+  return 1;
+#endif
+}
+
+// Threads a loop started now by this thread runs on.
+inline size_t ParallelConcurrency() {
+  if (InParallelJob()) {
+    return 1;
+  }
+  return ParallelConcurrency(*ParallelBackend::Instance().Settings());
+}
+
+template <typename Body>
+void RunParallelRange(void *body, size_t begin, size_t end) {
+  Body &run = *static_cast<Body *>(body);
+  for (size_t i = begin; i < end; ++i) {
+    run(i);
+  }
+}
+
+// body(i) for every i in [0, n), in any order and on any thread of the backend.
+template <typename Body>
+void ParallelFor(size_t n, Body body) {
+  std::shared_ptr<const ParallelSettings> settings;
+  size_t threads_num = 1;
+  if (!InParallelJob()) {
+    // holding the settings keeps the pool of the loop alive when the backend is reconfigured meanwhile
+    settings = ParallelBackend::Instance().Settings();
+    threads_num = std::min(ParallelConcurrency(*settings), n);
+  }
+  if (threads_num <= 1) {
+    for (size_t i = 0; i < n; ++i) {
+      body(i);
+    }
+    return;
+  }
+  ThreadPool *pool = ActiveThreadPool(*settings);
+  if (pool != NULL) {
+    assert(n <= 0xffffffff);
+    ParallelJob job(n, threads_num, &RunParallelRange<Body>, &body);
+    pool->Run(job);
+    return;
+  }
+  PerfPhaseCounts *phase = CurrentPerfPhase();
+#pragma omp parallel num_threads(threads_num) proc_bind(close)
+  {
+    PerfWorkerScope counting(phase);
+#pragma omp for
+    for (size_t i = 0; i < n; ++i) {
+      body(i);
+    }
+  }
+}
+
+// The OpenMP collapse(2) of ParallelFor.
+template <typename Body>
+void ParallelFor2D(size_t n0, size_t n1, Body body) {
+  ParallelFor(n0 * n1, [&](size_t i) { body(i / n1, i % n1); });
+}
+
+// The OpenMP collapse(3) of ParallelFor.
+template <typename Body>
+void ParallelFor3D(size_t n0, size_t n1, size_t n2, Body body) {
+  ParallelFor(n0 * n1 * n2, [&](size_t i) { body(i / (n1 * n2), i / n2 % n1, i % n2); });
+}
+
+// body(chunk, begin, end) for ParallelConcurrency() contiguous chunks of [0, n), which is what loops with a
+// reduction or scratch space per thread need. Returns the number of chunks.
+template <typename Body>
+size_t ParallelChunks(size_t n, Body body) {
+  size_t chunks = std::max(std::min(ParallelConcurrency(), n), static_cast<size_t>(1));
+  ParallelFor(chunks, [&](size_t chunk) { body(chunk, chunk * n / chunks, (chunk + 1) * n / chunks); });
+  return chunks;
+}
+
+#endif
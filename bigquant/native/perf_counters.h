@@ -0,0 +1,332 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bigquant.h"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// CPU time and hardware counters of the phases of ops (QuantizedPerfCountersEnable). Every thread counts itself, in a
+// group of its own that it opens the first time it works for a phase and that closes when it exits. A phase adds up
+// what the thread running it counts and what the workers of its parallel loops, OpenMP team, thread pool or NUMA
+// teams, count while they run them for it; threads working for other ops do not count towards it.
+
+#define PERF_COUNTERS_NUM 6
+
+// Counters of one thread, opened as one group so that they are scheduled onto the PMU together.
+struct PerfCounterGroup {
+  PerfCounterGroup() : leader_(-1) {
+    for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+      fds_[i] = -1;
+    }
+  }
+
+  // Opens what the host supports of task clock, cycles, instructions and LLC, L1D and dTLB read misses, user space
+  // only. Returns false if none.
+  bool Open(int tid) {
+#ifdef __linux__
+    static const uint32_t types[PERF_COUNTERS_NUM] = {PERF_TYPE_SOFTWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                      PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+    static const uint64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    static const uint64_t configs[PERF_COUNTERS_NUM] = {PERF_COUNT_SW_TASK_CLOCK,
+                                                        PERF_COUNT_HW_CPU_CYCLES,
+                                                        PERF_COUNT_HW_INSTRUCTIONS,
+                                                        PERF_COUNT_HW_CACHE_LL | read_miss,
+                                                        PERF_COUNT_HW_CACHE_L1D | read_miss,
+                                                        PERF_COUNT_HW_CACHE_DTLB | read_miss};
+    for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = types[i];
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds_[i] = syscall(SYS_perf_event_open, &attr, tid, -1, leader_, 0);
+      leader_ = (leader_ < 0) ? fds_[i] : leader_;
+    }
+#endif
+    return leader_ >= 0;
+  }
+
+  // Adds the counts of the group to values, scaled up for the time the group was multiplexed off the PMU.
+  void Read(uint64_t *values) const {
+#ifdef __linux__
+    // {counters, time enabled, time running, the counts in the order the counters were opened}
+    uint64_t buffer[3 + PERF_COUNTERS_NUM];
+    if (leader_ < 0 || read(leader_, buffer, sizeof(buffer)) < static_cast<ssize_t>(3 * sizeof(uint64_t)) ||
+        buffer[2] == 0) {
+      return;
+    }
+    double scale = static_cast<double>(buffer[1]) / buffer[2];
+    for (int i = 0, v = 0; i < PERF_COUNTERS_NUM && v < static_cast<int>(buffer[0]); ++i) {
+      if (fds_[i] >= 0) {
+        values[i] += static_cast<uint64_t>(buffer[3 + v++] * scale);
+      }
+    }
+#endif
+  }
+
+  bool Counts(int counter) const {
+    return fds_[counter] >= 0;
+  }
+
+  void Close() {
+#ifdef __linux__
+    for (int i = PERF_COUNTERS_NUM - 1; i >= 0; --i) {
+      if (fds_[i] >= 0) {
+        close(fds_[i]);
+      }
+      fds_[i] = -1;
+    }
+#endif
+    leader_ = -1;
+  }
+
+ private:
+  int fds_[PERF_COUNTERS_NUM];
+  int leader_;
+};
+
+// A phase in progress: the thread running it samples its own counts at its start and end, and the workers running
+// its parallel loops add theirs to it and to the phases it is nested in.
+struct PerfPhaseCounts {
+  explicit PerfPhaseCounts(PerfPhaseCounts *parent) : parent_(parent) {
+    for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+      workers_[i] = 0;
+    }
+  }
+
+  PerfPhaseCounts *parent_;
+  std::atomic<uint64_t> workers_[PERF_COUNTERS_NUM];
+};
+
+// The innermost phase the calling thread counts for, NULL when it counts for none.
+inline PerfPhaseCounts *&CurrentPerfPhase() {
+  static thread_local PerfPhaseCounts *phase = NULL;
+  return phase;
+}
+
+// The counter group of one thread. Only the thread itself reads it; Enable closes it under mutex_.
+struct PerfThreadCounters {
+  PerfThreadCounters() : opened_(false) {
+  }
+
+  std::mutex mutex_;
+  PerfCounterGroup group_;
+  // Open was tried since the last Enable
+  bool opened_;
+};
+
+struct PerfCounters {
+  static PerfCounters &Instance() {
+    // never destroyed, like Tracer
+    static PerfCounters *counters = new PerfCounters();
+    return *counters;
+  }
+
+  bool Enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Closes the counters of all threads, which open theirs again on their next phase when enabled; drops the counts so
+  // far. Returns -1 if the calling thread can count nothing, as when perf_event_paranoid is 3 or more or a seccomp
+  // profile denies the call.
+  int Enable(bool enable) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      enabled_.store(false);
+      for (auto thread : threads_) {
+        std::lock_guard<std::mutex> thread_lock(thread->mutex_);
+        thread->group_.Close();
+        thread->opened_ = false;
+      }
+      totals_.clear();
+      counted_ = 0;
+      enabled_.store(enable);
+    }
+    if (!enable) {
+      return 0;
+    }
+    uint64_t values[PERF_COUNTERS_NUM];
+    Sample(values);
+    if (counted_ == 0) {
+      enabled_.store(false);
+      return -1;
+    }
+    return 0;
+  }
+
+  // Counts of the calling thread so far, opening its counters on first use. Takes no lock other threads contend for
+  // except while Enable runs.
+  void Sample(uint64_t *values) {
+    std::fill(values, values + PERF_COUNTERS_NUM, 0);
+    PerfThreadCounters *thread = LocalCounters();
+    std::lock_guard<std::mutex> lock(thread->mutex_);
+    if (!thread->opened_ && Enabled()) {
+      thread->opened_ = true;
+      if (thread->group_.Open(0)) {
+        for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+          counted_ |= thread->group_.Counts(i) ? (1 << i) : 0;
+        }
+      }
+    }
+    thread->group_.Read(values);
+  }
+
+  // Makes phase the one the calling thread counts for and samples its start.
+  void Begin(PerfPhaseCounts &phase, uint64_t *start) {
+    CurrentPerfPhase() = &phase;
+    Sample(start);
+  }
+
+  // Adds what the calling thread and the workers counted for phase since Begin to the totals of op.
+  void End(uint64_t op, TRACE_PHASE phase_id, PerfPhaseCounts &phase, const uint64_t *start) {
+    uint64_t counts[PERF_COUNTERS_NUM];
+    Sample(counts);
+    CurrentPerfPhase() = phase.parent_;
+    for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+      counts[i] = counts[i] - std::min(start[i], counts[i]) + phase.workers_[i].load();
+    }
+    Add(op, phase_id, counts);
+  }
+
+  // Copies up to capacity of the totals per op and phase to records; returns how many totals there are.
+  size_t Fetch(QuantizedPerfCounterRecord *records, size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t index = 0;
+    for (auto iter = totals_.begin(); iter != totals_.end() && index < capacity; ++iter, ++index) {
+      records[index] = iter->second;
+    }
+    return totals_.size();
+  }
+
+  void Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    totals_.clear();
+  }
+
+ private:
+  // Closes the counters of an exiting thread.
+  struct CountersOwner {
+    CountersOwner() : counters_(NULL) {
+    }
+
+    ~CountersOwner() {
+      if (counters_ != NULL) {
+        PerfCounters::Instance().Unregister(counters_);
+      }
+    }
+
+    PerfThreadCounters *counters_;
+  };
+
+  PerfCounters() : enabled_(false), counted_(0) {
+  }
+
+  PerfThreadCounters *LocalCounters() {
+    static thread_local CountersOwner owner;
+    if (owner.counters_ == NULL) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      owner.counters_ = new PerfThreadCounters();
+      threads_.insert(owner.counters_);
+    }
+    return owner.counters_;
+  }
+
+  void Unregister(PerfThreadCounters *thread) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      threads_.erase(thread);
+    }
+    thread->group_.Close();
+    delete thread;
+  }
+
+  void Add(uint64_t op, TRACE_PHASE phase, const uint64_t *counts) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_.load(std::memory_order_relaxed)) {
+      return;
+    }
+    QuantizedPerfCounterRecord &record = totals_[std::make_pair(op, static_cast<uint32_t>(phase))];
+    record.op = op;
+    record.phase = phase;
+    ++record.calls;
+    uint64_t *totals[PERF_COUNTERS_NUM] = {&record.cpu_ns,     &record.cycles,     &record.instructions,
+                                           &record.llc_misses, &record.l1d_misses, &record.dtlb_misses};
+    for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+      *totals[i] = ((counted_ & (1 << i)) == 0) ? UINT64_MAX : *totals[i] + counts[i];
+    }
+  }
+
+  std::atomic<bool> enabled_;
+  std::mutex mutex_;
+  // counters some thread counts, one bit each
+  std::atomic<int> counted_;
+  std::set<PerfThreadCounters *> threads_;
+  std::map<std::pair<uint64_t, uint32_t>, QuantizedPerfCounterRecord> totals_;
+};
+
+// Adds what the calling thread counts until the end of the block to phase, which the thread that started a parallel
+// loop counts for, and to the phases it is nested in. A no-op on that thread itself and when not counting.
+struct PerfWorkerScope {
+  explicit PerfWorkerScope(PerfPhaseCounts *phase)
+      : phase_((phase != CurrentPerfPhase()) ? phase : NULL), previous_(CurrentPerfPhase()) {
+    if (phase_ != NULL) {
+      CurrentPerfPhase() = phase_;
+      PerfCounters::Instance().Sample(start_);
+    }
+  }
+
+  ~PerfWorkerScope() {
+    if (phase_ == NULL) {
+      return;
+    }
+    uint64_t end[PERF_COUNTERS_NUM];
+    PerfCounters::Instance().Sample(end);
+    CurrentPerfPhase() = previous_;
+    for (PerfPhaseCounts *phase = phase_; phase != NULL; phase = phase->parent_) {
+      for (int i = 0; i < PERF_COUNTERS_NUM; ++i) {
+        phase->workers_[i] += end[i] - std::min(start_[i], end[i]);
+      }
+    }
+  }
+
+  PerfWorkerScope(const PerfWorkerScope &) = delete;
+
+  PerfWorkerScope &operator=(const PerfWorkerScope &) = delete;
+
+  PerfPhaseCounts *phase_;
+  PerfPhaseCounts *previous_;
+  uint64_t start_[PERF_COUNTERS_NUM];
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TESTS_FC_FIXTURE_H
+#define TESTS_FC_FIXTURE_H
+
+#include <vector>
+#include "bigquant.h"
+
+// Weights and inputs of one FC shape shared by the tests that run an FC, with the outputs they are checked against.
+struct FCFixture {
+  FCFixture(size_t data_batch, size_t data_channel, size_t filter_num)
+      : data_batch_(data_batch),
+        data_channel_(data_channel),
+        filter_num_(filter_num),
+        weight_(filter_num * data_channel),
+        data_(data_batch * data_channel) {
+    for (size_t i = 0; i < weight_.size(); ++i) {
+      weight_[i] = static_cast<float>(static_cast<int>(i * 7 % 13) - 6) / 6.0f;
+    }
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<float>(i * 5 % 11) / 11.0f;
+    }
+  }
+
+  // float FC of row b and output channel c
+  float Reference(size_t b, size_t c, float bias) const {
+    float expected = bias;
+    for (size_t k = 0; k < data_channel_; ++k) {
+      expected += weight_[c * data_channel_ + k] * data_[b * data_channel_ + k];
+    }
+    return expected;
+  }
+
+  // output of a plain SHUFFLE_FC op without bias
+  std::vector<float> ShuffleOut() {
+    std::vector<float> out(data_batch_ * filter_num_);
+    QuantizedFCOp *desc = QuantizedFCOpCreate();
+    QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num_, data_channel_, SHUFFLE_FC);
+    QuantizedFCOpInitWeight(desc, weight_.data());
+    QuantizedFCOpExecute(desc, out.data(), data_.data(), NULL, data_batch_, data_channel_);
+    QuantizedFCOpFree(desc);
+    return out;
+  }
+
+  size_t data_batch_;
+  size_t data_channel_;
+  size_t filter_num_;
+  std::vector<float> weight_;
+  std::vector<float> data_;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include "bigquant.h"
+#include "fc_fixture.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+struct CountingAllocator {
+  size_t allocations;
+  size_t releases;
+};
+
+void *CountingAllocate(size_t alignment, size_t size, void *user_data) {
+  void *p = NULL;
+  if (posix_memalign(&p, alignment, size) != 0) {
+    return NULL;
+  }
+  ++static_cast<CountingAllocator *>(user_data)->allocations;
+  return p;
+}
+
+void CountingRelease(void *p, void *user_data) {
+  ++static_cast<CountingAllocator *>(user_data)->releases;
+  free(p);
+}
+
+// Runs an FC on the memory of allocator, which then accounts for the weights and workspaces of the op until it is
+// freed; the allocator is freed before the op, with blocks still live.
+void TestFCAllocator(QuantizedAllocator *allocator, size_t data_batch, size_t data_channel, size_t filter_num) {
+  FCFixture fc(data_batch, data_channel, filter_num);
+  std::vector<float> &weight = fc.weight_, &data = fc.data_;
+  std::vector<float> expected = fc.ShuffleOut(), out(expected.size());
+
+  QuantizedAllocatorStats process_before, process_after, stats;
+  QuantizedGetAllocatorStats(NULL, &process_before);
+  CHECK(allocator != NULL);
+  QuantizedBindAllocator(allocator);
+  QuantizedFCOp *instance = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(instance, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(instance, weight.data());
+  QuantizedFCOpExecute(instance, out.data(), data.data(), NULL, data_batch, data_channel);
+  QuantizedBindAllocator(NULL);
+  QuantizedGetAllocatorStats(allocator, &stats);
+  CHECK(stats.live_bytes >= filter_num * data_channel);
+  CHECK(stats.peak_bytes >= stats.live_bytes);
+  CHECK(stats.live_allocations > 0);
+  CHECK(stats.allocations >= stats.live_allocations);
+  QuantizedGetAllocatorStats(NULL, &process_after);
+  CHECK(process_after.live_bytes >= process_before.live_bytes + stats.live_bytes);
+  QuantizedAllocatorFree(allocator);
+  QuantizedFCOpFree(instance);
+  QuantizedGetAllocatorStats(NULL, &process_after);
+  CHECK(process_after.live_bytes == process_before.live_bytes);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    DOUBLES_EQUAL(expected[i], out[i], 1e-5 * data_channel);
+  }
+}
+
+TEST_GROUP(ALLOCATOR){
+
+};
+
+TEST(ALLOCATOR, TEST_ALLOCATOR) {
+  ALLOCATOR_KIND kinds[] = {DEFAULT_ALLOCATOR, HUGE_PAGE_ALLOCATOR, ARENA_ALLOCATOR};
+  for (auto kind : kinds) {
+    TestFCAllocator(QuantizedAllocatorCreate(kind), 3, 300, 131);
+    TestFCAllocator(QuantizedAllocatorCreate(kind), 64, 4096, 1024);
+  }
+  CountingAllocator counts = {0, 0};
+  TestFCAllocator(QuantizedCustomAllocatorCreate(CountingAllocate, CountingRelease, &counts), 33, 1023, 64);
+  CHECK(counts.allocations > 0);
+  CHECK(counts.releases == counts.allocations);
+  CHECK(QuantizedAllocatorCreate(static_cast<ALLOCATOR_KIND>(3)) == NULL);
+}
+
+int main(int argc, char **argv) {
+  return RUN_ALL_TESTS(argc, argv);
+}
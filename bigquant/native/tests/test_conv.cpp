@@ -1,7 +1,9 @@
 #include <iostream>
 #include <array>
 #include <vector>
+#include <thread>
 #include <algorithm>
+#include <cmath>
 #include "bigquant.h"
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/CommandLineTestRunner.h"
@@ -43,6 +45,599 @@ void TestConvolutionDesc(size_t data_batch, size_t data_channel, size_t data_hei
   }
 }
 
+void TestConvolutionFusion(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                           size_t filter_num, size_t filter_height, size_t filter_width, LAYOUT layout,
+                           FUSION_MASK fusion_mask, size_t previous_filter_num = 0) {
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+
+  std::vector<float> weight(filter_num * data_channel * filter_height * filter_width, 1.0f);
+  // negative input so that relu clamps the raw convolution result
+  std::vector<float> data(data_batch * data_channel * data_height * data_width, -1.0f);
+
+  size_t out_height = GetConvOutSize(data_height, filter_height, 1, 0, 1);
+  size_t out_width = GetConvOutSize(data_width, filter_width, 1, 0, 1);
+  std::vector<float> out(data_batch * filter_num * out_height * out_width);
+
+  std::vector<float> mean(filter_num), variance(filter_num), scale(filter_num), shift(filter_num);
+  for (size_t c = 0; c < filter_num; ++c) {
+    mean[c] = -0.5f * c;
+    variance[c] = 4.0f;
+    scale[c] = 1.0f + 0.25f * (c % 4);
+    shift[c] = (c % 2 == 0) ? 1.0f : -1.0f;
+  }
+
+  // a set up for previous_filter_num first: its BN parameters are kept if the channel count matches and dropped if not
+  if (previous_filter_num != 0) {
+    std::vector<float> previous(previous_filter_num, 1.0f);
+    QuantizedConvOpSetupConvParameter(desc, layout, previous_filter_num, data_channel, 1, filter_height, filter_width,
+                                      1, 1, 0, 0, 1, 1, fusion_mask, SHUFFLE_CONV);
+    if (previous_filter_num == filter_num) {
+      QuantizedConvOpSetupBNParameter(desc, mean.data(), variance.data(), scale.data(), shift.data(), 0.0f);
+    } else {
+      QuantizedConvOpSetupBNParameter(desc, previous.data(), previous.data(), previous.data(), previous.data(), 0.0f);
+    }
+  }
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, 1, filter_height, filter_width, 1, 1, 0, 0,
+                                    1, 1, fusion_mask, SHUFFLE_CONV);
+  if (previous_filter_num != filter_num) {
+    QuantizedConvOpSetupBNParameter(desc, mean.data(), variance.data(), scale.data(), shift.data(), 0.0f);
+  }
+  QuantizedConvOpInitWeight(desc, weight.data());
+  QuantizedConvOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel, data_height, data_width);
+  QuantizedConvOpFree(desc);
+
+  float conv = -1.0f * data_channel * filter_height * filter_width;
+  for (size_t i = 0; i < out.size(); ++i) {
+    size_t c = (layout == NHWC) ? (i % filter_num) : ((i / (out_height * out_width)) % filter_num);
+    float expect = conv;
+    if (fusion_mask == CONV_RELU_FUSION || fusion_mask == CONV_RELU_BN_FUSION) {
+      expect = std::max(expect, 0.0f);
+    }
+    if (fusion_mask != CONV_RELU_FUSION) {
+      expect = (expect - mean[c]) / 2.0f * scale[c] + shift[c];
+    }
+    if (fusion_mask == CONV_BN_RELU_FUSION) {
+      expect = std::max(expect, 0.0f);
+    }
+    DOUBLES_EQUAL(expect, out[i], 1e-3);
+  }
+}
+
+void TestConvolutionWorkspaceReuse(size_t data_channel, size_t filter_num, size_t filter_height, size_t filter_width,
+                                   LAYOUT layout) {
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  std::vector<float> weight(filter_num * data_channel * filter_height * filter_width, 1.0f);
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, 1, filter_height, filter_width, 1, 1, 0, 0,
+                                    1, 1, 0, SHUFFLE_CONV);
+  QuantizedConvOpInitWeight(desc, weight.data());
+  // grow, shrink, repeat and grow again after releasing the workspace
+  size_t shapes[][3] = {{1, 10, 10}, {4, 16, 16}, {2, 8, 12}, {2, 8, 12}, {8, 20, 20}};
+  for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i) {
+    size_t batch = shapes[i][0];
+    size_t height = shapes[i][1];
+    size_t width = shapes[i][2];
+    std::vector<float> data(batch * data_channel * height * width, 1.0f);
+    size_t out_height = GetConvOutSize(height, filter_height, 1, 0, 1);
+    size_t out_width = GetConvOutSize(width, filter_width, 1, 0, 1);
+    std::vector<float> out(batch * filter_num * out_height * out_width);
+    if (i == 3) {
+      QuantizedConvOpReleaseWorkspace(desc);
+    }
+    QuantizedConvOpExecute(desc, out.data(), data.data(), NULL, batch, data_channel, height, width);
+    for (auto iter = out.begin(); iter < out.end(); ++iter) {
+      DOUBLES_EQUAL(*iter, data_channel * filter_height * filter_width, 1e-6);
+    }
+  }
+  QuantizedConvOpFree(desc);
+}
+
+void TestConvolutionConcurrent(size_t data_channel, size_t filter_num, size_t filter_height, size_t filter_width,
+                               LAYOUT layout) {
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  std::vector<float> weight(filter_num * data_channel * filter_height * filter_width, 1.0f);
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, 1, filter_height, filter_width, 1, 1, 0, 0,
+                                    1, 1, 0, SHUFFLE_CONV);
+  QuantizedConvOpInitWeight(desc, weight.data());
+  // every thread runs its own shape on the shared op
+  const size_t thread_num = 4;
+  std::vector<std::vector<float> > outs(thread_num);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&, t] {
+      size_t batch = t + 1;
+      size_t height = 8 + 3 * t;
+      size_t width = 10 + t;
+      std::vector<float> data(batch * data_channel * height * width, 1.0f);
+      outs[t].resize(batch * filter_num * GetConvOutSize(height, filter_height, 1, 0, 1) *
+                     GetConvOutSize(width, filter_width, 1, 0, 1));
+      for (size_t iter = 0; iter < 8; ++iter) {
+        QuantizedConvOpExecute(desc, outs[t].data(), data.data(), NULL, batch, data_channel, height, width);
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  QuantizedConvOpFree(desc);
+  for (size_t t = 0; t < thread_num; ++t) {
+    for (auto iter = outs[t].begin(); iter < outs[t].end(); ++iter) {
+      DOUBLES_EQUAL(*iter, data_channel * filter_height * filter_width, 1e-6);
+    }
+  }
+}
+
+void TestConvolutionWinograd(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                             size_t filter_num, size_t pad, LAYOUT layout, CONV_ALGORITHM algo) {
+  size_t out_height = GetConvOutSize(data_height, 3, 1, pad, 1);
+  size_t out_width = GetConvOutSize(data_width, 3, 1, pad, 1);
+  std::vector<float> weight(filter_num * data_channel * 9);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(filter_num);
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 3);
+  }
+  std::vector<float> data(data_batch * data_channel * data_height * data_width);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i * 11 % 23) / 23.0f;
+  }
+
+  auto run = [&](CONV_ALGORITHM conv_algo) {
+    std::vector<float> out(data_batch * filter_num * out_height * out_width);
+    QuantizedConvOp* desc = QuantizedConvOpCreate();
+    QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, 1, 3, 3, 1, 1, pad, pad, 1, 1, 0,
+                                      conv_algo);
+    QuantizedConvOpInitWeight(desc, weight.data());
+    QuantizedConvOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                           data_width);
+    QuantizedConvOpFree(desc);
+    return out;
+  };
+  std::vector<float> out = run(algo);
+  std::vector<float> shuffle_out = run(SHUFFLE_CONV);
+
+  auto data_at = [&](size_t b, size_t c, size_t h, size_t w) {
+    return (layout == NCHW) ? data[((b * data_channel + c) * data_height + h) * data_width + w]
+                            : data[((b * data_height + h) * data_width + w) * data_channel + c];
+  };
+  auto weight_at = [&](size_t o, size_t c, size_t y, size_t x) {
+    return (layout == NCHW) ? weight[((o * data_channel + c) * 3 + y) * 3 + x]
+                            : weight[((o * 3 + y) * 3 + x) * data_channel + c];
+  };
+  // the largest errors against fp32 of algo and of SHUFFLE_CONV on the same input
+  double error = 0.0, shuffle_error = 0.0;
+  for (size_t b = 0; b < data_batch; ++b) {
+    for (size_t o = 0; o < filter_num; ++o) {
+      for (size_t h = 0; h < out_height; ++h) {
+        for (size_t w = 0; w < out_width; ++w) {
+          float expected = bias[o];
+          for (size_t c = 0; c < data_channel; ++c) {
+            for (size_t y = 0; y < 3; ++y) {
+              for (size_t x = 0; x < 3; ++x) {
+                long ih = static_cast<long>(h + y) - static_cast<long>(pad);
+                long iw = static_cast<long>(w + x) - static_cast<long>(pad);
+                if (ih >= 0 && ih < static_cast<long>(data_height) && iw >= 0 && iw < static_cast<long>(data_width)) {
+                  expected += weight_at(o, c, y, x) * data_at(b, c, ih, iw);
+                }
+              }
+            }
+          }
+          size_t index = (layout == NCHW) ? ((b * filter_num + o) * out_height + h) * out_width + w
+                                          : ((b * out_height + h) * out_width + w) * filter_num + o;
+          error = std::max(error, std::fabs(static_cast<double>(out[index] - expected)));
+          shuffle_error = std::max(shuffle_error, std::fabs(static_cast<double>(shuffle_out[index] - expected)));
+        }
+      }
+    }
+  }
+  // the transforms of F(2x2, 3x3) scale the quantization error up by a small constant factor
+  CHECK(error <= 4.0 * shuffle_error + 1e-3);
+}
+
+void TestConvolution1x1(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                        size_t filter_num, size_t stride, LAYOUT layout) {
+  size_t out_height = GetConvOutSize(data_height, 1, stride, 0, 1);
+  size_t out_width = GetConvOutSize(data_width, 1, stride, 0, 1);
+  std::vector<float> weight(filter_num * data_channel);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(filter_num);
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 3);
+  }
+  std::vector<float> data(data_batch * data_channel * data_height * data_width);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i * 11 % 23) / 23.0f;
+  }
+  std::vector<float> out(data_batch * filter_num * out_height * out_width);
+
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, 1, 1, 1, stride, stride, 0, 0, 1, 1, 0,
+                                    SHUFFLE_CONV);
+  QuantizedConvOpInitWeight(desc, weight.data());
+  QuantizedConvOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpFree(desc);
+
+  for (size_t b = 0; b < data_batch; ++b) {
+    for (size_t o = 0; o < filter_num; ++o) {
+      for (size_t h = 0; h < out_height; ++h) {
+        for (size_t w = 0; w < out_width; ++w) {
+          float expected = bias[o];
+          for (size_t c = 0; c < data_channel; ++c) {
+            size_t ih = h * stride;
+            size_t iw = w * stride;
+            float value = (layout == NCHW) ? data[((b * data_channel + c) * data_height + ih) * data_width + iw]
+                                           : data[((b * data_height + ih) * data_width + iw) * data_channel + c];
+            expected += weight[o * data_channel + c] * value;
+          }
+          float actual = (layout == NCHW) ? out[((b * filter_num + o) * out_height + h) * out_width + w]
+                                          : out[((b * out_height + h) * out_width + w) * filter_num + o];
+          DOUBLES_EQUAL(expected, actual, 0.02 * data_channel + 1e-3);
+        }
+      }
+    }
+  }
+}
+
+void TestConvolutionDepthwise(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                              size_t filter_height, size_t filter_width, size_t stride, size_t pad, LAYOUT layout,
+                              CONV_ALGORITHM algo) {
+  size_t out_height = GetConvOutSize(data_height, filter_height, stride, pad, 1);
+  size_t out_width = GetConvOutSize(data_width, filter_width, stride, pad, 1);
+  size_t kernel_size = filter_height * filter_width;
+  std::vector<float> weight(data_channel * kernel_size);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(data_channel);
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 3);
+  }
+  std::vector<float> data(data_batch * data_channel * data_height * data_width);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(static_cast<int>(i * 11 % 23) - 5) / 23.0f;
+  }
+  std::vector<float> out(data_batch * data_channel * out_height * out_width);
+
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(desc, layout, data_channel, data_channel, data_channel, filter_height,
+                                    filter_width, stride, stride, pad, pad, 1, 1, 0, algo);
+  QuantizedConvOpInitWeight(desc, weight.data());
+  QuantizedConvOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpFree(desc);
+
+  for (size_t b = 0; b < data_batch; ++b) {
+    for (size_t c = 0; c < data_channel; ++c) {
+      for (size_t h = 0; h < out_height; ++h) {
+        for (size_t w = 0; w < out_width; ++w) {
+          float expected = bias[c];
+          for (size_t y = 0; y < filter_height; ++y) {
+            for (size_t x = 0; x < filter_width; ++x) {
+              long ih = static_cast<long>(h * stride + y) - static_cast<long>(pad);
+              long iw = static_cast<long>(w * stride + x) - static_cast<long>(pad);
+              if (ih >= 0 && ih < static_cast<long>(data_height) && iw >= 0 && iw < static_cast<long>(data_width)) {
+                float value = (layout == NCHW) ? data[((b * data_channel + c) * data_height + ih) * data_width + iw]
+                                               : data[((b * data_height + ih) * data_width + iw) * data_channel + c];
+                expected += weight[c * kernel_size + y * filter_width + x] * value;
+              }
+            }
+          }
+          float actual = (layout == NCHW) ? out[((b * data_channel + c) * out_height + h) * out_width + w]
+                                          : out[((b * out_height + h) * out_width + w) * data_channel + c];
+          DOUBLES_EQUAL(expected, actual, 0.01 * kernel_size + 1e-3);
+        }
+      }
+    }
+  }
+}
+
+void TestConvolutionStaticQuantization(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                                      size_t group, size_t filter_num, size_t filter_size, size_t stride, size_t pad,
+                                      LAYOUT layout, bool per_channel) {
+  size_t out_height = GetConvOutSize(data_height, filter_size, stride, pad, 1);
+  size_t out_width = GetConvOutSize(data_width, filter_size, stride, pad, 1);
+  size_t channel_in_per_group = data_channel / group;
+  size_t filter_per_group = filter_num / group;
+  std::vector<float> weight(filter_num * channel_in_per_group * filter_size * filter_size);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(filter_num);
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 3);
+  }
+  auto channel_of = [&](size_t i) {
+    return (layout == NCHW) ? i / (data_height * data_width) % data_channel : i % data_channel;
+  };
+  std::vector<float> data(data_batch * data_channel * data_height * data_width);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (static_cast<float>(i * 11 % 23) / 23.0f - 0.25f) * (1 + channel_of(i) % 3);
+  }
+  // calibrate on the data itself; the range always includes 0
+  size_t count = per_channel ? data_channel : 1;
+  std::vector<float> min(count, 0.0f), max(count, 0.0f), scale(count);
+  std::vector<uint8_t> zero_point(count);
+  for (size_t i = 0; i < data.size(); ++i) {
+    size_t c = per_channel ? channel_of(i) : 0;
+    min[c] = std::min(min[c], data[i]);
+    max[c] = std::max(max[c], data[i]);
+  }
+  for (size_t c = 0; c < count; ++c) {
+    scale[c] = (max[c] - min[c]) / 127.0f;
+    zero_point[c] = static_cast<uint8_t>(std::round(-min[c] / scale[c]));
+  }
+  std::vector<float> out(data_batch * filter_num * out_height * out_width);
+
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, group, filter_size, filter_size, stride,
+                                    stride, pad, pad, 1, 1, 0, AUTO_SELECT_CONV);
+  QuantizedConvOpSetupActivationQuantization(desc, scale.data(), zero_point.data(), count);
+  QuantizedConvOpInitWeight(desc, weight.data());
+  QuantizedConvOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpFree(desc);
+
+  for (size_t b = 0; b < data_batch; ++b) {
+    for (size_t o = 0; o < filter_num; ++o) {
+      for (size_t h = 0; h < out_height; ++h) {
+        for (size_t w = 0; w < out_width; ++w) {
+          float expected = bias[o];
+          for (size_t ci = 0; ci < channel_in_per_group; ++ci) {
+            size_t c = o / filter_per_group * channel_in_per_group + ci;
+            for (size_t y = 0; y < filter_size; ++y) {
+              for (size_t x = 0; x < filter_size; ++x) {
+                long ih = static_cast<long>(h * stride + y) - static_cast<long>(pad);
+                long iw = static_cast<long>(w * stride + x) - static_cast<long>(pad);
+                if (ih < 0 || ih >= static_cast<long>(data_height) || iw < 0 || iw >= static_cast<long>(data_width)) {
+                  continue;
+                }
+                float value = (layout == NCHW) ? data[((b * data_channel + c) * data_height + ih) * data_width + iw]
+                                               : data[((b * data_height + ih) * data_width + iw) * data_channel + c];
+                float kernel = (layout == NCHW)
+                                   ? weight[((o * channel_in_per_group + ci) * filter_size + y) * filter_size + x]
+                                   : weight[((o * filter_size + y) * filter_size + x) * channel_in_per_group + ci];
+                expected += kernel * value;
+              }
+            }
+          }
+          float actual = (layout == NCHW) ? out[((b * filter_num + o) * out_height + h) * out_width + w]
+                                          : out[((b * out_height + h) * out_width + w) * filter_num + o];
+          DOUBLES_EQUAL(expected, actual, 0.02 * channel_in_per_group * filter_size + 1e-3);
+        }
+      }
+    }
+  }
+}
+
+// conv1 (3x3) writes uint8, plain and shuffled, which a 1x1 conv2 calibrated with the same parameters consumes.
+void TestConvolutionQuantizedChain(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                                   size_t mid_channel, size_t filter_num, LAYOUT layout) {
+  size_t pixels = data_batch * data_height * data_width;
+  std::vector<float> weight1(mid_channel * data_channel * 9), weight2(filter_num * mid_channel);
+  for (size_t i = 0; i < weight1.size(); ++i) {
+    weight1[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 16.0f;
+  }
+  for (size_t i = 0; i < weight2.size(); ++i) {
+    weight2[i] = static_cast<float>(static_cast<int>(i * 5 % 13) - 6) / 6.0f;
+  }
+  std::vector<float> bias(std::max(mid_channel, filter_num));
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 3);
+  }
+  std::vector<float> data(pixels * data_channel);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(static_cast<int>(i * 11 % 23) - 5) / 23.0f;
+  }
+
+  // calibrate the intermediate tensor on the float result of conv1
+  std::vector<float> mid(pixels * mid_channel);
+  QuantizedConvOp* conv1 = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(conv1, layout, mid_channel, data_channel, 1, 3, 3, 1, 1, 1, 1, 1, 1, 0,
+                                    SHUFFLE_CONV);
+  QuantizedConvOpInitWeight(conv1, weight1.data());
+  QuantizedConvOpExecute(conv1, mid.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpFree(conv1);
+  float min = 0.0f, max = 0.0f;
+  for (auto value : mid) {
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+  float scale = (max - min) / 127.0f;
+  uint8_t zero_point = static_cast<uint8_t>(std::round(-min / scale));
+
+  std::vector<uint8_t> mid_q(mid.size());
+  std::vector<uint8_t> mid_shuffled(QuantizedShuffledActivationSize(pixels, mid_channel));
+  conv1 = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(conv1, layout, mid_channel, data_channel, 1, 3, 3, 1, 1, 1, 1, 1, 1, 0,
+                                    SHUFFLE_CONV);
+  QuantizedConvOpSetupOutputQuantization(conv1, &scale, &zero_point, 1);
+  QuantizedConvOpInitWeight(conv1, weight1.data());
+  QuantizedConvOpExecuteQuantized(conv1, mid_q.data(), UINT8_ACTIVATION, data.data(), FLOAT_ACTIVATION, bias.data(),
+                                  data_batch, data_channel, data_height, data_width);
+  QuantizedConvOpExecuteQuantized(conv1, mid_shuffled.data(), SHUFFLED_UINT8_ACTIVATION, data.data(),
+                                  FLOAT_ACTIVATION, bias.data(), data_batch, data_channel, data_height, data_width);
+  QuantizedConvOpFree(conv1);
+
+  std::vector<float> mid_dequantized(mid.size());
+  for (size_t i = 0; i < mid.size(); ++i) {
+    float expected = std::min(std::max(std::round(mid[i] / scale) + zero_point, 0.0f), 127.0f);
+    DOUBLES_EQUAL(expected, mid_q[i], 1.0);
+    mid_dequantized[i] = (static_cast<float>(mid_q[i]) - zero_point) * scale;
+  }
+
+  std::vector<float> out(pixels * filter_num), out_q(pixels * filter_num), out_shuffled(pixels * filter_num);
+  QuantizedConvOp* conv2 = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(conv2, layout, filter_num, mid_channel, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0,
+                                    SHUFFLE_CONV);
+  QuantizedConvOpSetupActivationQuantization(conv2, &scale, &zero_point, 1);
+  QuantizedConvOpInitWeight(conv2, weight2.data());
+  QuantizedConvOpExecute(conv2, out.data(), mid_dequantized.data(), bias.data(), data_batch, mid_channel,
+                         data_height, data_width);
+  QuantizedConvOpExecuteQuantized(conv2, out_q.data(), FLOAT_ACTIVATION, mid_q.data(), UINT8_ACTIVATION,
+                                  bias.data(), data_batch, mid_channel, data_height, data_width);
+  QuantizedConvOpExecuteQuantized(conv2, out_shuffled.data(), FLOAT_ACTIVATION, mid_shuffled.data(),
+                                  SHUFFLED_UINT8_ACTIVATION, bias.data(), data_batch, mid_channel, data_height,
+                                  data_width);
+  QuantizedConvOpFree(conv2);
+
+  for (size_t i = 0; i < out.size(); ++i) {
+    DOUBLES_EQUAL(out[i], out_q[i], 1e-3);
+    DOUBLES_EQUAL(out_q[i], out_shuffled[i], 1e-3);
+  }
+}
+
+void TestConvolutionPackedWeight(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                                 size_t group, size_t filter_num, size_t filter_size, LAYOUT layout,
+                                 CONV_ALGORITHM algo, CONV_ALGORITHM loaded_algo) {
+  const char* path = "test_conv_packed_weight.bin";
+  size_t out_height = GetConvOutSize(data_height, filter_size, 1, filter_size / 2, 1);
+  size_t out_width = GetConvOutSize(data_width, filter_size, 1, filter_size / 2, 1);
+  std::vector<float> weight(filter_num * data_channel / group * filter_size * filter_size);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(filter_num, 1.0f);
+  std::vector<float> data(data_batch * data_channel * data_height * data_width);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i * 11 % 23) / 23.0f;
+  }
+  std::vector<float> out(data_batch * filter_num * out_height * out_width);
+  std::vector<float> loaded_out(out.size());
+
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, group, filter_size, filter_size, 1, 1,
+                                    filter_size / 2, filter_size / 2, 1, 1, 0, algo);
+  CHECK(QuantizedConvOpSaveWeight(desc, path) != 0);
+  QuantizedConvOpInitWeight(desc, weight.data());
+  // AUTO_SELECT_CONV saves the algorithm its first Execute chose
+  QuantizedConvOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  CHECK(QuantizedConvOpSaveWeight(desc, path) == 0);
+  QuantizedConvOpFree(desc);
+
+  QuantizedConvOp* loaded = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(loaded, layout, filter_num, data_channel, group, filter_size, filter_size, 1, 1,
+                                    filter_size / 2, filter_size / 2, 1, 1, 0, loaded_algo);
+  CHECK(QuantizedConvOpLoadWeight(loaded, path) == 0);
+  QuantizedConvOpExecute(loaded, loaded_out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpFree(loaded);
+  for (size_t i = 0; i < out.size(); ++i) {
+    DOUBLES_EQUAL(out[i], loaded_out[i], 0);
+  }
+
+  // a file packed for other parameters is rejected; depthwise needs filter_num == group
+  QuantizedConvOp* other = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(other, layout, filter_num * 2, data_channel, group, filter_size, filter_size, 1, 1,
+                                    filter_size / 2, filter_size / 2, 1, 1, 0,
+                                    (algo == DEPTHWISE_CONV) ? AUTO_SELECT_CONV : algo);
+  CHECK(QuantizedConvOpLoadWeight(other, path) != 0);
+  QuantizedConvOpFree(other);
+  std::remove(path);
+}
+
+// Reads the choices recorded in a tuning database, in order.
+static std::vector<int> ReadTuningChoices(const char* path) {
+  FILE* file = fopen(path, "r");
+  char line[512];
+  std::vector<int> choices;
+  while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+    choices.push_back(atoi(strrchr(line, ' ') + 1));
+  }
+  if (file != NULL) {
+    fclose(file);
+  }
+  return choices;
+}
+
+void TestConvolutionAutoSelect(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                               size_t group, size_t filter_num, LAYOUT layout) {
+  const char* path = "test_conv_tuning.db";
+  std::remove(path);
+  CHECK(QuantizedSetTuningDatabase(path) == 0);
+  std::vector<float> weight(filter_num * data_channel / group * 9);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(filter_num, 0.5f);
+  size_t next_batch = data_batch + 1;
+  std::vector<float> data(next_batch * data_channel * data_height * data_width);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i * 11 % 23) / 23.0f;
+  }
+  size_t out_image = filter_num * GetConvOutSize(data_height, 3, 1, 1, 1) * GetConvOutSize(data_width, 3, 1, 1, 1);
+  size_t out_size = data_batch * out_image;
+  std::vector<float> tuned_out(out_size), cached_out(out_size), expected_out(out_size);
+  auto create = [&](CONV_ALGORITHM algo) {
+    QuantizedConvOp* desc = QuantizedConvOpCreate();
+    QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, group, 3, 3, 1, 1, 1, 1, 1, 1, 0, algo);
+    QuantizedConvOpInitWeight(desc, weight.data());
+    return desc;
+  };
+
+  // The first Execute times the candidates, a second op with the same parameters reuses the decision. Either keeps
+  // no more memory afterwards than an op set up with the chosen algorithm, besides the copy of the weight later
+  // shapes are tuned from; the record is the algorithm plus 16 times the LLC schedule SHUFFLE_CONV runs with.
+  std::vector<float>* outs[] = {&tuned_out, &cached_out, &expected_out};
+  QuantizedAllocatorStats stats[3];
+  int choice = -1;
+  for (size_t i = 0; i < 3; ++i) {
+    if (i == 2) {
+      std::vector<int> choices = ReadTuningChoices(path);
+      CHECK_EQUAL(1, choices.size());
+      choice = choices[0];
+      // WINOGRAD_CONV is not an AUTO_SELECT_CONV candidate
+      CHECK(choice % 16 == SHUFFLE_CONV || choice % 16 == DEPTHWISE_CONV);
+    }
+    QuantizedAllocator* allocator = QuantizedAllocatorCreate(DEFAULT_ALLOCATOR);
+    QuantizedBindAllocator(allocator);
+    QuantizedConvOp* desc = create((i == 2) ? static_cast<CONV_ALGORITHM>(choice % 16) : AUTO_SELECT_CONV);
+    QuantizedConvOpExecute(desc, outs[i]->data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                           data_width);
+    QuantizedBindAllocator(NULL);
+    QuantizedGetAllocatorStats(allocator, &stats[i]);
+    QuantizedConvOpFree(desc);
+    QuantizedAllocatorFree(allocator);
+  }
+  CHECK(stats[0].live_bytes <= stats[2].live_bytes + weight.size() * sizeof(float));
+  CHECK(stats[1].live_bytes <= stats[2].live_bytes + weight.size() * sizeof(float));
+  for (size_t i = 0; i < out_size; ++i) {
+    DOUBLES_EQUAL(expected_out[i], tuned_out[i], 0);
+    DOUBLES_EQUAL(expected_out[i], cached_out[i], 0);
+  }
+
+  // Another batch size is tuned on its own input and the first one keeps its decision.
+  std::vector<float> next_out(next_batch * out_image), next_expected(next_out.size());
+  QuantizedConvOp* desc = create(AUTO_SELECT_CONV);
+  QuantizedConvOpExecute(desc, cached_out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpExecute(desc, next_out.data(), data.data(), bias.data(), next_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpExecute(desc, cached_out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  QuantizedConvOpFree(desc);
+  std::vector<int> choices = ReadTuningChoices(path);
+  CHECK_EQUAL(2, choices.size());
+  CHECK_EQUAL(choice, choices[0]);
+  QuantizedConvOp* expected = create(static_cast<CONV_ALGORITHM>(choices[1] % 16));
+  QuantizedConvOpExecute(expected, next_expected.data(), data.data(), bias.data(), next_batch, data_channel,
+                         data_height, data_width);
+  QuantizedConvOpFree(expected);
+  for (size_t i = 0; i < out_size; ++i) {
+    DOUBLES_EQUAL(expected_out[i], cached_out[i], 0);
+  }
+  for (size_t i = 0; i < next_out.size(); ++i) {
+    DOUBLES_EQUAL(next_expected[i], next_out[i], 0);
+  }
+  CHECK(QuantizedSetTuningDatabase(NULL) == 0);
+  std::remove(path);
+}
+
 void TestConvolutionTensor(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width, size_t group,
                            size_t filter_num, size_t filter_height, size_t filter_width, size_t stride_h,
                            size_t stride_w, size_t pad_h, size_t pad_w, size_t dilation_h, size_t dilation_w,
@@ -158,6 +753,124 @@ TEST(CONVOLUTION, TEST_NCHW_CONVOLUTION_TENSOR) {
   TestConvolutionTensor(32, 128, 16, 16, 1, 1, 11, 11, 1, 1, 0, 0, 1, 1, NCHW);
 }
 
+TEST(CONVOLUTION, TEST_CONVOLUTION_WORKSPACE_REUSE) {
+  TestConvolutionWorkspaceReuse(3, 5, 3, 3, NHWC);
+  TestConvolutionWorkspaceReuse(32, 84, 3, 3, NHWC);
+  TestConvolutionWorkspaceReuse(3, 5, 3, 3, NCHW);
+  TestConvolutionWorkspaceReuse(32, 84, 1, 1, NCHW);
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_CONCURRENT) {
+  TestConvolutionConcurrent(3, 5, 3, 3, NHWC);
+  TestConvolutionConcurrent(32, 84, 3, 3, NHWC);
+  TestConvolutionConcurrent(3, 5, 3, 3, NCHW);
+  TestConvolutionConcurrent(32, 84, 1, 1, NCHW);
+}
+
+TEST(CONVOLUTION, TEST_WINOGRAD_CONVOLUTION) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestConvolutionWinograd(1, 1, 4, 4, 1, 0, layout, WINOGRAD_CONV);
+    TestConvolutionWinograd(1, 3, 7, 9, 5, 1, layout, WINOGRAD_CONV);
+    TestConvolutionWinograd(2, 32, 14, 14, 84, 1, layout, WINOGRAD_CONV);
+    TestConvolutionWinograd(3, 64, 13, 11, 64, 0, layout, AUTO_SELECT_CONV);
+  }
+}
+
+TEST(CONVOLUTION, TEST_1X1_CONVOLUTION) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestConvolution1x1(1, 3, 7, 9, 5, 1, layout);
+    TestConvolution1x1(2, 32, 14, 14, 84, 1, layout);
+    TestConvolution1x1(3, 67, 13, 11, 64, 2, layout);
+    TestConvolution1x1(1, 128, 15, 16, 33, 3, layout);
+  }
+}
+
+TEST(CONVOLUTION, TEST_DEPTHWISE_CONVOLUTION) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestConvolutionDepthwise(1, 3, 7, 9, 3, 3, 1, 1, layout, DEPTHWISE_CONV);
+    TestConvolutionDepthwise(2, 32, 14, 14, 3, 3, 2, 1, layout, DEPTHWISE_CONV);
+    TestConvolutionDepthwise(1, 100, 13, 11, 5, 5, 1, 2, layout, DEPTHWISE_CONV);
+    TestConvolutionDepthwise(3, 64, 10, 10, 3, 3, 1, 0, layout, AUTO_SELECT_CONV);
+    TestConvolutionDepthwise(1, 16, 9, 9, 3, 3, 1, 1, layout, SHUFFLE_CONV);
+  }
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_STATIC_QUANTIZATION) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  bool per_channel[] = {false, true};
+  for (auto layout : layouts) {
+    for (auto mode : per_channel) {
+      TestConvolutionStaticQuantization(1, 3, 7, 9, 1, 5, 3, 1, 1, layout, mode);
+      TestConvolutionStaticQuantization(2, 32, 14, 14, 1, 84, 3, 2, 1, layout, mode);
+      TestConvolutionStaticQuantization(1, 64, 13, 11, 1, 33, 1, 1, 0, layout, mode);
+      TestConvolutionStaticQuantization(2, 16, 10, 10, 2, 24, 3, 1, 1, layout, mode);
+    }
+  }
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_QUANTIZED_CHAIN) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestConvolutionQuantizedChain(1, 3, 7, 9, 5, 4, layout);
+    TestConvolutionQuantizedChain(2, 32, 14, 14, 84, 33, layout);
+    TestConvolutionQuantizedChain(1, 16, 13, 11, 64, 64, layout);
+  }
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_PACKED_WEIGHT) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestConvolutionPackedWeight(1, 3, 7, 9, 1, 5, 3, layout, SHUFFLE_CONV, SHUFFLE_CONV);
+    TestConvolutionPackedWeight(2, 32, 14, 14, 1, 84, 1, layout, SHUFFLE_CONV, SHUFFLE_CONV);
+    TestConvolutionPackedWeight(1, 16, 10, 10, 2, 24, 3, layout, SHUFFLE_CONV, SHUFFLE_CONV);
+    TestConvolutionPackedWeight(2, 16, 10, 10, 1, 24, 3, layout, WINOGRAD_CONV, WINOGRAD_CONV);
+    TestConvolutionPackedWeight(2, 16, 10, 10, 16, 16, 3, layout, DEPTHWISE_CONV, DEPTHWISE_CONV);
+    TestConvolutionPackedWeight(2, 16, 10, 10, 1, 24, 3, layout, AUTO_SELECT_CONV, AUTO_SELECT_CONV);
+    TestConvolutionPackedWeight(2, 16, 10, 10, 16, 16, 3, layout, AUTO_SELECT_CONV, AUTO_SELECT_CONV);
+    // AUTO_SELECT_CONV takes the algorithm of the file
+    TestConvolutionPackedWeight(2, 16, 10, 10, 1, 24, 3, layout, WINOGRAD_CONV, AUTO_SELECT_CONV);
+    TestConvolutionPackedWeight(2, 16, 10, 10, 16, 16, 3, layout, SHUFFLE_CONV, AUTO_SELECT_CONV);
+  }
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_AUTO_SELECT) {
+  TestConvolutionAutoSelect(1, 40, 13, 11, 1, 36, NHWC);
+  TestConvolutionAutoSelect(2, 24, 9, 10, 24, 24, NCHW);
+  TestConvolutionAutoSelect(1, 8, 7, 5, 1, 12, NCHW);
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_FUSION) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  FUSION_MASK masks[] = {CONV_RELU_FUSION, CONV_BN_FUSION, CONV_BN_RELU_FUSION, CONV_RELU_BN_FUSION};
+  for (auto layout : layouts) {
+    for (auto mask : masks) {
+      TestConvolutionFusion(1, 1, 10, 10, 1, 1, 1, layout, mask);
+      TestConvolutionFusion(1, 3, 10, 10, 5, 3, 3, layout, mask);
+      TestConvolutionFusion(2, 32, 16, 16, 84, 3, 3, layout, mask);
+      TestConvolutionFusion(1, 64, 19, 19, 64, 1, 1, layout, mask);
+      TestConvolutionFusion(1, 3, 10, 10, 5, 3, 3, layout, mask, 5);
+      TestConvolutionFusion(1, 3, 10, 10, 84, 3, 3, layout, mask, 5);
+    }
+  }
+}
+
+TEST(CONVOLUTION, TEST_CONVOLUTION_THREAD_POOL) {
+  CHECK(QuantizedSetThreadingBackend(THREAD_POOL_BACKEND, 4, 0) == 0);
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestConvolutionDesc(2, 128, 16, 16, 1, 1, 3, 3, 1, 1, 0, 0, 1, 1, layout);
+    TestConvolutionWinograd(2, 32, 14, 14, 84, 1, layout, WINOGRAD_CONV);
+    TestConvolution1x1(3, 67, 13, 11, 64, 2, layout);
+    TestConvolutionDepthwise(2, 32, 14, 14, 3, 3, 2, 1, layout, DEPTHWISE_CONV);
+    TestConvolutionStaticQuantization(2, 16, 10, 10, 2, 24, 3, 1, 1, layout, true);
+    TestConvolutionConcurrent(32, 84, 3, 3, layout);
+  }
+  CHECK(QuantizedSetThreadingBackend(OPENMP_BACKEND, 0, 0) == 0);
+}
+
 int main(int argc, char** argv) {
   return RUN_ALL_TESTS(argc, argv);
 }
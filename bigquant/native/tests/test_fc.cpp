@@ -1,8 +1,12 @@
 #include <iostream>
 #include <array>
 #include <vector>
+#include <thread>
+#include <atomic>
 #include <algorithm>
+#include <chrono>
 #include "bigquant.h"
+#include "fc_fixture.h"
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/CommandLineTestRunner.h"
 
@@ -43,6 +47,332 @@ void TestFC(size_t data_batch, size_t data_channel, size_t filter_num) {
   }
 }
 
+void TestFCAccuracy(size_t data_batch, size_t data_channel, size_t filter_num, LAYOUT layout) {
+  FCFixture fc(data_batch, data_channel, filter_num);
+  std::vector<float> bias(filter_num);
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 5);
+  }
+  std::vector<float> out(data_batch * filter_num);
+
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, layout, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, fc.weight_.data());
+  QuantizedFCOpExecute(desc, out.data(), fc.data_.data(), bias.data(), data_batch, data_channel);
+  QuantizedFCOpFree(desc);
+
+  for (size_t b = 0; b < data_batch; ++b) {
+    for (size_t c = 0; c < filter_num; ++c) {
+      DOUBLES_EQUAL(fc.Reference(b, c, bias[c]), out[b * filter_num + c], 0.02 * data_channel / 6.0 + 1e-3);
+    }
+  }
+}
+
+void TestFCStaticQuantization(size_t data_batch, size_t data_channel, size_t filter_num, bool per_channel) {
+  FCFixture fc(data_batch, data_channel, filter_num);
+  std::vector<float> bias(filter_num);
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 5);
+  }
+  std::vector<float> &data = fc.data_;
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = (data[i] - 0.25f) * (1 + i % data_channel % 3);
+  }
+  // calibrate on the data itself; the range always includes 0
+  size_t count = per_channel ? data_channel : 1;
+  std::vector<float> min(count, 0.0f), max(count, 0.0f), scale(count);
+  std::vector<uint8_t> zero_point(count);
+  for (size_t i = 0; i < data.size(); ++i) {
+    size_t c = per_channel ? i % data_channel : 0;
+    min[c] = std::min(min[c], data[i]);
+    max[c] = std::max(max[c], data[i]);
+  }
+  for (size_t c = 0; c < count; ++c) {
+    scale[c] = (max[c] - min[c]) / 127.0f;
+    zero_point[c] = static_cast<uint8_t>(std::round(-min[c] / scale[c]));
+  }
+  std::vector<float> out(data_batch * filter_num);
+
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpSetupActivationQuantization(desc, scale.data(), zero_point.data(), count);
+  QuantizedFCOpInitWeight(desc, fc.weight_.data());
+  QuantizedFCOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel);
+  QuantizedFCOpFree(desc);
+
+  for (size_t b = 0; b < data_batch; ++b) {
+    for (size_t c = 0; c < filter_num; ++c) {
+      DOUBLES_EQUAL(fc.Reference(b, c, bias[c]), out[b * filter_num + c], 0.02 * data_channel / 6.0 + 1e-3);
+    }
+  }
+}
+
+// fc1 writes uint8, plain and shuffled, which fc2 calibrated with the same parameters consumes.
+void TestFCQuantizedChain(size_t data_batch, size_t data_channel, size_t mid_channel, size_t filter_num) {
+  FCFixture fc(data_batch, data_channel, mid_channel);
+  std::vector<float> &weight1 = fc.weight_, weight2(filter_num * mid_channel);
+  for (size_t i = 0; i < weight2.size(); ++i) {
+    weight2[i] = static_cast<float>(static_cast<int>(i * 5 % 11) - 5) / 5.0f;
+  }
+  std::vector<float> bias(std::max(mid_channel, filter_num));
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 5);
+  }
+  std::vector<float> &data = fc.data_;
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] -= 0.25f;
+  }
+
+  // calibrate the intermediate tensor on the float result of fc1
+  std::vector<float> mid(data_batch * mid_channel);
+  QuantizedFCOp *fc1 = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(fc1, NCHW, mid_channel, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(fc1, weight1.data());
+  QuantizedFCOpExecute(fc1, mid.data(), data.data(), bias.data(), data_batch, data_channel);
+  QuantizedFCOpFree(fc1);
+  float min = 0.0f, max = 0.0f;
+  for (auto value : mid) {
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+  float scale = (max - min) / 127.0f;
+  uint8_t zero_point = static_cast<uint8_t>(std::round(-min / scale));
+
+  std::vector<uint8_t> mid_q(mid.size());
+  std::vector<uint8_t> mid_shuffled(QuantizedShuffledActivationSize(data_batch, mid_channel));
+  fc1 = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(fc1, NCHW, mid_channel, data_channel, SHUFFLE_FC);
+  QuantizedFCOpSetupOutputQuantization(fc1, &scale, &zero_point, 1);
+  QuantizedFCOpInitWeight(fc1, weight1.data());
+  QuantizedFCOpExecuteQuantized(fc1, mid_q.data(), UINT8_ACTIVATION, data.data(), FLOAT_ACTIVATION, bias.data(),
+                                data_batch, data_channel);
+  QuantizedFCOpExecuteQuantized(fc1, mid_shuffled.data(), SHUFFLED_UINT8_ACTIVATION, data.data(), FLOAT_ACTIVATION,
+                                bias.data(), data_batch, data_channel);
+  QuantizedFCOpFree(fc1);
+
+  std::vector<float> mid_dequantized(mid.size());
+  for (size_t i = 0; i < mid.size(); ++i) {
+    float expected = std::min(std::max(std::round(mid[i] / scale) + zero_point, 0.0f), 127.0f);
+    DOUBLES_EQUAL(expected, mid_q[i], 1.0);
+    mid_dequantized[i] = (static_cast<float>(mid_q[i]) - zero_point) * scale;
+  }
+
+  std::vector<float> out(data_batch * filter_num), out_q(out.size()), out_shuffled(out.size());
+  QuantizedFCOp *fc2 = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(fc2, NCHW, filter_num, mid_channel, SHUFFLE_FC);
+  QuantizedFCOpSetupActivationQuantization(fc2, &scale, &zero_point, 1);
+  QuantizedFCOpInitWeight(fc2, weight2.data());
+  QuantizedFCOpExecute(fc2, out.data(), mid_dequantized.data(), bias.data(), data_batch, mid_channel);
+  QuantizedFCOpExecuteQuantized(fc2, out_q.data(), FLOAT_ACTIVATION, mid_q.data(), UINT8_ACTIVATION, bias.data(),
+                                data_batch, mid_channel);
+  QuantizedFCOpExecuteQuantized(fc2, out_shuffled.data(), FLOAT_ACTIVATION, mid_shuffled.data(),
+                                SHUFFLED_UINT8_ACTIVATION, bias.data(), data_batch, mid_channel);
+  QuantizedFCOpFree(fc2);
+
+  for (size_t i = 0; i < out.size(); ++i) {
+    DOUBLES_EQUAL(out[i], out_q[i], 1e-3);
+    DOUBLES_EQUAL(out[i], out_shuffled[i], 1e-3);
+  }
+}
+
+void TestFCPackedWeight(size_t data_batch, size_t data_channel, size_t filter_num) {
+  const char *path = "test_fc_packed_weight.bin";
+  FCFixture fc(data_batch, data_channel, filter_num);
+  std::vector<float> &weight = fc.weight_, &data = fc.data_;
+  std::vector<float> out(data_batch * filter_num), loaded_out(out.size());
+
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  CHECK(QuantizedFCOpSaveWeight(desc, path) == 0);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  QuantizedFCOpFree(desc);
+
+  QuantizedFCOp *loaded = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(loaded, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  CHECK(QuantizedFCOpLoadWeight(loaded, path) == 0);
+  QuantizedFCOpExecute(loaded, loaded_out.data(), data.data(), NULL, data_batch, data_channel);
+  QuantizedFCOpFree(loaded);
+  for (size_t i = 0; i < out.size(); ++i) {
+    DOUBLES_EQUAL(out[i], loaded_out[i], 0);
+  }
+
+  // a file packed for other parameters is rejected
+  QuantizedFCOp *other = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(other, NCHW, filter_num, data_channel + 1, SHUFFLE_FC);
+  CHECK(QuantizedFCOpLoadWeight(other, path) != 0);
+  QuantizedFCOpFree(other);
+  std::remove(path);
+}
+
+void TestFCAutoSelect(size_t data_batch, size_t data_channel, size_t filter_num) {
+  const char *path = "test_fc_tuning.db";
+  std::remove(path);
+  CHECK(QuantizedSetTuningDatabase(path) == 0);
+  FCFixture fc(data_batch, data_channel, filter_num);
+  std::vector<float> &weight = fc.weight_, &data = fc.data_;
+  std::vector<float> tuned_out(data_batch * filter_num), cached_out(tuned_out.size());
+
+  std::vector<float> *outs[] = {&tuned_out, &cached_out};
+  for (auto out : outs) {
+    QuantizedFCOp *desc = QuantizedFCOpCreate();
+    QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, AUTO_SELECT_FC);
+    QuantizedFCOpInitWeight(desc, weight.data());
+    QuantizedFCOpExecute(desc, out->data(), data.data(), NULL, data_batch, data_channel);
+    QuantizedFCOpFree(desc);
+  }
+  std::vector<float> expected_out = fc.ShuffleOut();
+
+  // Concurrent first callers of another op wait for one of them to decide, so its parameters add a single record.
+  FCFixture other(data_batch, data_channel, filter_num + 1);
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num + 1, data_channel, AUTO_SELECT_FC);
+  QuantizedFCOpInitWeight(desc, other.weight_.data());
+  std::vector<std::vector<float>> other_outs(4, std::vector<float>(data_batch * (filter_num + 1)));
+  std::vector<std::thread> threads;
+  std::atomic<size_t> ready(0);
+  for (size_t t = 0; t < other_outs.size(); ++t) {
+    threads.push_back(std::thread([&, t]() {
+      for (++ready; ready.load() < other_outs.size();) {
+      }
+      QuantizedFCOpExecute(desc, other_outs[t].data(), other.data_.data(), NULL, data_batch, data_channel);
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  QuantizedFCOpFree(desc);
+
+  FILE *file = fopen(path, "r");
+  CHECK(file != NULL);
+  char line[512];
+  size_t records = 0;
+  while (fgets(line, sizeof(line), file) != NULL) {
+    CHECK(strncmp(line, "fc:", 3) == 0);
+    ++records;
+  }
+  fclose(file);
+  CHECK_EQUAL(2, records);
+  // the GEMV and GEMM paths quantize identically and differ only in the float accumulation order
+  for (size_t i = 0; i < tuned_out.size(); ++i) {
+    DOUBLES_EQUAL(expected_out[i], tuned_out[i], 1e-4 * data_channel);
+    DOUBLES_EQUAL(tuned_out[i], cached_out[i], 0);
+  }
+  for (size_t t = 1; t < other_outs.size(); ++t) {
+    for (size_t i = 0; i < other_outs[t].size(); ++i) {
+      DOUBLES_EQUAL(other_outs[0][i], other_outs[t][i], 0);
+    }
+  }
+  CHECK(QuantizedSetTuningDatabase(NULL) == 0);
+  std::remove(path);
+}
+
+void TestFCConcurrent(size_t data_channel, size_t filter_num) {
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  std::vector<float> weight(filter_num * data_channel, 1.0f);
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  // every thread runs its own batch size on the shared op
+  const size_t thread_num = 4;
+  std::vector<std::vector<float> > outs(thread_num);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&, t] {
+      size_t batch = 1 + 5 * t;
+      std::vector<float> data(batch * data_channel, 1.0f);
+      outs[t].resize(batch * filter_num);
+      for (size_t iter = 0; iter < 8; ++iter) {
+        QuantizedFCOpExecute(desc, outs[t].data(), data.data(), NULL, batch, data_channel);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  QuantizedFCOpReleaseWorkspace(desc);
+  QuantizedFCOpFree(desc);
+  for (size_t t = 0; t < thread_num; ++t) {
+    for (auto iter = outs[t].begin(); iter < outs[t].end(); ++iter) {
+      DOUBLES_EQUAL(*iter, data_channel, 1e-6);
+    }
+  }
+}
+
+// The backend switches between pools and OpenMP while other threads execute the op.
+void TestFCReconfigure(size_t data_channel, size_t filter_num) {
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  std::vector<float> weight(filter_num * data_channel, 1.0f);
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  const size_t thread_num = 2;
+  std::vector<std::vector<float> > outs(thread_num);
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_num; ++t) {
+    threads.push_back(std::thread([&, t] {
+      size_t batch = 1 + 7 * t;
+      std::vector<float> data(batch * data_channel, 1.0f);
+      outs[t].resize(batch * filter_num);
+      while (!done) {
+        QuantizedFCOpExecute(desc, outs[t].data(), data.data(), NULL, batch, data_channel);
+      }
+    }));
+  }
+  for (size_t i = 0; i < 16; ++i) {
+    CHECK(QuantizedSetThreadingBackend((i % 4 == 3) ? OPENMP_BACKEND : THREAD_POOL_BACKEND, 2 + i % 3, 0) == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  QuantizedFCOpFree(desc);
+  for (size_t t = 0; t < thread_num; ++t) {
+    for (auto iter = outs[t].begin(); iter < outs[t].end(); ++iter) {
+      DOUBLES_EQUAL(*iter, data_channel, 1e-6);
+    }
+  }
+}
+
+// Two instances with a context each run side by side, one through ExecuteInContext and one bound to its thread.
+void TestFCExecutionContext(size_t data_batch, size_t data_channel, size_t filter_num) {
+  FCFixture fc(data_batch, data_channel, filter_num);
+  std::vector<float> &weight = fc.weight_, &data = fc.data_;
+  std::vector<float> expected = fc.ShuffleOut();
+
+  int cpus[] = {0};
+  QuantizedExecutionContext *contexts[] = {QuantizedExecutionContextCreate(3, cpus, 1),
+                                           QuantizedExecutionContextCreate(2, NULL, 0)};
+  std::vector<std::vector<float> > outs(2, std::vector<float>(expected.size()));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 2; ++t) {
+    CHECK(contexts[t] != NULL);
+    threads.push_back(std::thread([&, t] {
+      QuantizedFCOp *instance = QuantizedFCOpCreate();
+      QuantizedFCOpSetupFCParameter(instance, NCHW, filter_num, data_channel, SHUFFLE_FC);
+      QuantizedFCOpInitWeight(instance, weight.data());
+      if (t == 0) {
+        QuantizedFCOpExecuteInContext(instance, contexts[t], outs[t].data(), data.data(), NULL, data_batch,
+                                      data_channel);
+      } else {
+        QuantizedBindExecutionContext(contexts[t]);
+        QuantizedFCOpExecute(instance, outs[t].data(), data.data(), NULL, data_batch, data_channel);
+        QuantizedBindExecutionContext(NULL);
+      }
+      QuantizedFCOpFree(instance);
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < 2; ++t) {
+    QuantizedExecutionContextFree(contexts[t]);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      DOUBLES_EQUAL(expected[i], outs[t][i], 1e-5 * data_channel);
+    }
+  }
+}
+
 TEST_GROUP(FC){
 
 };
@@ -60,6 +390,84 @@ TEST(FC, TEST_FC) {
   TestFC(128, 200, 10001);
 }
 
+TEST(FC, TEST_FC_SMALL_BATCH) {
+  LAYOUT layouts[] = {NCHW, NHWC};
+  for (auto layout : layouts) {
+    for (size_t batch = 1; batch <= 9; ++batch) {
+      TestFCAccuracy(batch, 1, 1, layout);
+      TestFCAccuracy(batch, 37, 5, layout);
+      TestFCAccuracy(batch, 300, 131, layout);
+    }
+  }
+}
+
+TEST(FC, TEST_FC_STATIC_QUANTIZATION) {
+  bool per_channel[] = {false, true};
+  for (auto mode : per_channel) {
+    TestFCStaticQuantization(1, 37, 5, mode);
+    TestFCStaticQuantization(3, 300, 131, mode);
+    TestFCStaticQuantization(16, 300, 131, mode);
+    TestFCStaticQuantization(33, 1023, 64, mode);
+  }
+}
+
+TEST(FC, TEST_FC_QUANTIZED_CHAIN) {
+  TestFCQuantizedChain(1, 37, 5, 3);
+  TestFCQuantizedChain(3, 300, 131, 64);
+  TestFCQuantizedChain(16, 300, 131, 17);
+  TestFCQuantizedChain(33, 1023, 64, 128);
+}
+
+// few output tiles over a long K, which split along K when more threads than tiles run
+TEST(FC, TEST_FC_SPLIT_K) {
+  LAYOUT layouts[] = {NCHW, NHWC};
+  for (auto layout : layouts) {
+    TestFCAccuracy(1, 25088, 10, layout);
+    TestFCAccuracy(3, 8192, 5, layout);
+    TestFCAccuracy(8, 4099, 16, layout);
+  }
+  TestFCStaticQuantization(1, 4096, 10, true);
+  TestFCQuantizedChain(2, 8192, 12, 5);
+}
+
+TEST(FC, TEST_FC_PACKED_WEIGHT) {
+  TestFCPackedWeight(1, 37, 5);
+  TestFCPackedWeight(3, 300, 131);
+  TestFCPackedWeight(33, 1023, 64);
+}
+
+TEST(FC, TEST_FC_AUTO_SELECT) {
+  TestFCAutoSelect(1, 515, 37);
+  TestFCAutoSelect(1, 96, 129);
+}
+
+TEST(FC, TEST_FC_CONCURRENT) {
+  TestFCConcurrent(128, 128);
+  TestFCConcurrent(1023, 1024);
+}
+
+TEST(FC, TEST_FC_THREAD_POOL) {
+  CHECK(QuantizedSetThreadingBackend(THREAD_POOL_BACKEND, 4, 0) == 0);
+  TestFCAccuracy(3, 300, 131, NCHW);
+  TestFCAccuracy(8, 4099, 16, NHWC);
+  TestFCQuantizedChain(16, 300, 131, 17);
+  TestFCConcurrent(1023, 1024);
+  CHECK(QuantizedSetThreadingBackend(THREAD_POOL_BACKEND, 4, 2) == 0);
+  TestFCAccuracy(33, 1023, 64, NCHW);
+  TestFCConcurrent(128, 128);
+  TestFCReconfigure(1023, 256);
+  CHECK(QuantizedSetThreadingBackend(static_cast<THREADING_BACKEND>(2), 4, 0) != 0);
+  CHECK(QuantizedSetThreadingBackend(OPENMP_BACKEND, 0, 0) == 0);
+}
+
+TEST(FC, TEST_FC_EXECUTION_CONTEXT) {
+  TestFCExecutionContext(1, 300, 131);
+  TestFCExecutionContext(33, 1023, 64);
+  TestFCExecutionContext(64, 4096, 256);
+  int invalid_cpus[] = {-1};
+  CHECK(QuantizedExecutionContextCreate(2, invalid_cpus, 1) == NULL);
+}
+
 int main(int argc, char **argv) {
   return RUN_ALL_TESTS(argc, argv);
 }
@@ -248,6 +248,61 @@ TEST(GEMM, RandMixPrecisionGEMM) {
   }
 }
 
+TEST(GEMM, GemmPlan) {
+  std::vector<std::tuple<size_t, size_t, size_t>> data;
+  data.push_back(std::move(std::make_tuple(8, 8, 8)));
+  data.push_back(std::move(std::make_tuple(64, 3136, 64)));
+  data.push_back(std::move(std::make_tuple(1024, 8, 1024)));
+  data.push_back(std::move(std::make_tuple(4096, 4096, 4096)));
+  data.push_back(std::move(std::make_tuple(8, 8, 16384)));
+  data.push_back(std::move(std::make_tuple(512, 56, 4608)));
+  data.push_back(std::move(std::make_tuple(2048, 56, 512)));
+  for (auto &item : data) {
+    size_t m = std::get<0>(item);
+    size_t n = std::get<1>(item);
+    size_t k = std::get<2>(item);
+    for (auto schedule : {LLC_SCHEDULE_EXCLUSIVE, LLC_SCHEDULE_SHARED}) {
+      GemmPlan plan = MakeGemmPlan<4, 8, 8>(m, n, k, schedule);
+      CHECK(plan.schedule_ == schedule);
+      CHECK(plan.Matches(m, n, k));
+      CHECK(!plan.Matches(m, n + 8, k));
+      CHECK(plan.mltn_ == (m < n));
+      CHECK(plan.blocks_[0] == (plan.mltn_ ? n : m));
+      CHECK(plan.blocks_[1] == (plan.mltn_ ? m : n));
+      CHECK(plan.blocks_[8] == (plan.mltn_ ? 8 : 4));
+      CHECK(plan.blocks_[9] == (plan.mltn_ ? 4 : 8));
+      // every level is a multiple of the tile, so the tile loops cover each block exactly
+      for (size_t level = 2; level < 8; ++level) {
+        CHECK(plan.blocks_[level] > 0);
+        CHECK(plan.blocks_[level] % plan.blocks_[8 + level % 2] == 0);
+      }
+      for (size_t level = 4; level < 8; ++level) {
+        CHECK(plan.blocks_[level] <= plan.blocks_[level - 2]);
+      }
+      CHECK(plan.L3BlockNum() >= 1);
+      // enough tasks for every thread, unless each task is already a single tile
+      size_t level = (schedule == LLC_SCHEDULE_SHARED) ? 4 : 2;
+      CHECK(plan.ParallelTasks() >= GEMM_TASKS_PER_THREAD * plan.threads_num_ ||
+            (plan.blocks_[level] == plan.blocks_[8] && plan.blocks_[level + 1] == plan.blocks_[9]));
+      if (plan.k_slices_ > 1) {
+        CHECK(plan.k_slice_ % 8 == 0);
+        CHECK((plan.k_slices_ - 1) * plan.k_slice_ < k);
+        CHECK(plan.k_slices_ * plan.k_slice_ >= k);
+      }
+    }
+    // both schedules visit every tile exactly once
+    for (auto schedule : {LLC_SCHEDULE_EXCLUSIVE, LLC_SCHEDULE_SHARED}) {
+      GemmPlan plan = MakeGemmPlan<4, 8, 8>(m, n, k, schedule);
+      std::vector<int> visits(m / 4 * (n / 8), 0);
+      shuffle::ForEachGemmTile(plan, [&](size_t i, size_t j) {
+#pragma omp atomic
+        ++visits[i / 4 * (n / 8) + j / 8];
+      });
+      CHECK(std::count(visits.begin(), visits.end(), 1) == static_cast<long>(visits.size()));
+    }
+  }
+}
+
 int main(int argc, char** argv) {
   return RUN_ALL_TESTS(argc, argv);
 }
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <set>
+#include <cstdlib>
+#include "bigquant.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+// Threads that ran a TRACE_OP of op among the records traced since tracing was enabled.
+static size_t TracedOpThreads(const void* op) {
+  std::vector<QuantizedTraceRecord> records(1 << 16);
+  records.resize(QuantizedTraceFetch(records.data(), records.size()));
+  std::set<uint32_t> threads;
+  for (auto& record : records) {
+    if (record.phase == TRACE_OP && record.op == reinterpret_cast<uintptr_t>(op)) {
+      threads.insert(record.thread);
+    }
+  }
+  return threads.size();
+}
+
+// A batch runs as one slice of images per team against the weight replica of the team; the images come out as they
+// do one at a time, which stays on the calling thread, up to the float rounding of GEMMs blocked for another width.
+// Two callers run their batches at the same time.
+void TestNumaConvolution(size_t data_batch, size_t data_channel, size_t data_height, size_t data_width,
+                         size_t filter_num, size_t filter_size, LAYOUT layout, CONV_ALGORITHM algo) {
+  // stride 1 and same padding
+  size_t pad = filter_size / 2;
+  size_t out_image = filter_num * data_height * data_width;
+  size_t data_image = data_channel * data_height * data_width;
+  std::vector<float> weight(filter_num * data_channel * filter_size * filter_size);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 17) - 8) / 8.0f;
+  }
+  std::vector<float> bias(filter_num, 0.5f);
+  std::vector<float> data(data_batch * data_image);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i * 11 % 23) / 23.0f;
+  }
+  QuantizedConvOp* desc = QuantizedConvOpCreate();
+  QuantizedConvOpSetupConvParameter(desc, layout, filter_num, data_channel, 1, filter_size, filter_size, 1, 1, pad,
+                                    pad, 1, 1, 0, algo);
+  QuantizedConvOpInitWeight(desc, weight.data());
+
+  std::vector<float> expected(data_batch * out_image);
+  for (size_t b = 0; b < data_batch; ++b) {
+    QuantizedConvOpExecute(desc, expected.data() + b * out_image, data.data() + b * data_image, bias.data(), 1,
+                           data_channel, data_height, data_width);
+  }
+  std::vector<float> out(expected.size());
+  QuantizedTraceEnable(1024);
+  QuantizedConvOpExecute(desc, out.data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                         data_width);
+  CHECK_EQUAL(3, TracedOpThreads(desc));
+  QuantizedTraceEnable(0);
+  for (size_t i = 0; i < out.size(); ++i) {
+    DOUBLES_EQUAL(expected[i], out[i], 1e-5);
+  }
+
+  std::vector<std::vector<float>> outs(2, std::vector<float>(expected.size()));
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < outs.size(); ++t) {
+    threads.push_back(std::thread([&, t]() {
+      for (size_t r = 0; r < 4; ++r) {
+        QuantizedConvOpExecute(desc, outs[t].data(), data.data(), bias.data(), data_batch, data_channel, data_height,
+                               data_width);
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  QuantizedConvOpFree(desc);
+  for (size_t t = 0; t < outs.size(); ++t) {
+    for (size_t i = 0; i < out.size(); ++i) {
+      DOUBLES_EQUAL(out[i], outs[t][i], 0);
+    }
+  }
+}
+
+void TestNumaFC(size_t data_batch, size_t data_channel, size_t filter_num) {
+  std::vector<float> weight(filter_num * data_channel);
+  for (size_t i = 0; i < weight.size(); ++i) {
+    weight[i] = static_cast<float>(static_cast<int>(i * 7 % 13) - 6) / 6.0f;
+  }
+  std::vector<float> data(data_batch * data_channel);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<float>(i * 5 % 11) / 11.0f;
+  }
+  QuantizedFCOp* desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  std::vector<float> expected(data_batch * filter_num), out(expected.size());
+  for (size_t b = 0; b < data_batch; ++b) {
+    QuantizedFCOpExecute(desc, expected.data() + b * filter_num, data.data() + b * data_channel, NULL, 1,
+                         data_channel);
+  }
+  QuantizedTraceEnable(1024);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  CHECK_EQUAL(3, TracedOpThreads(desc));
+  QuantizedTraceEnable(0);
+  QuantizedFCOpFree(desc);
+  // rows quantize the same alone and in a slice; the GEMV and GEMM paths differ only in the float accumulation order
+  for (size_t i = 0; i < out.size(); ++i) {
+    DOUBLES_EQUAL(expected[i], out[i], 1e-4 * data_channel);
+  }
+}
+
+TEST_GROUP(NUMA){};
+
+TEST(NUMA, TEST_NUMA_CONVOLUTION) {
+  LAYOUT layouts[] = {NHWC, NCHW};
+  for (auto layout : layouts) {
+    TestNumaConvolution(3, 16, 10, 10, 24, 3, layout, SHUFFLE_CONV);
+    TestNumaConvolution(2, 32, 7, 9, 64, 1, layout, SHUFFLE_CONV);
+    TestNumaConvolution(5, 16, 10, 10, 24, 3, layout, AUTO_SELECT_CONV);
+  }
+}
+
+TEST(NUMA, TEST_NUMA_FC) {
+  TestNumaFC(3, 300, 131);
+  TestNumaFC(33, 1023, 64);
+}
+
+// Splits this machine into two teams, whatever its NUMA nodes, before the first op runs.
+int main(int argc, char** argv) {
+  setenv("BIGQUANT_NUMA_TEAMS", "2", 1);
+  return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <dirent.h>
+#include <stdint.h>
+#include "bigquant.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+// Counts two runs of an FC; hosts without PMU access still count the CPU time.
+void TestFCPerfCounters(size_t data_batch, size_t data_channel, size_t filter_num) {
+  std::vector<float> weight(filter_num * data_channel, 0.5f), data(data_batch * data_channel, 1.0f);
+  std::vector<float> out(data_batch * filter_num);
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  if (QuantizedPerfCountersEnable(1) != 0) {
+    QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+    CHECK(QuantizedPerfCountersFetch(NULL, 0) == 0);
+    QuantizedFCOpFree(desc);
+    return;
+  }
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  std::vector<QuantizedPerfCounterRecord> records(QuantizedPerfCountersFetch(NULL, 0));
+  CHECK(QuantizedPerfCountersFetch(records.data(), records.size()) == records.size());
+  QuantizedPerfCounterRecord totals[TRACE_EPILOGUE + 1] = {};
+  for (auto &record : records) {
+    if (record.op == reinterpret_cast<uintptr_t>(desc) && record.phase <= TRACE_EPILOGUE) {
+      totals[record.phase] = record;
+    }
+  }
+  CHECK(totals[TRACE_OP].calls == 2);
+  CHECK(totals[TRACE_IM2COL].calls == 2);
+  CHECK(totals[TRACE_GEMM].calls == 2);
+  CHECK(totals[TRACE_OP].cpu_ns > 0);
+  CHECK(totals[TRACE_GEMM].cpu_ns <= totals[TRACE_OP].cpu_ns);
+  if (totals[TRACE_OP].cycles != UINT64_MAX) {
+    CHECK(totals[TRACE_OP].cycles > 0);
+    CHECK(totals[TRACE_GEMM].cycles <= totals[TRACE_OP].cycles);
+  }
+  if (totals[TRACE_OP].instructions != UINT64_MAX) {
+    CHECK(totals[TRACE_GEMM].instructions >= data_batch * data_channel * filter_num / 64);
+  }
+
+  QuantizedPerfCountersReset();
+  CHECK(QuantizedPerfCountersFetch(NULL, 0) == 0);
+  CHECK(QuantizedPerfCountersEnable(0) == 0);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  CHECK(QuantizedPerfCountersFetch(NULL, 0) == 0);
+  QuantizedFCOpFree(desc);
+}
+
+static size_t OpenFiles() {
+  size_t files = 0;
+  DIR *dir = opendir("/proc/self/fd");
+  for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    ++files;
+  }
+  closedir(dir);
+  return files;
+}
+
+// Threads that run an op one after the other each count in a group of their own, which closes when they exit. The
+// loops of the op run on the calling thread only, so no other thread opens counters meanwhile.
+void TestFCPerfCountersThreadExit(size_t data_batch, size_t data_channel, size_t filter_num) {
+  std::vector<float> weight(filter_num * data_channel, 0.5f), data(data_batch * data_channel, 1.0f);
+  std::vector<float> out(data_batch * filter_num);
+  CHECK(QuantizedSetThreadingBackend(THREAD_POOL_BACKEND, 1, 0) == 0);
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  if (QuantizedPerfCountersEnable(1) == 0) {
+    size_t files = OpenFiles();
+    for (size_t t = 0; t < 8; ++t) {
+      std::thread([&] { QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel); }).join();
+    }
+    CHECK(OpenFiles() == files);
+    std::vector<QuantizedPerfCounterRecord> records(QuantizedPerfCountersFetch(NULL, 0));
+    QuantizedPerfCountersFetch(records.data(), records.size());
+    size_t calls = 0;
+    for (auto &record : records) {
+      calls += (record.op == reinterpret_cast<uintptr_t>(desc) && record.phase == TRACE_OP) ? record.calls : 0;
+    }
+    CHECK(calls == 8);
+    CHECK(QuantizedPerfCountersEnable(0) == 0);
+  }
+  QuantizedFCOpFree(desc);
+  CHECK(QuantizedSetThreadingBackend(OPENMP_BACKEND, 0, 0) == 0);
+}
+
+TEST_GROUP(PERF_COUNTERS){
+
+};
+
+TEST(PERF_COUNTERS, TEST_PERF_COUNTERS) {
+  TestFCPerfCounters(3, 300, 131);
+  TestFCPerfCounters(64, 4096, 256);
+}
+
+TEST(PERF_COUNTERS, TEST_PERF_COUNTERS_THREAD_EXIT) {
+  TestFCPerfCountersThreadExit(3, 300, 131);
+}
+
+int main(int argc, char **argv) {
+  return RUN_ALL_TESTS(argc, argv);
+}
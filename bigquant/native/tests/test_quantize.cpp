@@ -6,6 +6,7 @@
 #include "../base.h"
 #include "../common.h"
 #include "../ops/ops.h"
+#include "../model.h"
 #include "CppUTest/TestHarness.h"
 #include "CppUTest/CommandLineTestRunner.h"
 
@@ -225,6 +226,102 @@ TEST(Quantize, PADQuantizeShuffle2DInt8) {
   }
 }
 
+// Rows pinned to [-127, 127] quantize at scale 1, so that every other value is a half and has to round away from zero.
+template <size_t m_block, size_t n_block>
+void TestPadQuantizeShuffle2DRounding(size_t m, size_t n) {
+  size_t pad_m = GetAlignmentLength(m, m_block);
+  size_t pad_n = GetAlignmentLength(n, n_block);
+  std::vector<float> src(m * n);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = static_cast<float>(static_cast<int>(i * 37 % 253) - 126) / 2.0f;
+  }
+  for (size_t i = 0; i < m; ++i) {
+    src[i * n] = -127.0f;
+    src[i * n + 1] = 127.0f;
+  }
+  std::vector<int8_t> dst_int8(pad_m * pad_n, 1);
+  std::vector<uint8_t> dst_uint8(pad_m * pad_n, 1);
+  std::vector<float> min(m), max(m), ratio(m);
+  shuffle::PadQuantizeShuffle2D<float, m_block, n_block>(dst_int8.data(), m, n, pad_m, pad_n, src.data(), min.data(),
+                                                         max.data(), ratio.data(), 127.0f);
+  shuffle::PadQuantizeShuffle2D<float, m_block, n_block>(dst_uint8.data(), m, n, pad_m, pad_n, src.data(), min.data(),
+                                                         max.data(), ratio.data(), 254.0f);
+  size_t x_block_num = pad_n / n_block;
+  for (size_t i = 0; i < pad_m; ++i) {
+    for (size_t j = 0; j < pad_n; ++j) {
+      size_t index = (i / m_block * x_block_num + j / n_block) * m_block * n_block + (i % m_block) * n_block +
+                     j % n_block;
+      bool inside = (i < m) && (j < n);
+      BYTES_EQUAL(inside ? static_cast<int8_t>(std::round(src[i * n + j])) : 0, dst_int8[index]);
+      BYTES_EQUAL(inside ? static_cast<uint8_t>(std::round(src[i * n + j] + 127.0f)) : 0, dst_uint8[index]);
+    }
+  }
+}
+
+TEST(Quantize, PADQuantizeShuffle2DRounding) {
+  TestPadQuantizeShuffle2DRounding<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(5, 3 * CONV_SHUFFLE_KERNEL_K + 5);
+  TestPadQuantizeShuffle2DRounding<CONV_SHUFFLE_KERNEL_M, CONV_SHUFFLE_KERNEL_K>(9, 200);
+  TestPadQuantizeShuffle2DRounding<FC_GEMV_KERNEL_M, FC_GEMV_KERNEL_K>(7, 2 * FC_GEMV_KERNEL_K + 3);
+}
+
+TEST(Quantize, PADRequantizeShuffle2DInt8) {
+  const size_t m_block = CONV_SHUFFLE_KERNEL_M;
+  const size_t n_block = CONV_SHUFFLE_KERNEL_K;
+  std::vector<std::pair<size_t, size_t>> problemset;
+  problemset.push_back(std::make_pair(8, 8));
+  problemset.push_back(std::make_pair(33, 27));
+  problemset.push_back(std::make_pair(128, 333));
+  std::vector<float> thresholds = {64.0f, 100.0f, 127.0f};
+  for (auto problem_it = problemset.begin(); problem_it < problemset.end(); ++problem_it) {
+    for (auto thres_it = thresholds.begin(); thres_it < thresholds.end(); ++thres_it) {
+      size_t m = problem_it->first;
+      size_t n = problem_it->second;
+      std::vector<int8_t> src(m * n);
+      std::generate(src.begin(), src.end(), [] { return static_cast<int8_t>(std::rand() % 255 - 127); });
+      std::vector<float> src_min(m);
+      std::vector<float> src_max(m);
+      for (size_t i = 0; i < m; ++i) {
+        src_max[i] = 0.5f + static_cast<float>(std::rand()) / RAND_MAX;
+        src_min[i] = -src_max[i] * static_cast<float>(std::rand()) / RAND_MAX;
+        // odd rows are packed at full range, so with threshold 127 they are copied as is
+        src[i * n + (i % n)] = (i % 2 == 1) ? 127 : src[i * n + (i % n)];
+      }
+      // reference: dequantize to fp32, then quantize and shuffle again
+      std::vector<float> fp_model(m * n);
+      DequantizeModel(fp_model.data(), src.data(), src_min.data(), src_max.data(), m, n, 1, 1);
+      size_t pad_m = GetAlignmentLength(m, m_block);
+      size_t pad_n = GetAlignmentLength(n, n_block);
+      std::vector<int8_t> dst_ref(pad_m * pad_n), dst(pad_m * pad_n, 1);
+      std::vector<float> min_ref(m), max_ref(m), ratio_ref(m), min(m), max(m), ratio(m);
+      shuffle::PadQuantizeShuffle2D<float, m_block, n_block>(dst_ref.data(), m, n, pad_m, pad_n, fp_model.data(),
+                                                             min_ref.data(), max_ref.data(), ratio_ref.data(),
+                                                             *thres_it);
+      shuffle::PadRequantizeShuffle2D<m_block, n_block>(dst.data(), m, n, pad_m, pad_n, src.data(), src_min.data(),
+                                                        src_max.data(), min.data(), max.data(), ratio.data(),
+                                                        *thres_it);
+      for (size_t i = 0; i < m; ++i) {
+        DOUBLES_EQUAL(min_ref[i], min[i], 1e-5);
+        DOUBLES_EQUAL(max_ref[i], max[i], 1e-5);
+        DOUBLES_EQUAL(ratio_ref[i], ratio[i], 1e-7);
+      }
+      size_t x_block_num = pad_n / n_block;
+      size_t block_size = m_block * n_block;
+      for (size_t i = 0; i < pad_m; ++i) {
+        for (size_t j = 0; j < pad_n; ++j) {
+          size_t index = (i / m_block * x_block_num + j / n_block) * block_size + (i % m_block) * n_block + j % n_block;
+          CHECK(std::abs(dst[index] - dst_ref[index]) <= 1);
+          if ((i < m) && (j < n) && (i % 2 == 1) && (*thres_it == 127.0f)) {
+            BYTES_EQUAL(src[i * n + j], dst[index]);
+          }
+          if ((i >= m) || (j >= n)) {
+            BYTES_EQUAL(0, dst[index]);
+          }
+        }
+      }
+    }
+  }
+}
+
 TEST_GROUP(Im2Col){
 
 };
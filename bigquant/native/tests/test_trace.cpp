@@ -0,0 +1,81 @@
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "bigquant.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTest/CommandLineTestRunner.h"
+
+// Traces two runs of an FC: each is one TRACE_OP of the op, spanning the phases its thread records for it.
+void TestFCTrace(size_t data_batch, size_t data_channel, size_t filter_num) {
+  std::vector<float> weight(filter_num * data_channel, 0.5f), data(data_batch * data_channel, 1.0f);
+  std::vector<float> out(data_batch * filter_num);
+  QuantizedFCOp *desc = QuantizedFCOpCreate();
+  QuantizedFCOpSetupFCParameter(desc, NCHW, filter_num, data_channel, SHUFFLE_FC);
+  QuantizedFCOpInitWeight(desc, weight.data());
+  QuantizedTraceEnable(64);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  std::vector<QuantizedTraceRecord> records(256);
+  records.resize(QuantizedTraceFetch(records.data(), records.size()));
+  CHECK(QuantizedTraceFetch(records.data(), records.size()) == 0);
+  size_t ops = 0, gemms = 0, im2cols = 0;
+  for (auto &record : records) {
+    CHECK(record.start_ns <= record.end_ns);
+    if (record.phase == TRACE_OP) {
+      CHECK(record.op == reinterpret_cast<uintptr_t>(desc));
+      ++ops;
+      continue;
+    }
+    if (record.op != reinterpret_cast<uintptr_t>(desc)) {
+      continue;
+    }
+    gemms += (record.phase == TRACE_GEMM);
+    im2cols += (record.phase == TRACE_IM2COL);
+    if (record.phase == TRACE_GEMM) {
+      CHECK(record.ops >= 2 * data_batch * data_channel * filter_num);
+    }
+    bool enclosed = false;
+    for (auto &op : records) {
+      enclosed |= op.phase == TRACE_OP && op.thread == record.thread && op.start_ns <= record.start_ns &&
+                  record.end_ns <= op.end_ns;
+    }
+    CHECK(enclosed);
+  }
+  CHECK(ops == 2);
+  CHECK(gemms == 2);
+  CHECK(im2cols == 2);
+
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  char path[] = "/tmp/bigquant_traceXXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  CHECK(QuantizedTraceExportChrome(path) == 0);
+  CHECK(QuantizedTraceFetch(records.data(), records.size()) == 0);
+  std::ifstream file(path);
+  std::string trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  unlink(path);
+  CHECK(trace.find("\"traceEvents\"") != std::string::npos);
+  CHECK(trace.find("\"name\": \"gemm\"") != std::string::npos);
+  CHECK(QuantizedTraceExportChrome("/nonexistent/trace.json") != 0);
+
+  QuantizedTraceEnable(0);
+  QuantizedFCOpExecute(desc, out.data(), data.data(), NULL, data_batch, data_channel);
+  CHECK(QuantizedTraceFetch(records.data(), records.size()) == 0);
+  QuantizedFCOpFree(desc);
+}
+
+TEST_GROUP(TRACE){
+
+};
+
+TEST(TRACE, TEST_TRACE) {
+  TestFCTrace(3, 300, 131);
+  TestFCTrace(64, 4096, 256);
+}
+
+int main(int argc, char **argv) {
+  return RUN_ALL_TESTS(argc, argv);
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2016 The BigDL Authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bigquant.h"
+#include "perf_counters.h"
+
+// Timings of the phases of ops (QuantizedTraceEnable). Each thread keeps its records in a ring of its own, so that
+// recording takes a lock only its thread and a fetch ever contend for; with tracing off a phase costs one atomic load.
+
+inline const char *TracePhaseName(uint32_t phase) {
+  switch (phase) {
+    case TRACE_OP:
+      return "op";
+    case TRACE_FIND_EXTREME:
+      return "find_extreme";
+    case TRACE_IM2COL:
+      return "im2col";
+    case TRACE_LAYOUT_TRANSFORM:
+      return "layout_transform";
+    case TRACE_GEMM:
+      return "gemm";
+    case TRACE_EPILOGUE:
+      return "epilogue";
+    default:
+      return "unknown";
+  }
+}
+
+// The records of one thread, oldest first from head_; once full the oldest is overwritten.
+struct TraceBuffer {
+  TraceBuffer(uint32_t thread, size_t capacity) : thread_(thread), records_(capacity), head_(0), size_(0) {
+  }
+
+  void Push(QuantizedTraceRecord &record) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (records_.empty()) {
+      return;
+    }
+    record.thread = thread_;
+    records_[(head_ + size_) % records_.size()] = record;
+    if (size_ < records_.size()) {
+      ++size_;
+    } else {
+      head_ = (head_ + 1) % records_.size();
+    }
+  }
+
+  // Moves up to count of the oldest records to records; returns how many.
+  size_t Pop(QuantizedTraceRecord *records, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count = std::min(count, size_);
+    for (size_t i = 0; i < count; ++i) {
+      records[i] = records_[(head_ + i) % records_.size()];
+    }
+    head_ = (count == 0) ? head_ : (head_ + count) % records_.size();
+    size_ -= count;
+    return count;
+  }
+
+  size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  void Reset(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.assign(capacity, QuantizedTraceRecord());
+    head_ = 0;
+    size_ = 0;
+  }
+
+  const uint32_t thread_;
+
+ private:
+  std::mutex mutex_;
+  std::vector<QuantizedTraceRecord> records_;
+  size_t head_;
+  size_t size_;
+};
+
+struct Tracer {
+  static Tracer &Instance() {
+    // never destroyed, threads may record while the process exits
+    static Tracer *tracer = new Tracer();
+    return *tracer;
+  }
+
+  bool Enabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Nanoseconds since the tracer was first used.
+  uint64_t Now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count();
+  }
+
+  // records_per_thread records per thread from now on, 0 stops tracing; drops the records so far.
+  void Enable(size_t records_per_thread) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = records_per_thread;
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      buffers_[i]->Reset(capacity_);
+    }
+    RemoveRetired();
+    enabled_.store(capacity_ > 0);
+  }
+
+  void Record(uint64_t op, TRACE_PHASE phase, uint64_t start, uint64_t end, uint64_t bytes, uint64_t ops) {
+    QuantizedTraceRecord record = {op, static_cast<uint32_t>(phase), 0, start, end, bytes, ops};
+    LocalBuffer()->Push(record);
+  }
+
+  // Moves up to count records to records, those of one thread after the other and oldest first; returns how many.
+  size_t Fetch(QuantizedTraceRecord *records, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t fetched = 0;
+    for (size_t i = 0; i < buffers_.size() && fetched < count; ++i) {
+      fetched += buffers_[i]->Pop(records + fetched, count - fetched);
+    }
+    RemoveRetired();
+    return fetched;
+  }
+
+  size_t Pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t pending = 0;
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      pending += buffers_[i]->Size();
+    }
+    return pending;
+  }
+
+  void Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      buffers_[i]->Reset(capacity_);
+    }
+    RemoveRetired();
+  }
+
+  // Moves the records there are now to a Chrome trace (chrome://tracing, Perfetto) at path. Returns 0 on success.
+  int ExportChrome(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+      fprintf(stderr, "Cannot write %s.\n", path);
+      return -1;
+    }
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    QuantizedTraceRecord records[256];
+    size_t written = 0;
+    for (size_t pending = Pending(); pending > 0;) {
+      size_t fetched = Fetch(records, std::min(pending, sizeof(records) / sizeof(records[0])));
+      if (fetched == 0) {
+        break;
+      }
+      for (size_t i = 0; i < fetched; ++i, ++written) {
+        const QuantizedTraceRecord &record = records[i];
+        fprintf(file,
+                "%s\n  {\"name\": \"%s\", \"cat\": \"bigquant\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, "
+                "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"op\": \"0x%" PRIx64 "\", \"bytes\": %" PRIu64
+                ", \"ops\": %" PRIu64 "}}",
+                (written == 0) ? "" : ",", TracePhaseName(record.phase), record.thread, record.start_ns / 1e3,
+                (record.end_ns - record.start_ns) / 1e3, record.op, record.bytes, record.ops);
+      }
+      pending -= fetched;
+    }
+    fprintf(file, "\n]}\n");
+    return (fclose(file) == 0) ? 0 : -1;
+  }
+
+ private:
+  // Hands the buffer of an exiting thread back, to be deleted once its records are fetched.
+  struct BufferOwner {
+    BufferOwner() : buffer_(NULL) {
+    }
+
+    ~BufferOwner() {
+      if (buffer_ != NULL) {
+        Tracer::Instance().Retire(buffer_);
+      }
+    }
+
+    TraceBuffer *buffer_;
+  };
+
+  Tracer() : enabled_(false), epoch_(std::chrono::steady_clock::now()), capacity_(0), next_thread_(0) {
+  }
+
+  TraceBuffer *LocalBuffer() {
+    static thread_local BufferOwner owner;
+    if (owner.buffer_ == NULL) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      buffers_.emplace_back(new TraceBuffer(next_thread_++, capacity_));
+      owner.buffer_ = buffers_.back().get();
+    }
+    return owner.buffer_;
+  }
+
+  void Retire(TraceBuffer *buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired_.push_back(buffer);
+    RemoveRetired();
+  }
+
+  // mutex_ held
+  void RemoveRetired() {
+    for (size_t r = 0; r < retired_.size();) {
+      if (retired_[r]->Size() > 0) {
+        ++r;
+        continue;
+      }
+      for (size_t i = 0; i < buffers_.size(); ++i) {
+        if (buffers_[i].get() == retired_[r]) {
+          buffers_.erase(buffers_.begin() + i);
+          break;
+        }
+      }
+      retired_.erase(retired_.begin() + r);
+    }
+  }
+
+  std::atomic<bool> enabled_;
+  const std::chrono::steady_clock::time_point epoch_;
+  std::mutex mutex_;
+  size_t capacity_;
+  uint32_t next_thread_;
+  std::vector<std::unique_ptr<TraceBuffer> > buffers_;
+  std::vector<TraceBuffer *> retired_;
+};
+
+// The op the calling thread executes, 0 outside of one.
+inline uint64_t &TraceOp() {
+  static thread_local uint64_t op = 0;
+  return op;
+}
+
+// Records the enclosing block as one phase of the op the thread executes, and adds up its counters when counting.
+struct TraceScope {
+  TraceScope(TRACE_PHASE phase, uint64_t bytes, uint64_t ops)
+      : phase_(phase),
+        bytes_(bytes),
+        ops_(ops),
+        active_(Tracer::Instance().Enabled()),
+        counting_(PerfCounters::Instance().Enabled()),
+        counts_(CurrentPerfPhase()) {
+    start_ = active_ ? Tracer::Instance().Now() : 0;
+    if (counting_) {
+      PerfCounters::Instance().Begin(counts_, counters_);
+    }
+  }
+
+  ~TraceScope() {
+    if (counting_) {
+      PerfCounters::Instance().End(TraceOp(), phase_, counts_, counters_);
+    }
+    if (active_) {
+      Tracer::Instance().Record(TraceOp(), phase_, start_, Tracer::Instance().Now(), bytes_, ops_);
+    }
+  }
+
+  TRACE_PHASE phase_;
+  uint64_t bytes_;
+  uint64_t ops_;
+  bool active_;
+  bool counting_;
+  uint64_t start_;
+  PerfPhaseCounts counts_;
+  uint64_t counters_[PERF_COUNTERS_NUM];
+};
+
+// Attributes the phases the calling thread records to op until the end of the block, which is recorded as a TRACE_OP.
+struct TraceOpScope {
+  explicit TraceOpScope(const void *op)
+      : previous_(TraceOp()),
+        active_(Tracer::Instance().Enabled()),
+        counting_(PerfCounters::Instance().Enabled()),
+        counts_(CurrentPerfPhase()) {
+    TraceOp() = reinterpret_cast<uintptr_t>(op);
+    start_ = active_ ? Tracer::Instance().Now() : 0;
+    if (counting_) {
+      PerfCounters::Instance().Begin(counts_, counters_);
+    }
+  }
+
+  ~TraceOpScope() {
+    if (counting_) {
+      PerfCounters::Instance().End(TraceOp(), TRACE_OP, counts_, counters_);
+    }
+    if (active_) {
+      Tracer::Instance().Record(TraceOp(), TRACE_OP, start_, Tracer::Instance().Now(), 0, 0);
+    }
+    TraceOp() = previous_;
+  }
+
+  uint64_t previous_;
+  bool active_;
+  bool counting_;
+  uint64_t start_;
+  PerfPhaseCounts counts_;
+  uint64_t counters_[PERF_COUNTERS_NUM];
+};
+
+#endif
@@ -22,9 +22,29 @@
 typedef enum LAYOUT { NCHW = 0, NHWC = 1 } LAYOUT;
 typedef enum CONV_ALGORITHM {
   AUTO_SELECT_CONV = 0,
-  SHUFFLE_CONV = 1
+  SHUFFLE_CONV = 1,
+  WINOGRAD_CONV = 2,
+  DEPTHWISE_CONV = 3
 } CONV_ALGORITHM;
 typedef enum FC_ALGORITHM { AUTO_SELECT_FC = 0, SHUFFLE_FC = 1 } FC_ALGORITHM;
+typedef enum ACTIVATION_FORMAT {
+  FLOAT_ACTIVATION = 0,
+  UINT8_ACTIVATION = 1,
+  SHUFFLED_UINT8_ACTIVATION = 2
+} ACTIVATION_FORMAT;
+typedef enum ALLOCATOR_KIND {
+  DEFAULT_ALLOCATOR = 0,
+  HUGE_PAGE_ALLOCATOR = 1,
+  ARENA_ALLOCATOR = 2
+} ALLOCATOR_KIND;
+typedef enum TRACE_PHASE {
+  TRACE_OP = 0,
+  TRACE_FIND_EXTREME = 1,
+  TRACE_IM2COL = 2,
+  TRACE_LAYOUT_TRANSFORM = 3,
+  TRACE_GEMM = 4,
+  TRACE_EPILOGUE = 5
+} TRACE_PHASE;
 
 struct FPTensorDesc {
   void *data;
@@ -51,6 +71,41 @@ typedef struct QuantizedConvOp QuantizedConvOp;
 struct QuantizedFCOp;
 typedef struct QuantizedFCOp QuantizedFCOp;
 
+struct QuantizedExecutionContext;
+typedef struct QuantizedExecutionContext QuantizedExecutionContext;
+
+struct QuantizedAllocator;
+typedef struct QuantizedAllocator QuantizedAllocator;
+
+typedef struct QuantizedAllocatorStats {
+  size_t live_bytes;
+  size_t peak_bytes;
+  size_t allocations;
+  size_t live_allocations;
+} QuantizedAllocatorStats;
+
+typedef struct QuantizedTraceRecord {
+  uint64_t op;
+  uint32_t phase;
+  uint32_t thread;
+  uint64_t start_ns;
+  uint64_t end_ns;
+  uint64_t bytes;
+  uint64_t ops;
+} QuantizedTraceRecord;
+
+typedef struct QuantizedPerfCounterRecord {
+  uint64_t op;
+  uint32_t phase;
+  uint32_t calls;
+  uint64_t cpu_ns;
+  uint64_t cycles;
+  uint64_t instructions;
+  uint64_t llc_misses;
+  uint64_t l1d_misses;
+  uint64_t dtlb_misses;
+} QuantizedPerfCounterRecord;
+
 #ifdef WINDOWS
 #define API_PREFIX __declspec(dllexport)
 #else
@@ -170,6 +225,43 @@ API_PREFIX void FreeFPTensor(struct FPTensorDesc *p);
 
 API_PREFIX void FreeQuantizedTensor(struct QuantizedTensorDesc *p);
 
+API_PREFIX QuantizedExecutionContext *
+QuantizedExecutionContextCreate(size_t threads_num, const int *cpus,
+                                size_t cpus_num);
+
+API_PREFIX void
+QuantizedBindExecutionContext(QuantizedExecutionContext *context);
+
+API_PREFIX void
+QuantizedExecutionContextFree(QuantizedExecutionContext *context);
+
+API_PREFIX QuantizedAllocator *QuantizedAllocatorCreate(ALLOCATOR_KIND kind);
+
+API_PREFIX void QuantizedSetAllocator(QuantizedAllocator *allocator);
+
+API_PREFIX void QuantizedBindAllocator(QuantizedAllocator *allocator);
+
+API_PREFIX void QuantizedGetAllocatorStats(QuantizedAllocator *allocator,
+                                           QuantizedAllocatorStats *stats);
+
+API_PREFIX void QuantizedAllocatorFree(QuantizedAllocator *allocator);
+
+API_PREFIX void QuantizedTraceEnable(size_t records_per_thread);
+
+API_PREFIX size_t QuantizedTraceFetch(QuantizedTraceRecord *records,
+                                      size_t capacity);
+
+API_PREFIX void QuantizedTraceFlush();
+
+API_PREFIX int QuantizedTraceExportChrome(const char *path);
+
+API_PREFIX int QuantizedPerfCountersEnable(int enable);
+
+API_PREFIX size_t QuantizedPerfCountersFetch(
+    QuantizedPerfCounterRecord *records, size_t capacity);
+
+API_PREFIX void QuantizedPerfCountersReset();
+
 #ifdef __cplusplus
 }
 #endif
@@ -158,6 +158,141 @@ Java_com_intel_analytics_bigdl_bigquant_BigQuant_FCDataInit(JNIEnv *, jclass,
                                                             jint, jint, jint,
                                                             jfloat, jint);
 
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    ExecutionContextCreate
+ * Signature: (I[I)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_ExecutionContextCreate(
+    JNIEnv *, jclass, jint, jintArray);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    BindExecutionContext
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_BindExecutionContext(
+    JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    ExecutionContextFree
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_ExecutionContextFree(
+    JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    AllocatorCreate
+ * Signature: (I)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_AllocatorCreate(
+    JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    SetAllocator
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_SetAllocator(
+    JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    BindAllocator
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_BindAllocator(
+    JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    AllocatorStats
+ * Signature: (J)[J
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_AllocatorStats(
+    JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    AllocatorFree
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_AllocatorFree(
+    JNIEnv *, jclass, jlong);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceEnable
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceEnable(
+    JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceFetch
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceFetch(
+    JNIEnv *, jclass);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceFlush
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceFlush(
+    JNIEnv *, jclass);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceExportChrome
+ * Signature: (Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceExportChrome(
+    JNIEnv *, jclass, jstring);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    PerfCountersEnable
+ * Signature: (I)I
+ */
+JNIEXPORT jint JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_PerfCountersEnable(
+    JNIEnv *, jclass, jint);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    PerfCountersFetch
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_PerfCountersFetch(
+    JNIEnv *, jclass);
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    PerfCountersReset
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_PerfCountersReset(
+    JNIEnv *, jclass);
+
 #ifdef __cplusplus
 }
 #endif
@@ -282,6 +282,251 @@ Java_com_intel_analytics_bigdl_bigquant_BigQuant_FCDataInit(
   (*env)->ReleasePrimitiveArrayCritical(env, src, jni_src, 0);
 }
 
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    ExecutionContextCreate
+ * Signature: (I[I)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_ExecutionContextCreate(
+    JNIEnv *env, jclass cls, jint threads_num, jintArray cpus)
+{
+  if (cpus == NULL) {
+    return (jlong)QuantizedExecutionContextCreate(threads_num, NULL, 0);
+  }
+  jsize cpus_num = (*env)->GetArrayLength(env, cpus);
+  jint *jni_cpus = (*env)->GetIntArrayElements(env, cpus, JNI_FALSE);
+  QuantizedExecutionContext *context =
+      QuantizedExecutionContextCreate(threads_num, jni_cpus, cpus_num);
+  (*env)->ReleaseIntArrayElements(env, cpus, jni_cpus, JNI_ABORT);
+  return (jlong)context;
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    BindExecutionContext
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_BindExecutionContext(
+    JNIEnv *env, jclass cls, jlong context)
+{
+  QuantizedBindExecutionContext((QuantizedExecutionContext *)context);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    ExecutionContextFree
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_ExecutionContextFree(
+    JNIEnv *env, jclass cls, jlong context)
+{
+  QuantizedExecutionContextFree((QuantizedExecutionContext *)context);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    AllocatorCreate
+ * Signature: (I)J
+ */
+JNIEXPORT jlong JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_AllocatorCreate(JNIEnv *env,
+                                                                 jclass cls,
+                                                                 jint kind)
+{
+  return (jlong)QuantizedAllocatorCreate(kind);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    SetAllocator
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_SetAllocator(JNIEnv *env,
+                                                              jclass cls,
+                                                              jlong allocator)
+{
+  QuantizedSetAllocator((QuantizedAllocator *)allocator);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    BindAllocator
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_BindAllocator(JNIEnv *env,
+                                                               jclass cls,
+                                                               jlong allocator)
+{
+  QuantizedBindAllocator((QuantizedAllocator *)allocator);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    AllocatorStats
+ * Signature: (J)[J
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_AllocatorStats(
+    JNIEnv *env, jclass cls, jlong allocator)
+{
+  QuantizedAllocatorStats stats;
+  QuantizedGetAllocatorStats((QuantizedAllocator *)allocator, &stats);
+  jlong values[4] = {stats.live_bytes, stats.peak_bytes, stats.allocations,
+                     stats.live_allocations};
+  jlongArray result = (*env)->NewLongArray(env, 4);
+  if (result != NULL) {
+    (*env)->SetLongArrayRegion(env, result, 0, 4, values);
+  }
+  return result;
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    AllocatorFree
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_AllocatorFree(JNIEnv *env,
+                                                               jclass cls,
+                                                               jlong allocator)
+{
+  QuantizedAllocatorFree((QuantizedAllocator *)allocator);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceEnable
+ * Signature: (I)V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceEnable(
+    JNIEnv *env, jclass cls, jint records_per_thread)
+{
+  QuantizedTraceEnable(records_per_thread);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceFetch
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceFetch(JNIEnv *env,
+                                                            jclass cls)
+{
+  size_t capacity = 1024, count = 0;
+  QuantizedTraceRecord *records = NULL;
+  for (;;) {
+    QuantizedTraceRecord *grown =
+        realloc(records, capacity * sizeof(QuantizedTraceRecord));
+    if (grown == NULL) {
+      free(records);
+      return NULL;
+    }
+    records = grown;
+    count += QuantizedTraceFetch(records + count, capacity - count);
+    if (count < capacity) {
+      break;
+    }
+    capacity *= 2;
+  }
+  jlongArray result = (*env)->NewLongArray(env, count * 7);
+  for (size_t i = 0; result != NULL && i < count; ++i) {
+    jlong values[7] = {records[i].op,     records[i].phase,
+                       records[i].thread, records[i].start_ns,
+                       records[i].end_ns, records[i].bytes,
+                       records[i].ops};
+    (*env)->SetLongArrayRegion(env, result, i * 7, 7, values);
+  }
+  free(records);
+  return result;
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceFlush
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceFlush(JNIEnv *env,
+                                                            jclass cls)
+{
+  QuantizedTraceFlush();
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    TraceExportChrome
+ * Signature: (Ljava/lang/String;)I
+ */
+JNIEXPORT jint JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_TraceExportChrome(
+    JNIEnv *env, jclass cls, jstring path)
+{
+  const char *jPath = (*env)->GetStringUTFChars(env, path, 0);
+  jint ret = QuantizedTraceExportChrome(jPath);
+  (*env)->ReleaseStringUTFChars(env, path, jPath);
+  return ret;
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    PerfCountersEnable
+ * Signature: (I)I
+ */
+JNIEXPORT jint JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_PerfCountersEnable(
+    JNIEnv *env, jclass cls, jint enable)
+{
+  return QuantizedPerfCountersEnable(enable);
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    PerfCountersFetch
+ * Signature: ()[J
+ */
+JNIEXPORT jlongArray JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_PerfCountersFetch(
+    JNIEnv *env, jclass cls)
+{
+  size_t count = QuantizedPerfCountersFetch(NULL, 0);
+  QuantizedPerfCounterRecord *records =
+      malloc((count + 1) * sizeof(QuantizedPerfCounterRecord));
+  if (records == NULL) {
+    return NULL;
+  }
+  count = QuantizedPerfCountersFetch(records, count);
+  jlongArray result = (*env)->NewLongArray(env, count * 9);
+  for (size_t i = 0; result != NULL && i < count; ++i) {
+    jlong values[9] = {records[i].op,         records[i].phase,
+                       records[i].calls,      records[i].cpu_ns,
+                       records[i].cycles,     records[i].instructions,
+                       records[i].llc_misses, records[i].l1d_misses,
+                       records[i].dtlb_misses};
+    (*env)->SetLongArrayRegion(env, result, i * 9, 9, values);
+  }
+  free(records);
+  return result;
+}
+
+/*
+ * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
+ * Method:    PerfCountersReset
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL
+Java_com_intel_analytics_bigdl_bigquant_BigQuant_PerfCountersReset(
+    JNIEnv *env, jclass cls)
+{
+  QuantizedPerfCountersReset();
+}
+
 /*
  * Class:     com_intel_analytics_bigdl_bigquant_BigQuant
  * Method:    loadRuntime
@@ -142,4 +142,51 @@ public class BigQuant {
                                          int channel,
                                          float threshold,
                                          int layout);
+
+    // A slice of the machine for one model instance: threadsNum threads (0: one per CPU of cpus) that run on cpus
+    // only (null: on any CPU). Returns 0 for an invalid CPU.
+    public native static long ExecutionContextCreate(int threadsNum, int[] cpus);
+
+    // Runs every call of the current thread in context until the next call; 0 unbinds the thread.
+    public native static void BindExecutionContext(long context);
+
+    public native static void ExecutionContextFree(long context);
+
+    // Memory of tensors and workspaces: kind 0 default, 1 transparent huge pages for blocks of 2 MB and more, 2 an
+    // arena of huge page chunks for the memory of one model. Returns 0 for an unknown kind.
+    public native static long AllocatorCreate(int kind);
+
+    // Allocates all later memory of the process from allocator; 0 restores the default allocator.
+    public native static void SetAllocator(long allocator);
+
+    // Allocates the memory of the current thread from allocator until the next call; 0 unbinds the thread.
+    public native static void BindAllocator(long allocator);
+
+    // {live bytes, peak bytes, allocations, live allocations} of allocator, or of the whole process for 0.
+    public native static long[] AllocatorStats(long allocator);
+
+    public native static void AllocatorFree(long allocator);
+
+    // Records the im2col, layout transform, GEMM and epilogue phases of every op in a ring of recordsPerThread
+    // records per thread; 0 stops tracing. Drops the records so far.
+    public native static void TraceEnable(int recordsPerThread);
+
+    // The records so far, 7 values each: {op, phase, thread, start ns, end ns, bytes, ops}.
+    public native static long[] TraceFetch();
+
+    public native static void TraceFlush();
+
+    // Writes the records so far to a Chrome trace at path, for chrome://tracing or Perfetto. Returns 0 on success.
+    public native static int TraceExportChrome(String path);
+
+    // Sums the CPU time, cycles, instructions and LLC, L1D and dTLB read misses of every phase of every op, over the
+    // thread running it and the workers of its loops, with enable 1; 0 stops. Returns -1 if perf_event_open cannot
+    // count anything on this host.
+    public native static int PerfCountersEnable(int enable);
+
+    // The totals so far per op and phase, 9 values each: {op, phase, calls, cpu ns, cycles, instructions, LLC misses,
+    // L1D misses, dTLB misses}. -1 stands for a counter the host cannot count.
+    public native static long[] PerfCountersFetch();
+
+    public native static void PerfCountersReset();
 }